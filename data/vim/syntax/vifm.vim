@@ -106,13 +106,16 @@ syntax keyword vifmHiColors contained black red green yellow blue magenta cyan
 syntax case match
 
 " Options
-syntax keyword vifmOption contained aproposprg autochpos cdpath cd chaselinks
-		\ classify columns co confirm cf cpoptions cpo dotdirs fastrun fillchars fcs
-		\ findprg followlinks fusehome gdefault grepprg history hi hlsearch hls iec
-		\ ignorecase ic incsearch is laststatus lines locateprg ls lsview
+syntax keyword vifmOption contained aproposprg autochpos bgthreads cdpath cd
+		\ chaselinks classify columns co confirm cf copythreads cpoptions cpo
+		\ dotdirs fastrun fillchars fcs findprg followlinks fusehome gdefault
+		\ grepprg history hi hlsearch hls iec
+		\ ignorecase ic incsearch is iobandwidth iofilerate laststatus lines
+		\ locateprg ls lsview
 		\ mintimeoutlen number nu numberwidth nuw relativenumber rnu rulerformat ruf
 		\ runexec scrollbind scb scrolloff so sort sortorder shell sh shortmess shm
-		\ slowfs smartcase scs sortnumbers statusline stl syscalls tabstop timefmt
+		\ slowfs smartcase scs sortnumbers statthreads statusline stl syscalls
+		\ tabstop timefmt
 		\ timeoutlen tm trash trashdir ts tuioptions to undolevels ul vicmd
 		\ viewcolumns vifminfo vimhelp vixcmd wildmenu wmnu wordchars wrap wrapscan
 		\ ws
@@ -31,6 +31,7 @@
 #include <assert.h> /* assert() */
 #include <errno.h> /* errno */
 #include <stddef.h> /* wchar_t NULL */
+#include <stdint.h> /* uint64_t */
 #include <stdlib.h> /* free() malloc() */
 #include <string.h>
 #include <sys/stat.h> /* O_RDONLY */
@@ -42,6 +43,7 @@
 #endif
 
 #include "cfg/config.h"
+#include "io/iolimit.h"
 #include "modes/dialogs/msg_dialog.h"
 #include "ui/cancellation.h"
 #include "ui/statusline.h"
@@ -88,15 +90,27 @@
 #endif
 
 /* Structure with passed to background_task_bootstrap() so it can perform
- * correct initialization/cleanup. */
-typedef struct
+ * correct initialization/cleanup.  Also serves as an element of queues of
+ * pending and running tasks. */
+typedef struct background_task_args
 {
 	bg_task_func func; /* Function to execute in a background thread. */
 	void *args;        /* Argument to pass. */
 	job_t *job;        /* Job identifier that corresponds to the task. */
+	uint64_t group;    /* Tasks of the same non-zero group don't run together. */
+
+	struct background_task_args *next; /* Next task in the same list. */
 }
 background_task_args;
 
+/* List of tasks with fast insertion at the end. */
+typedef struct
+{
+	background_task_args *head; /* First element of the list. */
+	background_task_args *tail; /* Last element of the list. */
+}
+task_list_t;
+
 static void job_check(job_t *const job);
 static void job_free(job_t *const job);
 #ifndef _WIN32
@@ -106,15 +120,36 @@ static job_t * add_background_job(pid_t pid, const char cmd[], int fd,
 static job_t * add_background_job(pid_t pid, const char cmd[], HANDLE hprocess,
 		BgJobType type);
 #endif
-static void * background_task_bootstrap(void *arg);
+static void * worker_thread(void *arg);
+static background_task_args * take_task(void);
+static int get_thread_limit(void);
+static int can_run_task(const background_task_args *task);
+static void list_append(task_list_t *list, background_task_args *task);
+static void list_remove(task_list_t *list, background_task_args *task);
+static void background_task_bootstrap(background_task_args *task_args);
 static void set_current_job(job_t *job);
 static void make_current_job_key(void);
+static void make_shared_io_limit(void);
 
 job_t *jobs;
 
 static pthread_key_t current_job;
 static pthread_once_t current_job_once = PTHREAD_ONCE_INIT;
 
+/* Limiter of I/O rate shared by all background operations. */
+static iolimit_t *shared_io_limit;
+static pthread_once_t shared_io_limit_once = PTHREAD_ONCE_INIT;
+
+/* State of worker threads, protected by sched_lock. */
+static pthread_mutex_t sched_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sched_cond = PTHREAD_COND_INITIALIZER;
+static task_list_t queued_ops;     /* Operations waiting for a thread. */
+static task_list_t queued_tasks;   /* Tasks waiting for a thread. */
+static task_list_t running;        /* Operations and tasks being executed. */
+static int nworkers;               /* Number of started threads. */
+static int nidle;                  /* Number of threads waiting for work. */
+static int nrunning_tasks;         /* Number of tasks in the running list. */
+
 void
 init_background(void)
 {
@@ -264,7 +299,7 @@ job_free(job_t *const job)
 		return;
 	}
 
-	if(job->type == BJT_COMMAND)
+	if(job->type != BJT_COMMAND)
 	{
 		pthread_mutex_destroy(&job->bg_op_guard);
 	}
@@ -280,6 +315,8 @@ job_free(job_t *const job)
 		CloseHandle(job->hprocess);
 	}
 #endif
+	iolimit_free(job->bg_op.limit);
+	free(job->bg_op.descr);
 	free(job->cmd);
 	free(job);
 }
@@ -742,8 +779,13 @@ int
 bg_execute(const char desc[], int total, int important, bg_task_func task_func,
 		void *args)
 {
-	pthread_t id;
+	return bg_execute_grouped(desc, total, important, 0U, task_func, args);
+}
 
+int
+bg_execute_grouped(const char desc[], int total, int important,
+		uint64_t group, bg_task_func task_func, void *args)
+{
 	background_task_args *const task_args = malloc(sizeof(*task_args));
 	if(task_args == NULL)
 	{
@@ -752,6 +794,8 @@ bg_execute(const char desc[], int total, int important, bg_task_func task_func,
 
 	task_args->func = task_func;
 	task_args->args = args;
+	task_args->group = important ? 0U : group;
+	task_args->next = NULL;
 	task_args->job = add_background_job(WRONG_PID, desc, NO_JOB_ID,
 			important ? BJT_OPERATION : BJT_TASK);
 
@@ -767,20 +811,221 @@ bg_execute(const char desc[], int total, int important, bg_task_func task_func,
 	}
 
 	task_args->job->bg_op.total = total;
+	task_args->job->queued = 1;
+
+	pthread_mutex_lock(&sched_lock);
 
-	if(pthread_create(&id, NULL, &background_task_bootstrap, task_args) != 0)
+	list_append(task_args->job->type == BJT_OPERATION ? &queued_ops
+	                                                   : &queued_tasks, task_args);
+
+	/* Start new thread only if existing ones are busy. */
+	if(nidle == 0 && nworkers < get_thread_limit())
 	{
-		/* Mark job as finished with error. */
-		task_args->job->running = 0;
-		task_args->job->exit_code = 1;
+		pthread_attr_t attr;
+		pthread_t id;
+		int error;
 
-		free(task_args);
-		return 3;
+		pthread_attr_init(&attr);
+		pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+		error = pthread_create(&id, &attr, &worker_thread, NULL);
+		pthread_attr_destroy(&attr);
+
+		if(error == 0)
+		{
+			++nworkers;
+		}
+		else if(nworkers == 0)
+		{
+			/* Nobody will ever process the task. */
+			list_remove(task_args->job->type == BJT_OPERATION ? &queued_ops
+			                                                   : &queued_tasks,
+					task_args);
+			pthread_mutex_unlock(&sched_lock);
+
+			/* Mark job as finished with error. */
+			task_args->job->running = 0;
+			task_args->job->exit_code = 1;
+
+			free(task_args);
+			return 3;
+		}
 	}
 
+	pthread_cond_broadcast(&sched_cond);
+	pthread_mutex_unlock(&sched_lock);
+
 	return 0;
 }
 
+/* Entry point of a background thread, which executes queued operations and
+ * tasks until there are too many threads.  Returns NULL. */
+static void *
+worker_thread(void *arg)
+{
+	pthread_mutex_lock(&sched_lock);
+	while(1)
+	{
+		background_task_args *const task_args = take_task();
+		if(task_args == NULL)
+		{
+			if(nworkers > get_thread_limit())
+			{
+				/* Limit was lowered, exit. */
+				break;
+			}
+
+			++nidle;
+			pthread_cond_wait(&sched_cond, &sched_lock);
+			--nidle;
+			continue;
+		}
+
+		pthread_mutex_unlock(&sched_lock);
+		background_task_bootstrap(task_args);
+		pthread_mutex_lock(&sched_lock);
+
+		list_remove(&running, task_args);
+		if(task_args->job->type == BJT_TASK)
+		{
+			--nrunning_tasks;
+		}
+		/* This must be the last access of the job. */
+		task_args->job->running = 0;
+		free(task_args);
+
+		/* Finished task might have been blocking others. */
+		pthread_cond_broadcast(&sched_cond);
+	}
+	--nworkers;
+	pthread_mutex_unlock(&sched_lock);
+
+	return NULL;
+}
+
+/* Picks next operation or task to run and moves it to the list of running ones.
+ * Must be called with sched_lock held.  Returns the task or NULL if there is
+ * nothing to run. */
+static background_task_args *
+take_task(void)
+{
+	background_task_args *task = queued_ops.head;
+
+	if(task != NULL)
+	{
+		list_remove(&queued_ops, task);
+	}
+	else
+	{
+		/* Don't let tasks occupy the last thread, there might be operations. */
+		const int limit = get_thread_limit();
+		const int max_tasks = (limit > 1) ? limit - 1 : 1;
+		if(nrunning_tasks >= max_tasks)
+		{
+			return NULL;
+		}
+
+		for(task = queued_tasks.head; task != NULL; task = task->next)
+		{
+			if(can_run_task(task))
+			{
+				list_remove(&queued_tasks, task);
+				++nrunning_tasks;
+				break;
+			}
+		}
+
+		if(task == NULL)
+		{
+			return NULL;
+		}
+	}
+
+	task->job->queued = 0;
+	list_append(&running, task);
+	return task;
+}
+
+/* Retrieves maximum number of worker threads.  Returns the number. */
+static int
+get_thread_limit(void)
+{
+	return (cfg.bg_threads > 0) ? cfg.bg_threads : 1;
+}
+
+/* Checks whether task can be run right now, which isn't the case when a task
+ * of the same group is running.  Returns non-zero if so, otherwise zero is
+ * returned. */
+static int
+can_run_task(const background_task_args *task)
+{
+	const background_task_args *other;
+
+	if(task->group == 0U)
+	{
+		return 1;
+	}
+
+	for(other = running.head; other != NULL; other = other->next)
+	{
+		if(other->group == task->group)
+		{
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/* Appends task to the end of the list. */
+static void
+list_append(task_list_t *list, background_task_args *task)
+{
+	task->next = NULL;
+	if(list->tail == NULL)
+	{
+		list->head = task;
+	}
+	else
+	{
+		list->tail->next = task;
+	}
+	list->tail = task;
+}
+
+/* Removes task from the list. */
+static void
+list_remove(task_list_t *list, background_task_args *task)
+{
+	background_task_args *prev = NULL;
+	background_task_args *p = list->head;
+
+	while(p != NULL && p != task)
+	{
+		prev = p;
+		p = p->next;
+	}
+
+	if(p == NULL)
+	{
+		return;
+	}
+
+	if(prev == NULL)
+	{
+		list->head = task->next;
+	}
+	else
+	{
+		prev->next = task->next;
+	}
+
+	if(list->tail == task)
+	{
+		list->tail = prev;
+	}
+
+	task->next = NULL;
+}
+
 /* Creates structure that describes background job and registers it in the list
  * of jobs. */
 #ifndef _WIN32
@@ -809,6 +1054,7 @@ add_background_job(pid_t pid, const char cmd[], HANDLE hprocess, BgJobType type)
 #endif
 	new->skip_errors = 0;
 	new->running = 1;
+	new->queued = 0;
 	new->error = NULL;
 
 	if(type != BJT_COMMAND)
@@ -819,30 +1065,28 @@ add_background_job(pid_t pid, const char cmd[], HANDLE hprocess, BgJobType type)
 	new->bg_op.done = 0;
 	new->bg_op.progress = -1;
 	new->bg_op.descr = NULL;
+	new->bg_op.cancelled = 0;
+	new->bg_op.cancellable = 0;
+	new->bg_op.limit = (type == BJT_OPERATION) ? iolimit_alloc() : NULL;
 
 	jobs = new;
 	return new;
 }
 
-/* Pthreads entry point for a new background task.  Performs correct
- * startup/exit with related updates of internal data structures.  Returns
- * result for this thread. */
-static void *
-background_task_bootstrap(void *arg)
+/* Runs background task on a worker thread.  Performs correct startup/exit
+ * with related updates of internal data structures. */
+static void
+background_task_bootstrap(background_task_args *task_args)
 {
-	background_task_args *const task_args = arg;
-
 	set_current_job(task_args->job);
 
 	task_args->func(&task_args->job->bg_op, task_args->args);
 
-	/* Mark task as finished normally. */
-	task_args->job->running = 0;
-	task_args->job->exit_code = 0;
-
-	free(task_args);
+	set_current_job(NULL);
 
-	return NULL;
+	/* The job is marked as finished by the worker thread, after which the job
+	 * can be freed at any moment. */
+	task_args->job->exit_code = 0;
 }
 
 /* Stores pointer to the job in a thread-local storage. */
@@ -924,5 +1168,84 @@ bg_op_changed(bg_op_t *bg_op)
 	ui_stat_job_bar_changed(bg_op);
 }
 
+void
+bg_op_cancel(bg_op_t *bg_op)
+{
+	bg_op_lock(bg_op);
+	bg_op->cancelled = 1;
+	bg_op_unlock(bg_op);
+}
+
+void
+bg_op_set_cancellable(bg_op_t *bg_op)
+{
+	bg_op_lock(bg_op);
+	bg_op->cancellable = 1;
+	bg_op_unlock(bg_op);
+}
+
+int
+bg_job_cancel(job_t *job)
+{
+	int cancellable;
+
+	if(job->type == BJT_COMMAND)
+	{
+		return 1;
+	}
+
+	/* Queued jobs check for cancellation on start, so they are always
+	 * cancellable. */
+	pthread_mutex_lock(&sched_lock);
+	bg_op_lock(&job->bg_op);
+	cancellable = job->queued || job->bg_op.cancellable;
+	bg_op_unlock(&job->bg_op);
+	pthread_mutex_unlock(&sched_lock);
+
+	if(!cancellable)
+	{
+		return 1;
+	}
+
+	bg_op_cancel(&job->bg_op);
+	return 0;
+}
+
+int
+bg_op_cancelled(bg_op_t *bg_op)
+{
+	int cancelled;
+
+	bg_op_lock(bg_op);
+	cancelled = bg_op->cancelled;
+	bg_op_unlock(bg_op);
+
+	return cancelled;
+}
+
+void
+bg_set_shared_io_limit(uint64_t bytes_rate, uint64_t files_rate)
+{
+	iolimit_t *const limit = bg_get_shared_io_limit();
+	if(limit != NULL)
+	{
+		iolimit_set(limit, bytes_rate, files_rate);
+	}
+}
+
+iolimit_t *
+bg_get_shared_io_limit(void)
+{
+	pthread_once(&shared_io_limit_once, &make_shared_io_limit);
+	return shared_io_limit;
+}
+
+/* shared_io_limit initializer for pthread_once(). */
+static void
+make_shared_io_limit(void)
+{
+	shared_io_limit = iolimit_alloc();
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 : */
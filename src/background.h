@@ -28,6 +28,7 @@
 
 #include <sys/types.h> /* pid_t */
 
+#include <stdint.h> /* uint64_t */
 #include <stdio.h>
 
 /* Special value of total amount of work in job_t structure to indicate
@@ -50,8 +51,13 @@ typedef struct bg_op_t
 	int total; /* Total number of coarse operations. */
 	int done;  /* Number of already processed coarse operations. */
 
-	int progress; /* Progress in percents.  -1 if task doesn't provide one. */
-	char *descr;  /* Description of current activity, can be NULL. */
+	int progress;  /* Progress in percents.  -1 if task doesn't provide one. */
+	char *descr;   /* Description of current activity, can be NULL. */
+	int cancelled; /* Whether cancellation of the operation was requested. */
+	int cancellable; /* Whether running operation checks for cancellation. */
+
+	/* Limit of I/O rate of the operation, NULL for tasks. */
+	struct iolimit_t *limit;
 }
 bg_op_t;
 
@@ -63,6 +69,7 @@ typedef struct job_t
 	char *cmd;
 	int skip_errors;
 	int running;
+	int queued; /* Whether internal job waits for a free thread. */
 	int exit_code;
 	char *error;
 
@@ -109,11 +116,19 @@ pid_t background_and_capture(char cmd[], int user_sh, FILE **out, FILE **err);
 void add_finished_job(pid_t pid, int status);
 void check_background_jobs(void);
 
-/* Start new background task, executed in a separate thread.  Returns zero on
+/* Start new background task, executed by one of background threads.  Tasks
+ * are queued when there are no free threads and should check for cancellation
+ * before doing any work as queued tasks can be cancelled.  Returns zero on
  * success, otherwise non-zero is returned. */
 int bg_execute(const char desc[], int total, int important,
 		bg_task_func task_func, void *args);
 
+/* Same as bg_execute(), but unimportant tasks with the same non-zero group
+ * (e.g. id of a device they work with) are run one at a time.  Returns zero on
+ * success, otherwise non-zero is returned. */
+int bg_execute_grouped(const char desc[], int total, int important,
+		uint64_t group, bg_task_func task_func, void *args);
+
 /* Checks whether there are any internal jobs (not external applications tracked
  * by vifm) running in background. */
 int bg_has_active_jobs(void);
@@ -138,6 +153,32 @@ void bg_op_unlock(bg_op_t *bg_op);
  * changed. */
 void bg_op_changed(bg_op_t *bg_op);
 
+/* Asks background operation to stop.  It's up to the operation to check for
+ * this and finish early. */
+void bg_op_cancel(bg_op_t *bg_op);
+
+/* Marks running background operation as the one that checks for cancellation
+ * requests.  Operations that don't do this can be cancelled only while they
+ * are queued. */
+void bg_op_set_cancellable(bg_op_t *bg_op);
+
+/* Requests cancellation of internal background job, which must be either
+ * queued or cancellable.  Returns zero on success and non-zero if the job can't
+ * be cancelled. */
+int bg_job_cancel(job_t *job);
+
+/* Checks whether cancellation of background operation was requested.  Returns
+ * non-zero if so, otherwise zero is returned. */
+int bg_op_cancelled(bg_op_t *bg_op);
+
+/* Sets limits of I/O rate that are shared by all background operations.  Zero
+ * means no limit. */
+void bg_set_shared_io_limit(uint64_t bytes_rate, uint64_t files_rate);
+
+/* Retrieves limiter of I/O rate shared by all background operations.  Returns
+ * the limiter, which can be NULL. */
+struct iolimit_t * bg_get_shared_io_limit(void);
+
 #endif /* VIFM__BACKGROUND_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
@@ -127,6 +127,7 @@ cfg_init(void)
 	cfg.follow_links = 1;
 	cfg.fast_run = 0;
 	cfg.confirm = 1;
+	cfg.copy_threads = 1;
 	cfg.vi_command = strdup("vim");
 	cfg.vi_cmd_bg = 0;
 	cfg.vi_x_command = strdup("");
@@ -149,6 +150,9 @@ cfg_init(void)
 	cfg.hl_search = 1;
 	cfg.vifm_info = VIFMINFO_BOOKMARKS;
 	cfg.auto_ch_pos = 1;
+	cfg.bg_threads = 4;
+	cfg.io_bandwidth = 0;
+	cfg.io_file_rate = 0;
 	cfg.scroll_off = 0;
 	cfg.gdefault = 0;
 	cfg.scroll_bind = 0;
@@ -177,6 +181,7 @@ cfg_init(void)
 	cfg.locate_prg = strdup("locate %a");
 
 	cfg.slow_fs_list = strdup("");
+	cfg.stat_threads = 1;
 
 	cfg.cd_path = strdup(env_get_def("CDPATH", DEFAULT_CD_PATH));
 	replace_char(cfg.cd_path, ':', ',');
@@ -106,6 +106,9 @@ typedef struct config_t
 	int hl_search;
 	int vifm_info;
 	int auto_ch_pos;
+	int bg_threads; /* Maximum number of threads for background jobs. */
+	int io_bandwidth; /* Limit of I/O of background jobs in KiB/s, 0 for none. */
+	int io_file_rate; /* Limit of files processed per second, 0 for none. */
 	char *shell;
 	int scroll_off;
 	int gdefault;
@@ -115,6 +118,7 @@ typedef struct config_t
 	int selection_is_primary; /* For yy, dd and DD: act on selection not file. */
 	int tab_switches_pane; /* Whether <tab> is switch pane or history forward. */
 	int use_system_calls; /* Prefer performing operations with system calls. */
+	int copy_threads; /* Number of threads that copy files of a directory. */
 	int tab_stop;
 	char *ruler_format;
 	char *status_line;
@@ -133,6 +137,10 @@ typedef struct config_t
 	/* Comma-separated list of file system types which are slow to respond. */
 	char *slow_fs_list;
 
+	/* Number of threads used to query information about files on loading a
+	 * directory. */
+	int stat_threads;
+
 	/* Coma separated list of places to look for relative path to directories. */
 	char *cd_path;
 
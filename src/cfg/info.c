@@ -876,10 +876,12 @@ write_options(FILE *const fp)
 	fputs("\n# Options:\n", fp);
 	fprintf(fp, "=aproposprg=%s\n", escape_spaces(cfg.apropos_prg));
 	fprintf(fp, "=%sautochpos\n", cfg.auto_ch_pos ? "" : "no");
+	fprintf(fp, "=bgthreads=%d\n", cfg.bg_threads);
 	fprintf(fp, "=cdpath=%s\n", cfg.cd_path);
 	fprintf(fp, "=%schaselinks\n", cfg.chase_links ? "" : "no");
 	fprintf(fp, "=columns=%d\n", cfg.columns);
 	fprintf(fp, "=%sconfirm\n", cfg.confirm ? "" : "no");
+	fprintf(fp, "=copythreads=%d\n", cfg.copy_threads);
 	fprintf(fp, "=cpoptions=%s%s%s\n",
 			cfg.filter_inverted_by_default ? "f" : "",
 			cfg.selection_is_primary ? "s" : "",
@@ -899,6 +901,8 @@ write_options(FILE *const fp)
 	fprintf(fp, "=%siec\n", cfg.use_iec_prefixes ? "" : "no");
 	fprintf(fp, "=%signorecase\n", cfg.ignore_case ? "" : "no");
 	fprintf(fp, "=%sincsearch\n", cfg.inc_search ? "" : "no");
+	fprintf(fp, "=iobandwidth=%d\n", cfg.io_bandwidth);
+	fprintf(fp, "=iofilerate=%d\n", cfg.io_file_rate);
 	fprintf(fp, "=%slaststatus\n", cfg.display_statusline ? "" : "no");
 	fprintf(fp, "=lines=%d\n", cfg.lines);
 	fprintf(fp, "=locateprg=%s\n", escape_spaces(cfg.locate_prg));
@@ -914,6 +918,9 @@ write_options(FILE *const fp)
 #endif
 	fprintf(fp, "=%ssmartcase\n", cfg.smart_case ? "" : "no");
 	fprintf(fp, "=%ssortnumbers\n", cfg.sort_numbers ? "" : "no");
+#ifndef _WIN32
+	fprintf(fp, "=statthreads=%d\n", cfg.stat_threads);
+#endif
 	fprintf(fp, "=statusline=%s\n", escape_spaces(cfg.status_line));
 	fprintf(fp, "=tabstop=%d\n", cfg.tab_stop);
 	fprintf(fp, "=timefmt=%s\n", escape_spaces(cfg.time_format + 1));
@@ -1199,10 +1206,12 @@ write_trash(FILE *const fp, char *trash[], int ntrash)
 {
 	int i;
 	fputs("\n# Trash content:\n", fp);
+	lock_trash_list();
 	for(i = 0; i < nentries; i++)
 	{
 		fprintf(fp, "t%s\n\t%s\n", trash_list[i].trash_name, trash_list[i].path);
 	}
+	unlock_trash_list();
 	for(i = 0; i < ntrash; i += 2)
 	{
 		fprintf(fp, "t%s\n\t%s\n", trash[i], trash[i + 1]);
@@ -19,7 +19,9 @@
 #include "color_manager.h"
 
 #include <assert.h> /* assert() */
-#include <stddef.h> /* NULL */
+#include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* uint64_t */
+#include <stdlib.h> /* free() malloc() qsort() realloc() */
 
 #include "utils/macros.h"
 #include "colors.h"
@@ -27,10 +29,27 @@
 /* Number of color pairs preallocated by curses library. */
 #define PREALLOCATED_COUNT 1
 
+/* Foreground of pairs that were allocated and then freed. */
+#define FREE_PAIR_FG (-2)
+
+/* Copy of a color pair that was set via curses. */
+typedef struct
+{
+	short int fg;    /* Foreground color or FREE_PAIR_FG. */
+	short int bg;    /* Background color. */
+	uint64_t stamp;  /* Value of use_clock on the last request of the pair. */
+}
+pair_t;
+
 static int find_pair(int fg, int bg);
-static int color_pair_matches(int pair, int fg, int bg);
 static int allocate_pair(int fg, int bg);
+static int take_free_pair(void);
+static int ensure_pairs_capacity(int count);
+static void index_pair(int pair);
+static int rebuild_index(size_t size);
+static size_t hash_pair(int fg, int bg);
 static int compress_pair_space(void);
+static int stamp_cmp(const void *a, const void *b);
 
 /* Number of color pairs available. */
 static int avail_pairs;
@@ -41,14 +60,26 @@ static int used_pairs;
 /* Configuration data passed in during initialization. */
 static colmgr_conf_t conf;
 
+/* Copies of first used_pairs pairs, so that curses isn't queried for them. */
+static pair_t *pairs;
+/* Number of allocated elements of the pairs array. */
+static int pairs_capacity;
+/* Number of freed pairs below used_pairs, which can be taken again. */
+static int nfree;
+/* Open addressing hash table of pair numbers keyed by their colors, zero marks
+ * free slots.  Size is zero or a power of two. */
+static int *pair_index;
+/* Number of slots in the pair_index. */
+static size_t index_size;
+/* Counter of pair requests, which orders pairs by the time of their use. */
+static uint64_t use_clock;
+
 void
 colmgr_init(const colmgr_conf_t *conf_init)
 {
 	assert(conf_init != NULL && "conf_init structure is required.");
 	assert(conf_init->init_pair != NULL && "init_pair must be set.");
-	assert(conf_init->pair_content != NULL && "pair_content must be set.");
 	assert(conf_init->pair_in_use != NULL && "pair_in_use must be set.");
-	assert(conf_init->move_pair != NULL && "move_pair must be set.");
 
 	conf = *conf_init;
 
@@ -58,8 +89,16 @@ colmgr_init(const colmgr_conf_t *conf_init)
 void
 colmgr_reset(void)
 {
+	size_t i;
+
 	used_pairs = PREALLOCATED_COUNT;
 	avail_pairs = conf.max_color_pairs - used_pairs;
+	nfree = 0;
+
+	for(i = 0U; i < index_size; ++i)
+	{
+		pair_index[i] = 0;
+	}
 }
 
 int
@@ -78,13 +117,17 @@ colmgr_get_pair(int fg, int bg)
 	}
 
 	p = find_pair(fg, bg);
-	if(p != -1)
+	if(p == -1)
 	{
-		return p;
+		p = allocate_pair(fg, bg);
+		if(p == -1)
+		{
+			return 0;
+		}
 	}
 
-	p = allocate_pair(fg, bg);
-	return (p == -1) ? 0 : p;
+	pairs[p].stamp = ++use_clock;
+	return p;
 }
 
 /* Tries to find pair with specified colors among already allocated pairs.
@@ -92,34 +135,34 @@ colmgr_get_pair(int fg, int bg)
 static int
 find_pair(int fg, int bg)
 {
-	int i;
+	size_t slot;
 
-	for(i = PREALLOCATED_COUNT; i < used_pairs; ++i)
+	if(index_size == 0U)
+	{
+		return -1;
+	}
+
+	slot = hash_pair(fg, bg) & (index_size - 1U);
+	while(pair_index[slot] != 0)
 	{
-		if(color_pair_matches(i, fg, bg))
+		const pair_t *const pair = &pairs[pair_index[slot]];
+		if(pair->fg == fg && pair->bg == bg)
 		{
-			return i;
+			return pair_index[slot];
 		}
+		slot = (slot + 1U) & (index_size - 1U);
 	}
 
 	return -1;
 }
 
-/* Checks whether color pair number pair has specified foreground (fg) and
- * background (bg) colors. */
-static int
-color_pair_matches(int pair, int fg, int bg)
-{
-	short pair_fg, pair_bg;
-	conf.pair_content(pair, &pair_fg, &pair_bg);
-	return (pair_fg == fg && pair_bg == bg);
-}
-
 /* Allocates new color pair.  Returns new pair index, or -1 on failure. */
 static int
 allocate_pair(int fg, int bg)
 {
-	if(avail_pairs == 0)
+	int pair;
+
+	if(avail_pairs == 0 && nfree == 0)
 	{
 		/* Out of pairs, free unused ones. */
 		if(compress_pair_space() != 0)
@@ -128,66 +171,217 @@ allocate_pair(int fg, int bg)
 		}
 	}
 
-	conf.init_pair(used_pairs, fg, bg);
+	if(nfree != 0)
+	{
+		pair = take_free_pair();
+	}
+	else
+	{
+		if(ensure_pairs_capacity(used_pairs + 1) != 0)
+		{
+			return -1;
+		}
+
+		pair = used_pairs++;
+		--avail_pairs;
+	}
+
+	conf.init_pair(pair, fg, bg);
+	pairs[pair].fg = fg;
+	pairs[pair].bg = bg;
+	index_pair(pair);
 
-	--avail_pairs;
-	return used_pairs++;
+	return pair;
 }
 
-/* Returns zero if at least one pair is now available, otherwise non-zero is
- * returned. */
+/* Picks one of freed pairs.  Returns its number. */
 static int
-compress_pair_space(void)
+take_free_pair(void)
 {
-	/* TODO: in case of performance issues cache pair_in_use() in the first loop
-	 * or change the function to fill in bit field of pairs. */
+	int i;
+	for(i = PREALLOCATED_COUNT; i < used_pairs; ++i)
+	{
+		if(pairs[i].fg == FREE_PAIR_FG)
+		{
+			--nfree;
+			return i;
+		}
+	}
 
+	assert(0 && "Number of free pairs is out of sync.");
+	return -1;
+}
+
+/* Makes sure that pairs array can hold at least count elements.  Returns zero
+ * on success, otherwise non-zero is returned. */
+static int
+ensure_pairs_capacity(int count)
+{
+	pair_t *new_pairs;
+	int new_capacity;
+
+	if(count <= pairs_capacity)
+	{
+		return 0;
+	}
+
+	new_capacity = (pairs_capacity == 0) ? 64 : pairs_capacity*2;
+	new_capacity = MIN(MAX(new_capacity, count), conf.max_color_pairs);
+
+	new_pairs = realloc(pairs, sizeof(*pairs)*new_capacity);
+	if(new_pairs == NULL)
+	{
+		return 1;
+	}
+
+	pairs = new_pairs;
+	pairs_capacity = new_capacity;
+	return 0;
+}
+
+/* Adds the pair to the pair_index growing it if needed.  Failure to grow the
+ * index leaves the pair out of it, so the pair is just never found. */
+static void
+index_pair(int pair)
+{
+	size_t slot;
+
+	/* Keep load factor under one half to make probe sequences short. */
+	if((size_t)used_pairs*2U > index_size)
+	{
+		const size_t size = (index_size == 0U) ? 128U : index_size*2U;
+		if(rebuild_index(size) != 0)
+		{
+			return;
+		}
+	}
+
+	slot = hash_pair(pairs[pair].fg, pairs[pair].bg) & (index_size - 1U);
+	while(pair_index[slot] != 0)
+	{
+		slot = (slot + 1U) & (index_size - 1U);
+	}
+	pair_index[slot] = pair;
+}
+
+/* Recreates the pair_index of the specified size (same size doesn't allocate)
+ * for all pairs that aren't free.  Returns zero on success, otherwise non-zero
+ * is returned and the index is left intact. */
+static int
+rebuild_index(size_t size)
+{
 	int i;
-	int j;
-	int in_use;
-	int first_unused;
+	size_t slot;
+
+	if(size != index_size)
+	{
+		int *const new_index = malloc(sizeof(*new_index)*size);
+		if(new_index == NULL)
+		{
+			return 1;
+		}
+
+		free(pair_index);
+		pair_index = new_index;
+		index_size = size;
+	}
+
+	for(slot = 0U; slot < index_size; ++slot)
+	{
+		pair_index[slot] = 0;
+	}
 
-	in_use = 0;
-	first_unused = -1;
 	for(i = PREALLOCATED_COUNT; i < used_pairs; ++i)
 	{
-		if(conf.pair_in_use(i))
+		if(pairs[i].fg == FREE_PAIR_FG)
+		{
+			continue;
+		}
+
+		slot = hash_pair(pairs[i].fg, pairs[i].bg) & (index_size - 1U);
+		while(pair_index[slot] != 0)
 		{
-			++in_use;
+			slot = (slot + 1U) & (index_size - 1U);
 		}
-		else if(first_unused == -1)
+		pair_index[slot] = i;
+	}
+
+	return 0;
+}
+
+/* Computes hash of a pair of colors.  Returns the hash. */
+static size_t
+hash_pair(int fg, int bg)
+{
+	const unsigned int key = ((unsigned int)(fg + 1) << 16)
+	                       ^ (unsigned int)(bg + 1);
+	/* Multiplicative hashing, high bits are the best mixed ones. */
+	return (key*2654435761U) >> 8;
+}
+
+/* Frees least recently used half of pairs which are not in use, so that pairs
+ * that are still likely to be on the screen keep their colors.  Returns zero
+ * if at least one pair is now available, otherwise non-zero is returned. */
+static int
+compress_pair_space(void)
+{
+	int i;
+	int nunused;
+	uint64_t *stamps;
+	uint64_t threshold;
+
+	stamps = malloc(sizeof(*stamps)*used_pairs);
+	if(stamps == NULL)
+	{
+		return -1;
+	}
+
+	nunused = 0;
+	for(i = PREALLOCATED_COUNT; i < used_pairs; ++i)
+	{
+		if(!conf.pair_in_use(i))
 		{
-			first_unused = i;
+			stamps[nunused++] = pairs[i].stamp;
 		}
 	}
 
-	if(first_unused == -1)
+	if(nunused == 0)
 	{
 		/* No unused pairs. */
+		free(stamps);
 		return -1;
 	}
 
-	j = first_unused;
-	for(i = PREALLOCATED_COUNT + in_use; i < used_pairs; ++i)
+	qsort(stamps, nunused, sizeof(*stamps), &stamp_cmp);
+	/* Stamps are unique, so this frees nunused/2 pairs, but at least one. */
+	threshold = stamps[nunused/2];
+	free(stamps);
+
+	for(i = PREALLOCATED_COUNT; i < used_pairs; ++i)
 	{
-		if(conf.pair_in_use(i))
+		if(pairs[i].stamp < threshold ||
+				(nunused == 1 && pairs[i].stamp == threshold))
 		{
-			conf.move_pair(i, j);
-
-			/* Advance to next unused pair. */
-			do
+			if(!conf.pair_in_use(i))
 			{
-				++j;
+				pairs[i].fg = FREE_PAIR_FG;
+				++nfree;
 			}
-			while(conf.pair_in_use(j));
 		}
 	}
 
-	used_pairs = j;
-	avail_pairs = conf.max_color_pairs - used_pairs;
-
+	(void)rebuild_index(index_size);
 	return 0;
 }
 
+/* qsort() comparer of pair stamps.  Returns standard -1, 0, 1 for
+ * comparisons. */
+static int
+stamp_cmp(const void *a, const void *b)
+{
+	const uint64_t *const x = a, *const y = b;
+	return (*x > *y) - (*x < *y);
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 : */
@@ -704,10 +704,15 @@ check_directory_for_color_scheme(int left, const char dir[])
 	altered = 0;
 	do
 	{
+		char real_path[PATH_MAX];
+
 		t = *p;
 		*p = '\0';
 
-		if(tree_get_data(dirs, dir, &u.buf) == 0 && color_scheme_exists(u.name))
+		/* Associations are stored for canonical paths. */
+		if(realpath(dir, real_path) == real_path &&
+				tree_get_data(dirs, real_path, &u.buf) == 0 &&
+				color_scheme_exists(u.name))
 		{
 			(void)source_cs(u.name);
 			altered = 1;
@@ -823,9 +828,12 @@ assoc_dir(const char *name, const char *dir)
 		.s = strdup(name),
 	};
 
+	char real_path[PATH_MAX];
+
 	ensure_dirs_tree_exists();
 
-	if(tree_set_data(dirs, dir, u.l) != 0)
+	if(realpath(dir, real_path) != real_path ||
+			tree_set_data(dirs, real_path, u.l) != 0)
 		free(u.s);
 }
 
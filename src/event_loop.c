@@ -21,11 +21,16 @@
 
 #include <curses.h>
 
-#include <unistd.h> /* select() */
+#ifndef _WIN32
+#include <sys/select.h> /* FD_* fd_set select() */
+#include <sys/time.h> /* gettimeofday() timeval */
+#endif
+#include <unistd.h> /* STDIN_FILENO */
 
 #include <assert.h> /* assert() */
 #include <signal.h> /* signal() */
 #include <stddef.h> /* NULL size_t wchar_t wint_t */
+#include <stdint.h> /* int64_t */
 #include <string.h> /* memmove() strncpy() */
 #include <wchar.h> /* wcslen() wcscmp() */
 
@@ -37,6 +42,7 @@
 #include "ui/statusbar.h"
 #include "ui/statusline.h"
 #include "ui/ui.h"
+#include "utils/filemon.h"
 #include "utils/log.h"
 #include "utils/macros.h"
 #include "utils/utils.h"
@@ -48,6 +54,13 @@
 
 static int ensure_term_is_ready(void);
 static int get_char_async_loop(WINDOW *win, wint_t *c, int timeout);
+static int read_char(WINDOW *win, wint_t *c, int timeout);
+#ifndef _WIN32
+static int read_char_or_changes(WINDOW *win, wint_t *c, int timeout,
+		int watch_fd);
+static int64_t get_time_ms(void);
+#endif
+static void check_views_for_changes(void);
 static void process_scheduled_updates(void);
 static int process_scheduled_updates_of_view(FileView *view);
 static int should_check_views_for_changes(void);
@@ -277,21 +290,15 @@ get_char_async_loop(WINDOW *win, wint_t *c, int timeout)
 		int i;
 
 		process_scheduled_updates();
-
-		if(should_check_views_for_changes())
-		{
-			check_view_for_changes(curr_view);
-			check_view_for_changes(other_view);
-		}
+		check_views_for_changes();
 
 		for(i = 0; i < IPC_F; ++i)
 		{
 			int result;
 
 			ipc_check();
-			wtimeout(win, MIN(cfg.min_timeout_len, timeout)/IPC_F);
 
-			result = wget_wch(win, c);
+			result = read_char(win, c, MIN(cfg.min_timeout_len, timeout)/IPC_F);
 			if(result != ERR)
 			{
 				return result;
@@ -307,6 +314,82 @@ get_char_async_loop(WINDOW *win, wint_t *c, int timeout)
 	return ERR;
 }
 
+/* Reads character from the window waiting for it for at most timeout
+ * milliseconds.  Returns the same value as wget_wch(). */
+static int
+read_char(WINDOW *win, wint_t *c, int timeout)
+{
+#ifndef _WIN32
+	const int watch_fd = filemon_watch_fd();
+	if(watch_fd != -1)
+	{
+		return read_char_or_changes(win, c, timeout, watch_fd);
+	}
+#endif
+
+	wtimeout(win, timeout);
+	return wget_wch(win, c);
+}
+
+#ifndef _WIN32
+
+/* Same as read_char(), but also waits on descriptor of directory watchers and
+ * processes changes of directories as soon as they are reported. */
+static int
+read_char_or_changes(WINDOW *win, wint_t *c, int timeout, int watch_fd)
+{
+	const int64_t deadline = get_time_ms() + timeout;
+
+	/* Input is read without blocking, waiting happens in select(). */
+	wtimeout(win, 0);
+
+	while(1)
+	{
+		fd_set fds;
+		struct timeval tv;
+		int64_t left;
+
+		/* Check for input first as curses might have it buffered. */
+		const int result = wget_wch(win, c);
+		if(result != ERR)
+		{
+			return result;
+		}
+
+		left = deadline - get_time_ms();
+		if(left <= 0)
+		{
+			return ERR;
+		}
+
+		FD_ZERO(&fds);
+		FD_SET(STDIN_FILENO, &fds);
+		FD_SET(watch_fd, &fds);
+		tv.tv_sec = left/1000;
+		tv.tv_usec = (left%1000)*1000;
+
+		if(select(MAX(STDIN_FILENO, watch_fd) + 1, &fds, NULL, NULL, &tv) > 0 &&
+				FD_ISSET(watch_fd, &fds))
+		{
+			/* Move events to watchers, so that descriptor isn't readable if views
+			 * can't be checked right now. */
+			filemon_watch_read_events();
+			check_views_for_changes();
+		}
+	}
+}
+
+/* Retrieves current time.  Returns the time in milliseconds. */
+static int64_t
+get_time_ms(void)
+{
+	struct timeval tv;
+	(void)gettimeofday(&tv, NULL);
+	return (int64_t)tv.tv_sec*1000 + tv.tv_usec/1000;
+}
+
+#endif
+
 /* Updates TUI or its elements if something is scheduled. */
 static void
 process_scheduled_updates(void)
@@ -377,6 +460,18 @@ should_check_views_for_changes(void)
 	    && NONE(vle_mode_is, CMDLINE_MODE, MSG_MODE);
 }
 
+/* Updates views in case directories they display were changed externally and
+ * it's appropriate time to do so. */
+static void
+check_views_for_changes(void)
+{
+	if(should_check_views_for_changes())
+	{
+		check_view_for_changes(curr_view);
+		check_view_for_changes(other_view);
+	}
+}
+
 /* Updates view in case directory it displays was changed externally. */
 static void
 check_view_for_changes(FileView *view)
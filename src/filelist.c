@@ -28,11 +28,16 @@
 
 #include <curses.h>
 
+#ifndef _WIN32
+#include <pthread.h> /* PTHREAD_* pthread_*() */
+#endif
+
 #include <sys/stat.h> /* stat */
 #include <unistd.h> /* close() fork() pipe() */
 
 #include <assert.h> /* assert() */
 #include <errno.h> /* errno */
+#include <limits.h> /* INT_MAX */
 #include <stddef.h> /* NULL size_t */
 #include <stdint.h> /* uint64_t */
 #include <stdio.h> /* snprintf() */
@@ -46,9 +51,11 @@
 #include "engine/mode.h"
 #include "modes/dialogs/msg_dialog.h"
 #include "modes/modes.h"
+#include "ui/cancellation.h"
 #include "ui/statusbar.h"
 #include "ui/statusline.h"
 #include "ui/ui.h"
+#include "utils/dcache.h"
 #include "utils/env.h"
 #include "utils/filemon.h"
 #include "utils/fs.h"
@@ -59,7 +66,6 @@
 #include "utils/str.h"
 #include "utils/string_array.h"
 #include "utils/test_helpers.h"
-#include "utils/tree.h"
 #include "utils/utf8.h"
 #include "utils/utils.h"
 #include "fileview.h"
@@ -72,15 +78,51 @@
 #include "status.h"
 #include "types.h"
 
+/* Number of entries whose information is queried by a thread at a time. */
+#define STAT_BATCH_SIZE 64
+
+/* Number of entries read between updates of directory reading progress. */
+#define READ_PROGRESS_STEP 1024
+
 /* Structure to communicate data during filling view with list files. */
 typedef struct
 {
 	FileView *const view; /* View being filled. */
 	const int is_root;    /* Whether we're at file system root. */
 	int with_parent_dir;  /* Whether parent directory was seen during filling. */
+	int capacity;         /* Number of allocated elements of view->dir_entry. */
+	int defer_stat;       /* Whether querying file information is postponed. */
+	int interactive;      /* Whether progress and cancellation are enabled. */
 }
 dir_fill_info_t;
 
+#ifndef _WIN32
+/* State shared among threads that query information about files. */
+typedef struct
+{
+	dir_entry_t *entries; /* List of entries to process. */
+	int count;            /* Number of entries in the list. */
+	int cancellable;      /* Whether processing can be cancelled. */
+	int next;             /* Index of the first entry not taken by any thread. */
+	pthread_mutex_t lock; /* Protects next field. */
+}
+stat_job_t;
+
+/* Set of changed files of a directory that is being applied to a view. */
+typedef struct
+{
+	char **names;   /* Sorted names of changed files. */
+	int count;      /* Number of elements in the names array. */
+	char *listed;   /* Whether file with the name was in the list. */
+	char *selected; /* Whether file with the name was selected. */
+	char *updated;  /* Whether entry with the name was updated in place. */
+	int *in_place;  /* Positions of entries updated in place. */
+	int nin_place;  /* Number of elements in the in_place array. */
+	int first_moved; /* Lowest position of removed or added entry or -1. */
+}
+dir_changes_t;
+#endif
+
 /* Custom argument for is_in_list() function. */
 typedef struct
 {
@@ -111,7 +153,26 @@ static int fill_dir_entry_by_path(dir_entry_t *entry, const char path[]);
 #ifndef _WIN32
 static int fill_dir_entry(dir_entry_t *entry, const char path[],
 		const struct dirent *d);
+static int fill_dir_entry_by_stat(dir_entry_t *entry, const char path[],
+		FileType type_hint);
+static int fill_dir_entry_by_lstat(dir_entry_t *entry, const char path[],
+		FileType type_hint);
+static void fill_link_target_mode(dir_entry_t *entry);
+static void fill_entries_in_parallel(FileView *view, int cancellable);
+static void * stat_thread(void *arg);
+static int is_filled(FileView *view, const dir_entry_t *entry, void *arg);
 static int data_is_dir_entry(const struct dirent *d);
+static int update_changed_entries(FileView *view);
+static int apply_dir_changes(FileView *view, dir_changes_t *changes);
+static void update_entries_in_place(FileView *view, dir_changes_t *changes);
+static int update_entry_in_place(FileView *view, int pos);
+static int draw_changed_entries(FileView *view, const dir_changes_t *changes);
+static int name_cmp(const void *a, const void *b);
+static int is_unchanged(FileView *view, const dir_entry_t *entry, void *arg);
+static int entry_is_hidden(FileView *view, const dir_entry_t *entry);
+static int merge_entries(FileView *view, dir_entry_t *added, int nadded);
+static int count_filtered_file(const char name[], const void *data,
+		void *param);
 #else
 static int fill_dir_entry(dir_entry_t *entry, const char path[],
 		const WIN32_FIND_DATAW *ffd);
@@ -124,6 +185,7 @@ static int is_dead_or_filtered(FileView *view, const dir_entry_t *entry,
 		void *arg);
 static void update_entries_data(FileView *view);
 static int is_dir_big(const char path[]);
+static int estimate_entry_count(const FileView *view, int reload);
 static void free_view_entries(FileView *view);
 static void sort_dir_list(int msg, FileView *view);
 static int rescue_from_empty_filelist(FileView *view);
@@ -131,6 +193,10 @@ static void init_dir_entry(FileView *view, dir_entry_t *entry,
 		const char name[]);
 static void free_dir_entries(FileView *view, dir_entry_t **entries, int *count);
 static dir_entry_t * alloc_dir_entry(dir_entry_t **list, int list_size);
+static dir_entry_t * reserve_dir_entry(dir_entry_t **list, int list_size,
+		int *capacity);
+static void shrink_dir_entries(dir_entry_t **list, int list_size,
+		int *capacity);
 static int file_can_be_displayed(const char directory[], const char filename[]);
 TSTATIC void pick_cd_path(FileView *view, const char base_dir[],
 		const char path[], int *updir, char buf[], size_t buf_size);
@@ -238,6 +304,9 @@ load_initial_directory(FileView *view, const char *dir)
 	view->dir_entry[0].name = strdup("");
 	view->dir_entry[0].type = FT_DIR;
 	view->dir_entry[0].hi_num = -1;
+	view->dir_entry[0].name_width = 0;
+	view->dir_entry[0].link_broken = -1;
+	view->dir_entry[0].link_to_dir = -1;
 	view->dir_entry[0].origin = &view->curr_dir[0];
 
 	view->list_rows = 1;
@@ -1104,8 +1173,10 @@ reset_selected_files(FileView *view, int need_free)
 }
 
 #ifdef _WIN32
+/* Fills view with list of shared resources of a server.  *capacity is the
+ * number of elements allocated for view->dir_entry. */
 static void
-fill_with_shared(FileView *view)
+fill_with_shared(FileView *view, int *capacity)
 {
 	NET_API_STATUS res;
 	wchar_t *wserver;
@@ -1133,7 +1204,8 @@ fill_with_shared(FileView *view)
 				dir_entry_t *dir_entry;
 				char *utf8_name;
 
-				dir_entry = alloc_dir_entry(&view->dir_entry, view->list_rows);
+				dir_entry = reserve_dir_entry(&view->dir_entry, view->list_rows,
+						capacity);
 				if(dir_entry == NULL)
 				{
 					show_error_msg("Memory Error", "Unable to allocate enough memory");
@@ -1171,22 +1243,47 @@ win_to_unix_time(FILETIME ft)
 }
 #endif
 
+/* Fills view with list of files of its current directory.  The reload
+ * parameter should be set in case of view refresh operation.  The interactive
+ * parameter enables reporting progress and checking for cancellation, the
+ * list is left incomplete if reading is cancelled.  Returns non-zero on
+ * error. */
 static int
-refill_dir_list(FileView *view)
+refill_dir_list(FileView *view, int reload, int interactive)
 {
 	dir_fill_info_t info = {
 		.view = view,
 		.is_root = is_root_dir(view->curr_dir),
 		.with_parent_dir = 0,
+		.capacity = 0,
+#ifndef _WIN32
+		.defer_stat = (cfg.stat_threads > 1),
+#else
+		.defer_stat = 0,
+#endif
+		.interactive = interactive,
 	};
+	const int expected_count = estimate_entry_count(view, reload);
 
 	view->matches = 0;
 	free_view_entries(view);
 
+	/* Reserve space for all the files upfront to avoid reallocating the list on
+	 * every new entry.  It's fine if this fails, the list will just grow. */
+	if(expected_count > 0)
+	{
+		view->dir_entry = malloc(sizeof(*view->dir_entry)*expected_count);
+		if(view->dir_entry != NULL)
+		{
+			info.capacity = expected_count;
+		}
+	}
+
 #ifdef _WIN32
 	if(is_unc_root(view->curr_dir))
 	{
-		fill_with_shared(view);
+		fill_with_shared(view, &info.capacity);
+		shrink_dir_entries(&view->dir_entry, view->list_rows, &info.capacity);
 		return 0;
 	}
 #endif
@@ -1197,6 +1294,16 @@ refill_dir_list(FileView *view)
 		return 1;
 	}
 
+#ifndef _WIN32
+	if(info.defer_stat)
+	{
+		fill_entries_in_parallel(view, interactive);
+	}
+#endif
+
+	/* Give back memory that was reserved, but turned out to be unneeded. */
+	shrink_dir_entries(&view->dir_entry, view->list_rows, &info.capacity);
+
 #ifdef _WIN32
 	/* Not all Windows file systems provide standard dot directories. */
 	if(!info.with_parent_dir && cfg_parent_dir_is_visible(info.is_root))
@@ -1226,6 +1333,20 @@ add_file_entry_to_view(const char name[], const void *data, void *param)
 	FileView *view = info->view;
 	dir_entry_t *entry;
 
+	if(info->interactive)
+	{
+		if(ui_cancellation_requested())
+		{
+			return 1;
+		}
+
+		if(view->list_rows != 0 && view->list_rows%READ_PROGRESS_STEP == 0 &&
+				!vle_mode_is(CMDLINE_MODE))
+		{
+			ui_sb_quick_msgf("Reading directory... %d", view->list_rows);
+		}
+	}
+
 	/* Always ignore the "." directory. */
 	if(strcmp(name, ".") == 0)
 	{
@@ -1253,7 +1374,7 @@ add_file_entry_to_view(const char name[], const void *data, void *param)
 		return 0;
 	}
 
-	entry = alloc_dir_entry(&view->dir_entry, view->list_rows);
+	entry = reserve_dir_entry(&view->dir_entry, view->list_rows, &info->capacity);
 	if(entry == NULL)
 	{
 		show_error_msg("Memory Error", "Unable to allocate enough memory");
@@ -1262,6 +1383,17 @@ add_file_entry_to_view(const char name[], const void *data, void *param)
 
 	init_dir_entry(view, entry, name);
 
+#ifndef _WIN32
+	if(info->defer_stat)
+	{
+		/* Remember type reported by directory entry, it's the fallback value used
+		 * by fill_dir_entry() and the entry data won't be available later. */
+		entry->type = type_from_dir_entry(data);
+		++view->list_rows;
+		return 0;
+	}
+#endif
+
 	if(fill_dir_entry(entry, entry->name, data) == 0)
 	{
 		++view->list_rows;
@@ -1315,6 +1447,7 @@ void
 flist_custom_start(FileView *view, const char title[])
 {
 	free_dir_entries(view, &view->custom.entries, &view->custom.entry_count);
+	view->custom.entries_capacity = 0;
 	(void)replace_string(&view->custom.title, title);
 }
 
@@ -1331,7 +1464,8 @@ flist_custom_add(FileView *view, const char path[])
 		return;
 	}
 
-	dir_entry = alloc_dir_entry(&view->custom.entries, view->custom.entry_count);
+	dir_entry = reserve_dir_entry(&view->custom.entries, view->custom.entry_count,
+			&view->custom.entries_capacity);
 	if(dir_entry == NULL)
 	{
 		return;
@@ -1371,6 +1505,38 @@ fill_dir_entry_by_path(dir_entry_t *entry, const char path[])
  * non-zero is returned. */
 static int
 fill_dir_entry(dir_entry_t *entry, const char path[], const struct dirent *d)
+{
+	return fill_dir_entry_by_stat(entry, path,
+			(d == NULL) ? FT_UNK : type_from_dir_entry(d));
+}
+
+/* Fills fields of the entry from stat information of the file specified by its
+ * path.  type_hint is used if stat information doesn't define type of the
+ * file.  Returns zero on success, otherwise non-zero is returned. */
+static int
+fill_dir_entry_by_stat(dir_entry_t *entry, const char path[],
+		FileType type_hint)
+{
+	if(fill_dir_entry_by_lstat(entry, path, type_hint) != 0)
+	{
+		return 1;
+	}
+
+	if(entry->type == FT_LINK)
+	{
+		fill_link_target_mode(entry);
+	}
+
+	return 0;
+}
+
+/* Fills fields of the entry from lstat information of the file specified by
+ * its path without looking at targets of symbolic links.  type_hint is used if
+ * stat information doesn't define type of the file.  Returns zero on success,
+ * otherwise non-zero is returned. */
+static int
+fill_dir_entry_by_lstat(dir_entry_t *entry, const char path[],
+		FileType type_hint)
 {
 	struct stat s;
 
@@ -1384,7 +1550,7 @@ fill_dir_entry(dir_entry_t *entry, const char path[], const struct dirent *d)
 	entry->type = get_type_from_mode(s.st_mode);
 	if(entry->type == FT_UNK)
 	{
-		entry->type = (d == NULL) ? FT_UNK : type_from_dir_entry(d);
+		entry->type = type_hint;
 	}
 	if(entry->type == FT_UNK)
 	{
@@ -1400,20 +1566,132 @@ fill_dir_entry(dir_entry_t *entry, const char path[], const struct dirent *d)
 	entry->atime = s.st_atime;
 	entry->ctime = s.st_ctime;
 
-	if(entry->type == FT_LINK)
+	return 0;
+}
+
+/* Replaces mode of symbolic link entry with mode of its target unless the
+ * target is on a slow file system.  Mount table is protected by a lock, so this
+ * can be called from several threads. */
+static void
+fill_link_target_mode(dir_entry_t *entry)
+{
+	struct stat s;
+
+	const SymLinkType symlink_type = get_symlink_type(entry->name);
+	if(symlink_type != SLT_SLOW && os_stat(entry->name, &s) == 0)
 	{
-		/* Query mode of symbolic link target. */
+		entry->mode = s.st_mode;
+	}
+}
+
+/* Fills entries of the view with information about files in parallel by
+ * several threads (using current thread as one of them).  Each entry is
+ * expected to have type taken from directory entry.  Entries for which querying
+ * fails or which are skipped due to cancellation are removed from the list
+ * keeping order of the rest. */
+static void
+fill_entries_in_parallel(FileView *view, int cancellable)
+{
+	pthread_t *threads;
+	int nthreads;
+	int i;
+	stat_job_t job = {
+		.entries = view->dir_entry,
+		.count = view->list_rows,
+		.cancellable = cancellable,
+		.next = 0,
+		.lock = PTHREAD_MUTEX_INITIALIZER,
+	};
 
-		struct stat s;
+	/* Don't start more threads than there are batches, current thread does part
+	 * of the work too. */
+	nthreads = MIN(cfg.stat_threads, DIV_ROUND_UP(job.count, STAT_BATCH_SIZE))
+	         - 1;
+
+	threads = (nthreads > 0) ? malloc(sizeof(*threads)*nthreads) : NULL;
+	if(threads == NULL)
+	{
+		nthreads = 0;
+	}
 
-		const SymLinkType symlink_type = get_symlink_type(entry->name);
-		if(symlink_type != SLT_SLOW && os_stat(entry->name, &s) == 0)
+	for(i = 0; i < nthreads; ++i)
+	{
+		if(pthread_create(&threads[i], NULL, &stat_thread, &job) != 0)
 		{
-			entry->mode = s.st_mode;
+			break;
 		}
 	}
+	nthreads = i;
 
-	return 0;
+	(void)stat_thread(&job);
+
+	for(i = 0; i < nthreads; ++i)
+	{
+		(void)pthread_join(threads[i], NULL);
+	}
+	free(threads);
+
+	pthread_mutex_destroy(&job.lock);
+
+	/* Drop entries that weren't processed due to cancellation. */
+	for(i = job.next; i < job.count; ++i)
+	{
+		job.entries[i].type = FT_UNK;
+	}
+
+	(void)zap_entries(view, view->dir_entry, &view->list_rows, &is_filled, NULL,
+			1);
+}
+
+/* Entry point of a thread that queries information about files.  Takes entries
+ * in batches until there are none left.  Returns NULL. */
+static void *
+stat_thread(void *arg)
+{
+	stat_job_t *const job = arg;
+
+	while(1)
+	{
+		int first, last;
+
+		/* Entries are taken in order, so entries after job->next are those that
+		 * weren't processed. */
+		if(job->cancellable && ui_cancellation_requested())
+		{
+			break;
+		}
+
+		pthread_mutex_lock(&job->lock);
+		first = job->next;
+		job->next = MIN(job->count, first + STAT_BATCH_SIZE);
+		last = job->next;
+		pthread_mutex_unlock(&job->lock);
+
+		if(first == last)
+		{
+			break;
+		}
+
+		for(; first < last; ++first)
+		{
+			dir_entry_t *const entry = &job->entries[first];
+			if(fill_dir_entry_by_stat(entry, entry->name, entry->type) != 0)
+			{
+				/* Mark entry for removal. */
+				entry->type = FT_UNK;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+/* zap_entries() filter to filter-out entries for which querying information
+ * about files has failed. */
+static int
+is_filled(FileView *view, const dir_entry_t *entry, void *arg)
+{
+	return entry->type != FT_UNK;
 }
 
 /* Checks whether file is a directory.  Returns non-zero if so, otherwise zero
@@ -1507,8 +1785,8 @@ flist_custom_finish(FileView *view)
 
 	if(cfg_parent_dir_is_visible(0))
 	{
-		dir_entry_t *const dir_entry = alloc_dir_entry(&view->custom.entries,
-				view->custom.entry_count);
+		dir_entry_t *const dir_entry = reserve_dir_entry(&view->custom.entries,
+				view->custom.entry_count, &view->custom.entries_capacity);
 		if(dir_entry != NULL)
 		{
 			init_dir_entry(view, dir_entry, "..");
@@ -1530,10 +1808,13 @@ flist_custom_finish(FileView *view)
 	flist_ensure_pos_is_valid(view);
 
 	free_dir_entries(view, &view->dir_entry, &view->list_rows);
+	shrink_dir_entries(&view->custom.entries, view->custom.entry_count,
+			&view->custom.entries_capacity);
 	view->dir_entry = view->custom.entries;
 	view->list_rows = view->custom.entry_count;
 	view->custom.entries = NULL;
 	view->custom.entry_count = 0;
+	view->custom.entries_capacity = 0;
 	filters_dir_updated(view);
 
 	return 0;
@@ -1690,6 +1971,9 @@ static int
 populate_dir_list_internal(FileView *view, int reload)
 {
 	int need_free = (view->selected_filelist == NULL);
+	int big_dir = 0;
+	int refill_failed;
+	int cancelled;
 
 	view->filtered = 0;
 
@@ -1718,6 +2002,7 @@ populate_dir_list_internal(FileView *view, int reload)
 
 	if(!reload && is_dir_big(view->curr_dir))
 	{
+		big_dir = 1;
 		if(!vle_mode_is(CMDLINE_MODE))
 		{
 			ui_sb_quick_msgf("%s", "Reading directory...");
@@ -1741,7 +2026,24 @@ populate_dir_list_internal(FileView *view, int reload)
 		capture_selection(view);
 	}
 
-	if(refill_dir_list(view) != 0)
+	/* Reading of big directories can be interrupted by the user, in which case
+	 * only files that were read so far are displayed. */
+	if(big_dir)
+	{
+		ui_cancellation_reset();
+		ui_cancellation_enable();
+	}
+
+	refill_failed = refill_dir_list(view, reload, big_dir);
+
+	cancelled = 0;
+	if(big_dir)
+	{
+		ui_cancellation_disable();
+		cancelled = ui_cancellation_requested();
+	}
+
+	if(refill_failed)
 	{
 		/* We don't have read access, only execute, or there were other problems. */
 		free_view_entries(view);
@@ -1755,6 +2057,14 @@ populate_dir_list_internal(FileView *view, int reload)
 		clean_status_bar();
 	}
 
+	if(cancelled)
+	{
+		/* Make the next check for changes reload incomplete list. */
+		reset_dir_mtime(view);
+		status_bar_message("Reading of directory was cancelled, file list is "
+				"incomplete");
+	}
+
 	view->column_count = calculate_columns_count(view);
 
 	/* If reloading the same directory don't jump to history position.  Stay at
@@ -1880,6 +2190,34 @@ is_dir_big(const char path[])
 #endif
 }
 
+/* Guesses number of entries that will be read from current directory of the
+ * view.  Returns the guess, which is zero if nothing is known. */
+static int
+estimate_entry_count(const FileView *view, int reload)
+{
+#ifndef _WIN32
+	struct stat s;
+#endif
+
+	/* Previous list of the same directory is the best estimate available. */
+	if(reload && view->list_rows > 0)
+	{
+		return view->list_rows + view->filtered;
+	}
+
+#ifndef _WIN32
+	/* Size of a directory is roughly proportional to number of its entries on
+	 * most file systems, assume that average entry takes 32 bytes.  Directories
+	 * that fit in a single block aren't worth the trouble. */
+	if(os_stat(view->curr_dir, &s) == 0 && s.st_size > s.st_blksize)
+	{
+		return (int)MIN(s.st_size/32, (off_t)(INT_MAX/sizeof(dir_entry_t)));
+	}
+#endif
+
+	return 0;
+}
+
 /* Frees list of directory entries of the view. */
 static void
 free_view_entries(FileView *view)
@@ -2016,14 +2354,25 @@ init_dir_entry(FileView *view, dir_entry_t *entry, const char name[])
 
 	entry->type = FT_UNK;
 	entry->hi_num = -1;
+	entry->name_width = 0;
+	entry->link_broken = -1;
+	entry->link_to_dir = -1;
 
 	/* All files start as unselected, unmatched and unmarked. */
 	entry->selected = 0;
 	entry->was_selected = 0;
 	entry->search_match = 0;
 	entry->marked = 0;
+}
 
-	entry->list_num = -1;
+void
+rename_dir_entry(dir_entry_t *entry, const char new_name[])
+{
+	(void)replace_string(&entry->name, new_name);
+	entry->hi_num = -1;
+	entry->name_width = 0;
+	entry->link_broken = -1;
+	entry->link_to_dir = -1;
 }
 
 void
@@ -2120,6 +2469,53 @@ alloc_dir_entry(dir_entry_t **list, int list_size)
 	return &new_entry_list[list_size];
 }
 
+/* Allocates one more directory entry for the *list of size list_size, which
+ * has space for *capacity elements.  Unlike alloc_dir_entry(), grows the list
+ * geometrically, so sequence of additions takes amortized constant time.
+ * Returns pointer to new entry or NULL on failure. */
+static dir_entry_t *
+reserve_dir_entry(dir_entry_t **list, int list_size, int *capacity)
+{
+	if(list_size >= *capacity)
+	{
+		const int new_capacity = MAX(list_size + 1, *capacity*2);
+		dir_entry_t *const new_entry_list = realloc(*list,
+				sizeof(dir_entry_t)*new_capacity);
+		if(new_entry_list == NULL)
+		{
+			return NULL;
+		}
+
+		*list = new_entry_list;
+		*capacity = new_capacity;
+	}
+
+	return &(*list)[list_size];
+}
+
+/* Releases unused memory at the end of the *list of size list_size and updates
+ * *capacity to match. */
+static void
+shrink_dir_entries(dir_entry_t **list, int list_size, int *capacity)
+{
+	dir_entry_t *new_entry_list;
+
+	if(list_size == 0)
+	{
+		free(*list);
+		*list = NULL;
+		*capacity = 0;
+		return;
+	}
+
+	new_entry_list = realloc(*list, sizeof(dir_entry_t)*list_size);
+	if(new_entry_list != NULL)
+	{
+		*list = new_entry_list;
+		*capacity = list_size;
+	}
+}
+
 static void
 reload_window(FileView *view)
 {
@@ -2153,8 +2549,23 @@ check_if_filelist_have_changed(FileView *view)
 #ifndef _WIN32
 	{
 		filemon_t mon;
+		FileMonState state = FMS_ERRORED;
+
+		/* Notifications about changes are reliable and include changes of
+		 * permissions of the directory, so there is nothing to do if there are
+		 * none.  Modification time is checked otherwise. */
+		if(view->watch != NULL && filemon_watch_is_precise(view->watch))
+		{
+			state = filemon_watch_poll(view->watch);
+			if(state == FMS_UNCHANGED)
+			{
+				return;
+			}
+		}
+
 		failed = filemon_from_file(view->curr_dir, &mon) != 0;
-		changed = !failed && !filemon_equal(&mon, &view->mon);
+		changed = !failed
+		       && (state == FMS_UPDATED || !filemon_equal(&mon, &view->mon));
 	}
 #else
 	{
@@ -2182,10 +2593,432 @@ check_if_filelist_have_changed(FileView *view)
 
 	if(changed)
 	{
+#ifndef _WIN32
+		if(update_changed_entries(view) == 0)
+		{
+			return;
+		}
+#endif
 		reload_window(view);
 	}
 }
 
+#ifndef _WIN32
+
+/* Updates only those entries of the view which were reported to be changed by
+ * its watcher instead of rereading whole directory.  Returns zero on success,
+ * otherwise non-zero is returned and the view should be reloaded. */
+static int
+update_changed_entries(FileView *view)
+{
+	dir_changes_t changes;
+	char cursor_path[PATH_MAX];
+	int top_delta;
+	int failed;
+	int full_redraw;
+	const int old_top = view->top_line;
+	const int old_pos = view->list_pos;
+	const int old_rows = view->list_rows;
+	const size_t old_columns = view->column_count;
+	const size_t old_max_width = view->max_filename_width;
+
+	if(!window_shows_dirlist(view) || view->local_filter.in_progress ||
+			view->watch == NULL)
+	{
+		return 1;
+	}
+
+	if(filemon_watch_take_changes(view->watch, &changes.names, &changes.count) != 0)
+	{
+		return 1;
+	}
+
+	/* Parent directory might be there only because the list would be empty
+	 * otherwise, it's easier to just reload such a list. */
+	if(view->list_rows == 1 && is_parent_dir(view->dir_entry[0].name))
+	{
+		free_string_array(changes.names, changes.count);
+		return 1;
+	}
+
+	/* This is needed for functions that work with relative paths. */
+	if(vifm_chdir(view->curr_dir) != 0)
+	{
+		free_string_array(changes.names, changes.count);
+		return 1;
+	}
+
+	get_current_full_path(view, sizeof(cursor_path), cursor_path);
+	top_delta = view->list_pos - view->top_line;
+
+	changes.listed = calloc(changes.count, 1);
+	changes.selected = calloc(changes.count, 1);
+	changes.updated = calloc(changes.count, 1);
+	changes.in_place = malloc(sizeof(*changes.in_place)*changes.count);
+	changes.nin_place = 0;
+	changes.first_moved = -1;
+	failed = (changes.count != 0 && (changes.listed == NULL ||
+	                                 changes.selected == NULL ||
+	                                 changes.updated == NULL ||
+	                                 changes.in_place == NULL))
+	      || apply_dir_changes(view, &changes) != 0;
+
+	free(changes.listed);
+	free(changes.selected);
+	free(changes.updated);
+	free_string_array(changes.names, changes.count);
+
+	if(failed)
+	{
+		free(changes.in_place);
+		return 1;
+	}
+
+	(void)filemon_from_file(view->curr_dir, &view->mon);
+
+	recount_selected_files(view);
+	view->column_count = calculate_columns_count(view);
+	fview_list_updated(view);
+
+	flist_goto_by_path(view, cursor_path);
+	flist_ensure_pos_is_valid(view);
+	view->top_line = MAX(0, view->list_pos - top_delta);
+
+	if(curr_stats.load_stage < 2)
+	{
+		free(changes.in_place);
+		return 0;
+	}
+
+	/* Drawing only changed entries is possible while the rest of them stay
+	 * where they were on the screen. */
+	full_redraw = view->top_line != old_top
+	           || view->column_count != old_columns
+	           || (view->ls_view && view->max_filename_width != old_max_width)
+	           || ((view->num_type & NT_REL) && view->list_pos != old_pos)
+	           || (view->list_rows < old_rows &&
+	               view->top_line + (int)view->window_cells > view->list_rows)
+	           || draw_changed_entries(view, &changes) != 0;
+	free(changes.in_place);
+
+	if(full_redraw)
+	{
+		draw_dir_list_only(view);
+	}
+	fview_cursor_redraw(view);
+
+	if(view != curr_view)
+	{
+		put_inactive_mark(view);
+	}
+	if(curr_stats.number_of_windows != 1 || view == curr_view)
+	{
+		refresh_view_win(view);
+	}
+
+	return 0;
+}
+
+/* Removes outdated entries from the view and adds actual ones in their sorted
+ * positions.  Returns zero on success, otherwise non-zero is returned. */
+static int
+apply_dir_changes(FileView *view, dir_changes_t *changes)
+{
+	dir_entry_t *added;
+	int nadded = 0;
+	int recount_filtered = 0;
+	int i;
+
+	qsort(changes->names, changes->count, sizeof(*changes->names), &name_cmp);
+
+	update_entries_in_place(view, changes);
+
+	added = malloc(sizeof(*added)*changes->count);
+	if(changes->count != 0 && added == NULL)
+	{
+		return 1;
+	}
+
+	(void)zap_entries(view, view->dir_entry, &view->list_rows, &is_unchanged,
+			changes, 1);
+
+	for(i = 0; i < changes->count; ++i)
+	{
+		dir_entry_t *const entry = &added[nadded];
+
+		if(changes->updated[i])
+		{
+			continue;
+		}
+
+		init_dir_entry(view, entry, changes->names[i]);
+		if(entry->name == NULL || fill_dir_entry_by_path(entry, entry->name) != 0)
+		{
+			/* The file is gone, but it might have been counted as filtered out. */
+			recount_filtered |= !changes->listed[i];
+			free_dir_entry(view, entry);
+			continue;
+		}
+
+		if(entry_is_hidden(view, entry))
+		{
+			/* Only files that were displayed are known to not be counted as
+			 * filtered out yet. */
+			if(changes->listed[i])
+			{
+				++view->filtered;
+			}
+			else
+			{
+				recount_filtered = 1;
+			}
+			free_dir_entry(view, entry);
+			continue;
+		}
+
+		entry->selected = changes->selected[i];
+		++nadded;
+	}
+
+	i = merge_entries(view, added, nadded);
+	free(added);
+
+	if(i != -1 && (changes->first_moved == -1 || i < changes->first_moved))
+	{
+		changes->first_moved = i;
+	}
+
+	if(view->list_rows == 0)
+	{
+		return 1;
+	}
+
+	if(recount_filtered)
+	{
+		view->filtered = 0;
+		if(enum_dir_content(view->curr_dir, &count_filtered_file, view) != 0)
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/* Refreshes information about files of entries that are present in the list
+ * and stay at their positions.  Entries that can't be updated this way are left
+ * to be removed and added back.  Sets changes->first_moved to position of the
+ * first of them. */
+static void
+update_entries_in_place(FileView *view, dir_changes_t *changes)
+{
+	int i;
+
+	for(i = 0; i < view->list_rows; ++i)
+	{
+		dir_entry_t *const entry = &view->dir_entry[i];
+		char **const match = bsearch(&entry->name, changes->names, changes->count,
+				sizeof(*changes->names), &name_cmp);
+		if(match == NULL)
+		{
+			continue;
+		}
+
+		if(update_entry_in_place(view, i))
+		{
+			changes->updated[match - changes->names] = 1;
+			changes->in_place[changes->nin_place++] = i;
+		}
+		else if(changes->first_moved == -1)
+		{
+			changes->first_moved = i;
+		}
+	}
+}
+
+/* Re-reads information about file of the entry at position pos of the view.
+ * Returns non-zero if the entry was updated, otherwise zero is returned and the
+ * entry is left intact (the file is gone, changed its type or the entry would
+ * need to be moved to keep the list sorted). */
+static int
+update_entry_in_place(FileView *view, int pos)
+{
+	dir_entry_t *const entry = &view->dir_entry[pos];
+	const dir_entry_t old = *entry;
+
+	if(fill_dir_entry_by_path(entry, entry->name) != 0 ||
+			entry->type != old.type || !sort_is_in_order(view, pos))
+	{
+		*entry = old;
+		return 0;
+	}
+
+	/* Target of a symbolic link might have changed. */
+	entry->link_broken = -1;
+	entry->link_to_dir = -1;
+	return 1;
+}
+
+/* Draws entries of the view that were affected by changes: those updated in
+ * place and all entries starting with the first one that was added or removed.
+ * Returns zero on success, otherwise non-zero is returned and whole list should
+ * be redrawn. */
+static int
+draw_changed_entries(FileView *view, const dir_changes_t *changes)
+{
+	int i;
+
+	for(i = 0; i < changes->nin_place; ++i)
+	{
+		const int pos = changes->in_place[i];
+		/* Positions after the first moved entry are no longer valid and they are
+		 * drawn below anyway. */
+		if(changes->first_moved != -1 && pos >= changes->first_moved)
+		{
+			continue;
+		}
+
+		if(fview_draw_entries(view, pos, pos) != 0)
+		{
+			return 1;
+		}
+	}
+
+	if(changes->first_moved != -1)
+	{
+		return fview_draw_entries(view, changes->first_moved,
+				view->list_rows - 1);
+	}
+
+	return 0;
+}
+
+/* qsort() comparer for array of strings.  Returns standard -1, 0, 1 for
+ * comparisons. */
+static int
+name_cmp(const void *a, const void *b)
+{
+	return strcmp(*(const char **)a, *(const char **)b);
+}
+
+/* zap_entries() filter that removes entries which are listed in the set of
+ * changes remembering their state.  Returns non-zero to keep the entry. */
+static int
+is_unchanged(FileView *view, const dir_entry_t *entry, void *arg)
+{
+	dir_changes_t *const changes = arg;
+	char **const match = bsearch(&entry->name, changes->names, changes->count,
+			sizeof(*changes->names), &name_cmp);
+	int pos;
+
+	if(match == NULL)
+	{
+		return 1;
+	}
+
+	pos = match - changes->names;
+	if(changes->updated[pos])
+	{
+		return 1;
+	}
+
+	changes->listed[pos] = 1;
+	changes->selected[pos] = entry->selected;
+	return 0;
+}
+
+/* Checks whether file should be filtered out from the view.  Returns non-zero
+ * if so, otherwise zero is returned. */
+static int
+entry_is_hidden(FileView *view, const dir_entry_t *entry)
+{
+	return (view->hide_dot && entry->name[0] == '.')
+	    || !file_is_visible(view, entry->name, is_directory_entry(entry));
+}
+
+/* Inserts new entries into sorted list of the view.  Takes ownership of
+ * contents of the entries, but not of the array.  Returns position of the
+ * first inserted entry or -1 if nothing was inserted. */
+static int
+merge_entries(FileView *view, dir_entry_t *added, int nadded)
+{
+	dir_entry_t *list;
+	int *positions;
+	int first;
+	int i, j, k;
+
+	if(nadded == 0)
+	{
+		return -1;
+	}
+
+	list = realloc(view->dir_entry,
+			sizeof(*view->dir_entry)*(view->list_rows + nadded));
+	positions = malloc(sizeof(*positions)*nadded);
+	if(list == NULL || positions == NULL)
+	{
+		if(list != NULL)
+		{
+			view->dir_entry = list;
+		}
+		free(positions);
+		for(i = 0; i < nadded; ++i)
+		{
+			free_dir_entry(view, &added[i]);
+		}
+		show_error_msg("Memory Error", "Unable to allocate enough memory");
+		return -1;
+	}
+	view->dir_entry = list;
+
+	/* New entries are sorted, so their positions in the list don't decrease and
+	 * the list can be merged in a single pass from the end. */
+	sort_entries(view, added, nadded);
+	for(i = 0; i < nadded; ++i)
+	{
+		positions[i] = sort_find_insert_pos(view, &added[i]);
+	}
+
+	j = view->list_rows;
+	k = view->list_rows + nadded;
+	for(i = nadded - 1; i >= 0; --i)
+	{
+		const int count = j - positions[i];
+		k -= count;
+		j -= count;
+		memmove(&list[k], &list[j], sizeof(*list)*count);
+		list[--k] = added[i];
+	}
+
+	first = positions[0];
+	view->list_rows += nadded;
+	free(positions);
+	return first;
+}
+
+/* enum_dir_content() callback that counts files that are filtered out of the
+ * view the same way add_file_entry_to_view() does.  Returns zero. */
+static int
+count_filtered_file(const char name[], const void *data, void *param)
+{
+	FileView *const view = param;
+
+	if(is_builtin_dir(name))
+	{
+		return 0;
+	}
+
+	if((view->hide_dot && name[0] == '.') ||
+			!file_is_visible(view, name, data_is_dir_entry(data)))
+	{
+		++view->filtered;
+	}
+
+	return 0;
+}
+
+#endif
+
 int
 cd_is_possible(const char *path)
 {
@@ -2476,7 +3309,7 @@ get_file_size_by_entry(const FileView *view, size_t pos)
 	{
 		char full_path[PATH_MAX];
 		get_full_path_of(entry, sizeof(full_path), full_path);
-		tree_get_data(curr_stats.dirsize_cache, full_path, &size);
+		dcache_get(curr_stats.dirsize_cache, full_path, &size);
 	}
 
 	return (size == 0) ? entry->size : size;
@@ -269,6 +269,8 @@ int zap_entries(FileView *view, dir_entry_t *entries, int *count,
  * the found entry or NULL. */
 dir_entry_t * entry_from_path(dir_entry_t *entries, int count,
 		const char path[]);
+/* Changes name of the entry dropping data cached for the old name. */
+void rename_dir_entry(dir_entry_t *entry, const char new_name[]);
 /* Replaces all entries of the *entries with copy of with_entries elements. */
 void replace_dir_entries(FileView *view, dir_entry_t **entries, int *count,
 		const dir_entry_t *with_entries, int with_count);
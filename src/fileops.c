@@ -21,8 +21,6 @@
 
 #include <regex.h>
 
-#include <pthread.h>
-
 #include <fcntl.h>
 #include <sys/stat.h> /* stat */
 #include <sys/types.h> /* waitpid() */
@@ -35,6 +33,7 @@
 #include <assert.h> /* assert() */
 #include <ctype.h> /* isdigit() tolower() */
 #include <errno.h> /* errno */
+#include <limits.h> /* INT_MAX */
 #include <stddef.h> /* NULL size_t */
 #include <stdint.h> /* uint64_t */
 #include <stdio.h> /* snprintf() */
@@ -46,12 +45,14 @@
 #include "compat/os.h"
 #include "io/ioeta.h"
 #include "io/ionotif.h"
+#include "io/ior.h"
 #include "modes/dialogs/msg_dialog.h"
 #include "modes/cmdline.h"
 #include "modes/modes.h"
 #include "ui/cancellation.h"
 #include "ui/statusbar.h"
 #include "ui/ui.h"
+#include "utils/dcache.h"
 #ifdef _WIN32
 #include "utils/env.h"
 #endif
@@ -59,9 +60,9 @@
 #include "utils/fs_limits.h"
 #include "utils/macros.h"
 #include "utils/path.h"
+#include "utils/pwalk.h"
 #include "utils/str.h"
 #include "utils/string_array.h"
-#include "utils/tree.h"
 #include "utils/test_helpers.h"
 #include "utils/utils.h"
 #include "background.h"
@@ -131,6 +132,7 @@ typedef struct
 	char path[PATH_MAX];
 	int from_file;
 	int use_trash; /* Whether either source or destination is trash directory. */
+	int resume; /* Whether user agreed to continue interrupted copying. */
 }
 bg_args_t;
 
@@ -142,6 +144,23 @@ typedef struct
 }
 dir_size_args_t;
 
+/* State of directory size calculation passed to tree walker callbacks. */
+typedef struct
+{
+	int force;       /* Whether cached values should be ignored. */
+	bg_op_t *bg_op;  /* Background operation to report to or NULL. */
+}
+dir_size_walk_t;
+
+/* Trash directory picked for files of a directory, which saves looking it up
+ * for every file when many of them are deleted at once. */
+typedef struct
+{
+	char *base_dir;  /* Directory for which trash_dir was picked. */
+	char *trash_dir; /* Picked trash directory or NULL. */
+}
+trash_pick_t;
+
 static void io_progress_changed(const io_progress_t *const state);
 static int calc_io_progress(const io_progress_t *const state, int *skip);
 static void io_progress_fg(const io_progress_t *const state, int progress);
@@ -151,8 +170,12 @@ static char * format_file_progress(const ioeta_estim_t *estim, int precision);
 static void format_pretty_path(const char base_dir[], const char path[],
 		char pretty[], size_t pretty_size);
 static int prepare_register(int reg);
+static char * gen_trash_name_cached(trash_pick_t *pick, const char base_dir[],
+		const char name[]);
+static void free_trash_pick(trash_pick_t *pick);
 static void delete_files_in_bg(bg_op_t *bg_op, void *arg);
-static void delete_file_in_bg(ops_t *ops, const char path[], int use_trash);
+static void delete_file_in_bg(ops_t *ops, const char path[], int use_trash,
+		trash_pick_t *pick);
 TSTATIC int is_name_list_ok(int count, int nlines, char *list[], char *files[]);
 TSTATIC int is_rename_list_ok(char *files[], int *is_dup, int len,
 		char *list[]);
@@ -177,7 +200,6 @@ static int clone_file(const dir_entry_t *entry, const char path[],
 		const char clone[], ops_t *ops);
 static void put_decide_cb(const char dest_name[]);
 static void put_continue(int force);
-static int is_dir_entry(const char full_path[], const struct dirent* dentry);
 static int initiate_put_files(FileView *view, CopyMoveLikeOp op,
 				const char descr[], int reg_name);
 static OPS cmlo_to_op(CopyMoveLikeOp op);
@@ -198,7 +220,8 @@ static ops_t * get_ops(OPS main_op, const char descr[], const char base_dir[],
 static void progress_msg(const char text[], int ready, int total);
 static int cpmv_prepare(FileView *view, char ***list, int *nlines,
 		CopyMoveLikeOp op, int force, char undo_msg[], size_t undo_msg_len,
-		char *path, int *from_file, int *from_trash);
+		char *path, int *from_file, int *from_trash, int *resume);
+static int ask_about_resuming(const char dst[], int count, char *list[]);
 static int can_read_selected_files(FileView *view);
 static int check_dir_path(const FileView *view, const char path[], char buf[]);
 static char ** edit_list(size_t count, char **orig, int *nlines,
@@ -211,7 +234,8 @@ static progress_data_t * alloc_progress_data(int bg, void *info);
 static void free_ops(ops_t *ops);
 static void set_bg_descr(bg_op_t *bg_op, const char descr[]);
 static void cpmv_file_in_bg(ops_t *ops, const char src[], const char dst[],
-		int move, int force, int from_trash, const char dst_dir[]);
+		int move, int force, int from_trash, int resume, const char dst_dir[]);
+static int can_resume(const char dst[]);
 static int mv_file(const char src[], const char src_dir[], const char dst[],
 		const char dst_dir[], OPS op, int cancellable, ops_t *ops);
 static int mv_file_f(const char src[], const char dst[], OPS op, int bg,
@@ -232,7 +256,11 @@ static int check_if_dir_writable(DirRole dir_role, const char path[]);
 static void update_dir_entry_size(const FileView *view, int index, int force);
 static void start_dir_size_calc(const char path[], int force);
 static void dir_size_bg(bg_op_t *bg_op, void *arg);
-static void dir_size(char path[], int force);
+static void dir_size(char path[], int force, bg_op_t *bg_op);
+static uint64_t walk_dir_size(const char path[], int force, bg_op_t *bg_op);
+static int lookup_dir_size(const char path[], uint64_t *size, void *arg);
+static void store_dir_size(const char path[], uint64_t size, void *arg);
+static int dir_size_progress(const pwalk_stats_t *stats, void *arg);
 static void set_dir_size(const char path[], uint64_t size);
 static void redraw_after_path_change(FileView *view, const char path[]);
 
@@ -599,6 +627,7 @@ delete_files(FileView *view, int reg, int use_trash)
 	dir_entry_t *entry;
 	int nmarked_files;
 	ops_t *ops;
+	trash_pick_t pick = {};
 
 	if(!can_change_view_files(view))
 	{
@@ -646,7 +675,8 @@ delete_files(FileView *view, int reg, int use_trash)
 		{
 			if(!is_trash_directory(full_path))
 			{
-				char *const dest = gen_trash_name(entry->origin, entry->name);
+				char *const dest = gen_trash_name_cached(&pick, entry->origin,
+						entry->name);
 				if(dest != NULL)
 				{
 					result = perform_operation(OP_MOVE, ops, NULL, full_path, dest);
@@ -702,6 +732,8 @@ delete_files(FileView *view, int reg, int use_trash)
 		ops_advance(ops, result == 0);
 	}
 
+	free_trash_pick(&pick);
+
 	update_unnamed_reg(reg);
 
 	cmd_group_end();
@@ -717,6 +749,35 @@ delete_files(FileView *view, int reg, int use_trash)
 	return 1;
 }
 
+/* Generates name for a file of the base_dir in a trash directory.  Trash
+ * directory is picked only when base_dir differs from the one of the previous
+ * call with the same pick.  Returns newly allocated string or NULL. */
+static char *
+gen_trash_name_cached(trash_pick_t *pick, const char base_dir[],
+		const char name[])
+{
+	if(pick->base_dir == NULL || stroscmp(pick->base_dir, base_dir) != 0)
+	{
+		free_trash_pick(pick);
+		pick->base_dir = strdup(base_dir);
+		pick->trash_dir = pick_trash_dir(base_dir);
+	}
+
+	return (pick->trash_dir == NULL)
+	     ? NULL
+	     : gen_trash_name_in(pick->trash_dir, name);
+}
+
+/* Frees resources of the pick and resets it. */
+static void
+free_trash_pick(trash_pick_t *pick)
+{
+	free(pick->base_dir);
+	free(pick->trash_dir);
+	pick->base_dir = NULL;
+	pick->trash_dir = NULL;
+}
+
 /* Transforms "A-"Z register to "a-"z or clears the reg.  So that for "A-"Z new
  * values will be appended to "a-"z, for other registers old values will be
  * removed.  Returns possibly modified value of the reg parameter. */
@@ -784,11 +845,14 @@ delete_files_in_bg(bg_op_t *bg_op, void *arg)
 	size_t i;
 	bg_args_t *const args = arg;
 	ops_t *ops;
+	trash_pick_t pick = {};
+
+	bg_op_set_cancellable(bg_op);
 
 	ops = get_bg_ops(args->use_trash ? OP_REMOVE : OP_REMOVESL,
 			args->use_trash ? "deleting" : "Deleting", args->path, bg_op);
 
-	if(ops != NULL)
+	if(ops != NULL && !bg_op_cancelled(bg_op))
 	{
 		size_t i;
 		set_bg_descr(bg_op, "estimating...");
@@ -804,21 +868,23 @@ delete_files_in_bg(bg_op_t *bg_op, void *arg)
 		}
 	}
 
-	for(i = 0U; i < args->sel_list_len; ++i)
+	for(i = 0U; i < args->sel_list_len && !bg_op_cancelled(bg_op); ++i)
 	{
 		const char *const src = args->sel_list[i];
 		set_bg_descr(bg_op, src);
-		delete_file_in_bg(ops, src, args->use_trash);
+		delete_file_in_bg(ops, src, args->use_trash, &pick);
 		++bg_op->done;
 	}
 
+	free_trash_pick(&pick);
 	free_ops(ops);
 	free_bg_args(args);
 }
 
 /* Actual implementation of background file removal. */
 static void
-delete_file_in_bg(ops_t *ops, const char path[], int use_trash)
+delete_file_in_bg(ops_t *ops, const char path[], int use_trash,
+		trash_pick_t *pick)
 {
 	if(!use_trash)
 	{
@@ -828,9 +894,16 @@ delete_file_in_bg(ops_t *ops, const char path[], int use_trash)
 
 	if(!is_trash_directory(path))
 	{
+		char dir[PATH_MAX];
 		const char *const fname = get_last_path_component(path);
-		char *const trash_name = gen_trash_name(path, fname);
-		const char *const dest = (trash_name != NULL) ? trash_name : fname;
+		char *trash_name;
+		const char *dest;
+
+		copy_str(dir, sizeof(dir), path);
+		remove_last_path_component(dir);
+
+		trash_name = gen_trash_name_cached(pick, dir, fname);
+		dest = (trash_name != NULL) ? trash_name : fname;
 		(void)perform_operation(OP_MOVE, ops, (void *)1, path, dest);
 		free(trash_name);
 	}
@@ -880,7 +953,7 @@ rename_file_cb(const char new_name[])
 	/* Rename file in internal structures for correct positioning of cursor after
 	 * reloading, as cursor will be positioned on the file with the same name.
 	 * TODO: maybe create a function in ui or filelist to do this. */
-	(void)replace_string(&entry->name, new);
+	rename_dir_entry(entry, new);
 
 	ui_view_schedule_reload(curr_view);
 }
@@ -1067,7 +1140,7 @@ perform_renaming(FileView *view, char **files, int *is_dup, int len,
 				 * positioning of cursor after reloading, as cursor will be positioned
 				 * on the file with the same name.  For custom views rename to prevent
 				 * files from disappearing. */
-				(void)replace_string(&entry->name, new_name);
+				rename_dir_entry(entry, new_name);
 
 				if(flist_custom_active(view))
 				{
@@ -1075,7 +1148,7 @@ perform_renaming(FileView *view, char **files, int *is_dup, int len,
 							view->custom.entry_count, path);
 					if(entry != NULL)
 					{
-						(void)replace_string(&entry->name, new_name);
+						rename_dir_entry(entry, new_name);
 					}
 				}
 			}
@@ -2279,27 +2352,6 @@ clone_file(const dir_entry_t *entry, const char path[], const char clone[],
 	return 0;
 }
 
-/* Uses dentry to check file type and falls back to lstat() if dentry contains
- * unknown type. */
-static int
-is_dir_entry(const char full_path[], const struct dirent* dentry)
-{
-#ifndef _WIN32
-	struct stat s;
-	if(dentry->d_type != DT_UNKNOWN)
-	{
-		return dentry->d_type == DT_DIR;
-	}
-	if(os_lstat(full_path, &s) == 0 && s.st_ino != 0)
-	{
-		return (s.st_mode&S_IFMT) == S_IFDIR;
-	}
-	return 0;
-#else
-	return is_dir(full_path);
-#endif
-}
-
 int
 put_links(FileView *view, int reg_name, int relative)
 {
@@ -2883,17 +2935,21 @@ fixup_entry_after_rename(FileView *view, dir_entry_t *entry,
 		/* Rename file in internal structures for correct positioning of cursor
 		 * after reloading, as cursor will be positioned on the file with the same
 		 * name. */
-		(void)replace_string(&entry->name, new_fname);
+		rename_dir_entry(entry, new_fname);
 	}
 }
 
 static int
-is_copy_list_ok(const char *dst, int count, char **list)
+is_copy_list_ok(const char *dst, int count, char **list, int resume)
 {
 	int i;
 	for(i = 0; i < count; i++)
 	{
-		if(path_exists_at(dst, list[i], DEREF))
+		char full_path[PATH_MAX];
+		snprintf(full_path, sizeof(full_path), "%s/%s", dst, list[i]);
+
+		if(path_exists_at(dst, list[i], DEREF) &&
+				!(resume && can_resume(full_path)))
 		{
 			status_bar_errorf("File \"%s\" already exists", list[i]);
 			return 0;
@@ -2949,6 +3005,7 @@ cpmv_files(FileView *view, char **list, int nlines, CopyMoveLikeOp op,
 	char path[PATH_MAX];
 	int from_file;
 	int from_trash;
+	int resume;
 	ops_t *ops;
 
 	if((op == CMLO_LINK_REL || op == CMLO_LINK_ABS) && !symlinks_available())
@@ -2959,7 +3016,7 @@ cpmv_files(FileView *view, char **list, int nlines, CopyMoveLikeOp op,
 	}
 
 	err = cpmv_prepare(view, &list, &nlines, op, force, undo_msg,
-			sizeof(undo_msg), path, &from_file, &from_trash);
+			sizeof(undo_msg), path, &from_file, &from_trash, &resume);
 	if(err != 0)
 	{
 		return err > 0;
@@ -3006,6 +3063,7 @@ cpmv_files(FileView *view, char **list, int nlines, CopyMoveLikeOp op,
 
 		char dst_full[PATH_MAX];
 		const char *dst = custom_fnames ? list[i] : entry->name;
+		int append;
 		int err;
 
 		if(from_trash && !custom_fnames)
@@ -3016,7 +3074,8 @@ cpmv_files(FileView *view, char **list, int nlines, CopyMoveLikeOp op,
 		}
 
 		snprintf(dst_full, sizeof(dst_full), "%s/%s", path, dst);
-		if(path_exists(dst_full, DEREF) && !from_trash)
+		append = resume && !from_trash && can_resume(dst_full);
+		if(path_exists(dst_full, DEREF) && !from_trash && !append)
 		{
 			(void)perform_operation(OP_REMOVESL, NULL, NULL, dst_full, NULL);
 		}
@@ -3032,12 +3091,17 @@ cpmv_files(FileView *view, char **list, int nlines, CopyMoveLikeOp op,
 
 		if(op == CMLO_MOVE)
 		{
-			err = mv_file(entry->name, entry->origin, dst, path, OP_MOVE, 1, ops);
+			err = mv_file(entry->name, entry->origin, dst, path,
+					append ? OP_MOVEA : OP_MOVE, 1, ops);
 			if(err != 0)
 			{
 				view->list_pos = find_file_pos_in_list(view, entry->name);
 			}
 		}
+		else if(append)
+		{
+			err = mv_file(entry->name, entry->origin, dst, path, OP_COPYA, 1, ops);
+		}
 		else
 		{
 			err = cp_file(entry->origin, path, entry->name, dst, op, 1, ops);
@@ -3136,7 +3200,7 @@ cpmv_files_bg(FileView *view, char **list, int nlines, int move, int force)
 
 	err = cpmv_prepare(view, &list, &args->nlines, move ? CMLO_MOVE : CMLO_COPY,
 			force, task_desc, sizeof(task_desc), args->path, &args->from_file,
-			&args->use_trash);
+			&args->use_trash, &args->resume);
 	if(err != 0)
 	{
 		free_bg_args(args);
@@ -3159,13 +3223,14 @@ cpmv_files_bg(FileView *view, char **list, int nlines, int move, int force)
 }
 
 /* Performs general preparations for file copy/move-like operations: resolving
- * destination path, validating names, checking for conflicts, formatting undo
- * message.  Returns zero on success, otherwise positive number for status bar
- * message and negative number for other errors. */
+ * destination path, validating names, asking whether interrupted copying should
+ * be resumed, checking for conflicts, formatting undo message.  Returns zero on
+ * success, otherwise positive number for status bar message and negative number
+ * for other errors. */
 static int
 cpmv_prepare(FileView *view, char ***list, int *nlines, CopyMoveLikeOp op,
 		int force, char undo_msg[], size_t undo_msg_len, char *path, int *from_file,
-		int *from_trash)
+		int *from_trash, int *resume)
 {
 	char **marked;
 	size_t nmarked;
@@ -3213,15 +3278,26 @@ cpmv_prepare(FileView *view, char ***list, int *nlines, CopyMoveLikeOp op,
 		}
 	}
 
-	if(*nlines > 0 &&
-			(!is_name_list_ok(nmarked, *nlines, *list, NULL) ||
-			(!is_copy_list_ok(path, *nlines, *list) && !force)))
+	*resume = 0;
+	if(*nlines > 0 && !is_name_list_ok(nmarked, *nlines, *list, NULL))
 	{
 		error = 1;
 	}
-	if(*nlines == 0 && !force && !is_copy_list_ok(path, nmarked, marked))
+	else
 	{
-		error = 1;
+		const int count = (*nlines > 0) ? *nlines : (int)nmarked;
+		char **const names = (*nlines > 0) ? *list : marked;
+
+		if((op == CMLO_COPY || op == CMLO_MOVE) &&
+				!is_under_trash(view->curr_dir))
+		{
+			*resume = ask_about_resuming(path, count, names);
+		}
+
+		if(!force && !is_copy_list_ok(path, count, names, *resume))
+		{
+			error = 1;
+		}
 	}
 
 	free_string_array(marked, nmarked);
@@ -3251,6 +3327,29 @@ cpmv_prepare(FileView *view, char ***list, int *nlines, CopyMoveLikeOp op,
 	return 0;
 }
 
+/* Checks whether copying to any of the files in the dst directory was
+ * interrupted and asks user whether it should be continued.  Returns non-zero
+ * if it should, otherwise zero is returned. */
+static int
+ask_about_resuming(const char dst[], int count, char *list[])
+{
+	int i;
+	for(i = 0; i < count; ++i)
+	{
+		char full_path[PATH_MAX];
+		snprintf(full_path, sizeof(full_path), "%s/%s", dst, list[i]);
+
+		if(path_exists(full_path, DEREF) && can_resume(full_path))
+		{
+			return prompt_msg("Resume copying", "Copying to some of the files was "
+					"interrupted earlier.  Continue it instead of treating the files as "
+					"conflicting ones?  Only files whose source didn't change since then "
+					"will be continued.");
+		}
+	}
+	return 0;
+}
+
 /* Checks that all selected files can be read.  Returns non-zero if so,
  * otherwise zero is returned. */
 static int
@@ -3374,10 +3473,12 @@ cpmv_files_in_bg(bg_op_t *bg_op, void *arg)
 	const int custom_fnames = (args->nlines > 0);
 	ops_t *ops;
 
+	bg_op_set_cancellable(bg_op);
+
 	ops = get_bg_ops(args->move ? OP_MOVE : OP_COPY,
 			args->move ? "moving" : "copying", args->path, bg_op);
 
-	if(ops != NULL)
+	if(ops != NULL && !bg_op_cancelled(bg_op))
 	{
 		size_t i;
 		set_bg_descr(bg_op, "estimating...");
@@ -3389,13 +3490,13 @@ cpmv_files_in_bg(bg_op_t *bg_op, void *arg)
 		}
 	}
 
-	for(i = 0U; i < args->sel_list_len; ++i)
+	for(i = 0U; i < args->sel_list_len && !bg_op_cancelled(bg_op); ++i)
 	{
 		const char *const src = args->sel_list[i];
 		const char *const dst = custom_fnames ? args->list[i] : NULL;
 		set_bg_descr(bg_op, src);
 		cpmv_file_in_bg(ops, src, dst, args->move, args->force, args->use_trash,
-				args->path);
+				args->resume, args->path);
 		++bg_op->done;
 	}
 
@@ -3420,6 +3521,9 @@ get_bg_ops(OPS main_op, const char descr[], const char dir[], bg_op_t *bg_op)
 	ops = ops_alloc(main_op, descr, dir, dir);
 	pdata = alloc_progress_data(1, bg_op);
 	ops->estim = ioeta_alloc(pdata);
+	ops->estim->bg_op = bg_op;
+	ops->estim->limit = bg_op->limit;
+	ops->estim->shared_limit = bg_get_shared_io_limit();
 
 	return ops;
 }
@@ -3470,7 +3574,7 @@ set_bg_descr(bg_op_t *bg_op, const char descr[])
 /* Actual implementation of background file copying/moving. */
 static void
 cpmv_file_in_bg(ops_t *ops, const char src[], const char dst[], int move,
-		int force, int from_trash, const char dst_dir[])
+		int force, int from_trash, int resume, const char dst_dir[])
 {
 	char dst_full[PATH_MAX];
 
@@ -3487,6 +3591,12 @@ cpmv_file_in_bg(ops_t *ops, const char src[], const char dst[], int move,
 	}
 
 	snprintf(dst_full, sizeof(dst_full), "%s/%s", dst_dir, dst);
+	if(resume && !from_trash && can_resume(dst_full))
+	{
+		(void)mv_file_f(src, dst_full, move ? OP_MOVEA : OP_COPYA, 1, 0, ops);
+		return;
+	}
+
 	if(path_exists(dst_full, DEREF) && !from_trash)
 	{
 		perform_operation(OP_REMOVESL, NULL, (void *)1, dst_full, NULL);
@@ -3502,6 +3612,14 @@ cpmv_file_in_bg(ops_t *ops, const char src[], const char dst[], int move,
 	}
 }
 
+/* Checks whether interrupted copying to the dst can be continued.  Returns
+ * non-zero if so, otherwise zero is returned. */
+static int
+can_resume(const char dst[])
+{
+	return cfg.use_system_calls && ior_can_resume(dst);
+}
+
 /* Adapter for mv_file_f() that accepts paths broken into directory/file
  * parts. */
 static int
@@ -3967,6 +4085,8 @@ start_dir_size_calc(const char path[], int force)
 {
 	char task_desc[PATH_MAX];
 	dir_size_args_t *args;
+	struct stat st;
+	uint64_t device = 0U;
 
 	args = malloc(sizeof(*args));
 	args->path = strdup(path);
@@ -3974,7 +4094,14 @@ start_dir_size_calc(const char path[], int force)
 
 	snprintf(task_desc, sizeof(task_desc), "Calculating size: %s", path);
 
-	if(bg_execute(task_desc, BG_UNDEFINED_TOTAL, 0, &dir_size_bg, args) != 0)
+	/* Walks of the same device compete for it, so run them one by one. */
+	if(os_stat(path, &st) == 0)
+	{
+		device = (uint64_t)st.st_dev + 1U;
+	}
+
+	if(bg_execute_grouped(task_desc, BG_UNDEFINED_TOTAL, 0, device, &dir_size_bg,
+				args) != 0)
 	{
 		free(args->path);
 		free(args);
@@ -3990,7 +4117,11 @@ dir_size_bg(bg_op_t *bg_op, void *arg)
 {
 	dir_size_args_t *const args = arg;
 
-	dir_size(args->path, args->force);
+	bg_op_set_cancellable(bg_op);
+	if(!bg_op_cancelled(bg_op))
+	{
+		dir_size(args->path, args->force, bg_op);
+	}
 
 	free(args->path);
 	free(args);
@@ -3999,9 +4130,9 @@ dir_size_bg(bg_op_t *bg_op, void *arg)
 /* Calculates directory size and triggers view updates if necessary.  Changes
  * path. */
 static void
-dir_size(char path[], int force)
+dir_size(char path[], int force, bg_op_t *bg_op)
 {
-	(void)calculate_dir_size(path, force);
+	(void)walk_dir_size(path, force, bg_op);
 
 	remove_last_path_component(path);
 
@@ -4009,67 +4140,79 @@ dir_size(char path[], int force)
 	redraw_after_path_change(&rwin, path);
 }
 
-/* Calculates size of a directory possibly using cache of known sizes.  Returns
- * size of a directory or zero on error. */
 uint64_t
 calculate_dir_size(const char path[], int force_update)
 {
-	DIR* dir;
-	struct dirent* dentry;
-	const char* slash = "";
-	uint64_t size;
+	return walk_dir_size(path, force_update, NULL);
+}
 
-	dir = os_opendir(path);
-	if(dir == NULL)
-	{
-		return 0;
-	}
+/* Calculates size of a directory possibly using cache of known sizes, sizes of
+ * all traversed subdirectories are cached.  The tree is walked by several
+ * threads.  bg_op can be NULL.  Returns size of a directory or zero on error or
+ * cancellation. */
+static uint64_t
+walk_dir_size(const char path[], int force, bg_op_t *bg_op)
+{
+	dir_size_walk_t state = { .force = force, .bg_op = bg_op };
+	const pwalk_params_t params = {
+		.lookup = &lookup_dir_size,
+		.store = &store_dir_size,
+		.progress = (bg_op == NULL) ? NULL : &dir_size_progress,
+		.arg = &state,
+	};
+	pwalk_stats_t stats;
 
-	if(!ends_with_slash(path))
+	if(pwalk(path, &params, &stats) != 0)
 	{
-		slash = "/";
+		return 0U;
 	}
+	return stats.bytes;
+}
 
-	size = 0;
-	while((dentry = os_readdir(dir)) != NULL)
-	{
-		char buf[PATH_MAX];
+/* Implementation of pwalk_lookup_func for directory size calculation.  Returns
+ * zero if size is known, otherwise non-zero is returned. */
+static int
+lookup_dir_size(const char path[], uint64_t *size, void *arg)
+{
+	const dir_size_walk_t *const state = arg;
+	return state->force || dcache_get(curr_stats.dirsize_cache, path, size) != 0;
+}
 
-		if(is_builtin_dir(dentry->d_name))
-		{
-			continue;
-		}
+/* Implementation of pwalk_store_func for directory size calculation. */
+static void
+store_dir_size(const char path[], uint64_t size, void *arg)
+{
+	set_dir_size(path, size);
+}
 
-		snprintf(buf, sizeof(buf), "%s%s%s", path, slash, dentry->d_name);
-		if(is_dir_entry(buf, dentry))
-		{
-			uint64_t dir_size = 0;
-			if(tree_get_data(curr_stats.dirsize_cache, buf, &dir_size) != 0
-					|| force_update)
-				dir_size = calculate_dir_size(buf, force_update);
-			size += dir_size;
-		}
-		else
-		{
-			size += get_file_size(buf);
-		}
-	}
+/* Implementation of pwalk_progress_func for directory size calculation.
+ * Returns non-zero if calculation should be stopped. */
+static int
+dir_size_progress(const pwalk_stats_t *stats, void *arg)
+{
+	const dir_size_walk_t *const state = arg;
+	bg_op_t *const bg_op = state->bg_op;
 
-	os_closedir(dir);
+	bg_op_lock(bg_op);
+	bg_op->done = (stats->dirs > INT_MAX) ? INT_MAX : (int)stats->dirs;
+	bg_op_unlock(bg_op);
 
-	set_dir_size(path, size);
-	return size;
+	return bg_op_cancelled(bg_op);
 }
 
-/* Updates cached directory size in a thread-safe way. */
+/* Updates cached directory size.  The size is stored for both the path and its
+ * canonical form, so that lookups can use paths as they are without resolving
+ * them. */
 static void
 set_dir_size(const char path[], uint64_t size)
 {
-	static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+	char real_path[PATH_MAX];
 
-	pthread_mutex_lock(&mutex);
-	tree_set_data(curr_stats.dirsize_cache, path, size);
-	pthread_mutex_unlock(&mutex);
+	dcache_set(curr_stats.dirsize_cache, path, size);
+	if(realpath(path, real_path) == real_path && stroscmp(real_path, path) != 0)
+	{
+		dcache_set(curr_stats.dirsize_cache, real_path, size);
+	}
 }
 
 /* Schedules view redraw in case path change might have affected it. */
@@ -28,6 +28,7 @@
 
 #include <assert.h> /* assert() */
 #include <stddef.h> /* NULL size_t */
+#include <stdlib.h> /* abs() */
 #include <string.h> /* strcpy() strlen() */
 
 #include "cfg/config.h"
@@ -67,8 +68,11 @@ static void calculate_number_width(FileView *view);
 static int count_digits(int num);
 static int calculate_top_position(FileView *view, int top);
 static int get_line_color(const FileView *view, int pos);
+static int is_link_broken(const FileView *view, int pos);
 static size_t calculate_print_width(const FileView *view, int i,
 		size_t max_width);
+static void draw_cell_of(FileView *view, int pos, size_t cell,
+		size_t col_count, size_t col_width);
 static void draw_cell(const FileView *view, const column_data_t *cdt,
 		size_t col_width, size_t print_width);
 static void consider_scroll_bind(FileView *view);
@@ -104,6 +108,7 @@ static size_t get_max_filename_width(const FileView *view);
 static size_t get_filename_width(const FileView *view, int i);
 static size_t get_filetype_decoration_width(FileType type);
 static int move_curr_line(FileView *view);
+static int redraw_scrolled(FileView *view, int old_top);
 static void reset_view_columns(FileView *view);
 
 void
@@ -191,7 +196,6 @@ draw_dir_list_only(FileView *view)
 	size_t cell;
 	size_t col_width;
 	size_t col_count;
-	int coll_pad;
 	int top = view->top_line;
 
 	if(curr_stats.load_stage < 2)
@@ -224,21 +228,9 @@ draw_dir_list_only(FileView *view)
 	ui_view_erase(view);
 
 	cell = 0U;
-	coll_pad = (view->ls_view && cfg.filelist_col_padding) ? 1 : 0;
 	for(x = top; x < view->list_rows; ++x)
 	{
-		const column_data_t cdt = {
-			.view = view,
-			.line_pos = x,
-			.line_hi_group = get_line_color(view, x),
-			.is_current = (view == curr_view) ? x == view->list_pos : 0,
-			.current_line = cell/col_count,
-			.column_offset = (cell%col_count)*col_width,
-		};
-
-		const size_t print_width = calculate_print_width(view, x, col_width);
-
-		draw_cell(view, &cdt, col_width - coll_pad, print_width);
+		draw_cell_of(view, x, cell, col_count, col_width);
 
 		++cell;
 		if(cell >= view->window_cells)
@@ -258,6 +250,59 @@ draw_dir_list_only(FileView *view)
 	ui_view_win_changed(view);
 }
 
+int
+fview_draw_entries(FileView *view, int first, int last)
+{
+	const int old_num_width = view->real_num_width;
+	size_t col_width;
+	size_t col_count;
+	int pos;
+
+	if(curr_stats.load_stage < 2)
+	{
+		return 0;
+	}
+
+	calculate_table_conf(view, &col_count, &col_width);
+	if(view->real_num_width != old_num_width)
+	{
+		return 1;
+	}
+
+	first = MAX(first, view->top_line);
+	last = MIN(last, view->top_line + (int)view->window_cells - 1);
+	last = MIN(last, view->list_rows - 1);
+
+	for(pos = first; pos <= last; ++pos)
+	{
+		draw_cell_of(view, pos, pos - view->top_line, col_count, col_width);
+	}
+
+	ui_view_win_changed(view);
+	return 0;
+}
+
+/* Draws cell-th visible cell of the view, which displays entry at pos. */
+static void
+draw_cell_of(FileView *view, int pos, size_t cell, size_t col_count,
+		size_t col_width)
+{
+	const int coll_pad = (view->ls_view && cfg.filelist_col_padding) ? 1 : 0;
+
+	const column_data_t cdt = {
+		.view = view,
+		.line_pos = pos,
+		.line_hi_group = get_line_color(view, pos),
+		.is_current = (view == curr_view) ? pos == view->list_pos : 0,
+		.current_line = cell/col_count,
+		.column_offset = (cell%col_count)*col_width,
+	};
+
+	const size_t print_width = calculate_print_width(view, pos, col_width);
+
+	draw_cell(view, &cdt, col_width - coll_pad, print_width);
+}
+
 /* Calculates number of columns and maximum width of column in a view. */
 static void
 calculate_table_conf(FileView *view, size_t *count, size_t *width)
@@ -354,22 +399,14 @@ get_line_color(const FileView *view, int pos)
 			}
 			else
 			{
-				char full[PATH_MAX];
-				get_full_path_at(view, pos, sizeof(full), full);
-				if(get_link_target_abs(full, view->dir_entry[pos].origin, full,
-							sizeof(full)) != 0)
+				/* The check involves several system calls, so do it once per entry
+				 * rather than on every redraw. */
+				dir_entry_t *const entry = &view->dir_entry[pos];
+				if(entry->link_broken < 0)
 				{
-					return BROKEN_LINK_COLOR;
+					entry->link_broken = is_link_broken(view, pos);
 				}
-
-				/* Assume that targets on slow file system are not broken as actual
-				 * check might take long time. */
-				if(is_on_slow_fs(full))
-				{
-					return LINK_COLOR;
-				}
-
-				return path_exists(full, DEREF) ? LINK_COLOR : BROKEN_LINK_COLOR;
+				return entry->link_broken ? BROKEN_LINK_COLOR : LINK_COLOR;
 			}
 #ifndef _WIN32
 		case FT_SOCK:
@@ -386,6 +423,29 @@ get_line_color(const FileView *view, int pos)
 	}
 }
 
+/* Checks whether symbolic link at pos points to nowhere.  Returns non-zero if
+ * so, otherwise zero is returned. */
+static int
+is_link_broken(const FileView *view, int pos)
+{
+	char full[PATH_MAX];
+	get_full_path_at(view, pos, sizeof(full), full);
+	if(get_link_target_abs(full, view->dir_entry[pos].origin, full,
+				sizeof(full)) != 0)
+	{
+		return 1;
+	}
+
+	/* Assume that targets on slow file system are not broken as actual check
+	 * might take long time. */
+	if(is_on_slow_fs(full))
+	{
+		return 0;
+	}
+
+	return !path_exists(full, DEREF);
+}
+
 /* Calculates width of the column using entry and maximum width. */
 static size_t
 calculate_print_width(const FileView *view, int i, size_t max_width)
@@ -1228,23 +1288,30 @@ get_max_filename_width(const FileView *view)
 }
 
 /* Gets filename width (length in character positions on the screen) of ith
- * entry of the view.  Returns the width. */
+ * entry of the view.  Width of the name is computed once and cached in the
+ * entry, because this is called for every entry on list updates and for every
+ * visible one on redraws.  Returns the width. */
 static size_t
 get_filename_width(const FileView *view, int i)
 {
+	dir_entry_t *const entry = &view->dir_entry[i];
 	const FileType target_type = ui_view_entry_target_type(view, i);
-	size_t name_len;
-	if(flist_custom_active(view))
-	{
-		char name[NAME_MAX];
-		get_short_path_of(view, &view->dir_entry[i], 0, sizeof(name), name);
-		name_len = get_screen_string_length(name);
-	}
-	else
+
+	if(entry->name_width == 0)
 	{
-		name_len = get_screen_string_length(view->dir_entry[i].name);
+		if(flist_custom_active(view))
+		{
+			char name[NAME_MAX];
+			get_short_path_of(view, entry, 0, sizeof(name), name);
+			entry->name_width = get_screen_string_length(name);
+		}
+		else
+		{
+			entry->name_width = get_screen_string_length(entry->name);
+		}
 	}
-	return name_len + get_filetype_decoration_width(target_type);
+
+	return entry->name_width + get_filetype_decoration_width(target_type);
 }
 
 /* Returns additional number of characters which are needed to display names of
@@ -1261,6 +1328,7 @@ void
 fview_position_updated(FileView *view)
 {
 	int redraw = 0;
+	int old_top;
 	size_t col_width;
 	size_t col_count;
 	size_t print_width;
@@ -1281,6 +1349,7 @@ fview_position_updated(FileView *view)
 
 	erase_current_line_bar(view);
 
+	old_top = view->top_line;
 	redraw = move_curr_line(view);
 
 	if(curr_stats.load_stage < 2)
@@ -1290,7 +1359,10 @@ fview_position_updated(FileView *view)
 
 	if(redraw)
 	{
-		draw_dir_list(view);
+		if(!redraw_scrolled(view, old_top))
+		{
+			draw_dir_list(view);
+		}
 		clear_current_line_bar(view, 0);
 	}
 
@@ -1361,6 +1433,59 @@ move_curr_line(FileView *view)
 	return redraw != 0 || (view->num_type & NT_REL);
 }
 
+/* Updates view after scrolling by shifting contents of its window and drawing
+ * only cells that became visible, which is much cheaper than full redraw for
+ * scrolling by few lines at a time.  Returns non-zero on success, otherwise
+ * zero is returned meaning that full redraw is needed. */
+static int
+redraw_scrolled(FileView *view, int old_top)
+{
+	size_t col_width;
+	size_t col_count;
+	int delta, nrows;
+	int row, last_row;
+
+	/* Other view or numbers might need an update as well. */
+	if(view != curr_view || cfg.scroll_bind || (view->num_type & NT_REL))
+	{
+		return 0;
+	}
+
+	calculate_table_conf(view, &col_count, &col_width);
+
+	delta = view->top_line - old_top;
+	nrows = view->window_rows + 1;
+	if(delta == 0 || delta%(int)col_count != 0 ||
+			abs(delta)/(int)col_count >= nrows)
+	{
+		return 0;
+	}
+	delta /= (int)col_count;
+
+	ui_view_scroll(view, delta);
+
+	row = (delta > 0) ? nrows - delta : 0;
+	last_row = (delta > 0) ? nrows : -delta;
+	for(; row < last_row; ++row)
+	{
+		size_t col;
+		for(col = 0U; col < col_count; ++col)
+		{
+			const size_t cell = row*col_count + col;
+			const int pos = view->top_line + cell;
+			if(pos >= view->list_rows)
+			{
+				break;
+			}
+			draw_cell_of(view, pos, cell, col_count, col_width);
+		}
+	}
+
+	view->curr_line = view->list_pos - view->top_line;
+	ui_view_win_changed(view);
+	return 1;
+}
+
 void
 fview_sorting_updated(FileView *view)
 {
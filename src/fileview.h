@@ -44,6 +44,13 @@ void draw_dir_list(FileView *view);
  * draw_dir_list(). */
 void draw_dir_list_only(FileView *view);
 
+/* Redraws only visible cells of the view that display entries at positions in
+ * the [first, last] range.  Layout of the view (top line, columns) is expected
+ * to be the same as on the last full redraw.  Returns zero on success, otherwise
+ * non-zero is returned if layout has changed and whole list needs to be
+ * redrawn. */
+int fview_draw_entries(FileView *view, int first, int last);
+
 /* Updates view (maybe postponed) on the screen (redraws file list and
  * cursor). */
 void redraw_view(FileView *view);
@@ -26,6 +26,9 @@
 
 /* ioc - I/O common - Input/Output common */
 
+/* Maximum number of threads that process files of directories. */
+#define IO_MAX_THREADS 64
+
 /* Conflict resolution strategy.  Defines what to do if destination path already
  * exists. */
 typedef enum
@@ -93,6 +96,11 @@ struct io_args_t
 
 	int cancellable;
 
+	/* Maximum number of threads that process files of directories.  Values less
+	 * than two disable parallel processing, values greater than IO_MAX_THREADS
+	 * are not allowed. */
+	int nthreads;
+
 	/* File overwrite confirmation callback.  Set to NULL to silently
 	 * overwrite. */
 	io_confirm confirm;
@@ -100,6 +108,11 @@ struct io_args_t
 	/* Set to NULL to do not use estimates. */
 	ioeta_estim_t *estim;
 
+	/* Journal of copying that records its progress, managed by ior_cp().  Files
+	 * are resumed according to the journal when conflict resolution strategy is
+	 * IO_CRS_APPEND_TO_FILES.  NULL when journaling is not performed. */
+	struct journal_t *journal;
+
 	io_result_t result; /* TODO: use this. */
 };
 
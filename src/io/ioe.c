@@ -0,0 +1,81 @@
+/* vifm
+ * Copyright (C) 2015 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "ioe.h"
+
+#include <stddef.h> /* NULL size_t */
+#include <stdlib.h> /* free() realloc() */
+#include <string.h> /* strdup() */
+
+void
+io_errlst_init(io_errlst_t *lst)
+{
+	lst->errors = NULL;
+	lst->error_count = 0U;
+}
+
+int
+io_errlst_append(io_errlst_t *lst, const char path[], int error_code,
+		const char msg[])
+{
+	io_err_t *err;
+	io_err_t *const errors = realloc(lst->errors,
+			sizeof(*errors)*(lst->error_count + 1U));
+	if(errors == NULL)
+	{
+		return 0;
+	}
+	lst->errors = errors;
+
+	err = &lst->errors[lst->error_count];
+	err->path = strdup(path);
+	err->error_code = error_code;
+	err->msg = strdup(msg);
+	if(err->path == NULL || err->msg == NULL)
+	{
+		free(err->path);
+		free(err->msg);
+		return 0;
+	}
+
+	++lst->error_count;
+	return 1;
+}
+
+void
+io_errlst_free(io_errlst_t *lst)
+{
+	size_t i;
+
+	if(lst == NULL)
+	{
+		return;
+	}
+
+	for(i = 0U; i < lst->error_count; ++i)
+	{
+		free(lst->errors[i].path);
+		free(lst->errors[i].msg);
+	}
+	free(lst->errors);
+
+	io_errlst_init(lst);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -19,6 +19,8 @@
 #ifndef VIFM__IO__IOE_H__
 #define VIFM__IO__IOE_H__
 
+#include <stddef.h> /* size_t */
+
 /* ioe - I/O error reporting - Input/Output error reporting */
 
 enum
@@ -18,22 +18,38 @@
 
 #include "ioeta.h"
 
+#include <pthread.h> /* pthread_mutex_* pthread_self() */
+
 #include <assert.h> /* assert() */
 #include <stddef.h> /* NULL size_t */
 #include <stdint.h> /* uint64_t */
 #include <stdlib.h> /* calloc() free() */
 
-#include "../ui/cancellation.h"
+#include "../utils/fs.h"
+#include "../utils/pwalk.h"
 #include "private/ioeta.h"
-#include "private/traverser.h"
+#include "private/manifest.h"
 
-static VisitResult eta_visitor(const char full_path[], VisitAction action,
-		void *param);
+static int eta_visitor(const char path[], PWalkEntry type, uint64_t size,
+		void *arg);
+static int eta_progress(const pwalk_stats_t *stats, void *arg);
 
 ioeta_estim_t *
 ioeta_alloc(void *param)
 {
 	ioeta_estim_t *const estim = calloc(1U, sizeof(*estim));
+	if(estim == NULL)
+	{
+		return NULL;
+	}
+
+	if(pthread_mutex_init(&estim->lock, NULL) != 0)
+	{
+		free(estim);
+		return NULL;
+	}
+
+	estim->owner = pthread_self();
 	estim->param = param;
 	return estim;
 }
@@ -44,6 +60,11 @@ ioeta_free(ioeta_estim_t *estim)
 	if(estim != NULL)
 	{
 		free(estim->item);
+		free(estim->target);
+		free(estim->next_item);
+		free(estim->next_target);
+		manifest_free(estim->manifest);
+		pthread_mutex_destroy(&estim->lock);
 		free(estim);
 	}
 }
@@ -55,38 +76,79 @@ ioeta_calculate(ioeta_estim_t *estim, const char path[], int shallow)
 	{
 		ioeta_add_item(estim, path);
 	}
+	else if(is_symlink(path) || !is_dir(path))
+	{
+		/* Treat symbolic links to directories as files as well. */
+		ioeta_add_file(estim, path);
+	}
 	else
 	{
-		(void)traverse(path, &eta_visitor, estim);
+		/* Directories are read in parallel, while the estimation is updated only
+		 * from this thread. */
+		const pwalk_params_t params = {
+			.visit = &eta_visitor,
+			.progress = &eta_progress,
+			.arg = estim,
+		};
+
+		if(estim->manifest == NULL)
+		{
+			estim->manifest = manifest_alloc();
+		}
+
+		if(pwalk(path, &params, NULL) != 0 && estim->manifest != NULL)
+		{
+			/* Partial list of entries is of no use. */
+			manifest_invalidate(estim->manifest);
+		}
 	}
 }
 
-/* Implementation of traverse() visitor for subtree copying.  Returns 0 on
- * success, otherwise non-zero is returned. */
-static VisitResult
-eta_visitor(const char full_path[], VisitAction action, void *param)
+/* Implementation of pwalk() visitor for subtree estimation.  Returns non-zero
+ * to cancel the walk. */
+static int
+eta_visitor(const char path[], PWalkEntry type, uint64_t size, void *arg)
 {
-	ioeta_estim_t *const estim = param;
+	ioeta_estim_t *const estim = arg;
 
-	if(ui_cancellation_requested())
+	if(ioeta_cancelled(estim, 1))
 	{
-		return VR_CANCELLED;
+		return 1;
 	}
 
-	switch(action)
+	if(estim->manifest != NULL)
 	{
-		case VA_DIR_ENTER:
-			ioeta_add_dir(estim, full_path);
-			return VR_SKIP_DIR_LEAVE;
-		case VA_FILE:
-			ioeta_add_file(estim, full_path);
-			return VR_OK;
-		case VA_DIR_LEAVE:
-			assert(0 && "Can't get here because of VR_SKIP_DIR_LEAVE.");
-			return VR_OK;
+		manifest_add(estim->manifest, path, type, size);
 	}
 
-	return VR_OK;
+	switch(type)
+	{
+		case PWE_DIR:
+			ioeta_add_dir(estim, path);
+			break;
+		case PWE_FILE:
+			estim->total_bytes += size;
+			ioeta_add_item(estim, path);
+			break;
+		case PWE_LINK:
+			/* Size of symbolic links isn't counted. */
+			ioeta_add_item(estim, path);
+			break;
+		case PWE_FAIL:
+			/* Operations will fail on this directory, nothing to estimate. */
+			break;
+	}
+
+	return 0;
+}
+
+/* Implementation of pwalk() progress callback, which is used only to check for
+ * cancellation while there is nothing to visit.  Returns non-zero to cancel
+ * the walk. */
+static int
+eta_progress(const pwalk_stats_t *stats, void *arg)
+{
+	return ioeta_cancelled(arg, 1);
 }
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
@@ -19,6 +19,8 @@
 #ifndef VIFM__IO__IOETA_H__
 #define VIFM__IO__IOETA_H__
 
+#include <pthread.h> /* pthread_mutex_t pthread_t */
+
 #include <stddef.h> /* size_t */
 #include <stdint.h> /* uint64_t */
 
@@ -56,11 +58,50 @@ typedef struct
 	 * removal). */
 	char *target;
 
+	/* Sizes of buffers of item and target, which are reused to avoid allocating
+	 * memory for every file. */
+	size_t item_size;
+	size_t target_size;
+
+	/* Time of the last notification about progress of the operation in
+	 * microseconds.  Used to limit rate of notifications. */
+	uint64_t last_notified;
+
 	/* Progress reported while this flag is on is ignored. */
 	int silent;
 
+	/* Limits of processing rate of this operation and of a group of operations
+	 * it belongs to.  Progress updates sleep to satisfy them.  Not owned, NULL
+	 * means no limit. */
+	struct iolimit_t *limit;
+	struct iolimit_t *shared_limit;
+
+	/* Background operation this estimation belongs to, NULL for operations of
+	 * foreground.  Used to stop waiting for limits on cancellation. */
+	struct bg_op_t *bg_op;
+
 	/* Custom parameter for notification callbacks. */
 	void *param;
+
+	/* Entries found during estimation, which are reused by operations instead
+	 * of traversing the same subtrees again.  NULL until there are some. */
+	struct manifest_t *manifest;
+
+	/* Paths reported by threads other than the owner, which are moved to item
+	 * and target on the next notification.  Only the owner changes item and
+	 * target, so notification handlers can read them without locking. */
+	char *next_item;
+	char *next_target;
+	size_t next_item_size;
+	size_t next_target_size;
+	int has_next_item;
+	int has_next_target;
+
+	/* Progress can be updated by several threads at once (e.g., by workers of
+	 * parallel copying), but only the thread that allocated the estimation
+	 * notifies about it.  Counters are updated atomically. */
+	pthread_mutex_t lock; /* Protects next_* fields. */
+	pthread_t owner;      /* Thread that sends notifications. */
 }
 ioeta_estim_t;
 
@@ -72,7 +113,8 @@ void ioeta_free(ioeta_estim_t *estim);
 
 /* Calculates estimates for a subtree rooted at path.  Adds them up to values
  * already present in the estim.  Shallow estimation doesn't recur into
- * directories. */
+ * directories.  Deep estimation remembers subtree of a directory in the
+ * manifest, so operations see the subtree as it was at this point. */
 void ioeta_calculate(ioeta_estim_t *estim, const char path[], int shallow);
 
 #endif /* VIFM__IO__IOETA_H__ */
@@ -0,0 +1,258 @@
+/* vifm
+ * Copyright (C) 2015 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "iolimit.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#include <pthread.h> /* pthread_mutex_* */
+#include <sys/time.h> /* gettimeofday() timeval */
+#include <unistd.h> /* usleep() */
+
+#include <stddef.h> /* NULL */
+#include <stdint.h> /* uint64_t */
+#include <stdlib.h> /* free() malloc() */
+
+/* Maximum time of a single sleep in microseconds, which bounds delay of
+ * picking up new rates. */
+#define MAX_SLEEP_US 50000U
+
+/* Number of microseconds in a second. */
+#define US_PER_SEC 1000000.0
+
+/* Single token bucket. */
+typedef struct
+{
+	uint64_t rate;     /* Tokens per second, zero means no limit. */
+	double tokens;     /* Available tokens, negative when in debt. */
+	uint64_t consumed; /* Total number of consumed tokens. */
+}
+bucket_t;
+
+/* Pair of token buckets. */
+struct iolimit_t
+{
+	pthread_mutex_t lock; /* Protects all the fields below. */
+	bucket_t bytes;       /* Limit on number of processed bytes. */
+	bucket_t files;       /* Limit on number of processed files. */
+	uint64_t created;     /* Time of creation in microseconds. */
+	uint64_t refilled;    /* Time of the last refill in microseconds. */
+};
+
+static void refill(iolimit_t *limit);
+static void refill_bucket(bucket_t *bucket, uint64_t elapsed);
+static uint64_t get_wait_time(const bucket_t *bucket);
+static void sleep_us(uint64_t us);
+static uint64_t get_observed_rate(const bucket_t *bucket, uint64_t elapsed);
+static uint64_t get_time_us(void);
+
+iolimit_t *
+iolimit_alloc(void)
+{
+	iolimit_t *const limit = malloc(sizeof(*limit));
+	if(limit == NULL)
+	{
+		return NULL;
+	}
+
+	if(pthread_mutex_init(&limit->lock, NULL) != 0)
+	{
+		free(limit);
+		return NULL;
+	}
+
+	limit->bytes.rate = 0U;
+	limit->bytes.tokens = 0.0;
+	limit->bytes.consumed = 0U;
+	limit->files = limit->bytes;
+	limit->created = get_time_us();
+	limit->refilled = limit->created;
+
+	return limit;
+}
+
+void
+iolimit_free(iolimit_t *limit)
+{
+	if(limit != NULL)
+	{
+		pthread_mutex_destroy(&limit->lock);
+		free(limit);
+	}
+}
+
+void
+iolimit_set(iolimit_t *limit, uint64_t bytes_rate, uint64_t files_rate)
+{
+	pthread_mutex_lock(&limit->lock);
+	refill(limit);
+	limit->bytes.rate = bytes_rate;
+	limit->files.rate = files_rate;
+	pthread_mutex_unlock(&limit->lock);
+}
+
+void
+iolimit_get(iolimit_t *limit, uint64_t *bytes_rate, uint64_t *files_rate)
+{
+	pthread_mutex_lock(&limit->lock);
+	*bytes_rate = limit->bytes.rate;
+	*files_rate = limit->files.rate;
+	pthread_mutex_unlock(&limit->lock);
+}
+
+void
+iolimit_get_observed(iolimit_t *limit, uint64_t *bytes_rate,
+		uint64_t *files_rate)
+{
+	uint64_t elapsed;
+
+	pthread_mutex_lock(&limit->lock);
+	elapsed = get_time_us() - limit->created;
+	*bytes_rate = get_observed_rate(&limit->bytes, elapsed);
+	*files_rate = get_observed_rate(&limit->files, elapsed);
+	pthread_mutex_unlock(&limit->lock);
+}
+
+void
+iolimit_consume(iolimit_t *limit, uint64_t bytes, uint64_t files,
+		iolimit_cancelled_func cancelled, void *arg)
+{
+	if(limit == NULL)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&limit->lock);
+
+	refill(limit);
+
+	limit->bytes.consumed += bytes;
+	limit->files.consumed += files;
+	if(limit->bytes.rate != 0U)
+	{
+		limit->bytes.tokens -= bytes;
+	}
+	if(limit->files.rate != 0U)
+	{
+		limit->files.tokens -= files;
+	}
+
+	while(1)
+	{
+		const uint64_t bytes_wait = get_wait_time(&limit->bytes);
+		const uint64_t files_wait = get_wait_time(&limit->files);
+		const uint64_t wait = (bytes_wait > files_wait) ? bytes_wait : files_wait;
+		if(wait == 0U)
+		{
+			break;
+		}
+
+		pthread_mutex_unlock(&limit->lock);
+		sleep_us((wait > MAX_SLEEP_US) ? MAX_SLEEP_US : wait);
+		if(cancelled != NULL && cancelled(arg))
+		{
+			/* Debt stays, it's paid by the next consumer. */
+			return;
+		}
+		pthread_mutex_lock(&limit->lock);
+
+		refill(limit);
+	}
+
+	pthread_mutex_unlock(&limit->lock);
+}
+
+/* Adds tokens to both buckets according to time passed since the last refill.
+ * Must be called with lock held. */
+static void
+refill(iolimit_t *limit)
+{
+	const uint64_t now = get_time_us();
+	const uint64_t elapsed = now - limit->refilled;
+
+	refill_bucket(&limit->bytes, elapsed);
+	refill_bucket(&limit->files, elapsed);
+	limit->refilled = now;
+}
+
+/* Adds tokens to the bucket for elapsed number of microseconds.  The bucket
+ * holds at most one second worth of tokens. */
+static void
+refill_bucket(bucket_t *bucket, uint64_t elapsed)
+{
+	if(bucket->rate == 0U)
+	{
+		bucket->tokens = 0.0;
+		return;
+	}
+
+	bucket->tokens += bucket->rate*(elapsed/US_PER_SEC);
+	if(bucket->tokens > bucket->rate)
+	{
+		bucket->tokens = bucket->rate;
+	}
+}
+
+/* Computes how long one needs to wait for the bucket to get out of debt.
+ * Returns the time in microseconds. */
+static uint64_t
+get_wait_time(const bucket_t *bucket)
+{
+	if(bucket->rate == 0U || bucket->tokens >= 0.0)
+	{
+		return 0U;
+	}
+	/* Round up to avoid spinning on tiny intervals. */
+	return (uint64_t)(-bucket->tokens/bucket->rate*US_PER_SEC) + 1U;
+}
+
+/* Suspends calling thread for specified number of microseconds. */
+static void
+sleep_us(uint64_t us)
+{
+#ifndef _WIN32
+	usleep(us);
+#else
+	Sleep((us + 999U)/1000U);
+#endif
+}
+
+/* Computes average rate of consumption from the bucket.  Returns the rate. */
+static uint64_t
+get_observed_rate(const bucket_t *bucket, uint64_t elapsed)
+{
+	if(elapsed == 0U)
+	{
+		return 0U;
+	}
+	return (uint64_t)(bucket->consumed*(US_PER_SEC/elapsed));
+}
+
+/* Retrieves current time.  Returns the time in microseconds. */
+static uint64_t
+get_time_us(void)
+{
+	struct timeval tv;
+	(void)gettimeofday(&tv, NULL);
+	return (uint64_t)tv.tv_sec*1000000U + tv.tv_usec;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -0,0 +1,65 @@
+/* vifm
+ * Copyright (C) 2015 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__IO__IOLIMIT_H__
+#define VIFM__IO__IOLIMIT_H__
+
+#include <stdint.h> /* uint64_t */
+
+/* iolimit - Input/Output rate limiting
+ *
+ * Limiter is a pair of token buckets: one for bytes and one for files.  Each
+ * bucket is refilled at its rate and holds at most one second worth of tokens.
+ * Consuming more than there is puts bucket into debt, which is paid off by
+ * sleeping.  Limits can be changed at any time from any thread, sleeping
+ * threads pick new values up shortly. */
+
+/* Opaque declaration of structure describing limiter. */
+typedef struct iolimit_t iolimit_t;
+
+/* Allocates new limiter without any limits.  Returns the limiter or NULL on
+ * error. */
+iolimit_t * iolimit_alloc(void);
+
+/* Frees the limiter.  The limit can be NULL. */
+void iolimit_free(iolimit_t *limit);
+
+/* Sets rates of the limiter.  Zero rate means no limit. */
+void iolimit_set(iolimit_t *limit, uint64_t bytes_rate, uint64_t files_rate);
+
+/* Retrieves rates of the limiter.  Zero rate means no limit. */
+void iolimit_get(iolimit_t *limit, uint64_t *bytes_rate, uint64_t *files_rate);
+
+/* Retrieves average rates of consumption since creation of the limiter. */
+void iolimit_get_observed(iolimit_t *limit, uint64_t *bytes_rate,
+		uint64_t *files_rate);
+
+/* Checks whether waiting for a limit should be stopped.  Returns non-zero if
+ * so, otherwise zero is returned. */
+typedef int (*iolimit_cancelled_func)(void *arg);
+
+/* Accounts processed bytes and files and sleeps if it's too much for current
+ * rates.  The limit can be NULL.  Sleeping stops early if cancelled callback
+ * (can be NULL) returns non-zero. */
+void iolimit_consume(iolimit_t *limit, uint64_t bytes, uint64_t files,
+		iolimit_cancelled_func cancelled, void *arg);
+
+#endif /* VIFM__IO__IOLIMIT_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
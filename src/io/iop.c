@@ -20,23 +20,34 @@
 #define REQUIRED_WINVER 0x0600
 #include "../utils/windefs.h"
 #include <windows.h>
+#include <io.h> /* _chsize_s() _commit() */
+#endif
+
+#ifdef __linux__
+#define HAVE_KERNEL_COPY
 #endif
 
 #include "iop.h"
 
+#ifdef HAVE_KERNEL_COPY
+#include <linux/fs.h> /* FICLONE */
+#include <sys/ioctl.h> /* ioctl() */
+#include <sys/sendfile.h> /* sendfile() */
+#include <sys/syscall.h> /* __NR_copy_file_range */
+#endif
+
 #include <sys/stat.h> /* stat */
 #include <sys/types.h> /* mode_t */
-#include <unistd.h> /* rmdir() symlink() unlink() */
+#include <unistd.h> /* lseek() rmdir() symlink() syscall() unlink() */
 
 #include <errno.h> /* EEXIST errno */
 #include <stddef.h> /* NULL size_t */
-#include <stdio.h> /* FILE fpos_t fclose() fgetpos() fread() fseek() fsetpos()
-                      fwrite() snprintf() */
-#include <stdlib.h> /* free() */
+#include <stdio.h> /* FILE fpos_t fclose() fgetpos() fileno() fread() fseek()
+                      fsetpos() fwrite() snprintf() */
+#include <stdlib.h> /* free() malloc() */
 #include <string.h> /* strchr() */
 
 #include "../compat/os.h"
-#include "../ui/cancellation.h"
 #include "../utils/fs.h"
 #include "../utils/fs_limits.h"
 #include "../utils/log.h"
@@ -47,10 +58,31 @@
 #include "../utils/utils.h"
 #include "../background.h"
 #include "private/ioeta.h"
+#include "private/journal.h"
 #include "ioc.h"
 
-/* Amount of data to transfer at once. */
-#define BLOCK_SIZE 32*1024
+/* Amount of data to transfer at once through user space. */
+#define COPY_BLOCK_SIZE (256*1024)
+
+/* Amount of data after which copied part of a file is synchronized with the
+ * disk and recorded in the journal. */
+#define CHECKPOINT_SIZE (64*1024*1024)
+
+/* State of recording progress of copying a file in the journal. */
+typedef struct
+{
+	journal_t *journal;        /* Journal or NULL to do nothing. */
+	const char *dst;           /* Destination file. */
+	const struct stat *src_st; /* Information about the source file. */
+	uint64_t last;             /* Offset of the last checkpoint. */
+}
+checkpoint_t;
+
+#ifdef HAVE_KERNEL_COPY
+/* Amount of data to transfer at once by the kernel.  Limits delays of progress
+ * reporting and cancellation. */
+#define KERNEL_CHUNK_SIZE (1024*1024)
+#endif
 
 #ifdef _WIN32
 static DWORD CALLBACK win_progress_cb(LARGE_INTEGER total,
@@ -58,6 +90,17 @@ static DWORD CALLBACK win_progress_cb(LARGE_INTEGER total,
 		LARGE_INTEGER stream_transfered, DWORD stream_num, DWORD reason,
 		HANDLE src_file, HANDLE dst_file, LPVOID param);
 #endif
+static int can_resume_file(journal_t *journal, const char dst[],
+		const struct stat *src_st, uint64_t *offset);
+static int resume_file(const char dst[], uint64_t offset);
+static void checkpoint(checkpoint_t *cp, FILE *out_stream, int out);
+static int sync_file(int fd);
+#ifdef HAVE_KERNEL_COPY
+static int copy_in_kernel(io_args_t *const args, int in, int out,
+		int whole_file, checkpoint_t *cp);
+static ssize_t copy_range(int in, int out, size_t len);
+static int is_unsupported(int error);
+#endif
 
 int
 iop_mkfile(io_args_t *const args)
@@ -179,16 +222,19 @@ iop_cp(io_args_t *const args)
 {
 	const char *const src = args->arg1.src;
 	const char *const dst = args->arg2.dst;
-	const IoCrs crs = args->arg3.crs;
+	IoCrs crs = args->arg3.crs;
 	const io_confirm confirm = args->confirm;
 	const int cancellable = args->cancellable;
 
-	char block[BLOCK_SIZE];
+	char *block;
 	FILE *in, *out;
 	size_t nread;
 	int error;
 	struct stat src_st;
 	const char *open_mode = "wb";
+	uint64_t offset = 0U;
+	journal_t *const journal = args->journal;
+	checkpoint_t cp = { .journal = journal, .dst = dst, .src_st = &src_st };
 
 	ioeta_update(args->estim, src, dst, 0, 0);
 
@@ -212,6 +258,11 @@ iop_cp(io_args_t *const args)
 		free(utf16_src);
 		free(utf16_dst);
 
+		if(!error && journal != NULL && os_stat(src, &src_st) == 0)
+		{
+			journal_done(journal, dst, &src_st);
+		}
+
 		ioeta_update(args->estim, NULL, NULL, 1, 0);
 
 		return error;
@@ -246,15 +297,46 @@ iop_cp(io_args_t *const args)
 		return 1;
 	}
 
+	if(journal != NULL)
+	{
+		if(os_stat(src, &src_st) != 0)
+		{
+			return 1;
+		}
+
+		if(crs == IO_CRS_APPEND_TO_FILES && journal_is_done(journal, dst, &src_st)
+				&& get_file_size(dst) == (uint64_t)src_st.st_size)
+		{
+			/* The file was copied by previous run, nothing to do. */
+			ioeta_update_skipped(args->estim, NULL, NULL, 1, src_st.st_size);
+			return 0;
+		}
+	}
+
 	in = os_fopen(src, "rb");
 	if(in == NULL)
 	{
 		return 1;
 	}
 
+	if(crs == IO_CRS_APPEND_TO_FILES && journal != NULL &&
+			!can_resume_file(journal, dst, &src_st, &offset))
+	{
+		/* The file isn't a leftover of interrupted copying of this source, so
+		 * treat it as a regular conflict. */
+		crs = IO_CRS_REPLACE_FILES;
+	}
+
 	if(crs == IO_CRS_APPEND_TO_FILES)
 	{
 		open_mode = "ab";
+
+		/* Data past the last checkpoint might not have reached the disk. */
+		if(journal != NULL && resume_file(dst, offset) != 0)
+		{
+			fclose(in);
+			return 1;
+		}
 	}
 	else if(crs != IO_CRS_FAIL)
 	{
@@ -307,32 +389,51 @@ iop_cp(io_args_t *const args)
 
 		if(!error)
 		{
-			ioeta_update(args->estim, NULL, NULL, 0, get_file_size(dst));
+			cp.last = get_file_size(dst);
+			ioeta_update_skipped(args->estim, NULL, NULL, 0, cp.last);
 		}
 	}
 
-	/* TODO: use sendfile() if platform supports it. */
+#ifdef HAVE_KERNEL_COPY
+	/* Transfer as much as possible without copying data to user space, what's
+	 * left (if anything) is copied below. */
+	if(!error)
+	{
+		error = copy_in_kernel(args, fileno(in), fileno(out),
+				crs != IO_CRS_APPEND_TO_FILES, &cp);
+	}
+#endif
+
+	block = error ? NULL : malloc(COPY_BLOCK_SIZE);
+	error |= (block == NULL);
 
-	while((nread = fread(&block, 1, sizeof(block), in)) != 0U)
+	while(!error && (nread = fread(block, 1, COPY_BLOCK_SIZE, in)) != 0U)
 	{
-		if(cancellable && ui_cancellation_requested())
+		if(ioeta_cancelled(args->estim, cancellable))
 		{
 			error = 1;
 			break;
 		}
 
-		if(fwrite(&block, 1, nread, out) != nread)
+		if(fwrite(block, 1, nread, out) != nread)
 		{
 			error = 1;
 			break;
 		}
 
 		ioeta_update(args->estim, NULL, NULL, 0, nread);
+		checkpoint(&cp, out, fileno(out));
 	}
 
+	free(block);
 	fclose(in);
 	fclose(out);
 
+	if(error == 0 && journal != NULL)
+	{
+		journal_done(journal, dst, &src_st);
+	}
+
 	if(error == 0 && os_lstat(src, &src_st) == 0)
 	{
 		error = os_chmod(dst, src_st.st_mode & 07777);
@@ -343,6 +444,193 @@ iop_cp(io_args_t *const args)
 	return error;
 }
 
+/* Checks whether journal has a record about unfinished copying of the source
+ * described by src_st to dst and dst still has all data it lists.  Sets
+ * *offset to size of valid part of dst.  Returns non-zero if so, otherwise zero
+ * is returned. */
+static int
+can_resume_file(journal_t *journal, const char dst[], const struct stat *src_st,
+		uint64_t *offset)
+{
+	return journal_get_offset(journal, dst, src_st, offset) == 0
+		&& path_exists(dst, NODEREF) && get_file_size(dst) >= *offset;
+}
+
+/* Prepares partially copied dst for appending the rest of data to it by
+ * dropping everything after the last checkpoint at the offset.  Returns zero on
+ * success, otherwise non-zero is returned. */
+static int
+resume_file(const char dst[], uint64_t offset)
+{
+	int error;
+	FILE *const fp = os_fopen(dst, "ab");
+	if(fp == NULL)
+	{
+		return 1;
+	}
+
+#ifndef _WIN32
+	error = ftruncate(fileno(fp), offset);
+#else
+	error = _chsize_s(fileno(fp), offset);
+#endif
+
+	fclose(fp);
+	return error != 0;
+}
+
+/* Synchronizes copied data with the disk and records its amount in the journal
+ * if enough data was written since the last checkpoint.  out_stream can be
+ * NULL. */
+static void
+checkpoint(checkpoint_t *cp, FILE *out_stream, int out)
+{
+	off_t offset;
+
+	if(cp->journal == NULL)
+	{
+		return;
+	}
+
+	if(out_stream != NULL && fflush(out_stream) != 0)
+	{
+		return;
+	}
+
+	offset = lseek(out, 0, SEEK_CUR);
+	if(offset == (off_t)-1 || (uint64_t)offset - cp->last < CHECKPOINT_SIZE)
+	{
+		return;
+	}
+
+	if(sync_file(out) == 0)
+	{
+		journal_checkpoint(cp->journal, cp->dst, cp->src_st, offset);
+		cp->last = offset;
+	}
+}
+
+/* Waits for data of the file to reach the disk.  Returns zero on success,
+ * otherwise non-zero is returned. */
+static int
+sync_file(int fd)
+{
+#ifndef _WIN32
+	return fsync(fd);
+#else
+	return _commit(fd);
+#endif
+}
+
+#ifdef HAVE_KERNEL_COPY
+
+/* Copies data from in to out starting at their current offsets without
+ * passing it through user space.  Cloning (reflinking) is tried first and only
+ * for whole files, then copy_file_range() and then sendfile().  Stops at the end
+ * of input or when none of the methods is applicable, the rest of the data
+ * should be copied by the caller in both cases.  Returns zero on success,
+ * otherwise non-zero is returned. */
+static int
+copy_in_kernel(io_args_t *const args, int in, int out, int whole_file,
+		checkpoint_t *cp)
+{
+	struct stat st;
+	int use_range = 1;
+
+	/* Special files might report zero size or not support these methods at all,
+	 * leave them to the caller. */
+	if(fstat(in, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0)
+	{
+		return 0;
+	}
+
+#ifdef FICLONE
+	if(whole_file && ioctl(out, FICLONE, in) == 0)
+	{
+		/* Cloning doesn't move offsets, do it to let caller see end of input. */
+		if(lseek(in, 0, SEEK_END) == (off_t)-1 ||
+				lseek(out, 0, SEEK_END) == (off_t)-1)
+		{
+			return 1;
+		}
+		/* No data was transferred, so don't charge it to limits. */
+		ioeta_update_skipped(args->estim, NULL, NULL, 0, st.st_size);
+		return 0;
+	}
+#endif
+
+	while(1)
+	{
+		ssize_t n;
+
+		if(ioeta_cancelled(args->estim, args->cancellable))
+		{
+			return 1;
+		}
+
+		n = use_range ? copy_range(in, out, KERNEL_CHUNK_SIZE)
+		              : sendfile(out, in, NULL, KERNEL_CHUNK_SIZE);
+		if(n > 0)
+		{
+			ioeta_update(args->estim, NULL, NULL, 0, n);
+			checkpoint(cp, NULL, out);
+			continue;
+		}
+
+		if(n == 0)
+		{
+			return 0;
+		}
+
+		if(errno == EINTR)
+		{
+			continue;
+		}
+
+		if(!is_unsupported(errno))
+		{
+			return 1;
+		}
+
+		/* Both functions use and update file offsets, so switching to another
+		 * method continues copying from where the failed one stopped. */
+		if(!use_range)
+		{
+			return 0;
+		}
+		use_range = 0;
+	}
+}
+
+/* Wrapper for copy_file_range() system call, which might be unavailable in
+ * libc.  Returns number of copied bytes or -1 on error. */
+static ssize_t
+copy_range(int in, int out, size_t len)
+{
+#ifdef __NR_copy_file_range
+	return syscall(__NR_copy_file_range, in, NULL, out, NULL, len, 0U);
+#else
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+/* Checks whether error code signals that a copying method can't be used for
+ * particular files rather than failure of an I/O operation.  Returns non-zero
+ * if so, otherwise zero is returned. */
+static int
+is_unsupported(int error)
+{
+	return error == ENOSYS
+	    || error == EXDEV
+	    || error == EINVAL
+	    || error == EBADF
+	    || error == EOPNOTSUPP
+	    || error == ETXTBSY;
+}
+
+#endif
+
 #ifdef _WIN32
 
 static DWORD CALLBACK win_progress_cb(LARGE_INTEGER total,
@@ -367,7 +655,7 @@ static DWORD CALLBACK win_progress_cb(LARGE_INTEGER total,
 
 	last_size = transferred.QuadPart;
 
-	if(args->cancellable && ui_cancellation_requested())
+	if(ioeta_cancelled(args->estim, args->cancellable))
 	{
 		return PROGRESS_CANCEL;
 	}
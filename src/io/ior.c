@@ -18,54 +18,130 @@
 
 #include "ior.h"
 
-#include <sys/stat.h> /* stat */
-#include <unistd.h> /* unlink() */
+#include <fcntl.h> /* AT_REMOVEDIR AT_SYMLINK_NOFOLLOW */
+#include <pthread.h> /* pthread_* */
+#include <sys/stat.h> /* stat fstatat() */
+#include <sys/time.h> /* gettimeofday() timeval */
+#include <sys/types.h> /* mode_t */
+#include <unistd.h> /* unlink() unlinkat() */
 
 #include <errno.h> /* EEXIST EISDIR ENOTEMPTY EXDEV errno */
 #include <stddef.h> /* NULL */
+#include <stdint.h> /* uint64_t */
 #include <stdio.h> /* removee() snprintf() */
-#include <stdlib.h> /* free() */
-#include <string.h> /* strlen() */
+#include <stdlib.h> /* free() malloc() realloc() */
+#include <string.h> /* strdup() strlen() */
+#include <time.h> /* timespec */
 
 #include "../compat/os.h"
-#include "../ui/cancellation.h"
 #include "../utils/fs.h"
 #include "../utils/fs_limits.h"
 #include "../utils/log.h"
+#include "../utils/macros.h"
 #include "../utils/path.h"
 #include "../utils/str.h"
 #include "../background.h"
 #include "private/ioeta.h"
+#include "private/journal.h"
+#include "private/manifest.h"
 #include "private/traverser.h"
 #include "ioc.h"
 #include "iop.h"
 
-static VisitResult rm_visitor(const char full_path[], VisitAction action,
-		void *param);
-static VisitResult cp_visitor(const char full_path[], VisitAction action,
-		void *param);
+/* Maximum number of files waiting to be copied by threads. */
+#define MAX_CP_QUEUE 1024
+
+/* How long the calling thread waits for workers before reporting progress, in
+ * milliseconds. */
+#define CP_PROGRESS_INTERVAL_MS 100
+
+/* Files smaller than this aren't worth journaling. */
+#define MIN_JOURNALED_SIZE (64*1024*1024)
+
+/* File waiting to be copied by a worker thread. */
+typedef struct cp_job_t
+{
+	char *src;             /* Source path. */
+	char *dst;             /* Destination path. */
+	struct cp_job_t *next; /* Next job in the queue. */
+}
+cp_job_t;
+
+/* State of parallel copying.  Directories are processed by the calling thread
+ * in traversal order, files are passed to worker threads. */
+typedef struct
+{
+	io_args_t *args; /* Arguments of the whole operation. */
+
+	pthread_t threads[IO_MAX_THREADS]; /* Worker threads. */
+	int nthreads;                      /* Number of started worker threads. */
+
+	/* Fields below are protected by this lock. */
+	pthread_mutex_t lock;
+	pthread_cond_t work_cv; /* Signaled on new jobs and on finishing. */
+	pthread_cond_t done_cv; /* Signaled when a job is done. */
+	cp_job_t *head;         /* First job in the queue. */
+	cp_job_t *tail;         /* Last job in the queue. */
+	int queued;             /* Number of jobs in the queue. */
+	int active;             /* Number of jobs being processed. */
+	int finishing;          /* Whether no more jobs will be added. */
+	int failed;             /* Whether any of the jobs has failed. */
+
+	/* Permissions of directories, which are set after all files are copied.
+	 * Used only by the calling thread. */
+	char **dirs;   /* Destination directories in order of leaving them. */
+	mode_t *modes; /* Permissions for each of the dirs. */
+	int ndirs;     /* Number of elements in dirs and modes. */
+}
+cp_pool_t;
+
+static VisitResult rm_visitor(const char full_path[],
+		const visit_at_t *at, VisitAction action, void *param);
+#ifndef _WIN32
+static int rm_at(const io_args_t *rm_args, const char full_path[],
+		const visit_at_t *at, int dir);
+#endif
+static int cp_tree(io_args_t *const args);
+static journal_t * open_journal(const io_args_t *args);
+static VisitResult cp_visitor(const char full_path[],
+		const visit_at_t *at, VisitAction action, void *param);
+static int cp_in_parallel(io_args_t *const args);
+static VisitResult cp_par_visitor(const char full_path[],
+		const visit_at_t *at, VisitAction action, void *param);
+static int defer_dir_mode(cp_pool_t *pool, const visit_at_t *at,
+		const char dst[]);
+static int enqueue_cp_job(cp_pool_t *pool, const char src[], const char dst[]);
+static void * cp_worker(void *arg);
+static int cp_job_file(const io_args_t *cp_args, const cp_job_t *job);
+static void wait_for_cp_job(cp_pool_t *pool);
+static void report_cp_progress(cp_pool_t *pool);
+static char * get_dst_path(const io_args_t *args, const char full_path[]);
+static int stat_at(const visit_at_t *at, struct stat *st);
 static int is_file(const char path[]);
-static VisitResult mv_visitor(const char full_path[], VisitAction action,
-		void *param);
-static VisitResult cp_mv_visitor(const char full_path[], VisitAction action,
-		void *param, int cp);
+static manifest_t * get_manifest(const io_args_t *args);
+static int mv_by_copying(io_args_t *const args);
+static VisitResult mv_visitor(const char full_path[],
+		const visit_at_t *at, VisitAction action, void *param);
+static VisitResult cp_mv_visitor(const char full_path[],
+		const visit_at_t *at, VisitAction action, void *param, int cp);
 
 int
 ior_rm(io_args_t *const args)
 {
 	const char *const path = args->arg1.path;
-	return traverse(path, &rm_visitor, args);
+	return traverse_manifest(get_manifest(args), path, &rm_visitor, args);
 }
 
 /* Implementation of traverse() visitor for subtree removal.  Returns 0 on
  * success, otherwise non-zero is returned. */
 static VisitResult
-rm_visitor(const char full_path[], VisitAction action, void *param)
+rm_visitor(const char full_path[], const visit_at_t *at, VisitAction action,
+		void *param)
 {
 	const io_args_t *const rm_args = param;
 	VisitResult result = VR_OK;
 
-	if(rm_args->cancellable && ui_cancellation_requested())
+	if(ioeta_cancelled(rm_args->estim, rm_args->cancellable))
 	{
 		return VR_CANCELLED;
 	}
@@ -76,6 +152,14 @@ rm_visitor(const char full_path[], VisitAction action, void *param)
 			/* Do nothing, directories are removed on leaving them. */
 			result = VR_OK;
 			break;
+#ifndef _WIN32
+		case VA_FILE:
+			result = rm_at(rm_args, full_path, at, 0);
+			break;
+		case VA_DIR_LEAVE:
+			result = rm_at(rm_args, full_path, at, 1);
+			break;
+#else
 		case VA_FILE:
 			{
 				io_args_t args =
@@ -102,22 +186,113 @@ rm_visitor(const char full_path[], VisitAction action, void *param)
 				result = iop_rmdir(&args);
 				break;
 			}
+#endif
+	}
+
+	return result;
+}
+
+#ifndef _WIN32
+
+/* Same as iop_rmfile() or iop_rmdir(), but removes entry relative to its parent
+ * directory.  Returns zero on success, otherwise non-zero is returned. */
+static int
+rm_at(const io_args_t *rm_args, const char full_path[], const visit_at_t *at,
+		int dir)
+{
+	uint64_t size = 0U;
+	int result;
+
+	ioeta_update(rm_args->estim, full_path, full_path, 0, 0);
+
+	if(!dir && rm_args->estim != NULL)
+	{
+		struct stat st;
+		if(fstatat(at->dir_fd, at->name, &st, AT_SYMLINK_NOFOLLOW) == 0)
+		{
+			size = st.st_size;
+		}
 	}
 
+	result = unlinkat(at->dir_fd, at->name, dir ? AT_REMOVEDIR : 0);
+
+	ioeta_update(rm_args->estim, NULL, NULL, 1, size);
+
 	return result;
 }
 
+#endif
+
 int
 ior_cp(io_args_t *const args)
 {
 	const char *const src = args->arg1.src;
 	const char *const dst = args->arg2.dst;
+	journal_t *journal;
+	int result;
 
 	if(is_in_subtree(dst, src))
 	{
 		return 1;
 	}
 
+	if(args->journal != NULL)
+	{
+		return cp_tree(args);
+	}
+
+	journal = open_journal(args);
+	args->journal = journal;
+	result = cp_tree(args);
+	args->journal = NULL;
+
+	/* Journal of unsuccessful operation is kept to be able to resume it. */
+	journal_close(journal, result == 0);
+
+	return result;
+}
+
+int
+ior_can_resume(const char dst[])
+{
+	char *const path = journal_path(dst);
+	const int exists = (path != NULL && path_exists(path, NODEREF));
+	free(path);
+	return exists;
+}
+
+/* Opens journal for copying if it's worth it.  Returns the journal or NULL. */
+static journal_t *
+open_journal(const io_args_t *args)
+{
+	const char *const src = args->arg1.src;
+	const char *const dst = args->arg2.dst;
+	int resume;
+
+	if(is_symlink(src) ||
+			(!is_dir(src) && get_file_size(src) < MIN_JOURNALED_SIZE))
+	{
+		return NULL;
+	}
+
+	/* Files are appended to as before when there is no journal to resume. */
+	resume = (args->arg3.crs == IO_CRS_APPEND_TO_FILES);
+	if(resume && !ior_can_resume(dst))
+	{
+		return NULL;
+	}
+
+	return journal_open(dst, resume);
+}
+
+/* Copies file/directory recursively without managing journal.  Returns zero on
+ * success, otherwise non-zero is returned. */
+static int
+cp_tree(io_args_t *const args)
+{
+	const char *const src = args->arg1.src;
+	const char *const dst = args->arg2.dst;
+
 	if(args->arg3.crs == IO_CRS_REPLACE_ALL)
 	{
 		io_args_t rm_args =
@@ -134,15 +309,346 @@ ior_cp(io_args_t *const args)
 		}
 	}
 
-	return traverse(src, &cp_visitor, args);
+	if(args->nthreads > 1 && !is_symlink(src) && is_dir(src))
+	{
+		return cp_in_parallel(args);
+	}
+
+	return traverse_manifest(get_manifest(args), src, &cp_visitor, args);
 }
 
 /* Implementation of traverse() visitor for subtree copying.  Returns 0 on
  * success, otherwise non-zero is returned. */
 static VisitResult
-cp_visitor(const char full_path[], VisitAction action, void *param)
+cp_visitor(const char full_path[], const visit_at_t *at, VisitAction action,
+		void *param)
+{
+	return cp_mv_visitor(full_path, at, action, param, 1);
+}
+
+/* Copies directory by processing its files in several threads.  Returns zero
+ * on success, otherwise non-zero is returned. */
+static int
+cp_in_parallel(io_args_t *const args)
+{
+	cp_pool_t pool = { .args = args };
+	manifest_t *const manifest = get_manifest(args);
+	int result;
+	int i;
+
+	pthread_mutex_init(&pool.lock, NULL);
+	pthread_cond_init(&pool.work_cv, NULL);
+	pthread_cond_init(&pool.done_cv, NULL);
+
+	for(i = 0; i < MIN(args->nthreads, IO_MAX_THREADS); ++i)
+	{
+		if(pthread_create(&pool.threads[i], NULL, &cp_worker, &pool) != 0)
+		{
+			break;
+		}
+	}
+	pool.nthreads = i;
+
+	result = (pool.nthreads == 0)
+	       ? traverse_manifest(manifest, args->arg1.src, &cp_visitor, args)
+	       : traverse_manifest(manifest, args->arg1.src, &cp_par_visitor, &pool);
+
+	/* Wait for all jobs to finish. */
+	pthread_mutex_lock(&pool.lock);
+	pool.finishing = 1;
+	pthread_cond_broadcast(&pool.work_cv);
+	while(pool.queued + pool.active != 0)
+	{
+		wait_for_cp_job(&pool);
+
+		pthread_mutex_unlock(&pool.lock);
+		report_cp_progress(&pool);
+		pthread_mutex_lock(&pool.lock);
+	}
+	pthread_mutex_unlock(&pool.lock);
+
+	for(i = 0; i < pool.nthreads; ++i)
+	{
+		(void)pthread_join(pool.threads[i], NULL);
+	}
+	report_cp_progress(&pool);
+
+	/* Directories are writable until this point, so that files could be added
+	 * to them. */
+	for(i = 0; i < pool.ndirs; ++i)
+	{
+		if(os_chmod(pool.dirs[i], pool.modes[i]) != 0)
+		{
+			result = 1;
+		}
+		free(pool.dirs[i]);
+	}
+	free(pool.dirs);
+	free(pool.modes);
+
+	pthread_mutex_destroy(&pool.lock);
+	pthread_cond_destroy(&pool.work_cv);
+	pthread_cond_destroy(&pool.done_cv);
+
+	return result != 0 || pool.failed;
+}
+
+/* Implementation of traverse() visitor for parallel subtree copying.  Returns
+ * 0 on success, otherwise non-zero is returned. */
+static VisitResult
+cp_par_visitor(const char full_path[], const visit_at_t *at, VisitAction action,
+		void *param)
+{
+	cp_pool_t *const pool = param;
+	io_args_t *const cp_args = pool->args;
+	char *dst_full_path;
+	VisitResult result = VR_OK;
+	int failed;
+
+	pthread_mutex_lock(&pool->lock);
+	failed = pool->failed;
+	pthread_mutex_unlock(&pool->lock);
+
+	if(failed)
+	{
+		return VR_ERROR;
+	}
+
+	if(ioeta_cancelled(cp_args->estim, cp_args->cancellable))
+	{
+		return VR_CANCELLED;
+	}
+
+	report_cp_progress(pool);
+
+	switch(action)
+	{
+		case VA_DIR_ENTER:
+			result = cp_visitor(full_path, at, action, cp_args);
+			break;
+		case VA_FILE:
+			dst_full_path = get_dst_path(cp_args, full_path);
+
+			/* Ask user here, because workers must not interact with the user. */
+			if(cp_args->confirm != NULL && (cp_args->arg3.crs == IO_CRS_REPLACE_FILES
+						|| cp_args->arg3.crs == IO_CRS_REPLACE_ALL) &&
+					path_exists(dst_full_path, DEREF) &&
+					!cp_args->confirm(cp_args, full_path, dst_full_path))
+			{
+				free(dst_full_path);
+				break;
+			}
+
+			result = (enqueue_cp_job(pool, full_path, dst_full_path) == 0)
+			       ? VR_OK
+			       : VR_ERROR;
+			free(dst_full_path);
+			break;
+		case VA_DIR_LEAVE:
+			dst_full_path = get_dst_path(cp_args, full_path);
+			result = (defer_dir_mode(pool, at, dst_full_path) == 0)
+			       ? VR_OK
+			       : VR_ERROR;
+			free(dst_full_path);
+			break;
+	}
+
+	return result;
+}
+
+/* Remembers to set permissions of source directory at the at for dst directory
+ * at the end of copying.  Returns zero on success, otherwise non-zero is
+ * returned. */
+static int
+defer_dir_mode(cp_pool_t *pool, const visit_at_t *at, const char dst[])
+{
+	struct stat st;
+	char **dirs;
+	mode_t *modes;
+
+	if(stat_at(at, &st) != 0)
+	{
+		return 1;
+	}
+
+	dirs = realloc(pool->dirs, sizeof(*dirs)*(pool->ndirs + 1));
+	if(dirs == NULL)
+	{
+		return 1;
+	}
+	pool->dirs = dirs;
+
+	modes = realloc(pool->modes, sizeof(*modes)*(pool->ndirs + 1));
+	if(modes == NULL)
+	{
+		return 1;
+	}
+	pool->modes = modes;
+
+	pool->dirs[pool->ndirs] = strdup(dst);
+	if(pool->dirs[pool->ndirs] == NULL)
+	{
+		return 1;
+	}
+	pool->modes[pool->ndirs] = st.st_mode & 07777;
+	++pool->ndirs;
+	return 0;
+}
+
+/* Adds file to the queue of worker threads, waits for free space in the queue
+ * if it's full.  Returns zero on success, otherwise non-zero is returned. */
+static int
+enqueue_cp_job(cp_pool_t *pool, const char src[], const char dst[])
+{
+	cp_job_t *const job = malloc(sizeof(*job));
+	if(job == NULL)
+	{
+		return 1;
+	}
+
+	job->src = strdup(src);
+	job->dst = strdup(dst);
+	job->next = NULL;
+	if(job->src == NULL || job->dst == NULL)
+	{
+		free(job->src);
+		free(job->dst);
+		free(job);
+		return 1;
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	while(pool->queued >= MAX_CP_QUEUE)
+	{
+		wait_for_cp_job(pool);
+
+		pthread_mutex_unlock(&pool->lock);
+		report_cp_progress(pool);
+		pthread_mutex_lock(&pool->lock);
+	}
+
+	if(pool->tail == NULL)
+	{
+		pool->head = job;
+	}
+	else
+	{
+		pool->tail->next = job;
+	}
+	pool->tail = job;
+	++pool->queued;
+
+	pthread_cond_signal(&pool->work_cv);
+	pthread_mutex_unlock(&pool->lock);
+	return 0;
+}
+
+/* Entry point of a worker thread.  Copies files until there are no more of
+ * them.  After the first error or on cancellation remaining files are skipped.
+ * Returns NULL. */
+static void *
+cp_worker(void *arg)
+{
+	cp_pool_t *const pool = arg;
+	io_args_t *const cp_args = pool->args;
+
+	pthread_mutex_lock(&pool->lock);
+	while(1)
+	{
+		cp_job_t *job;
+		int skip;
+		int error = 0;
+
+		while(pool->head == NULL && !pool->finishing)
+		{
+			pthread_cond_wait(&pool->work_cv, &pool->lock);
+		}
+
+		job = pool->head;
+		if(job == NULL)
+		{
+			break;
+		}
+
+		pool->head = job->next;
+		if(pool->head == NULL)
+		{
+			pool->tail = NULL;
+		}
+		--pool->queued;
+		++pool->active;
+		skip = pool->failed
+		    || ioeta_cancelled(cp_args->estim, cp_args->cancellable);
+		pthread_mutex_unlock(&pool->lock);
+
+		if(!skip)
+		{
+			error = cp_job_file(cp_args, job);
+		}
+
+		pthread_mutex_lock(&pool->lock);
+		--pool->active;
+		if(error)
+		{
+			pool->failed = 1;
+			(void)io_errlst_append(&cp_args->result.errors, job->src,
+					IO_ERR_UNKNOWN, "Failed to copy file");
+		}
+		pthread_cond_signal(&pool->done_cv);
+
+		free(job->src);
+		free(job->dst);
+		free(job);
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	return NULL;
+}
+
+/* Copies single file of a job.  Returns zero on success, otherwise non-zero is
+ * returned. */
+static int
+cp_job_file(const io_args_t *cp_args, const cp_job_t *job)
+{
+	/* Confirmation was done before the job was created.  Progress is added to
+	 * the shared estimation, but only the calling thread reports it. */
+	io_args_t args =
+	{
+		.arg1.src = job->src,
+		.arg2.dst = job->dst,
+		.arg3.crs = cp_args->arg3.crs,
+
+		.cancellable = cp_args->cancellable,
+		.estim = cp_args->estim,
+		.journal = cp_args->journal,
+	};
+
+	return iop_cp(&args);
+}
+
+/* Waits until a job is done, but not for too long, so that progress of large
+ * files is reported while they are copied.  The pool must be locked. */
+static void
+wait_for_cp_job(cp_pool_t *pool)
+{
+	struct timeval tv;
+	struct timespec deadline;
+	uint64_t nsec;
+
+	(void)gettimeofday(&tv, NULL);
+	nsec = tv.tv_usec*1000ULL + CP_PROGRESS_INTERVAL_MS*1000000ULL;
+	deadline.tv_sec = tv.tv_sec + nsec/1000000000ULL;
+	deadline.tv_nsec = nsec%1000000000ULL;
+
+	(void)pthread_cond_timedwait(&pool->done_cv, &pool->lock, &deadline);
+}
+
+/* Reports progress made by worker threads, which can't do it themselves.  Must
+ * be called only by the thread that started copying. */
+static void
+report_cp_progress(cp_pool_t *pool)
 {
-	return cp_mv_visitor(full_path, action, param, 1);
+	ioeta_update(pool->args->estim, NULL, NULL, 0, 0U);
 }
 
 int
@@ -158,6 +664,12 @@ ior_mv(io_args_t *const args)
 		return 1;
 	}
 
+	/* Continue interrupted moving between file systems. */
+	if(crs == IO_CRS_APPEND_TO_FILES && ior_can_resume(dst))
+	{
+		return mv_by_copying(args);
+	}
+
 	if(crs == IO_CRS_APPEND_TO_FILES)
 	{
 		if(!is_file(src) || !is_file(dst))
@@ -183,25 +695,7 @@ ior_mv(io_args_t *const args)
 	switch(errno)
 	{
 		case EXDEV:
-			{
-				int result = ior_cp(args);
-				if(result == 0)
-				{
-					io_args_t rm_args =
-					{
-						.arg1.path = src,
-
-						.cancellable = args->cancellable,
-						.estim = args->estim,
-					};
-
-					/* Disable progress reporting for this "secondary" operation. */
-					const int silent = ioeta_silent_on(rm_args.estim);
-					result = ior_rm(&rm_args);
-					ioeta_silent_set(rm_args.estim, silent);
-				}
-				return result;
-			}
+			return mv_by_copying(args);
 		case EISDIR:
 		case ENOTEMPTY:
 		case EEXIST:
@@ -250,7 +744,7 @@ ior_mv(io_args_t *const args)
 					}
 				}
 
-				return traverse(src, &mv_visitor, args);
+				return traverse_manifest(get_manifest(args), src, &mv_visitor, args);
 			}
 			/* Break is intentionally omitted. */
 
@@ -259,6 +753,38 @@ ior_mv(io_args_t *const args)
 	}
 }
 
+/* Retrieves entries collected during estimation.  Returns the manifest or NULL
+ * if there is none. */
+static manifest_t *
+get_manifest(const io_args_t *args)
+{
+	return (args->estim == NULL) ? NULL : args->estim->manifest;
+}
+
+/* Moves file/directory by copying it and removing the source afterwards.
+ * Returns zero on success, otherwise non-zero is returned. */
+static int
+mv_by_copying(io_args_t *const args)
+{
+	int result = ior_cp(args);
+	if(result == 0)
+	{
+		io_args_t rm_args =
+		{
+			.arg1.path = args->arg1.src,
+
+			.cancellable = args->cancellable,
+			.estim = args->estim,
+		};
+
+		/* Disable progress reporting for this "secondary" operation. */
+		const int silent = ioeta_silent_on(rm_args.estim);
+		result = ior_rm(&rm_args);
+		ioeta_silent_set(rm_args.estim, silent);
+	}
+	return result;
+}
+
 /* Checks that path points to a file or symbolic link.  Returns non-zero if so,
  * otherwise zero is returned. */
 static int
@@ -271,37 +797,39 @@ is_file(const char path[])
 /* Implementation of traverse() visitor for subtree moving.  Returns 0 on
  * success, otherwise non-zero is returned. */
 static VisitResult
-mv_visitor(const char full_path[], VisitAction action, void *param)
+mv_visitor(const char full_path[], const visit_at_t *at, VisitAction action,
+		void *param)
 {
-	return cp_mv_visitor(full_path, action, param, 0);
+	return cp_mv_visitor(full_path, at, action, param, 0);
 }
 
 /* Generic implementation of traverse() visitor for subtree copying/moving.
  * Returns 0 on success, otherwise non-zero is returned. */
 static VisitResult
-cp_mv_visitor(const char full_path[], VisitAction action, void *param, int cp)
+cp_mv_visitor(const char full_path[], const visit_at_t *at,
+		VisitAction action, void *param, int cp)
 {
 	const io_args_t *const cp_args = param;
-	const char *dst_full_path;
-	char *free_me = NULL;
+	char *dst_full_path;
 	VisitResult result = VR_OK;
-	const char *rel_part;
 
-	if(cp_args->cancellable && ui_cancellation_requested())
+	if(ioeta_cancelled(cp_args->estim, cp_args->cancellable))
 	{
 		return VR_CANCELLED;
 	}
 
-	/* TODO: come up with something better than this. */
-	rel_part = full_path + strlen(cp_args->arg1.src);
-	dst_full_path = (rel_part[0] == '\0')
-	              ? cp_args->arg2.dst
-	              : (free_me = format_str("%s/%s", cp_args->arg2.dst, rel_part));
+	dst_full_path = get_dst_path(cp_args, full_path);
 
 	switch(action)
 	{
 		case VA_DIR_ENTER:
-			if(cp_args->arg3.crs != IO_CRS_REPLACE_FILES || !is_dir(dst_full_path))
+			if(cp_args->arg3.crs == IO_CRS_APPEND_TO_FILES && is_dir(dst_full_path))
+			{
+				/* Directory was created by interrupted operation. */
+				result = VR_OK;
+			}
+			else if(cp_args->arg3.crs != IO_CRS_REPLACE_FILES ||
+					!is_dir(dst_full_path))
 			{
 				io_args_t args =
 				{
@@ -332,6 +860,7 @@ cp_mv_visitor(const char full_path[], VisitAction action, void *param, int cp)
 					.cancellable = cp_args->cancellable,
 					.confirm = cp_args->confirm,
 					.estim = cp_args->estim,
+					.journal = cp_args->journal,
 				};
 
 				result = ((cp ? iop_cp(&args) : ior_mv(&args)) == 0) ? VR_OK : VR_ERROR;
@@ -341,7 +870,7 @@ cp_mv_visitor(const char full_path[], VisitAction action, void *param, int cp)
 			{
 				struct stat st;
 
-				if(os_stat(full_path, &st) == 0)
+				if(stat_at(at, &st) == 0)
 				{
 					result = (os_chmod(dst_full_path, st.st_mode & 07777) == 0)
 									? VR_OK
@@ -355,10 +884,34 @@ cp_mv_visitor(const char full_path[], VisitAction action, void *param, int cp)
 			}
 	}
 
-	free(free_me);
+	free(dst_full_path);
 
 	return result;
 }
 
+/* Maps path inside of source subtree to corresponding path inside of
+ * destination subtree.  Returns newly allocated string. */
+static char *
+get_dst_path(const io_args_t *args, const char full_path[])
+{
+	/* TODO: come up with something better than this. */
+	const char *const rel_part = full_path + strlen(args->arg1.src);
+	return (rel_part[0] == '\0')
+	     ? strdup(args->arg2.dst)
+	     : format_str("%s/%s", args->arg2.dst, rel_part);
+}
+
+/* Queries information about entry at the at following symbolic links.  Returns
+ * zero on success, otherwise non-zero is returned. */
+static int
+stat_at(const visit_at_t *at, struct stat *st)
+{
+#ifndef _WIN32
+	return fstatat(at->dir_fd, at->name, st, 0);
+#else
+	return os_stat(at->name, st);
+#endif
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 : */
@@ -29,11 +29,18 @@
 int ior_rm(io_args_t *const args);
 
 /* Copies file/directory recursively.  Expects path in arg1 and overwrite in
- * arg3. */
+ * arg3.  Progress of copying directories and large files is recorded in a
+ * journal next to destination, which is removed on success.  Passing
+ * IO_CRS_APPEND_TO_FILES when there is a journal resumes copying. */
 int ior_cp(io_args_t *const args);
 
+/* Checks whether there is a journal of interrupted copying to dst.  Returns
+ * non-zero if so, otherwise zero is returned. */
+int ior_can_resume(const char dst[]);
+
 /* Moves/renames file/directory recursively.  Expects src in arg1, dst in arg2
- * and overwrite in arg3. */
+ * and overwrite in arg3.  Moving between file systems is journaled and resumed
+ * the same way as ior_cp() does it. */
 int ior_mv(io_args_t *const args);
 
 /* Change owner of file/directory recursively.  Expects path in arg1 and uid in
@@ -18,22 +18,50 @@
 
 #include "ioeta.h"
 
-#include <stddef.h> /* NULL */
+#include <pthread.h> /* pthread_equal() pthread_mutex_* pthread_self() */
+#include <sys/time.h> /* gettimeofday() timeval */
+
+#include <stddef.h> /* NULL size_t */
 #include <stdint.h> /* uint64_t */
+#include <stdlib.h> /* realloc() */
+#include <string.h> /* memcpy() strlen() */
 
+#include "../../ui/cancellation.h"
 #include "../../utils/fs.h"
-#include "../../utils/str.h"
+#include "../../background.h"
 #include "../ioeta.h"
+#include "../iolimit.h"
 #include "ionotif.h"
 
+/* Minimal interval between two notifications about progress of an operation in
+ * microseconds. */
+#define NOTIFY_INTERVAL_US 100000U
+
+static void update(ioeta_estim_t *estim, const char path[],
+		const char target[], int finished, uint64_t bytes, int charge);
+static int is_cancelled(void *arg);
+static void notify_estimating(ioeta_estim_t *estim);
+static void set_paths(ioeta_estim_t *estim, const char path[],
+		const char target[]);
+static void take_next_paths(ioeta_estim_t *estim);
+static void set_path(char **buf, size_t *size, const char path[]);
+static int is_owner(const ioeta_estim_t *estim);
+static void raise_u64(uint64_t *value, uint64_t min);
+static void raise_size(size_t *value, size_t min);
+static int should_notify(ioeta_estim_t *estim);
+static uint64_t get_time_us(void);
+
+/* Source of time for limiting rate of notifications. */
+static ioeta_clock_func get_time = &get_time_us;
+
 void
 ioeta_add_item(ioeta_estim_t *estim, const char path[])
 {
-	++estim->total_items;
+	(void)__atomic_add_fetch(&estim->total_items, 1U, __ATOMIC_RELAXED);
 
-	replace_string(&estim->item, path);
+	set_paths(estim, path, NULL);
 
-	ionotif_notify(IO_PS_ESTIMATING, estim);
+	notify_estimating(estim);
 }
 
 void
@@ -41,7 +69,8 @@ ioeta_add_file(ioeta_estim_t *estim, const char path[])
 {
 	if(!is_symlink(path))
 	{
-		estim->total_bytes += get_file_size(path);
+		const uint64_t size = get_file_size(path);
+		(void)__atomic_add_fetch(&estim->total_bytes, size, __ATOMIC_RELAXED);
 	}
 
 	ioeta_add_item(estim, path);
@@ -50,81 +79,273 @@ ioeta_add_file(ioeta_estim_t *estim, const char path[])
 void
 ioeta_add_dir(ioeta_estim_t *estim, const char path[])
 {
-	replace_string(&estim->item, path);
+	set_paths(estim, path, NULL);
 
-	ionotif_notify(IO_PS_ESTIMATING, estim);
+	notify_estimating(estim);
 }
 
 void
 ioeta_update(ioeta_estim_t *estim, const char path[], const char target[],
 		int finished, uint64_t bytes)
 {
-	if(estim == NULL || estim->silent)
+	update(estim, path, target, finished, bytes, 1);
+}
+
+void
+ioeta_update_skipped(ioeta_estim_t *estim, const char path[],
+		const char target[], int finished, uint64_t bytes)
+{
+	update(estim, path, target, finished, bytes, 0);
+}
+
+int
+ioeta_silent_on(ioeta_estim_t *estim)
+{
+	if(estim == NULL)
 	{
-		return;
+		return 0;
+	}
+
+	return __atomic_exchange_n(&estim->silent, 1, __ATOMIC_ACQ_REL);
+}
+
+void
+ioeta_silent_set(ioeta_estim_t *estim, int silent)
+{
+	if(estim != NULL)
+	{
+		__atomic_store_n(&estim->silent, silent, __ATOMIC_RELEASE);
+	}
+}
+
+int
+ioeta_cancelled(const ioeta_estim_t *estim, int cancellable)
+{
+	if(estim != NULL && estim->bg_op != NULL)
+	{
+		return bg_op_cancelled(estim->bg_op);
 	}
+	return cancellable && ui_cancellation_requested();
+}
 
-	estim->current_byte += bytes;
-	estim->current_file_byte += bytes;
-	if(estim->current_byte > estim->total_bytes)
+TSTATIC void
+ioeta_set_clock(ioeta_clock_func clock)
+{
+	get_time = (clock == NULL) ? &get_time_us : clock;
+}
+
+/* Implementation of ioeta_update() and ioeta_update_skipped().  Charges
+ * processed data to limits when charge is non-zero.  Doesn't lock the estim
+ * for anything but copying of paths of other threads. */
+static void
+update(ioeta_estim_t *estim, const char path[], const char target[],
+		int finished, uint64_t bytes, int charge)
+{
+	uint64_t current_byte;
+
+	if(estim == NULL || __atomic_load_n(&estim->silent, __ATOMIC_ACQUIRE))
 	{
-		/* Estimations are out of date, update them. */
-		estim->total_bytes = estim->current_byte;
+		return;
 	}
 
+	current_byte = __atomic_add_fetch(&estim->current_byte, bytes,
+			__ATOMIC_RELAXED);
+	(void)__atomic_add_fetch(&estim->current_file_byte, bytes, __ATOMIC_RELAXED);
+	/* Estimations can be out of date, update them. */
+	raise_u64(&estim->total_bytes, current_byte);
+
 	if(finished)
 	{
-		++estim->current_item;
-		if(estim->current_item > estim->total_items)
+		const size_t current_item = __atomic_add_fetch(&estim->current_item, 1U,
+				__ATOMIC_RELAXED);
+		raise_size(&estim->total_items, current_item);
+		__atomic_store_n(&estim->current_file_byte, 0U, __ATOMIC_RELAXED);
+		__atomic_store_n(&estim->total_file_bytes, 0U, __ATOMIC_RELAXED);
+	}
+
+	set_paths(estim, path, target);
+
+	if(is_owner(estim) && should_notify(estim))
+	{
+		take_next_paths(estim);
+
+		/* Size of current file is needed only for displaying progress. */
+		if(!finished && estim->item != NULL &&
+				estim->inspected_items != estim->current_item + 1)
 		{
-			/* Estimations are out of date, update them. */
-			estim->total_items = estim->current_item;
+			estim->inspected_items = estim->current_item + 1;
+			__atomic_store_n(&estim->total_file_bytes, get_file_size(estim->item),
+					__ATOMIC_RELAXED);
 		}
-		estim->current_file_byte = 0U;
-		estim->total_file_bytes = 0U;
+
+		ionotif_notify(IO_PS_IN_PROGRESS, estim);
 	}
-	else if(estim->inspected_items != estim->current_item + 1)
+
+	if(charge)
 	{
-		estim->inspected_items = estim->current_item + 1;
-		estim->total_file_bytes = get_file_size(path);
+		const uint64_t files = finished ? 1U : 0U;
+		iolimit_consume(estim->limit, bytes, files, &is_cancelled, estim);
+		iolimit_consume(estim->shared_limit, bytes, files, &is_cancelled, estim);
 	}
+}
 
-	if(path != NULL)
+/* Checks whether operation of the estimation was cancelled.  Returns non-zero
+ * if so, otherwise zero is returned. */
+static int
+is_cancelled(void *arg)
+{
+	return ioeta_cancelled(arg, 1);
+}
+
+/* Notifies about progress of estimation if it's time to do so and current
+ * thread is the one that sends notifications. */
+static void
+notify_estimating(ioeta_estim_t *estim)
+{
+	if(is_owner(estim) && should_notify(estim))
 	{
-		replace_string(&estim->item, path);
+		take_next_paths(estim);
+		ionotif_notify(IO_PS_ESTIMATING, estim);
+	}
+}
+
+/* Remembers paths of currently processed item, either of which can be NULL.
+ * Paths of threads other than the owner are put aside under the lock until the
+ * owner picks them up. */
+static void
+set_paths(ioeta_estim_t *estim, const char path[], const char target[])
+{
+	if(path == NULL && target == NULL)
+	{
+		return;
+	}
+
+	if(is_owner(estim))
+	{
+		if(path != NULL)
+		{
+			set_path(&estim->item, &estim->item_size, path);
+		}
+		if(target != NULL)
+		{
+			set_path(&estim->target, &estim->target_size, target);
+		}
+		return;
 	}
 
+	pthread_mutex_lock(&estim->lock);
+	if(path != NULL)
+	{
+		set_path(&estim->next_item, &estim->next_item_size, path);
+		estim->has_next_item = 1;
+	}
 	if(target != NULL)
 	{
-		replace_string(&estim->target, target);
+		set_path(&estim->next_target, &estim->next_target_size, target);
+		estim->has_next_target = 1;
 	}
+	pthread_mutex_unlock(&estim->lock);
+}
 
-	ionotif_notify(IO_PS_IN_PROGRESS, estim);
+/* Moves paths reported by other threads to item and target.  Must be called
+ * only by the owner of the estim. */
+static void
+take_next_paths(ioeta_estim_t *estim)
+{
+	pthread_mutex_lock(&estim->lock);
+	if(estim->has_next_item)
+	{
+		set_path(&estim->item, &estim->item_size, estim->next_item);
+		estim->has_next_item = 0;
+	}
+	if(estim->has_next_target)
+	{
+		set_path(&estim->target, &estim->target_size, estim->next_target);
+		estim->has_next_target = 0;
+	}
+	pthread_mutex_unlock(&estim->lock);
 }
 
-int
-ioeta_silent_on(ioeta_estim_t *estim)
+/* Copies path into the buffer reallocating it only if it's too small. */
+static void
+set_path(char **buf, size_t *size, const char path[])
 {
-	int silent;
+	const size_t len = strlen(path) + 1U;
 
-	if(estim == NULL)
+	if(len > *size)
 	{
-		return 0;
+		char *const new_buf = realloc(*buf, len);
+		if(new_buf == NULL)
+		{
+			return;
+		}
+		*buf = new_buf;
+		*size = len;
 	}
 
-	silent = estim->silent;
-	estim->silent = 1;
-	return silent;
+	memcpy(*buf, path, len);
 }
 
-void
-ioeta_silent_set(ioeta_estim_t *estim, int silent)
+/* Checks whether current thread is the one that sends notifications.  Returns
+ * non-zero if so, otherwise zero is returned. */
+static int
+is_owner(const ioeta_estim_t *estim)
 {
-	if(estim != NULL)
+	return pthread_equal(estim->owner, pthread_self());
+}
+
+/* Atomically makes sure that the value isn't less than min. */
+static void
+raise_u64(uint64_t *value, uint64_t min)
+{
+	uint64_t current = __atomic_load_n(value, __ATOMIC_RELAXED);
+	while(current < min && !__atomic_compare_exchange_n(value, &current, min, 1,
+				__ATOMIC_RELAXED, __ATOMIC_RELAXED))
 	{
-		estim->silent = silent;
+		/* current is updated by failed exchange, just try again. */
 	}
 }
 
+/* Atomically makes sure that the value isn't less than min. */
+static void
+raise_size(size_t *value, size_t min)
+{
+	size_t current = __atomic_load_n(value, __ATOMIC_RELAXED);
+	while(current < min && !__atomic_compare_exchange_n(value, &current, min, 1,
+				__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+	{
+		/* current is updated by failed exchange, just try again. */
+	}
+}
+
+/* Checks whether enough time has passed since the last notification about
+ * progress.  Must be called only by the owner of the estim.  Completion of the last item is always reported.  Returns non-zero
+ * if so, otherwise zero is returned. */
+static int
+should_notify(ioeta_estim_t *estim)
+{
+	const uint64_t now = get_time();
+
+	if(__atomic_load_n(&estim->current_item, __ATOMIC_RELAXED) <
+			__atomic_load_n(&estim->total_items, __ATOMIC_RELAXED) &&
+			now - estim->last_notified < NOTIFY_INTERVAL_US &&
+			estim->last_notified != 0U)
+	{
+		return 0;
+	}
+
+	estim->last_notified = now;
+	return 1;
+}
+
+/* Retrieves current time.  Returns the time in microseconds. */
+static uint64_t
+get_time_us(void)
+{
+	struct timeval tv;
+	(void)gettimeofday(&tv, NULL);
+	return (uint64_t)tv.tv_sec*1000000U + tv.tv_usec;
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 : */
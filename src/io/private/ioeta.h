@@ -21,10 +21,14 @@
 
 #include <stdint.h> /* uint64_t */
 
+#include "../../utils/test_helpers.h"
 #include "../ioeta.h"
 
 /* ioeta - private functions of Input/Output estimation */
 
+/* Retrieves current time in microseconds. */
+typedef uint64_t (*ioeta_clock_func)(void);
+
 /* Adds zero-size item to the estimation. */
 void ioeta_add_item(ioeta_estim_t *estim, const char path[]);
 
@@ -44,6 +48,12 @@ void ioeta_add_dir(ioeta_estim_t *estim, const char path[]);
 void ioeta_update(ioeta_estim_t *estim, const char path[], const char target[],
 		int finished, uint64_t bytes);
 
+/* Same as ioeta_update(), but for bytes that were processed without
+ * transferring them (e.g., file was cloned or copied by previous run), so
+ * neither they nor the file are charged to rate limits. */
+void ioeta_update_skipped(ioeta_estim_t *estim, const char path[],
+		const char target[], int finished, uint64_t bytes);
+
 /* Silence future progress reports.  Returns previous state to be passed to
  * ioeta_silent_set() later.  If estim is NULL, returns zero. */
 int ioeta_silent_on(ioeta_estim_t *estim);
@@ -51,6 +61,18 @@ int ioeta_silent_on(ioeta_estim_t *estim);
 /* Sets silence flag for the estimation.  Does nothing if estim is NULL. */
 void ioeta_silent_set(ioeta_estim_t *estim, int silent);
 
+/* Checks whether operation that reports progress to the estim should stop.
+ * Background operations are checked for cancellation of their job, others for
+ * cancellation requested via UI if cancellable is non-zero.  The estim can be
+ * NULL.  Returns non-zero if so, otherwise zero is returned. */
+int ioeta_cancelled(const ioeta_estim_t *estim, int cancellable);
+
+TSTATIC_DEFS(
+	/* Replaces source of time used to limit rate of notifications, NULL restores
+	 * the default one. */
+	void ioeta_set_clock(ioeta_clock_func clock);
+)
+
 #endif /* VIFM__IO__PRIVATE__IOETA_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
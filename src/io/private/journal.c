@@ -0,0 +1,308 @@
+/* vifm
+ * Copyright (C) 2015 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "journal.h"
+
+#include <pthread.h> /* pthread_mutex_* */
+#include <sys/stat.h> /* stat */
+#include <unistd.h> /* unlink() */
+
+#include <inttypes.h> /* PRId64 PRIu64 SCNd64 SCNu64 */
+#include <stddef.h> /* NULL */
+#include <stdint.h> /* int64_t uint64_t uintptr_t */
+#include <stdio.h> /* FILE fclose() fflush() fprintf() sscanf() */
+#include <stdlib.h> /* free() malloc() */
+#include <string.h> /* strchr() strcspn() strdup() */
+
+#include "../../compat/os.h"
+#include "../../utils/file_streams.h"
+#include "../../utils/path.h"
+#include "../../utils/str.h"
+#include "../../utils/tree.h"
+
+/* Suffix of names of journal files. */
+#define JOURNAL_SUFFIX ".vifm-journal"
+
+/* State of a destination file as recorded in the journal. */
+typedef struct
+{
+	uint64_t size;   /* Size of the source file. */
+	int64_t mtime;   /* Modification time of the source file. */
+	uint64_t offset; /* Number of bytes on disk. */
+	int done;        /* Whether the file was completely copied. */
+}
+record_t;
+
+/* Journal of a single copying operation. */
+struct journal_t
+{
+	char *path;           /* Path to the journal file. */
+	FILE *fp;             /* Stream to append records to. */
+	tree_t records;       /* Records loaded from previous runs (record_t *). */
+	int empty;            /* Whether there are no records at all. */
+	pthread_mutex_t lock; /* Serializes writes to the stream. */
+};
+
+static void load_records(journal_t *journal);
+static void parse_record(journal_t *journal, const char line[]);
+static const record_t * find_record(journal_t *journal, const char dst[],
+		const struct stat *src_st);
+static void write_record(journal_t *journal, const char dst[],
+		const struct stat *src_st, const uint64_t *offset);
+
+char *
+journal_path(const char dst[])
+{
+	char *dir;
+	char *path;
+
+	dir = strdup(dst);
+	if(dir == NULL)
+	{
+		return NULL;
+	}
+	if(strchr(dir, '/') == NULL)
+	{
+		dir[0] = '\0';
+	}
+	else
+	{
+		remove_last_path_component(dir);
+	}
+
+	path = (dir[0] == '\0')
+	     ? format_str(".%s" JOURNAL_SUFFIX, get_last_path_component(dst))
+	     : format_str("%s/.%s" JOURNAL_SUFFIX, dir, get_last_path_component(dst));
+	free(dir);
+	return path;
+}
+
+journal_t *
+journal_open(const char dst[], int load)
+{
+	journal_t *const journal = malloc(sizeof(*journal));
+	if(journal == NULL)
+	{
+		return NULL;
+	}
+
+	journal->path = journal_path(dst);
+	journal->records = tree_create(0, 1);
+	if(journal->path == NULL || journal->records == NULL_TREE)
+	{
+		free(journal->path);
+		tree_free(journal->records);
+		free(journal);
+		return NULL;
+	}
+
+	journal->empty = 1;
+	if(load)
+	{
+		load_records(journal);
+	}
+
+	journal->fp = os_fopen(journal->path, load ? "ab" : "wb");
+	if(journal->fp == NULL)
+	{
+		free(journal->path);
+		tree_free(journal->records);
+		free(journal);
+		return NULL;
+	}
+
+	pthread_mutex_init(&journal->lock, NULL);
+	return journal;
+}
+
+/* Reads records of previous runs from journal file. */
+static void
+load_records(journal_t *journal)
+{
+	char *line = NULL;
+	FILE *const fp = os_fopen(journal->path, "rb");
+	if(fp == NULL)
+	{
+		return;
+	}
+
+	while((line = read_line(fp, line)) != NULL)
+	{
+		parse_record(journal, line);
+	}
+
+	fclose(fp);
+}
+
+/* Parses single line of journal file and stores the record.  Malformed lines
+ * (e.g., incomplete last line) are ignored. */
+static void
+parse_record(journal_t *journal, const char line[])
+{
+	record_t *record;
+	record_t parsed = {};
+	int path_start = -1;
+	char kind;
+
+	if(sscanf(line, "%c", &kind) != 1)
+	{
+		return;
+	}
+
+	if(kind == 'D')
+	{
+		(void)sscanf(line, "D %" SCNu64 " %" SCNd64 " %n", &parsed.size,
+				&parsed.mtime, &path_start);
+		parsed.done = 1;
+	}
+	else if(kind == 'C')
+	{
+		(void)sscanf(line, "C %" SCNu64 " %" SCNd64 " %" SCNu64 " %n",
+				&parsed.size, &parsed.mtime, &parsed.offset, &path_start);
+	}
+
+	if(path_start < 0 || line[path_start] == '\0')
+	{
+		return;
+	}
+
+	record = malloc(sizeof(*record));
+	if(record == NULL)
+	{
+		return;
+	}
+	*record = parsed;
+
+	if(tree_set_data(journal->records, line + path_start,
+				(tree_val_t)(uintptr_t)record) != 0)
+	{
+		free(record);
+		return;
+	}
+	journal->empty = 0;
+}
+
+void
+journal_close(journal_t *journal, int remove)
+{
+	if(journal == NULL)
+	{
+		return;
+	}
+
+	fclose(journal->fp);
+	/* Empty journal would make unrelated destination look resumable. */
+	if(remove || journal->empty)
+	{
+		(void)unlink(journal->path);
+	}
+
+	pthread_mutex_destroy(&journal->lock);
+	tree_free(journal->records);
+	free(journal->path);
+	free(journal);
+}
+
+int
+journal_is_done(journal_t *journal, const char dst[],
+		const struct stat *src_st)
+{
+	const record_t *const record = find_record(journal, dst, src_st);
+	return record != NULL && record->done;
+}
+
+int
+journal_get_offset(journal_t *journal, const char dst[],
+		const struct stat *src_st, uint64_t *offset)
+{
+	const record_t *const record = find_record(journal, dst, src_st);
+	if(record == NULL || record->done)
+	{
+		return 1;
+	}
+
+	*offset = record->offset;
+	return 0;
+}
+
+/* Looks up record about the dst that matches the source file.  Returns the
+ * record or NULL. */
+static const record_t *
+find_record(journal_t *journal, const char dst[], const struct stat *src_st)
+{
+	tree_val_t data;
+	const record_t *record;
+
+	if(tree_get_data(journal->records, dst, &data) != 0)
+	{
+		return NULL;
+	}
+
+	record = (const record_t *)(uintptr_t)data;
+	if(record->size != (uint64_t)src_st->st_size ||
+			record->mtime != (int64_t)src_st->st_mtime)
+	{
+		return NULL;
+	}
+	return record;
+}
+
+void
+journal_checkpoint(journal_t *journal, const char dst[],
+		const struct stat *src_st, uint64_t offset)
+{
+	write_record(journal, dst, src_st, &offset);
+}
+
+void
+journal_done(journal_t *journal, const char dst[], const struct stat *src_st)
+{
+	write_record(journal, dst, src_st, NULL);
+}
+
+/* Appends record to the journal.  NULL offset means that the file is
+ * complete. */
+static void
+write_record(journal_t *journal, const char dst[], const struct stat *src_st,
+		const uint64_t *offset)
+{
+	/* Such paths can't be read back correctly. */
+	if(dst[strcspn(dst, "\r\n")] != '\0')
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&journal->lock);
+	journal->empty = 0;
+	if(offset == NULL)
+	{
+		fprintf(journal->fp, "D %" PRIu64 " %" PRId64 " %s\n",
+				(uint64_t)src_st->st_size, (int64_t)src_st->st_mtime, dst);
+	}
+	else
+	{
+		/* Checkpoints are rare, make sure they survive abnormal termination. */
+		fprintf(journal->fp, "C %" PRIu64 " %" PRId64 " %" PRIu64 " %s\n",
+				(uint64_t)src_st->st_size, (int64_t)src_st->st_mtime, *offset, dst);
+		fflush(journal->fp);
+	}
+	pthread_mutex_unlock(&journal->lock);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -0,0 +1,77 @@
+/* vifm
+ * Copyright (C) 2015 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__IO__PRIVATE__JOURNAL_H__
+#define VIFM__IO__PRIVATE__JOURNAL_H__
+
+#include <sys/stat.h> /* stat */
+
+#include <stdint.h> /* uint64_t */
+
+/* journal - record of progress of copying, which allows resuming it
+ *
+ * Journal is a text file next to the top-level destination of copying.  Each
+ * line describes a destination file:
+ *   D <size> <mtime> <path>           -- file was copied completely;
+ *   C <size> <mtime> <offset> <path>  -- first offset bytes are on disk;
+ * where size and mtime are those of the source file, so that records about
+ * files that changed since then are ignored.  Later lines override earlier
+ * ones.
+ *
+ * Functions can be called from multiple threads. */
+
+/* Opaque declaration of structure describing journal. */
+typedef struct journal_t journal_t;
+
+/* Builds path to journal of copying to the dst.  Returns newly allocated
+ * string or NULL on error. */
+char * journal_path(const char dst[]);
+
+/* Opens journal of copying to the dst.  Records are loaded from existing
+ * journal if load is non-zero, otherwise it's started anew.  Returns the
+ * journal or NULL on error. */
+journal_t * journal_open(const char dst[], int load);
+
+/* Closes the journal.  Its file is removed if remove is non-zero or if there
+ * are no records in it.  The journal can be NULL. */
+void journal_close(journal_t *journal, int remove);
+
+/* Checks whether dst was completely copied from a file described by src_st.
+ * Returns non-zero if so, otherwise zero is returned. */
+int journal_is_done(journal_t *journal, const char dst[],
+		const struct stat *src_st);
+
+/* Retrieves number of bytes of the dst that were copied from a file described
+ * by src_st and are known to be on disk.  Returns zero on success and non-zero
+ * if there is no record about unfinished copying of the same source file, in
+ * which case *offset is left untouched. */
+int journal_get_offset(journal_t *journal, const char dst[],
+		const struct stat *src_st, uint64_t *offset);
+
+/* Records that first offset bytes of the dst are on disk. */
+void journal_checkpoint(journal_t *journal, const char dst[],
+		const struct stat *src_st, uint64_t offset);
+
+/* Records that dst was completely copied. */
+void journal_done(journal_t *journal, const char dst[],
+		const struct stat *src_st);
+
+#endif /* VIFM__IO__PRIVATE__JOURNAL_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -0,0 +1,259 @@
+/* vifm
+ * Copyright (C) 2015 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "manifest.h"
+
+#include <sys/stat.h> /* stat */
+
+#include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* uint64_t */
+#include <stdlib.h> /* bsearch() free() qsort() realloc() */
+#include <string.h> /* strdup() strlen() strncmp() */
+#include <time.h> /* time() time_t */
+
+#include "../../compat/os.h"
+#include "../../utils/pwalk.h"
+
+/* Timestamps of some file systems have precision of two seconds, so changes
+ * made right after creation of a manifest can have slightly earlier time. */
+#define TIMESTAMP_SLACK 2
+
+struct manifest_t
+{
+	manifest_entry_t *entries; /* List of entries. */
+	size_t count;              /* Number of entries. */
+	size_t capacity;           /* Number of allocated entries. */
+	int sorted;                /* Whether entries are sorted. */
+	int invalid;               /* Whether some entries are missing. */
+	time_t created;            /* When the manifest was created. */
+};
+
+static void sort_entries(manifest_t *m);
+static int entry_cmp(const void *a, const void *b);
+static int path_cmp(const char a[], const char b[]);
+
+manifest_t *
+manifest_alloc(void)
+{
+	manifest_t *const m = calloc(1U, sizeof(manifest_t));
+	if(m != NULL)
+	{
+		m->created = time(NULL);
+	}
+	return m;
+}
+
+void
+manifest_free(manifest_t *m)
+{
+	size_t i;
+
+	if(m == NULL)
+	{
+		return;
+	}
+
+	for(i = 0U; i < m->count; ++i)
+	{
+		free(m->entries[i].path);
+	}
+	free(m->entries);
+	free(m);
+}
+
+void
+manifest_add(manifest_t *m, const char path[], PWalkEntry type, uint64_t size)
+{
+	manifest_entry_t *entry;
+
+	if(m->invalid)
+	{
+		return;
+	}
+
+	if(m->count == m->capacity)
+	{
+		const size_t capacity = (m->capacity == 0U) ? 64U : m->capacity*2U;
+		manifest_entry_t *const entries = realloc(m->entries,
+				sizeof(*entries)*capacity);
+		if(entries == NULL)
+		{
+			manifest_invalidate(m);
+			return;
+		}
+		m->entries = entries;
+		m->capacity = capacity;
+	}
+
+	entry = &m->entries[m->count];
+	entry->path = strdup(path);
+	entry->type = type;
+	entry->size = size;
+	if(entry->path == NULL)
+	{
+		manifest_invalidate(m);
+		return;
+	}
+
+	++m->count;
+	m->sorted = 0;
+}
+
+void
+manifest_invalidate(manifest_t *m)
+{
+	m->invalid = 1;
+}
+
+size_t
+manifest_find(manifest_t *m, const char path[],
+		const manifest_entry_t **entries)
+{
+	const manifest_entry_t key = { .path = (char *)path };
+	const manifest_entry_t *root;
+	size_t count;
+
+	if(m == NULL || m->invalid)
+	{
+		return 0U;
+	}
+
+	sort_entries(m);
+
+	root = bsearch(&key, m->entries, m->count, sizeof(*m->entries), &entry_cmp);
+	if(root == NULL)
+	{
+		return 0U;
+	}
+
+	count = 1U;
+	if(root->type == PWE_DIR)
+	{
+		const manifest_entry_t *const end = m->entries + m->count;
+		while(root + count != end &&
+				manifest_in_subtree(root[count].path, root->path))
+		{
+			++count;
+		}
+	}
+
+	*entries = root;
+	return count;
+}
+
+int
+manifest_dir_changed(const manifest_t *m, const char path[])
+{
+	/* Entries are added after the manifest is created, so anything that changed
+	 * since then might be missing in it.  Change time can't be set back, unlike
+	 * modification time. */
+	struct stat st;
+	const time_t since = m->created - TIMESTAMP_SLACK;
+	return os_lstat(path, &st) != 0
+	    || st.st_mtime >= since
+	    || st.st_ctime >= since;
+}
+
+int
+manifest_in_subtree(const char path[], const char root[])
+{
+	const size_t len = strlen(root);
+	if(strncmp(path, root, len) != 0)
+	{
+		return 0;
+	}
+	return (len != 0U && root[len - 1U] == '/') || path[len] == '/';
+}
+
+/* Sorts entries and drops duplicates if entries were added since the last
+ * sorting. */
+static void
+sort_entries(manifest_t *m)
+{
+	size_t i, j;
+
+	if(m->sorted)
+	{
+		return;
+	}
+
+	qsort(m->entries, m->count, sizeof(*m->entries), &entry_cmp);
+
+	/* The same subtree might have been estimated more than once. */
+	j = 0U;
+	for(i = 0U; i < m->count; ++i)
+	{
+		if(j != 0U && path_cmp(m->entries[j - 1U].path, m->entries[i].path) == 0)
+		{
+			free(m->entries[i].path);
+			continue;
+		}
+		m->entries[j++] = m->entries[i];
+	}
+	m->count = j;
+
+	m->sorted = 1;
+}
+
+/* qsort() and bsearch() comparer of manifest entries.  Returns standard -1, 0,
+ * 1 for comparisons. */
+static int
+entry_cmp(const void *a, const void *b)
+{
+	const manifest_entry_t *const x = a;
+	const manifest_entry_t *const y = b;
+	return path_cmp(x->path, y->path);
+}
+
+/* Compares paths so that slash goes before any other character, which puts
+ * each directory right before its subtree.  Returns standard -1, 0, 1 for
+ * comparisons. */
+static int
+path_cmp(const char a[], const char b[])
+{
+	while(*a != '\0' && *a == *b)
+	{
+		++a;
+		++b;
+	}
+
+	if(*a == *b)
+	{
+		return 0;
+	}
+	if(*a == '\0')
+	{
+		return -1;
+	}
+	if(*b == '\0')
+	{
+		return 1;
+	}
+	if(*a == '/')
+	{
+		return -1;
+	}
+	if(*b == '/')
+	{
+		return 1;
+	}
+	return ((unsigned char)*a < (unsigned char)*b) ? -1 : 1;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -0,0 +1,80 @@
+/* vifm
+ * Copyright (C) 2015 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__IO__PRIVATE__MANIFEST_H__
+#define VIFM__IO__PRIVATE__MANIFEST_H__
+
+#include <stddef.h> /* size_t */
+#include <stdint.h> /* uint64_t */
+
+#include "../../utils/pwalk.h"
+
+/* manifest - list of file system entries found during estimation
+ *
+ * Operations look up their subtrees in the manifest to avoid reading the same
+ * directories and querying the same files for the second time.  Entries are
+ * kept sorted in such a way that every directory is followed by its whole
+ * subtree.  Directories that were modified after the manifest was created
+ * should be read again, as their entries in the manifest might be out of
+ * date. */
+
+/* Single file system entry. */
+typedef struct
+{
+	char *path;      /* Full path to the entry. */
+	PWalkEntry type; /* Type of the entry. */
+	uint64_t size;   /* Size of a file, zero for anything else. */
+}
+manifest_entry_t;
+
+/* Opaque manifest type. */
+typedef struct manifest_t manifest_t;
+
+/* Allocates empty manifest.  Returns NULL on error. */
+manifest_t * manifest_alloc(void);
+
+/* Frees the manifest.  The m can be NULL. */
+void manifest_free(manifest_t *m);
+
+/* Adds entry to the manifest.  Failure to add an entry invalidates the
+ * manifest. */
+void manifest_add(manifest_t *m, const char path[], PWalkEntry type,
+		uint64_t size);
+
+/* Marks manifest as incomplete, after which nothing can be found in it. */
+void manifest_invalidate(manifest_t *m);
+
+/* Looks up subtree rooted at the path.  On success sets *entries to point at
+ * the root, which is followed by the rest of the subtree.  Returns number of
+ * entries in the subtree or zero if the path is unknown. */
+size_t manifest_find(manifest_t *m, const char path[],
+		const manifest_entry_t **entries);
+
+/* Checks whether directory at the path might have been changed after creation
+ * of the manifest.  Returns non-zero if so or if it can't be determined,
+ * otherwise zero is returned. */
+int manifest_dir_changed(const manifest_t *m, const char path[]);
+
+/* Checks whether path is inside of directory at the root path.  Returns
+ * non-zero if so, otherwise zero is returned. */
+int manifest_in_subtree(const char path[], const char root[]);
+
+#endif /* VIFM__IO__PRIVATE__MANIFEST_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -18,16 +18,48 @@
 
 #include "traverser.h"
 
-#include <stddef.h> /* NULL */
-#include <stdlib.h> /* free() */
+#ifndef _WIN32
+#include <sys/stat.h> /* S_ISDIR() S_ISLNK() fstatat() lstat() */
+#include <dirent.h> /* DIR DT_* dirent closedir() fdopendir() readdir() */
+#include <fcntl.h> /* AT_FDCWD AT_SYMLINK_NOFOLLOW O_* open() openat() */
+#include <unistd.h> /* close() */
+#endif
+
+#include <stddef.h> /* NULL size_t */
+#include <stdlib.h> /* free() realloc() */
+#include <string.h> /* strcpy() strlen() */
 
 #include "../../compat/os.h"
 #include "../../utils/fs.h"
 #include "../../utils/path.h"
 #include "../../utils/str.h"
+#include "manifest.h"
+
+/* State of traversal shared by all levels of recursion. */
+typedef struct
+{
+	subtree_visitor visitor; /* Visitor of entries. */
+	void *param;             /* Parameter of the visitor. */
+
+	char *path;      /* Full path to current entry. */
+	size_t len;      /* Length of the path. */
+	size_t capacity; /* Size of buffer of the path. */
+}
+traverser_t;
 
-static int traverse_subtree(const char path[], subtree_visitor visitor,
-		void *param);
+static int traverse_subtree(traverser_t *t, const visit_at_t *at,
+		DIR *dir);
+static int append_name(traverser_t *t, const char name[]);
+#ifndef _WIN32
+static DIR * open_dir_at(int dir_fd, const char name[]);
+static int is_dir_entry(int dir_fd, const struct dirent *d, int *is_link);
+#else
+static int is_dir_entry(const char full_path[], const struct dirent *d,
+		int *is_link);
+#endif
+static int replay_subtree(const manifest_t *manifest,
+		const manifest_entry_t entries[], size_t count, size_t *i,
+		subtree_visitor visitor, void *param);
 
 int
 traverse(const char path[], subtree_visitor visitor, void *param)
@@ -35,38 +67,81 @@ traverse(const char path[], subtree_visitor visitor, void *param)
 	/* Duplication with traverse_subtree(), but this way traverse_subtree() can
 	 * use information from dirent structure to save some operations. */
 
-	if(is_symlink(path))
+	traverser_t t = { .visitor = visitor, .param = param };
+	visit_at_t at = { .dir_fd = -1, .name = path };
+	DIR *dir;
+	int result;
+
+#ifndef _WIN32
+	struct stat st;
+
+	at.dir_fd = AT_FDCWD;
+
+	/* Treat symbolic links to directories as files as well. */
+	if(lstat(path, &st) != 0 || !S_ISDIR(st.st_mode))
+	{
+		return visitor(path, &at, VA_FILE, param);
+	}
+
+	dir = open_dir_at(AT_FDCWD, path);
+#else
+	if(is_symlink(path) || !is_dir(path))
 	{
 		/* Tread symbolic links to directories as files as well. */
-		return visitor(path, VA_FILE, param);
+		return visitor(path, &at, VA_FILE, param);
 	}
-	else if(is_dir(path))
+
+	dir = os_opendir(path);
+#endif
+
+	if(dir == NULL || append_name(&t, path) != 0)
 	{
-		return traverse_subtree(path, visitor, param);
+		if(dir != NULL)
+		{
+			(void)os_closedir(dir);
+		}
+		free(t.path);
+		return 1;
 	}
-	else
+
+	result = traverse_subtree(&t, &at, dir);
+	free(t.path);
+	return result;
+}
+
+int
+traverse_manifest(manifest_t *manifest, const char path[],
+		subtree_visitor visitor, void *param)
+{
+	const manifest_entry_t *entries;
+	const size_t count = manifest_find(manifest, path, &entries);
+	size_t i = 0U;
+
+	if(count == 0U)
 	{
-		return visitor(path, VA_FILE, param);
+		return traverse(path, visitor, param);
 	}
+
+	return replay_subtree(manifest, entries, count, &i, visitor, param);
 }
 
-/* A generic subtree traversing.  Returns zero on success, otherwise non-zero is
- * returned. */
+/* A generic subtree traversing.  The dir is an opened directory located at the
+ * at, t->path holds full path to it.  The dir is closed by this function.
+ * Returns zero on success, otherwise non-zero is returned. */
 static int
-traverse_subtree(const char path[], subtree_visitor visitor, void *param)
+traverse_subtree(traverser_t *t, const visit_at_t *at, DIR *dir)
 {
-	DIR *dir;
+	const size_t len = t->len;
 	struct dirent *d;
 	int result;
 	VisitResult enter_result;
+	visit_at_t child_at = { .dir_fd = -1 };
 
-	dir = os_opendir(path);
-	if(dir == NULL)
-	{
-		return 1;
-	}
+#ifndef _WIN32
+	child_at.dir_fd = dirfd(dir);
+#endif
 
-	enter_result = visitor(path, VA_DIR_ENTER, param);
+	enter_result = t->visitor(t->path, at, VA_DIR_ENTER, t->param);
 	if(enter_result == VR_ERROR)
 	{
 		(void)os_closedir(dir);
@@ -76,36 +151,210 @@ traverse_subtree(const char path[], subtree_visitor visitor, void *param)
 	result = 0;
 	while((d = os_readdir(dir)) != NULL)
 	{
-		if(!is_builtin_dir(d->d_name))
+		int is_link;
+		int is_dir;
+
+		if(is_builtin_dir(d->d_name))
 		{
-			char *const full_path = format_str("%s/%s", path, d->d_name);
-			if(entry_is_link(full_path, d))
-			{
-				/* Treat symbolic links to directories as files as well. */
-				result = visitor(full_path, VA_FILE, param);
-			}
-			else if(entry_is_dir(full_path, d))
-			{
-				result = traverse_subtree(full_path, visitor, param);
-			}
-			else
-			{
-				result = visitor(full_path, VA_FILE, param);
-			}
-			free(full_path);
+			continue;
+		}
+
+		if(append_name(t, d->d_name) != 0)
+		{
+			result = 1;
+			break;
+		}
+
+#ifndef _WIN32
+		child_at.name = d->d_name;
+		is_dir = is_dir_entry(child_at.dir_fd, d, &is_link);
+#else
+		child_at.name = t->path;
+		is_dir = is_dir_entry(t->path, d, &is_link);
+#endif
+
+		if(is_dir)
+		{
+#ifndef _WIN32
+			DIR *const child = open_dir_at(child_at.dir_fd, d->d_name);
+#else
+			DIR *const child = os_opendir(t->path);
+#endif
+			result = (child == NULL) ? 1 : traverse_subtree(t, &child_at, child);
+		}
+		else
+		{
+			/* Symbolic links to directories are treated as files as well. */
+			result = t->visitor(t->path, &child_at, VA_FILE, t->param);
+		}
+
+		t->len = len;
+		t->path[len] = '\0';
+
+		if(result != 0)
+		{
+			break;
+		}
+	}
+
+	(void)os_closedir(dir);
+
+	if(result == 0 && enter_result != VR_SKIP_DIR_LEAVE &&
+			enter_result != VR_CANCELLED)
+	{
+		result = t->visitor(t->path, at, VA_DIR_LEAVE, t->param);
+	}
 
-			if(result != 0)
+	return result;
+}
+
+/* Appends name to the path of the traverser separating it with a slash unless
+ * the path is empty.  Returns zero on success, otherwise non-zero is
+ * returned. */
+static int
+append_name(traverser_t *t, const char name[])
+{
+	const size_t name_len = strlen(name);
+	const size_t needed = t->len + 1U + name_len + 1U;
+
+	if(needed > t->capacity)
+	{
+		const size_t capacity = (needed > 2U*t->capacity) ? needed : 2U*t->capacity;
+		char *const path = realloc(t->path, capacity);
+		if(path == NULL)
+		{
+			return 1;
+		}
+		t->path = path;
+		t->capacity = capacity;
+	}
+
+	if(t->len != 0U)
+	{
+		t->path[t->len++] = '/';
+	}
+	strcpy(t->path + t->len, name);
+	t->len += name_len;
+	return 0;
+}
+
+#ifndef _WIN32
+
+/* Opens directory at name relative to the dir_fd without following symbolic
+ * links.  Returns opened directory or NULL on error. */
+static DIR *
+open_dir_at(int dir_fd, const char name[])
+{
+	DIR *dir;
+	const int fd = openat(dir_fd, name,
+			O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+	if(fd == -1)
+	{
+		return NULL;
+	}
+
+	dir = fdopendir(fd);
+	if(dir == NULL)
+	{
+		(void)close(fd);
+	}
+	return dir;
+}
+
+/* Determines type of the entry, querying file system only if type isn't
+ * provided by the dirent structure.  Sets *is_link.  Returns non-zero for
+ * directories that aren't symbolic links, otherwise zero is returned. */
+static int
+is_dir_entry(int dir_fd, const struct dirent *d, int *is_link)
+{
+	struct stat st;
+
+	if(d->d_type != DT_UNKNOWN)
+	{
+		*is_link = (d->d_type == DT_LNK);
+		return d->d_type == DT_DIR;
+	}
+
+	if(fstatat(dir_fd, d->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+	{
+		*is_link = 0;
+		return 0;
+	}
+
+	*is_link = S_ISLNK(st.st_mode);
+	return S_ISDIR(st.st_mode);
+}
+
+#else
+
+/* Determines type of the entry.  Sets *is_link.  Returns non-zero for
+ * directories that aren't symbolic links, otherwise zero is returned. */
+static int
+is_dir_entry(const char full_path[], const struct dirent *d, int *is_link)
+{
+	*is_link = entry_is_link(full_path, d);
+	return !*is_link && entry_is_dir(full_path, d);
+}
+
+#endif
+
+/* Same as traverse_subtree(), but walks list of entries starting at *i, which
+ * is advanced past the processed subtree.  Directories that changed since the
+ * manifest was made are read from file system.  Returns zero on success,
+ * otherwise non-zero is returned. */
+static int
+replay_subtree(const manifest_t *manifest, const manifest_entry_t entries[],
+		size_t count, size_t *i, subtree_visitor visitor, void *param)
+{
+	const manifest_entry_t *const entry = &entries[(*i)++];
+	visit_at_t at = { .dir_fd = -1, .name = entry->path };
+	int result;
+	VisitResult enter_result;
+
+#ifndef _WIN32
+	at.dir_fd = AT_FDCWD;
+#endif
+
+	switch(entry->type)
+	{
+		case PWE_DIR:
+			if(manifest_dir_changed(manifest, entry->path))
 			{
-				break;
+				while(*i < count && manifest_in_subtree(entries[*i].path, entry->path))
+				{
+					++*i;
+				}
+				return traverse(entry->path, visitor, param);
 			}
+			break;
+		case PWE_FILE:
+		case PWE_LINK:
+			return visitor(entry->path, &at, VA_FILE, param);
+		case PWE_FAIL:
+			/* Directory couldn't be opened. */
+			return 1;
+	}
+
+	enter_result = visitor(entry->path, &at, VA_DIR_ENTER, param);
+	if(enter_result == VR_ERROR)
+	{
+		return 1;
+	}
+
+	result = 0;
+	while(*i < count && manifest_in_subtree(entries[*i].path, entry->path))
+	{
+		result = replay_subtree(manifest, entries, count, i, visitor, param);
+		if(result != 0)
+		{
+			break;
 		}
 	}
-	(void)os_closedir(dir);
 
 	if(result == 0 && enter_result != VR_SKIP_DIR_LEAVE &&
 			enter_result != VR_CANCELLED)
 	{
-		result = visitor(path, VA_DIR_LEAVE, param);
+		result = visitor(entry->path, &at, VA_DIR_LEAVE, param);
 	}
 
 	return result;
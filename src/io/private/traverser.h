@@ -38,15 +38,37 @@ typedef enum
 }
 VisitResult;
 
-/* Generic handler for file system traversing algorithm.  Must return 0 on
- * success, otherwise directory traverse will be stopped. */
+/* Location of an entry, which can be passed to *at() family of functions.
+ * The name is relative to the dir_fd, which is AT_FDCWD when name is a full
+ * path.  On Windows dir_fd is -1 and name is the full path. */
+typedef struct
+{
+	int dir_fd;       /* Descriptor of a directory or special value. */
+	const char *name; /* Path relative to the dir_fd. */
+}
+visit_at_t;
+
+/* Generic handler for file system traversing algorithm.  The at is valid only
+ * during the call.  Must return 0 on success, otherwise directory traverse will
+ * be stopped. */
 typedef VisitResult (*subtree_visitor)(const char full_path[],
-		VisitAction action, void *param);
+		const visit_at_t *at, VisitAction action, void *param);
 
-/* A generic recursive file system traversing entry point.  Returns zero on
- * success, otherwise non-zero is returned. */
+/* A generic recursive file system traversing entry point.  Directories are
+ * opened relative to their parents and types of entries are queried only when
+ * they aren't reported by readdir().  Returns zero on success, otherwise
+ * non-zero is returned. */
 int traverse(const char path[], subtree_visitor visitor, void *param);
 
+struct manifest_t;
+
+/* Same as traverse(), but takes entries from the manifest instead of reading
+ * file system if the manifest lists the path.  Directories changed after
+ * creation of the manifest are still read.  The manifest can be NULL.
+ * Returns zero on success, otherwise non-zero is returned. */
+int traverse_manifest(struct manifest_t *manifest, const char path[],
+		subtree_visitor visitor, void *param);
+
 #endif // VIFM__IO__PRIVATE__TRAVERSER_H__
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
@@ -19,17 +19,31 @@
 
 #include "jobs_menu.h"
 
+#include <inttypes.h> /* PRIu64 */
+#include <stdint.h> /* uint64_t */
 #include <stdio.h> /* snprintf() */
-#include <string.h> /* strlen() strdup() */
+#include <stdlib.h> /* free() */
+#include <string.h> /* strdup() */
+#include <wchar.h> /* wcscmp() */
 
+#include "../io/iolimit.h"
 #include "../modes/menu.h"
+#include "../ui/statusbar.h"
 #include "../ui/ui.h"
+#include "../utils/macros.h"
 #include "../utils/str.h"
 #include "../utils/string_array.h"
+#include "../utils/utils.h"
 #include "../background.h"
+#include "../status.h"
 #include "menus.h"
 
 static int execute_jobs_cb(FileView *view, menu_info *m);
+static KHandlerResponse jobs_khandler(menu_info *m, const wchar_t keys[]);
+static char * format_job_item(const job_t *job);
+static int cancel_job(menu_info *m);
+static job_t * find_job(int index);
+static void change_job_limit(menu_info *m, wchar_t action);
 
 int
 show_jobs_menu(FileView *view)
@@ -41,6 +55,7 @@ show_jobs_menu(FileView *view)
 	init_menu_info(&m, JOBS_MENU, strdup("No jobs currently running"));
 	m.title = strdup(" Pid --- Command ");
 	m.execute_handler = &execute_jobs_cb;
+	m.key_handler = &jobs_khandler;
 
 	check_background_jobs();
 
@@ -53,25 +68,7 @@ show_jobs_menu(FileView *view)
 	{
 		if(p->running)
 		{
-			char info_buf[24];
-			char item_buf[sizeof(info_buf) + strlen(p->cmd)];
-
-			if(p->type == BJT_COMMAND)
-			{
-				snprintf(info_buf, sizeof(info_buf), PRINTF_PID_T, p->pid);
-			}
-			else if(p->bg_op.total == BG_UNDEFINED_TOTAL)
-			{
-				snprintf(info_buf, sizeof(info_buf), "n/a");
-			}
-			else
-			{
-				snprintf(info_buf, sizeof(info_buf), "%d/%d", p->bg_op.done + 1,
-						p->bg_op.total);
-			}
-
-			snprintf(item_buf, sizeof(item_buf), "%-8s  %s", info_buf, p->cmd);
-			i = add_to_string_array(&m.items, i, 1, item_buf);
+			i = put_into_string_array(&m.items, i, format_job_item(p));
 		}
 
 		p = p->next;
@@ -84,6 +81,64 @@ show_jobs_menu(FileView *view)
 	return display_menu(&m, view);
 }
 
+/* Formats menu item that describes the job.  Returns newly allocated string. */
+static char *
+format_job_item(const job_t *job)
+{
+	char info_buf[24];
+	char limit_buf[64];
+
+	limit_buf[0] = '\0';
+
+	if(job->type == BJT_COMMAND)
+	{
+		snprintf(info_buf, sizeof(info_buf), PRINTF_PID_T, job->pid);
+	}
+	else if(job->bg_op.cancelled)
+	{
+		snprintf(info_buf, sizeof(info_buf), "stopping");
+	}
+	else if(job->queued)
+	{
+		snprintf(info_buf, sizeof(info_buf), "queued");
+	}
+	else if(job->bg_op.total == BG_UNDEFINED_TOTAL)
+	{
+		if(job->bg_op.done == 0)
+		{
+			snprintf(info_buf, sizeof(info_buf), "n/a");
+		}
+		else
+		{
+			snprintf(info_buf, sizeof(info_buf), "%d/?", job->bg_op.done);
+		}
+	}
+	else
+	{
+		snprintf(info_buf, sizeof(info_buf), "%d/%d", job->bg_op.done + 1,
+				job->bg_op.total);
+	}
+
+	if(job->bg_op.limit != NULL)
+	{
+		uint64_t bytes_rate, files_rate;
+		iolimit_get(job->bg_op.limit, &bytes_rate, &files_rate);
+
+		if(bytes_rate != 0U || files_rate != 0U)
+		{
+			char size_buf[24] = "-";
+			if(bytes_rate != 0U)
+			{
+				friendly_size_notation(bytes_rate, sizeof(size_buf), size_buf);
+			}
+			snprintf(limit_buf, sizeof(limit_buf), " (limit: %s/s, %" PRIu64
+					" files/s)", size_buf, files_rate);
+		}
+	}
+
+	return format_str("%-8s  %s%s", info_buf, job->cmd, limit_buf);
+}
+
 /* Callback that is called when menu item is selected.  Should return non-zero
  * to stay in menu mode. */
 static int
@@ -93,5 +148,119 @@ execute_jobs_cb(FileView *view, menu_info *m)
 	return 0;
 }
 
+/* Menu-specific shortcut handler.  Returns code that specifies both taken
+ * actions and what should be done next. */
+static KHandlerResponse
+jobs_khandler(menu_info *m, const wchar_t keys[])
+{
+	if(wcscmp(keys, L"dd") == 0)
+	{
+		if(cancel_job(m) != 0)
+		{
+			status_bar_error("This job can't be cancelled");
+			curr_stats.save_msg = 1;
+			return KHR_UNHANDLED;
+		}
+		return KHR_REFRESH_WINDOW;
+	}
+	else if(wcscmp(keys, L"-") == 0 || wcscmp(keys, L"+") == 0 ||
+			wcscmp(keys, L"=") == 0)
+	{
+		change_job_limit(m, keys[0]);
+		return KHR_REFRESH_WINDOW;
+	}
+	return KHR_UNHANDLED;
+}
+
+/* Requests cancellation of internal background operation under the cursor and
+ * updates its menu item.  The job is still listed as it keeps running until it
+ * notices the request.  Returns zero on success, otherwise non-zero is returned
+ * (e.g., for jobs that don't check for cancellation). */
+static int
+cancel_job(menu_info *m)
+{
+	job_t *p;
+	int result = 1;
+
+	bg_jobs_freeze();
+
+	p = find_job(m->pos);
+	if(p != NULL)
+	{
+		result = bg_job_cancel(p);
+		if(result == 0)
+		{
+			free(m->items[m->pos]);
+			m->items[m->pos] = format_job_item(p);
+		}
+	}
+
+	bg_jobs_unfreeze();
+
+	return result;
+}
+
+/* Looks up running job that corresponds to index-th menu item.  Job list must
+ * be frozen.  Returns the job or NULL. */
+static job_t *
+find_job(int index)
+{
+	job_t *p;
+	for(p = jobs; p != NULL; p = p->next)
+	{
+		if(p->running && index-- == 0)
+		{
+			return p;
+		}
+	}
+	return NULL;
+}
+
+/* Slows down ('-'), speeds up ('+') or removes limit ('=') of I/O rate of
+ * background operation under the cursor and updates its menu item.  Slowing
+ * down an operation without limit starts from its average rate. */
+static void
+change_job_limit(menu_info *m, wchar_t action)
+{
+	job_t *p;
+	uint64_t bytes_rate, files_rate;
+
+	bg_jobs_freeze();
+
+	p = find_job(m->pos);
+	if(p == NULL || p->bg_op.limit == NULL)
+	{
+		bg_jobs_unfreeze();
+		return;
+	}
+
+	iolimit_get(p->bg_op.limit, &bytes_rate, &files_rate);
+	switch(action)
+	{
+		case L'-':
+			if(bytes_rate == 0U && files_rate == 0U)
+			{
+				iolimit_get_observed(p->bg_op.limit, &bytes_rate, &files_rate);
+			}
+			bytes_rate = (bytes_rate == 0U) ? 0U : MAX(bytes_rate/2U, 1024U);
+			files_rate = (files_rate == 0U) ? 0U : MAX(files_rate/2U, 1U);
+			break;
+		case L'+':
+			bytes_rate *= 2U;
+			files_rate *= 2U;
+			break;
+		default:
+			bytes_rate = 0U;
+			files_rate = 0U;
+			break;
+	}
+	iolimit_set(p->bg_op.limit, bytes_rate, files_rate);
+
+	free(m->items[m->pos]);
+	m->items[m->pos] = format_job_item(p);
+
+	bg_jobs_unfreeze();
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 : */
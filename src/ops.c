@@ -446,6 +446,7 @@ op_cp(ops_t *ops, void *data, const char src[], const char dst[],
 		.arg3.crs = ca_to_crs(conflict_action),
 
 		.cancellable = data == NULL,
+		.nthreads = cfg.copy_threads,
 	};
 	return exec_io_op(ops, &ior_cp, &args);
 }
@@ -547,6 +548,7 @@ op_mv(ops_t *ops, void *data, const char src[], const char dst[],
 			.arg3.crs = ca_to_crs(conflict_action),
 
 			.cancellable = data == NULL,
+			.nthreads = cfg.copy_threads,
 		};
 		result = exec_io_op(ops, &ior_mv, &args);
 	}
@@ -882,6 +884,7 @@ static int
 exec_io_op(ops_t *ops, int (*func)(io_args_t *const), io_args_t *const args)
 {
 	int result;
+	size_t i;
 
 	args->estim = (ops == NULL) ? NULL : ops->estim;
 	args->confirm = &confirm_overwrite;
@@ -900,6 +903,13 @@ exec_io_op(ops_t *ops, int (*func)(io_args_t *const), io_args_t *const args)
 		ui_cancellation_disable();
 	}
 
+	for(i = 0U; i < args->result.errors.error_count; ++i)
+	{
+		const io_err_t *const err = &args->result.errors.errors[i];
+		LOG_ERROR_MSG("%s: %s", err->msg, err->path);
+	}
+	io_errlst_free(&args->result.errors);
+
 	return result;
 }
 
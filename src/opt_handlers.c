@@ -24,6 +24,7 @@
 #include <ctype.h> /* isdigit() */
 #include <limits.h> /* INT_MIN */
 #include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* uint64_t */
 #include <stdio.h> /* snprintf() */
 #include <stdlib.h> /* abs() free() */
 #include <string.h> /* memcpy() memmove() strchr() strdup() strlen() strncat()
@@ -32,6 +33,7 @@
 #include "cfg/config.h"
 #include "engine/options.h"
 #include "engine/text_buffer.h"
+#include "io/ioc.h"
 #include "modes/view.h"
 #include "ui/statusbar.h"
 #include "ui/ui.h"
@@ -40,6 +42,7 @@
 #include "utils/str.h"
 #include "utils/string_array.h"
 #include "utils/utils.h"
+#include "background.h"
 #include "column_view.h"
 #include "filelist.h"
 #include "fileview.h"
@@ -94,6 +97,7 @@ static void load_options_defaults(void);
 static void add_options(void);
 static void aproposprg_handler(OPT_OP op, optval_t val);
 static void autochpos_handler(OPT_OP op, optval_t val);
+static void bgthreads_handler(OPT_OP op, optval_t val);
 static void cdpath_handler(OPT_OP op, optval_t val);
 static void chaselinks_handler(OPT_OP op, optval_t val);
 static void classify_handler(OPT_OP op, optval_t val);
@@ -102,6 +106,7 @@ static const char * pick_out_decoration(const char classify_item[],
 		FileType *type);
 static void columns_handler(OPT_OP op, optval_t val);
 static void confirm_handler(OPT_OP op, optval_t val);
+static void copythreads_handler(OPT_OP op, optval_t val);
 static void cpoptions_handler(OPT_OP op, optval_t val);
 static void dotdirs_handler(OPT_OP op, optval_t val);
 static void fastrun_handler(OPT_OP op, optval_t val);
@@ -117,6 +122,9 @@ static void hlsearch_handler(OPT_OP op, optval_t val);
 static void iec_handler(OPT_OP op, optval_t val);
 static void ignorecase_handler(OPT_OP op, optval_t val);
 static void incsearch_handler(OPT_OP op, optval_t val);
+static void iobandwidth_handler(OPT_OP op, optval_t val);
+static void iofilerate_handler(OPT_OP op, optval_t val);
+static void update_io_limit(void);
 static int parse_range(const char range[], int *from, int *to);
 static int parse_endpoint(const char **str, int *endpoint);
 static void laststatus_handler(OPT_OP op, optval_t val);
@@ -148,6 +156,9 @@ static void set_view_columns_option(FileView *view, const char value[],
 static void add_column(columns_t columns, column_info_t column_info);
 static int map_name(const char name[]);
 static void resort_view(FileView * view);
+#ifndef _WIN32
+static void statthreads_handler(OPT_OP op, optval_t val);
+#endif
 static void statusline_handler(OPT_OP op, optval_t val);
 static void syscalls_handler(OPT_OP op, optval_t val);
 static void tabstop_handler(OPT_OP op, optval_t val);
@@ -288,6 +299,10 @@ options[] = {
 	  OPT_BOOL, 0, NULL, &autochpos_handler,
 	  { .ref.bool_val = &cfg.auto_ch_pos },
 	},
+	{ "bgthreads", "",
+	  OPT_INT, 0, NULL, &bgthreads_handler,
+	  { .ref.int_val = &cfg.bg_threads },
+	},
 	{ "cdpath", "cd",
 	  OPT_STRLIST, 0, NULL, &cdpath_handler,
 	  { .ref.str_val = &cfg.cd_path },
@@ -308,6 +323,10 @@ options[] = {
 	  OPT_BOOL, 0, NULL, &confirm_handler,
 	  { .ref.bool_val = &cfg.confirm },
 	},
+	{ "copythreads", "",
+	  OPT_INT, 0, NULL, &copythreads_handler,
+	  { .ref.int_val = &cfg.copy_threads },
+	},
 	{ "cpoptions", "cpo",
 	  OPT_CHARSET, cpoptions_count, &cpoptions_vals, &cpoptions_handler,
 	  { .init = &init_cpoptions },
@@ -364,6 +383,14 @@ options[] = {
 	  OPT_BOOL, 0, NULL, &incsearch_handler ,
 	  { .ref.bool_val = &cfg.inc_search },
 	},
+	{ "iobandwidth", "",
+	  OPT_INT, 0, NULL, &iobandwidth_handler,
+	  { .ref.int_val = &cfg.io_bandwidth },
+	},
+	{ "iofilerate", "",
+	  OPT_INT, 0, NULL, &iofilerate_handler,
+	  { .ref.int_val = &cfg.io_file_rate },
+	},
 	{ "laststatus", "ls",
 	  OPT_BOOL, 0, NULL, &laststatus_handler,
 	  { .ref.bool_val = &cfg.display_statusline },
@@ -418,6 +445,12 @@ options[] = {
 	  OPT_BOOL, 0, NULL, &sortnumbers_handler,
 	  { .ref.bool_val = &cfg.sort_numbers },
 	},
+#ifndef _WIN32
+	{ "statthreads", "",
+	  OPT_INT, 0, NULL, &statthreads_handler,
+	  { .ref.int_val = &cfg.stat_threads },
+	},
+#endif
 	{ "statusline", "stl",
 	  OPT_STR, 0, NULL, &statusline_handler,
 	  { .ref.str_val = &cfg.status_line },
@@ -861,6 +894,22 @@ autochpos_handler(OPT_OP op, optval_t val)
 	}
 }
 
+/* Maximum number of threads that run background operations and tasks. */
+static void
+bgthreads_handler(OPT_OP op, optval_t val)
+{
+	if(val.int_val <= 0)
+	{
+		vle_tb_append_linef(vle_err, "Argument must be > 0: %d", val.int_val);
+		error = 1;
+		val.int_val = 1;
+		set_option("bgthreads", val);
+		return;
+	}
+
+	cfg.bg_threads = val.int_val;
+}
+
 /* Specifies directories to check on cding by relative path. */
 static void
 cdpath_handler(OPT_OP op, optval_t val)
@@ -1019,6 +1068,31 @@ confirm_handler(OPT_OP op, optval_t val)
 	cfg.confirm = val.bool_val;
 }
 
+/* Number of threads that copy files of a directory. */
+static void
+copythreads_handler(OPT_OP op, optval_t val)
+{
+	if(val.int_val <= 0)
+	{
+		vle_tb_append_linef(vle_err, "Argument must be > 0: %d", val.int_val);
+		error = 1;
+		val.int_val = 1;
+		set_option("copythreads", val);
+		return;
+	}
+	if(val.int_val > IO_MAX_THREADS)
+	{
+		vle_tb_append_linef(vle_err, "Argument must be <= %d: %d", IO_MAX_THREADS,
+				val.int_val);
+		error = 1;
+		val.int_val = cfg.copy_threads;
+		set_option("copythreads", val);
+		return;
+	}
+
+	cfg.copy_threads = val.int_val;
+}
+
 /* Parses set of compatibility flags and changes configuration accordingly. */
 static void
 cpoptions_handler(OPT_OP op, optval_t val)
@@ -1191,6 +1265,49 @@ incsearch_handler(OPT_OP op, optval_t val)
 	cfg.inc_search = val.bool_val;
 }
 
+/* Limit of I/O rate of all background operations in KiB per second. */
+static void
+iobandwidth_handler(OPT_OP op, optval_t val)
+{
+	if(val.int_val < 0)
+	{
+		vle_tb_append_linef(vle_err, "Argument must be >= 0: %d", val.int_val);
+		error = 1;
+		val.int_val = 0;
+		set_option("iobandwidth", val);
+		return;
+	}
+
+	cfg.io_bandwidth = val.int_val;
+	update_io_limit();
+}
+
+/* Limit of number of files processed by all background operations per
+ * second. */
+static void
+iofilerate_handler(OPT_OP op, optval_t val)
+{
+	if(val.int_val < 0)
+	{
+		vle_tb_append_linef(vle_err, "Argument must be >= 0: %d", val.int_val);
+		error = 1;
+		val.int_val = 0;
+		set_option("iofilerate", val);
+		return;
+	}
+
+	cfg.io_file_rate = val.int_val;
+	update_io_limit();
+}
+
+/* Applies values of 'iobandwidth' and 'iofilerate' options to background
+ * operations. */
+static void
+update_io_limit(void)
+{
+	bg_set_shared_io_limit((uint64_t)cfg.io_bandwidth*1024U, cfg.io_file_rate);
+}
+
 /* Parses range, which can be shortened to single endpoint if first element
  * matches last one.  Returns non-zero on error, otherwise zero is returned. */
 static int
@@ -1649,6 +1766,24 @@ resort_view(FileView * view)
 	refresh_view_win(view);
 }
 
+#ifndef _WIN32
+/* Number of threads that query information about files of a directory. */
+static void
+statthreads_handler(OPT_OP op, optval_t val)
+{
+	if(val.int_val <= 0)
+	{
+		vle_tb_append_linef(vle_err, "Argument must be > 0: %d", val.int_val);
+		error = 1;
+		val.int_val = 1;
+		set_option("statthreads", val);
+		return;
+	}
+
+	cfg.stat_threads = val.int_val;
+}
+#endif
+
 static void
 statusline_handler(OPT_OP op, optval_t val)
 {
@@ -21,352 +21,569 @@
 
 #include <assert.h> /* assert() */
 #include <ctype.h>
-#include <stdlib.h> /* abs() qsort() */
-#include <string.h> /* strcmp() strrchr() */
+#include <stdlib.h> /* abs() free() malloc() qsort() */
+#include <string.h> /* memcpy() strcmp() strdup() strrchr() */
 
 #include "cfg/config.h"
 #include "ui/ui.h"
 #include "utils/fs_limits.h"
+#include "utils/dcache.h"
+#include "utils/log.h"
+#include "utils/macros.h"
 #include "utils/path.h"
 #include "utils/str.h"
 #include "utils/test_helpers.h"
-#include "utils/tree.h"
 #include "utils/utils.h"
 #include "filelist.h"
 #include "status.h"
 #include "types.h"
 
+/* Data of an entry computed once per sorting, so that comparisons don't need to
+ * derive it over and over again. */
+typedef struct
+{
+	dir_entry_t *entry; /* Entry the key is computed for. */
+	int index;          /* Original position of the entry, for stability. */
+	int is_parent;      /* Whether entry is reference to parent directory. */
+	int is_dir;         /* Whether entry is a directory or a link to one. */
+	const char *name;   /* Name to compare (short path for custom views). */
+	const char *iname;  /* Lower case version of name or NULL if not needed. */
+	const char *ext;    /* Extension of the file name or NULL if there is none. */
+#ifndef _WIN32
+	char perms[11];     /* Permissions string, empty if not needed. */
+#endif
+	char *name_buf;     /* Storage of name if it doesn't point to the entry. */
+	char *iname_buf;    /* Storage of iname if it's set. */
+}
+sort_key_t;
+
 /* View which is being sorted. */
 static FileView* view;
 /* Whether the view displays custom file list. */
 static int custom_view;
-static int sort_descending;
-/* Key used to sort entries in current sorting round. */
-static SortingKey sort_type;
-
-static void sort_by_key(char key);
-static int sort_dir_list(const void *one, const void *two);
+/* Sorting keys in the order of their significance. */
+static char keys[SK_COUNT + 1];
+/* Number of elements in the keys array. */
+static int nkeys;
+/* Whether names need to be replaced with short paths. */
+static int need_short_paths;
+/* Whether lower case versions of names are needed. */
+static int need_lower_names;
+/* Whether sizes of directories need to be retrieved. */
+static int need_dir_sizes;
+/* Whether permission strings are needed. */
+static int need_perms;
+
+static int prepare_keys(FileView *v);
+static int need_key(SortingKey key);
+static int init_sort_key(sort_key_t *key, dir_entry_t *entry, int index);
+static void fill_sort_key(sort_key_t *key, dir_entry_t *entry, int index,
+		char name[], char iname[]);
+static void free_sort_key(sort_key_t *key);
+static int sort_keys_cmp(const void *one, const void *two);
+static int compare_keys(const sort_key_t *a, const sort_key_t *b);
+static int compare_by_key(const sort_key_t *a, const sort_key_t *b,
+		SortingKey key);
 TSTATIC int strnumcmp(const char s[], const char t[]);
 #if !defined(HAVE_STRVERSCMP_FUNC) || !HAVE_STRVERSCMP_FUNC
 static int vercmp(const char s[], const char t[]);
 #else
 static char * skip_leading_zeros(const char str[]);
 #endif
-static int compare_entry_names(const dir_entry_t *a, const dir_entry_t *b,
-		int ignore_case);
-static int compare_full_file_names(const char s[], const char t[],
+static int compare_full_file_names(const sort_key_t *a, const sort_key_t *b,
 		int ignore_case);
-static int compare_file_names(const char s[], const char t[], int ignore_case);
+static int compare_file_names(const char s[], const char t[]);
 
 void
 sort_view(FileView *v)
 {
+	sort_entries(v, v->dir_entry, v->list_rows);
+}
+
+void
+sort_entries(FileView *v, dir_entry_t list[], int count)
+{
+	sort_key_t *sort_keys;
+	dir_entry_t *sorted;
 	int i;
 
-	if(v->sort[0] > SK_LAST)
+	if(!prepare_keys(v) || count < 2)
 	{
-		/* Completely skip sorting if primary key isn't set. */
 		return;
 	}
 
-	view = v;
-	custom_view = flist_custom_active(v);
+	sort_keys = malloc(sizeof(*sort_keys)*count);
+	sorted = malloc(sizeof(*sorted)*count);
+	if(sort_keys == NULL || sorted == NULL)
+	{
+		free(sort_keys);
+		free(sorted);
+		LOG_ERROR_MSG("Not enough memory to sort %d entries", count);
+		return;
+	}
+
+	for(i = 0; i < count; ++i)
+	{
+		if(init_sort_key(&sort_keys[i], &list[i], i) != 0)
+		{
+			break;
+		}
+	}
 
-	i = SK_COUNT;
-	while(--i >= 0)
+	/* Single sort by all keys at once, ties are resolved by original position,
+	 * which makes it stable. */
+	if(i == count)
 	{
-		const char sorting_key = view->sort[i];
+		qsort(sort_keys, count, sizeof(*sort_keys), &sort_keys_cmp);
 
-		if(abs(sorting_key) > SK_LAST)
+		for(i = 0; i < count; ++i)
 		{
-			continue;
+			sorted[i] = *sort_keys[i].entry;
 		}
+		memcpy(list, sorted, sizeof(*list)*count);
+	}
+	else
+	{
+		LOG_ERROR_MSG("Not enough memory to sort %d entries", count);
+	}
 
-		sort_by_key(sorting_key);
+	while(i-- > 0)
+	{
+		free_sort_key(&sort_keys[i]);
 	}
 
-	if(!ui_view_sort_list_contains(v->sort, SK_BY_DIR))
+	free(sort_keys);
+	free(sorted);
+}
+
+int
+sort_find_insert_pos(FileView *v, dir_entry_t *entry)
+{
+	sort_key_t entry_key;
+	int lo = 0, hi = v->list_rows;
+
+	if(!prepare_keys(v))
+	{
+		/* Unsorted list, just append. */
+		return v->list_rows;
+	}
+
+	if(init_sort_key(&entry_key, entry, v->list_rows) != 0)
 	{
-		sort_by_key(SK_BY_DIR);
+		return v->list_rows;
+	}
+
+	/* Find upper bound to put entry after all equal ones. */
+	while(lo < hi)
+	{
+		const int mid = lo + (hi - lo)/2;
+		char name[PATH_MAX], iname[NAME_MAX];
+		sort_key_t mid_key;
+
+		fill_sort_key(&mid_key, &v->dir_entry[mid], mid, name, iname);
+		if(compare_keys(&mid_key, &entry_key) <= 0)
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
 	}
+
+	free_sort_key(&entry_key);
+	return lo;
 }
 
-/* Sorts view by the key in a stable way. */
-static void
-sort_by_key(char key)
+int
+sort_is_in_order(FileView *v, int pos)
 {
-	int j;
+	sort_key_t near[3];
+	char names[3][PATH_MAX], inames[3][NAME_MAX];
+	int first, last;
+	int i;
+	int in_order = 1;
 
-	sort_descending = (key < 0);
-	sort_type = (SortingKey)abs(key);
+	if(!prepare_keys(v))
+	{
+		return 1;
+	}
+
+	first = MAX(pos - 1, 0);
+	last = MIN(pos + 1, v->list_rows - 1);
 
-	for(j = 0; j < view->list_rows; j++)
+	for(i = first; i <= last; ++i)
 	{
-		view->dir_entry[j].list_num = j;
+		fill_sort_key(&near[i - first], &v->dir_entry[i], i, names[i - first],
+				inames[i - first]);
 	}
 
-	qsort(view->dir_entry, view->list_rows, sizeof(dir_entry_t), sort_dir_list);
+	for(i = first; i < last && in_order; ++i)
+	{
+		in_order = (compare_keys(&near[i - first], &near[i - first + 1]) <= 0);
+	}
+
+	return in_order;
 }
 
-/* Compares file names containing numbers correctly. */
-TSTATIC int
-strnumcmp(const char s[], const char t[])
+/* Fills list of keys for the view in the order of their significance.  Returns
+ * zero if view shouldn't be sorted, otherwise non-zero is returned. */
+static int
+prepare_keys(FileView *v)
 {
-#if !defined(HAVE_STRVERSCMP_FUNC) || !HAVE_STRVERSCMP_FUNC
-	return vercmp(s, t);
+	int i;
+
+	if(v->sort[0] > SK_LAST)
+	{
+		/* Completely skip sorting if primary key isn't set. */
+		return 0;
+	}
+
+	view = v;
+	custom_view = flist_custom_active(v);
+
+	nkeys = 0;
+
+	/* Grouping of directories is implied if it's not mentioned explicitly. */
+	if(!ui_view_sort_list_contains(v->sort, SK_BY_DIR))
+	{
+		keys[nkeys++] = SK_BY_DIR;
+	}
+
+	for(i = 0; i < SK_COUNT; ++i)
+	{
+		if(abs(v->sort[i]) <= SK_LAST)
+		{
+			keys[nkeys++] = v->sort[i];
+		}
+	}
+
+	need_short_paths = custom_view
+	                && (need_key(SK_BY_NAME) || need_key(SK_BY_INAME));
+	need_lower_names = need_key(SK_BY_INAME);
+	need_dir_sizes = need_key(SK_BY_SIZE);
+#ifndef _WIN32
+	need_perms = need_key(SK_BY_PERMISSIONS);
 #else
-	const char *new_s = skip_leading_zeros(s);
-	const char *new_t = skip_leading_zeros(t);
-	return strverscmp(new_s, new_t);
+	need_perms = 0;
 #endif
+
+	return 1;
 }
 
-#if !defined(HAVE_STRVERSCMP_FUNC) || !HAVE_STRVERSCMP_FUNC
+/* Checks whether key is among sorting keys.  Returns non-zero if so, otherwise
+ * zero is returned. */
 static int
-vercmp(const char s[], const char t[])
+need_key(SortingKey key)
 {
-	while(*s != '\0' && *t != '\0')
+	int i;
+	for(i = 0; i < nkeys; ++i)
 	{
-		if(isdigit(*s) && isdigit(*t))
+		if(abs(keys[i]) == key)
 		{
-			int num_a, num_b;
-			const char *os = s, *ot = t;
-			char *p;
+			return 1;
+		}
+	}
+	return 0;
+}
 
-			num_a = strtol(s, &p, 10);
-			s = p;
+/* Computes data of the entry needed by current sorting keys.  Returns zero on
+ * success, otherwise non-zero is returned. */
+static int
+init_sort_key(sort_key_t *key, dir_entry_t *entry, int index)
+{
+	char name[PATH_MAX], iname[NAME_MAX];
 
-			num_b = strtol(t, &p, 10);
-			t = p;
+	fill_sort_key(key, entry, index, name, iname);
 
-			if(num_a != num_b)
-				return num_a - num_b;
-			else if(*os != *ot)
-				return *os - *ot;
+	if(key->name == name)
+	{
+		key->name_buf = strdup(name);
+		if(key->name_buf == NULL)
+		{
+			return 1;
 		}
-		else if(*s == *t)
+		key->name = key->name_buf;
+	}
+
+	if(key->iname != NULL)
+	{
+		key->iname_buf = strdup(iname);
+		if(key->iname_buf == NULL)
 		{
-			s++;
-			t++;
+			free(key->name_buf);
+			return 1;
 		}
-		else
-			break;
+		key->iname = key->iname_buf;
 	}
 
-	return *s - *t;
+	if(key->is_dir && need_dir_sizes)
+	{
+		char full_path[PATH_MAX];
+		get_full_path_of(entry, sizeof(full_path), full_path);
+		dcache_get(curr_stats.dirsize_cache, full_path, &entry->size);
+	}
+
+	return 0;
 }
-#else
-/* Skips all zeros in front of numbers (correctly handles zero).  Returns str, a
- * pointer to '0' or a pointer to non-zero digit. */
-static char *
-skip_leading_zeros(const char str[])
+
+/* Fills the key without allocating memory, which is enough for entries that
+ * are already in the sorted list (sizes of their directories were fetched on
+ * sorting).  Short path is stored in name buffer (PATH_MAX long) and lower case
+ * name in iname buffer (NAME_MAX long) when they are needed, so the buffers
+ * must outlive the key. */
+static void
+fill_sort_key(sort_key_t *key, dir_entry_t *entry, int index, char name[],
+		char iname[])
 {
-	while(str[0] == '0' && isdigit(str[1]))
+	key->entry = entry;
+	key->index = index;
+	key->is_parent = is_parent_dir(entry->name);
+	key->is_dir = is_directory_entry(entry);
+	key->name = entry->name;
+	key->iname = NULL;
+	key->ext = strrchr(entry->name, '.');
+	key->name_buf = NULL;
+	key->iname_buf = NULL;
+
+	if(key->ext != NULL)
 	{
-		str++;
+		++key->ext;
+	}
+
+	if(need_short_paths)
+	{
+		get_short_path_of(view, entry, 1, PATH_MAX, name);
+		key->name = name;
+	}
+
+	if(need_lower_names)
+	{
+		/* Ignore too small buffer errors by not caring about part that didn't
+		 * fit. */
+		(void)str_to_lower(key->name, iname, NAME_MAX);
+		key->iname = iname;
+	}
+
+#ifndef _WIN32
+	key->perms[0] = '\0';
+	if(need_perms)
+	{
+		get_perm_string(key->perms, sizeof(key->perms), entry->mode);
 	}
-	return (char *)str;
-}
 #endif
+}
 
+/* Frees resources allocated by init_sort_key(). */
+static void
+free_sort_key(sort_key_t *key)
+{
+	free(key->name_buf);
+	free(key->iname_buf);
+}
+
+/* qsort() comparer of sort keys that performs stable sorting.  Returns
+ * standard -1, 0, 1 for comparisons. */
+static int
+sort_keys_cmp(const void *one, const void *two)
+{
+	const sort_key_t *const a = one;
+	const sort_key_t *const b = two;
+
+	const int retval = compare_keys(a, b);
+	return (retval == 0) ? (a->index - b->index) : retval;
+}
+
+/* Compares two entries using all sorting keys of the view in the order of their
+ * significance.  Returns positive value if a is greater than b, zero if they
+ * are equal, otherwise negative value is returned. */
 static int
-sort_dir_list(const void *one, const void *two)
+compare_keys(const sort_key_t *a, const sort_key_t *b)
 {
-	int retval;
-	char *pfirst, *psecond;
-	dir_entry_t *const first = (dir_entry_t *)one;
-	dir_entry_t *const second = (dir_entry_t *)two;
-	int first_is_dir;
-	int second_is_dir;
+	int i;
 
-	if(is_parent_dir(first->name))
+	/* Parent directory always goes first. */
+	if(a->is_parent != b->is_parent)
 	{
-		return -1;
+		return a->is_parent ? -1 : 1;
 	}
-	else if(is_parent_dir(second->name))
+
+	for(i = 0; i < nkeys; ++i)
 	{
-		return 1;
+		const int retval = compare_by_key(a, b, (SortingKey)abs(keys[i]));
+		if(retval != 0)
+		{
+			return (keys[i] < 0) ? -retval : retval;
+		}
 	}
 
-	first_is_dir = is_directory_entry(first);
-	second_is_dir = is_directory_entry(second);
+	return 0;
+}
 
-	retval = 0;
-	switch(sort_type)
+/* Compares two entries by a single sorting key.  Returns positive value if a is
+ * greater than b, zero if they are equal, otherwise negative value is
+ * returned. */
+static int
+compare_by_key(const sort_key_t *a, const sort_key_t *b, SortingKey key)
+{
+	const dir_entry_t *const first = a->entry;
+	const dir_entry_t *const second = b->entry;
+
+	switch(key)
 	{
 		case SK_BY_NAME:
 		case SK_BY_INAME:
-			if(custom_view)
-			{
-				retval = compare_entry_names(first, second, sort_type == SK_BY_INAME);
-			}
-			else
-			{
-				retval = compare_full_file_names(first->name, second->name,
-						sort_type == SK_BY_INAME);
-			}
-			break;
+			return compare_full_file_names(a, b, key == SK_BY_INAME);
 
 		case SK_BY_DIR:
-			if(first_is_dir != second_is_dir)
-			{
-				retval = first_is_dir ? -1 : 1;
-			}
-			break;
+			return (a->is_dir == b->is_dir) ? 0 : (a->is_dir ? -1 : 1);
 
 		case SK_BY_TYPE:
-			retval = strcmp(get_type_str(first->type), get_type_str(second->type));
-			break;
+			return strcmp(get_type_str(first->type), get_type_str(second->type));
 
 		case SK_BY_EXTENSION:
-			pfirst = strrchr(first->name,  '.');
-			psecond = strrchr(second->name, '.');
-
-			if(pfirst && psecond)
-				retval = compare_file_names(++pfirst, ++psecond, 0);
-			else if(pfirst || psecond)
-				retval = pfirst ? -1 : 1;
+			if(a->ext != NULL && b->ext != NULL)
+				return compare_file_names(a->ext, b->ext);
+			else if(a->ext != NULL || b->ext != NULL)
+				return (a->ext != NULL) ? -1 : 1;
 			else
-				retval = compare_file_names(first->name, second->name, 0);
-			break;
+				return compare_file_names(first->name, second->name);
 
 		case SK_BY_SIZE:
-			{
-				if(first_is_dir)
-				{
-					char full_path[PATH_MAX];
-					get_full_path_of(first, sizeof(full_path), full_path);
-					tree_get_data(curr_stats.dirsize_cache, full_path, &first->size);
-				}
-
-				if(second_is_dir)
-				{
-					char full_path[PATH_MAX];
-					get_full_path_of(second, sizeof(full_path), full_path);
-					tree_get_data(curr_stats.dirsize_cache, full_path, &second->size);
-				}
-
-				retval = (first->size < second->size)
-				       ? -1
-				       : (first->size > second->size);
-			}
-			break;
+			return (first->size > second->size) - (first->size < second->size);
 
 		case SK_BY_TIME_MODIFIED:
-			retval = first->mtime - second->mtime;
-			break;
+			return (first->mtime > second->mtime) - (first->mtime < second->mtime);
 
 		case SK_BY_TIME_ACCESSED:
-			retval = first->atime - second->atime;
-			break;
+			return (first->atime > second->atime) - (first->atime < second->atime);
 
 		case SK_BY_TIME_CHANGED:
-			retval = first->ctime - second->ctime;
-			break;
+			return (first->ctime > second->ctime) - (first->ctime < second->ctime);
 #ifndef _WIN32
 		case SK_BY_MODE:
-			retval = first->mode - second->mode;
-			break;
+			return (first->mode > second->mode) - (first->mode < second->mode);
 
 		case SK_BY_OWNER_NAME: /* FIXME */
 		case SK_BY_OWNER_ID:
-			retval = first->uid - second->uid;
-			break;
+			return (first->uid > second->uid) - (first->uid < second->uid);
 
 		case SK_BY_GROUP_NAME: /* FIXME */
 		case SK_BY_GROUP_ID:
-			retval = first->gid - second->gid;
-			break;
+			return (first->gid > second->gid) - (first->gid < second->gid);
 
 		case SK_BY_PERMISSIONS:
-			{
-				char first_perm[11], second_perm[11];
-				get_perm_string(first_perm, sizeof(first_perm), first->mode);
-				get_perm_string(second_perm, sizeof(second_perm), second->mode);
-				retval = strcmp(first_perm, second_perm);
-			}
-			break;
+			return strcmp(a->perms, b->perms);
 #endif
 	}
 
-	if(retval == 0)
-	{
-		retval = first->list_num - second->list_num;
-	}
-	else if(sort_descending)
-	{
-		retval = -retval;
-	}
+	return 0;
+}
 
-	return retval;
+/* Compares file names containing numbers correctly. */
+TSTATIC int
+strnumcmp(const char s[], const char t[])
+{
+#if !defined(HAVE_STRVERSCMP_FUNC) || !HAVE_STRVERSCMP_FUNC
+	return vercmp(s, t);
+#else
+	const char *new_s = skip_leading_zeros(s);
+	const char *new_t = skip_leading_zeros(t);
+	return strverscmp(new_s, new_t);
+#endif
 }
 
-/* Compares names of two file entries.  Returns positive value if a is greater
- * than b, zero if they are equal, otherwise negative value is returned. */
+#if !defined(HAVE_STRVERSCMP_FUNC) || !HAVE_STRVERSCMP_FUNC
 static int
-compare_entry_names(const dir_entry_t *a, const dir_entry_t *b, int ignore_case)
+vercmp(const char s[], const char t[])
 {
-	char a_short_path[PATH_MAX];
-	char b_short_path[PATH_MAX];
+	while(*s != '\0' && *t != '\0')
+	{
+		if(isdigit(*s) && isdigit(*t))
+		{
+			int num_a, num_b;
+			const char *os = s, *ot = t;
+			char *p;
 
-	get_short_path_of(view, a, 1, sizeof(a_short_path), a_short_path);
-	get_short_path_of(view, b, 1, sizeof(b_short_path), b_short_path);
+			num_a = strtol(s, &p, 10);
+			s = p;
+
+			num_b = strtol(t, &p, 10);
+			t = p;
 
-	return compare_full_file_names(a_short_path, b_short_path, ignore_case);
+			if(num_a != num_b)
+				return num_a - num_b;
+			else if(*os != *ot)
+				return *os - *ot;
+		}
+		else if(*s == *t)
+		{
+			s++;
+			t++;
+		}
+		else
+			break;
+	}
+
+	return *s - *t;
 }
+#else
+/* Skips all zeros in front of numbers (correctly handles zero).  Returns str, a
+ * pointer to '0' or a pointer to non-zero digit. */
+static char *
+skip_leading_zeros(const char str[])
+{
+	while(str[0] == '0' && isdigit(str[1]))
+	{
+		str++;
+	}
+	return (char *)str;
+}
+#endif
 
-/* Compares two full filenames and assumes that dot character is smaller than
- * any other character.  Returns positive value if s is greater than t, zero if
+/* Compares names of two entries assuming that dot character is smaller than
+ * any other character.  Lower case versions of names must be available when
+ * ignore_case is set.  Returns positive value if a is greater than b, zero if
  * they are equal, otherwise negative value is returned. */
 static int
-compare_full_file_names(const char s[], const char t[], int ignore_case)
+compare_full_file_names(const sort_key_t *a, const sort_key_t *b,
+		int ignore_case)
 {
-	if(s[0] == '.' && t[0] != '.')
+	int result;
+
+	if(a->name[0] == '.' && b->name[0] != '.')
 	{
 		return -1;
 	}
-	else if(s[0] != '.' && t[0] == '.')
+	else if(a->name[0] != '.' && b->name[0] == '.')
 	{
 		return 1;
 	}
-	else
-	{
-		return compare_file_names(s, t, ignore_case);
-	}
-}
-
-/* Compares two file names or their parts (e.g. extensions).  Returns positive
- * value if s is greater than t, zero if they are equal, otherwise negative
- * value is returned. */
-static int
-compare_file_names(const char s[], const char t[], int ignore_case)
-{
-	const char *s_val = s, *t_val = t;
-	char s_buf[NAME_MAX];
-	char t_buf[NAME_MAX];
-	int result;
 
-	if(ignore_case)
+	if(!ignore_case)
 	{
-		/* Ignore too small buffer errors by not caring about part that didn't
-		 * fit. */
-		(void)str_to_lower(s, s_buf, sizeof(s_buf));
-		(void)str_to_lower(t, t_buf, sizeof(t_buf));
-
-		s_val = s_buf;
-		t_val = t_buf;
+		return compare_file_names(a->name, b->name);
 	}
 
-	result = cfg.sort_numbers ? strnumcmp(s_val, t_val) : strcmp(s_val, t_val);
-	if(result == 0 && ignore_case)
+	result = compare_file_names(a->iname, b->iname);
+	if(result == 0)
 	{
 		/* Resort to comparing original names when their normalized versions match
 		 * to always solve ties in deterministic way. */
-		result = strcmp(s, t);
+		result = strcmp(a->name, b->name);
 	}
 	return result;
 }
 
+/* Compares two file names or their parts (e.g. extensions).  Returns positive
+ * value if s is greater than t, zero if they are equal, otherwise negative
+ * value is returned. */
+static int
+compare_file_names(const char s[], const char t[])
+{
+	return cfg.sort_numbers ? strnumcmp(s, t) : strcmp(s, t);
+}
+
 SortingKey
 get_secondary_key(SortingKey primary_key)
 {
@@ -25,6 +25,19 @@
 
 void sort_view(FileView *view);
 
+/* Sorts list of entries that belong to the view according to sorting settings
+ * of the view. */
+void sort_entries(FileView *view, dir_entry_t entries[], int count);
+
+/* Finds position at which the entry should be inserted into sorted list of the
+ * view to keep it sorted.  Returns the position. */
+int sort_find_insert_pos(FileView *view, dir_entry_t *entry);
+
+/* Checks whether entry at position pos of the view is still ordered correctly
+ * relative to its neighbours (e.g. after its data has changed).  Returns
+ * non-zero if so, otherwise zero is returned. */
+int sort_is_in_order(FileView *view, int pos);
+
 /* Maps primary sort key to second column type.  Returns secondary key that
  * corresponds to the primary one. */
 SortingKey get_secondary_key(SortingKey primary_key);
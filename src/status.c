@@ -39,7 +39,7 @@
 #include "utils/macros.h"
 #include "utils/path.h"
 #include "utils/str.h"
-#include "utils/tree.h"
+#include "utils/dcache.h"
 #include "utils/utils.h"
 #include "colors.h"
 #include "commands_completion.h"
@@ -94,7 +94,7 @@ load_def_values(status_t *stats, config_t *config)
 	stats->use_input_bar = 1;
 	stats->load_stage = 0;
 	stats->term_state = TS_NORMAL;
-	stats->dirsize_cache = NULL_TREE;
+	stats->dirsize_cache = NULL;
 	stats->ch_pos = 1;
 	stats->confirmed = 0;
 	stats->skip_shellout_redraw = 0;
@@ -185,9 +185,9 @@ reset_status(const config_t *config)
 static int
 reset_dircache(status_t *stats)
 {
-	tree_free(stats->dirsize_cache);
-	stats->dirsize_cache = tree_create(0, 0);
-	return stats->dirsize_cache == NULL_TREE;
+	dcache_free(stats->dirsize_cache);
+	stats->dirsize_cache = dcache_create();
+	return stats->dirsize_cache == NULL;
 }
 
 void
@@ -22,7 +22,7 @@
 
 #include <stdio.h> /* FILE */
 
-#include "utils/tree.h"
+#include "utils/dcache.h"
 #include "utils/fs_limits.h"
 
 #include "color_scheme.h"
@@ -105,7 +105,7 @@ typedef struct
 	/* Describes terminal state with regard to its dimensions. */
 	TermState term_state;
 
-	tree_t dirsize_cache; /* ga command results */
+	dcache_t *dirsize_cache; /* ga command results */
 
 	int last_search_backward;
 
@@ -30,6 +30,7 @@ const char *tags[] = {
 	"vifm-'",
 	"vifm-'aproposprg'",
 	"vifm-'autochpos'",
+	"vifm-'bgthreads'",
 	"vifm-'cd'",
 	"vifm-'cdpath'",
 	"vifm-'cf'",
@@ -38,6 +39,7 @@ const char *tags[] = {
 	"vifm-'co'",
 	"vifm-'columns'",
 	"vifm-'confirm'",
+	"vifm-'copythreads'",
 	"vifm-'cpo'",
 	"vifm-'cpoptions'",
 	"vifm-'dotdirs'",
@@ -58,6 +60,8 @@ const char *tags[] = {
 	"vifm-'iec'",
 	"vifm-'ignorecase'",
 	"vifm-'incsearch'",
+	"vifm-'iobandwidth'",
+	"vifm-'iofilerate'",
 	"vifm-'is'",
 	"vifm-'laststatus'",
 	"vifm-'lines'",
@@ -88,6 +92,7 @@ const char *tags[] = {
 	"vifm-'sort'",
 	"vifm-'sortnumbers'",
 	"vifm-'sortorder'",
+	"vifm-'statthreads'",
 	"vifm-'statusline'",
 	"vifm-'stl'",
 	"vifm-'syscalls'",
@@ -511,6 +516,7 @@ const char *tags[] = {
 	"vifm-has()",
 	"vifm-i",
 	"vifm-j",
+	"vifm-jobs-menu",
 	"vifm-k",
 	"vifm-l",
 	"vifm-literal-string",
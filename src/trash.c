@@ -18,14 +18,16 @@
 
 #include "trash.h"
 
+#include <pthread.h> /* PTHREAD_MUTEX_INITIALIZER pthread_mutex_* */
 #include <sys/stat.h> /* stat */
 
 #include <assert.h> /* assert() */
+#include <ctype.h> /* tolower() */
 #include <errno.h> /* errno */
 #include <stddef.h> /* NULL size_t */
 #include <stdio.h> /* snprintf() */
-#include <stdlib.h> /* free() */
-#include <string.h> /* strchr() strcmp() strdup() strlen() strspn() */
+#include <stdlib.h> /* free() malloc() realloc() */
+#include <string.h> /* memmove() strchr() strcmp() strdup() strlen() strspn() */
 
 #include "cfg/config.h"
 #include "compat/os.h"
@@ -83,6 +85,14 @@ static void empty_trash_dirs(void);
 static void empty_trash_dir(const char trash_dir[]);
 static void empty_trash_in_bg(bg_op_t *bg_op, void *arg);
 static void empty_trash_list(void);
+static int find_entry(const char trash_name[]);
+static int index_entry(int pos);
+static void insert_into_index(int pos);
+static void unindex_entry(int pos);
+static size_t find_slot(int pos);
+static void shift_index(int pos);
+static int rebuild_index(size_t size);
+static unsigned int hash_path(const char path[]);
 static trashes_list get_list_of_trashes(void);
 static int get_list_of_trashes_traverser(struct mntent *entry, void *arg);
 static int is_trash_valid(const char trash_dir[]);
@@ -101,6 +111,17 @@ static char * format_root_spec(const char spec[], const char mount_point[]);
 static char **specs;
 static int nspecs;
 
+/* Open addressing hash table of positions in trash_list keyed by trash_name,
+ * -1 marks free slots.  Size is zero or a power of two. */
+static int *trash_index;
+/* Number of slots in the trash_index. */
+static size_t trash_index_size;
+/* Number of allocated elements of the trash_list. */
+static int trash_list_capacity;
+/* Protects trash_list and its index, as files can be trashed by background
+ * operations. */
+static pthread_mutex_t trash_list_lock = PTHREAD_MUTEX_INITIALIZER;
+
 int
 set_trash_dir(const char new_specs[])
 {
@@ -255,7 +276,10 @@ empty_trash_in_bg(bg_op_t *bg_op, void *arg)
 {
 	char *const trash_dir = arg;
 
-	remove_dir_content(trash_dir);
+	if(!bg_op_cancelled(bg_op))
+	{
+		remove_dir_content(trash_dir);
+	}
 
 	free(trash_dir);
 }
@@ -265,6 +289,8 @@ empty_trash_list(void)
 {
 	int i;
 
+	pthread_mutex_lock(&trash_list_lock);
+
 	for(i = 0; i < nentries; i++)
 	{
 		free(trash_list[i].path);
@@ -273,55 +299,246 @@ empty_trash_list(void)
 	free(trash_list);
 	trash_list = NULL;
 	nentries = 0;
+	trash_list_capacity = 0;
+
+	free(trash_index);
+	trash_index = NULL;
+	trash_index_size = 0U;
+
+	pthread_mutex_unlock(&trash_list_lock);
 }
 
 int
 add_to_trash(const char path[], const char trash_name[])
 {
-	void *p;
+	int result = 0;
 
 	if(!exists_in_trash(trash_name))
 	{
 		return -1;
 	}
 
-	if(is_in_trash(trash_name))
+	pthread_mutex_lock(&trash_list_lock);
+
+	if(find_entry(trash_name) >= 0)
 	{
+		pthread_mutex_unlock(&trash_list_lock);
 		return 0;
 	}
 
-	if((p = realloc(trash_list, sizeof(*trash_list)*(nentries + 1))) == NULL)
+	if(nentries == trash_list_capacity)
 	{
-		return -1;
+		const int capacity = (trash_list_capacity == 0)
+		                   ? 16
+		                   : trash_list_capacity*2;
+		void *const p = realloc(trash_list, sizeof(*trash_list)*capacity);
+		if(p == NULL)
+		{
+			pthread_mutex_unlock(&trash_list_lock);
+			return -1;
+		}
+		trash_list = p;
+		trash_list_capacity = capacity;
 	}
-	trash_list = p;
 
 	trash_list[nentries].path = strdup(path);
 	trash_list[nentries].trash_name = strdup(trash_name);
 	if(trash_list[nentries].path == NULL ||
-			trash_list[nentries].trash_name == NULL)
+			trash_list[nentries].trash_name == NULL ||
+			index_entry(nentries) != 0)
 	{
 		free(trash_list[nentries].path);
 		free(trash_list[nentries].trash_name);
-		return -1;
+		result = -1;
+	}
+	else
+	{
+		nentries++;
 	}
 
-	nentries++;
-	return 0;
+	pthread_mutex_unlock(&trash_list_lock);
+	return result;
 }
 
 int
 is_in_trash(const char trash_name[])
 {
-	int i;
-	for(i = 0; i < nentries; i++)
+	int pos;
+
+	pthread_mutex_lock(&trash_list_lock);
+	pos = find_entry(trash_name);
+	pthread_mutex_unlock(&trash_list_lock);
+
+	return pos >= 0;
+}
+
+/* Looks up entry of trash_list by its trash_name.  Must be called with
+ * trash_list_lock held.  Returns position of the entry or -1. */
+static int
+find_entry(const char trash_name[])
+{
+	size_t slot;
+
+	if(trash_index_size == 0U)
+	{
+		return -1;
+	}
+
+	slot = hash_path(trash_name) & (trash_index_size - 1U);
+	while(trash_index[slot] >= 0)
+	{
+		const int pos = trash_index[slot];
+		if(stroscmp(trash_list[pos].trash_name, trash_name) == 0)
+		{
+			return pos;
+		}
+		slot = (slot + 1U) & (trash_index_size - 1U);
+	}
+	return -1;
+}
+
+/* Adds entry of trash_list at the pos to the index growing it if needed.  Must
+ * be called with trash_list_lock held.  Returns zero on success, otherwise
+ * non-zero is returned. */
+static int
+index_entry(int pos)
+{
+	/* Keep load factor under one half to make probe sequences short. */
+	if((size_t)(pos + 1)*2U > trash_index_size)
+	{
+		const size_t size = (trash_index_size == 0U) ? 32U : trash_index_size*2U;
+		if(rebuild_index(size) != 0)
+		{
+			return 1;
+		}
+	}
+
+	insert_into_index(pos);
+	return 0;
+}
+
+/* Puts position of trash_list entry into a free slot of the index, which must
+ * exist.  Must be called with trash_list_lock held. */
+static void
+insert_into_index(int pos)
+{
+	size_t slot = hash_path(trash_list[pos].trash_name) & (trash_index_size - 1U);
+	while(trash_index[slot] >= 0)
+	{
+		slot = (slot + 1U) & (trash_index_size - 1U);
+	}
+	trash_index[slot] = pos;
+}
+
+/* Removes position of trash_list entry from the index moving entries of the
+ * same probe sequence back into the freed slot to keep them reachable.  Must be
+ * called with trash_list_lock held. */
+static void
+unindex_entry(int pos)
+{
+	const size_t mask = trash_index_size - 1U;
+	size_t hole = find_slot(pos);
+	size_t slot = (hole + 1U) & mask;
+
+	while(trash_index[slot] >= 0)
+	{
+		const char *const name = trash_list[trash_index[slot]].trash_name;
+		const size_t home = hash_path(name) & mask;
+		/* The entry can be moved if the hole is between its home slot and the
+		 * slot it occupies. */
+		if(((slot - home) & mask) >= ((slot - hole) & mask))
+		{
+			trash_index[hole] = trash_index[slot];
+			hole = slot;
+		}
+		slot = (slot + 1U) & mask;
+	}
+
+	trash_index[hole] = -1;
+}
+
+/* Looks up slot of the index that holds position of trash_list entry, which
+ * must be indexed.  Must be called with trash_list_lock held.  Returns the
+ * slot. */
+static size_t
+find_slot(int pos)
+{
+	const size_t mask = trash_index_size - 1U;
+	size_t slot = hash_path(trash_list[pos].trash_name) & mask;
+	while(trash_index[slot] != pos)
+	{
+		slot = (slot + 1U) & mask;
+	}
+	return slot;
+}
+
+/* Updates the index after entries of trash_list that followed the pos were
+ * moved one position back.  Must be called with trash_list_lock held. */
+static void
+shift_index(int pos)
+{
+	size_t i;
+	for(i = 0U; i < trash_index_size; ++i)
+	{
+		if(trash_index[i] > pos)
+		{
+			--trash_index[i];
+		}
+	}
+}
+
+/* Recreates the index of the specified size (same size doesn't allocate) for
+ * first nentries elements of trash_list.  Must be called with trash_list_lock
+ * held.  Returns zero on success, otherwise non-zero is returned and the index
+ * is left intact. */
+static int
+rebuild_index(size_t size)
+{
+	size_t i;
+
+	if(size != trash_index_size)
 	{
-		if(stroscmp(trash_list[i].trash_name, trash_name) == 0)
+		int *const index = malloc(sizeof(*index)*size);
+		if(index == NULL)
+		{
 			return 1;
+		}
+
+		free(trash_index);
+		trash_index = index;
+		trash_index_size = size;
+	}
+
+	for(i = 0U; i < trash_index_size; ++i)
+	{
+		trash_index[i] = -1;
+	}
+	for(i = 0U; i < (size_t)nentries; ++i)
+	{
+		insert_into_index(i);
 	}
 	return 0;
 }
 
+/* Computes hash of a path consistently with stroscmp() (FNV-1a).  Returns the
+ * hash. */
+static unsigned int
+hash_path(const char path[])
+{
+	unsigned int hash = 2166136261U;
+	while(*path != '\0')
+	{
+#ifndef _WIN32
+		hash ^= (unsigned char)*path;
+#else
+		hash ^= (unsigned char)tolower((unsigned char)*path);
+#endif
+		hash *= 16777619U;
+		++path;
+	}
+	return hash;
+}
+
 char **
 list_trashes(int *ntrashes)
 {
@@ -405,17 +622,19 @@ restore_from_trash(const char trash_name[])
 	char full[PATH_MAX];
 	char buf[PATH_MAX];
 
-	for(i = 0; i < nentries; i++)
+	pthread_mutex_lock(&trash_list_lock);
+	i = find_entry(trash_name);
+	if(i >= 0)
 	{
-		if(stroscmp(trash_list[i].trash_name, trash_name) == 0)
-			break;
+		copy_str(buf, sizeof(buf), trash_list[i].path);
+		copy_str(full, sizeof(full), trash_list[i].trash_name);
 	}
-	if(i >= nentries)
+	pthread_mutex_unlock(&trash_list_lock);
+
+	if(i < 0)
 		return -1;
 
-	copy_str(buf, sizeof(buf), trash_list[i].path);
-	copy_str(full, sizeof(full), trash_list[i].trash_name);
-	if(perform_operation(OP_MOVE, NULL, NULL, full, trash_list[i].path) == 0)
+	if(perform_operation(OP_MOVE, NULL, NULL, full, buf) == 0)
 	{
 		char *msg, *p;
 		size_t len;
@@ -443,33 +662,51 @@ restore_from_trash(const char trash_name[])
 	return -1;
 }
 
+void
+lock_trash_list(void)
+{
+	pthread_mutex_lock(&trash_list_lock);
+}
+
+void
+unlock_trash_list(void)
+{
+	pthread_mutex_unlock(&trash_list_lock);
+}
+
 int
 remove_from_trash(const char trash_name[])
 {
 	int i;
-	for(i = 0; i < nentries; i++)
+
+	pthread_mutex_lock(&trash_list_lock);
+
+	i = find_entry(trash_name);
+	if(i < 0)
 	{
-		if(stroscmp(trash_list[i].trash_name, trash_name) == 0)
-			break;
-	}
-	if(i >= nentries)
+		pthread_mutex_unlock(&trash_list_lock);
 		return -1;
+	}
 
+	unindex_entry(i);
 	free(trash_list[i].path);
 	free(trash_list[i].trash_name);
-	memmove(trash_list + i, trash_list + i + 1,
-			sizeof(*trash_list)*((nentries - 1) - i));
 
+	/* Shift the tail to keep entries in the order of their deletion, which is
+	 * visible to the user. */
 	nentries--;
+	memmove(&trash_list[i], &trash_list[i + 1],
+			sizeof(*trash_list)*(nentries - i));
+	shift_index(i);
+
+	pthread_mutex_unlock(&trash_list_lock);
 	return 0;
 }
 
 char *
 gen_trash_name(const char base_path[], const char name[])
 {
-	struct stat st;
-	char buf[PATH_MAX];
-	int i;
+	char *trash_name;
 	char *const trash_dir = pick_trash_dir(base_path);
 
 	if(trash_dir == NULL)
@@ -477,6 +714,18 @@ gen_trash_name(const char base_path[], const char name[])
 		return NULL;
 	}
 
+	trash_name = gen_trash_name_in(trash_dir, name);
+	free(trash_dir);
+	return trash_name;
+}
+
+char *
+gen_trash_name_in(const char trash_dir[], const char name[])
+{
+	struct stat st;
+	char buf[PATH_MAX];
+	int i;
+
 	i = 0;
 	do
 	{
@@ -485,8 +734,6 @@ gen_trash_name(const char base_path[], const char name[])
 	}
 	while(os_lstat(buf, &st) == 0);
 
-	free(trash_dir);
-
 	return strdup(buf);
 }
 
@@ -662,6 +909,8 @@ trash_prune_dead_entries(void)
 {
 	int i, j;
 
+	pthread_mutex_lock(&trash_list_lock);
+
 	j = 0;
 	for(i = 0; i < nentries; ++i)
 	{
@@ -675,6 +924,9 @@ trash_prune_dead_entries(void)
 		trash_list[j++] = trash_list[i];
 	}
 	nentries = j;
+	(void)rebuild_index(trash_index_size);
+
+	pthread_mutex_unlock(&trash_list_lock);
 }
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
@@ -63,12 +63,24 @@ int restore_from_trash(const char trash_name[]);
 
 int remove_from_trash(const char trash_name[]);
 
+/* Locks trash_list and nentries for reading outside of this module, as they
+ * can be changed by background operations. */
+void lock_trash_list(void);
+
+/* Releases lock taken by lock_trash_list(). */
+void unlock_trash_list(void);
+
 /* Generates unique name for a file at base_path location named name (doesn't
  * have to be base_path/name as long as base_path is at same mount) in a trash
  * directory.  Returns string containing full path that needs to be freed by
  * caller, if no trash directory available NULL is returned. */
 char * gen_trash_name(const char base_path[], const char name[]);
 
+/* Same as gen_trash_name(), but for already picked trash directory.  Returns
+ * string containing full path that needs to be freed by caller or NULL on
+ * error. */
+char * gen_trash_name_in(const char trash_dir[], const char name[]);
+
 /* Picks trash directory basing on original path for a file that is being
  * trashed.  Returns absolute path to picked trash directory on success which
  * should be freed by the caller, otherwise NULL is returned. */
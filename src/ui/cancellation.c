@@ -25,7 +25,6 @@
 #include "../status.h"
 
 static int ui_cancellation_enabled(void);
-static int ui_cancellation_disabled(void);
 
 /* State of cancellation request processing. */
 typedef enum
@@ -41,10 +40,18 @@ cancellation_request_state;
  * functions. */
 static cancellation_request_state cancellation_state;
 
+/* Number of ui_cancellation_enable() calls not yet paired with
+ * ui_cancellation_disable(). */
+static int nesting_depth;
+
 void
 ui_cancellation_reset(void)
 {
-	assert(ui_cancellation_disabled() && "Can't reset while active.");
+	/* Nested operation shouldn't drop request made for the outer one. */
+	if(nesting_depth > 0)
+	{
+		return;
+	}
 
 	cancellation_state = CRS_DISABLED;
 }
@@ -52,7 +59,10 @@ ui_cancellation_reset(void)
 void
 ui_cancellation_enable(void)
 {
-	assert(ui_cancellation_disabled() && "Can't enable twice in a row.");
+	if(nesting_depth++ > 0)
+	{
+		return;
+	}
 
 	cancellation_state = (cancellation_state == CRS_DISABLED)
 	                   ? CRS_ENABLED
@@ -89,6 +99,11 @@ ui_cancellation_disable(void)
 {
 	assert(ui_cancellation_enabled() && "Can't disable what disabled.");
 
+	if(--nesting_depth > 0)
+	{
+		return;
+	}
+
 	/* The check is here for tests, which are running with uninitialized
 	 * curses. */
 	if(curr_stats.load_stage > 0)
@@ -134,13 +149,5 @@ ui_cancellation_enabled(void)
 	    || cancellation_state == CRS_ENABLED_REQUESTED;
 }
 
-/* Checks whether cancellation processing is disabled.  Returns non-zero if so,
- * otherwise zero is returned. */
-static int
-ui_cancellation_disabled(void)
-{
-	return !ui_cancellation_enabled();
-}
-
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 : */
@@ -21,10 +21,14 @@
 
 /* Managing operation cancellation. */
 
-/* Resets state so that ui_cancellation_requested() returns zero. */
+/* Resets state so that ui_cancellation_requested() returns zero.  Does nothing
+ * while cancellation is enabled, so that nested operation sees request made
+ * for the outer one. */
 void ui_cancellation_reset(void);
 
-/* Enables handling of cancellation requests through the UI. */
+/* Enables handling of cancellation requests through the UI.  Calls can be
+ * nested, cancellation stays enabled until matching number of
+ * ui_cancellation_disable() calls is made. */
 void ui_cancellation_enable(void);
 
 /* External callback for notifying this unit about cancellation request.  Should
@@ -37,7 +41,8 @@ void ui_cancellation_request(void);
  * returned. */
 int ui_cancellation_requested(void);
 
-/* Disables handling of cancellation requests through the UI. */
+/* Disables handling of cancellation requests through the UI (only the outermost
+ * call has effect). */
 void ui_cancellation_disable(void);
 
 /* Pauses cancellation if it's active, otherwise does nothing.  This effectively
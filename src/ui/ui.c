@@ -19,7 +19,7 @@
 
 #include "ui.h"
 
-#include <curses.h> /* mvwin() wbkgdset() werase() */
+#include <curses.h> /* idlok() mvwin() scrollok() wbkgdset() werase() wscrl() */
 
 #ifndef _WIN32
 #include <sys/ioctl.h>
@@ -180,6 +180,7 @@ create_windows(void)
 
 	lwin.title = newwin(1, 1, 0, 0);
 	lwin.win = newwin(1, 1, 0, 0);
+	idlok(lwin.win, TRUE);
 
 	mborder = newwin(1, 1, 0, 0);
 
@@ -193,6 +194,7 @@ create_windows(void)
 
 	rwin.title = newwin(1, 1, 0, 0);
 	rwin.win = newwin(1, 1, 0, 0);
+	idlok(rwin.win, TRUE);
 
 	rborder = newwin(1, 1, 0, 0);
 
@@ -1458,16 +1460,19 @@ ui_view_displays_columns(const FileView *const view)
 FileType
 ui_view_entry_target_type(const FileView *const view, size_t pos)
 {
-	const dir_entry_t *const entry = &view->dir_entry[pos];
+	dir_entry_t *const entry = &view->dir_entry[pos];
 
 	if(entry->type == FT_LINK)
 	{
-		char *const full_path = format_str("%s/%s", entry->origin, entry->name);
-		const FileType type = (get_symlink_type(full_path) != SLT_UNKNOWN)
-		                    ? FT_DIR
-		                    : FT_LINK;
-		free(full_path);
-		return type;
+		/* Resolving the link is costly and this is called for every drawn cell, so
+		 * the result is cached in the entry. */
+		if(entry->link_to_dir < 0)
+		{
+			char *const full_path = format_str("%s/%s", entry->origin, entry->name);
+			entry->link_to_dir = (get_symlink_type(full_path) != SLT_UNKNOWN);
+			free(full_path);
+		}
+		return entry->link_to_dir ? FT_DIR : FT_LINK;
 	}
 
 	return entry->type;
@@ -1495,6 +1500,18 @@ ui_view_erase(FileView *view)
 	werase(view->win);
 }
 
+void
+ui_view_scroll(FileView *view, int lines)
+{
+	const col_scheme_t *cs = ui_view_get_cs(view);
+	const int bg = COLOR_PAIR(cs->pair[WIN_COLOR]) | cs->color[WIN_COLOR].attr;
+	wbkgdset(view->win, bg);
+
+	scrollok(view->win, TRUE);
+	wscrl(view->win, lines);
+	scrollok(view->win, FALSE);
+}
+
 void
 ui_view_clear(FileView *view)
 {
@@ -152,11 +152,14 @@ typedef struct
 	short int match_left;  /* Starting position of the match. */
 	short int match_right; /* Ending position of the match. */
 
-	int list_num;     /* Used by sorting comparer to perform stable sort. */
-
 	int marked;       /* Whether file should be processed. */
 
 	int hi_num;       /* File highlighting parameters cache (initially -1). */
+	int name_width;   /* Screen width of displayed name cache (initially 0). */
+	int link_broken;  /* Whether target of symlink is missing cache (initially
+	                     -1). */
+	int link_to_dir;  /* Whether symlink points to a directory cache (initially
+	                     -1). */
 }
 dir_entry_t;
 
@@ -175,6 +178,9 @@ typedef struct
 		dir_entry_t *entries;
 		/* Number of file entries. */
 		int entry_count;
+		/* Number of allocated file entries, valid only while list is being
+		 * built. */
+		int entries_capacity;
 
 		/* Directory we were in before custom view activation. */
 		char *orig_dir;
@@ -191,6 +197,9 @@ typedef struct
 #ifndef _WIN32
 	/* Monitor that checks for directory changes. */
 	filemon_t mon;
+	/* Watcher of current directory, which avoids polling if possible.  Can be
+	 * NULL. */
+	filemon_watch_t *watch;
 #else
 	FILETIME dir_mtime;
 	HANDLE dir_watcher;
@@ -472,6 +481,10 @@ const col_scheme_t * ui_view_get_cs(const FileView *view);
 /* Erases view window by filling it with the background color. */
 void ui_view_erase(FileView *view);
 
+/* Scrolls contents of view window by specified number of lines (positive
+ * value moves them up) filling new lines with the background color. */
+void ui_view_scroll(FileView *view, int lines);
+
 /* Same as erase, but ensures that view is updated in all its size on the
  * screen (e.g. to clear anything put there by other programs as well). */
 void ui_view_clear(FileView *view);
@@ -21,8 +21,9 @@
 #include <assert.h> /* assert() */
 #include <stddef.h> /* size_t */
 #include <stdio.h>
-#include <stdlib.h> /* free() */
-#include <string.h> /* strcpy() strdup() */
+#include <stdlib.h> /* calloc() free() malloc() realloc() */
+#include <string.h> /* memcpy() memmove() strcpy() strdup() strlen() strncmp()
+                       strrchr() */
 
 #include "utils/fs.h"
 #include "utils/fs_limits.h"
@@ -34,16 +35,62 @@
 #include "registers.h"
 #include "trash.h"
 
+/* Single command.  Commands are stored in an array of their group, so their
+ * order is implicit.  Paths are references into tables of the group, undo
+ * operation and roles of paths are derived from the do operation. */
 typedef struct
+{
+	void *do_data;
+	void *undo_data;
+	unsigned int dirs[2];  /* Indexes of directories of the paths. */
+	unsigned int names[2]; /* Offsets of names of the paths in strs. */
+	OPS op;
+}
+cmd_t;
+
+/* Group of commands.  Paths of commands are split at the last slash, directory
+ * part is stored once in the directory table and shared among commands, names
+ * are packed one after another, so bulk operations take about the size of
+ * their names per command. */
+typedef struct group_t
 {
 	char *msg;
 	int error;
 	int balance;
 	int can_undone;
 	int incomplete;
+
+	cmd_t *cmds;     /* Commands in order of execution. */
+	int begin;       /* Index of the first command, older ones are removed. */
+	int end;         /* Index past the last command. */
+	size_t cmds_cap; /* Number of elements allocated for cmds. */
+
+	char *strs;      /* Packed null-terminated directories and names. */
+	size_t strs_len; /* Number of used bytes of strs. */
+	size_t strs_cap; /* Number of allocated bytes of strs. */
+
+	unsigned int *dirs;    /* Offsets of directories in strs. */
+	size_t ndirs;          /* Number of elements of dirs. */
+	size_t dirs_cap;       /* Number of elements allocated for dirs. */
+	int recent_dirs[2];    /* Recently used directories, most recent first,
+	                          -1 if not set. */
+
+	struct group_t *prev; /* Previous (older) group. */
+	struct group_t *next; /* Next (newer) group. */
 }
 group_t;
 
+/* Position of a command in the list of groups.  NULL group with zero index
+ * denotes position before the first command. */
+typedef struct
+{
+	group_t *group; /* Group of the command. */
+	int index;      /* Index of the command in the group. */
+}
+pos_t;
+
+/* Operation of a command with its paths expanded.  Paths of commands aren't
+ * kept in this form to save memory. */
 typedef struct
 {
 	OPS op;
@@ -52,22 +99,11 @@ typedef struct
 	void *data;             /* for uid_t, gid_t and mode_t */
 	const char *exists;     /* NULL, buf1 or buf2 */
 	const char *dont_exist; /* NULL, buf1 or buf2 */
+	char buf1[PATH_MAX];
+	char buf2[PATH_MAX];
 }
 op_t;
 
-typedef struct cmd_t
-{
-	char *buf1;
-	char *buf2;
-	op_t do_op;
-	op_t undo_op;
-
-	group_t *group;
-	struct cmd_t *prev;
-	struct cmd_t *next;
-}
-cmd_t;
-
 static OPS undo_op[] = {
 	OP_NONE,     /* OP_NONE */
 	OP_NONE,     /* OP_USR */
@@ -205,10 +241,12 @@ static undo_cancel_requested cancel_func;
 /* Number of undo levels, which are not groups but operations. */
 static const int *undo_levels;
 
-static cmd_t cmds = {
-	.prev = &cmds,
-};
-static cmd_t *current = &cmds;
+/* Oldest group of commands. */
+static group_t *oldest_group;
+/* Newest group of commands. */
+static group_t *newest_group;
+/* Last executed command. */
+static pos_t current;
 
 static int group_opened;
 static long long next_group;
@@ -218,16 +256,35 @@ static char *group_msg;
 static int command_count;
 
 static int no_function(void);
-static void init_cmd(cmd_t *cmd, OPS op, void *do_data, void *undo_data);
-static void init_entry(cmd_t *cmd, const char **e, int type);
-static void remove_cmd(cmd_t *cmd);
+static int append_cmd(group_t *group, OPS op, void *do_data, void *undo_data,
+		const char buf1[], const char buf2[]);
+static void free_op_data(OPS op, void *do_data, void *undo_data);
+static group_t * alloc_group(const char msg[]);
+static void free_group(group_t *group);
+static void link_group(group_t *group);
+static void unlink_group(group_t *group);
+static int ensure_capacity(void **array, size_t *capacity, size_t size,
+		size_t elem_size);
+static int store_path(group_t *group, const char path[], unsigned int *dir,
+		unsigned int *name);
+static int store_str(group_t *group, const char str[], size_t len,
+		unsigned int *offset);
+static void get_op(const group_t *group, const cmd_t *cmd, int undo,
+		op_t *op);
+static const char * get_entry(const op_t *op, int type);
+static pos_t first_pos(void);
+static pos_t last_pos(void);
+static int same_pos(pos_t a, pos_t b);
+static void prev_pos(pos_t *pos);
+static int next_pos(pos_t *pos);
+static void remove_cmd(pos_t pos);
 static int is_undo_group_possible(void);
 static int is_redo_group_possible(void);
 static int is_op_possible(const op_t *op);
-static void change_filename_in_trash(cmd_t *cmd, const char *filename);
-static void update_entry(const char **e, const char old[], const char new[]);
+static void change_filename_in_trash(group_t *group, cmd_t *cmd,
+		const char *filename);
 static char ** fill_undolist_detail(char **list);
-static const char * get_op_desc(op_t op);
+static const char * get_op_desc(const op_t *op);
 static char **fill_undolist_nondetail(char **list);
 
 void
@@ -254,11 +311,24 @@ reset_undo_list(void)
 {
 	assert(!group_opened);
 
-	while(cmds.next != NULL)
-		remove_cmd(cmds.next);
-	cmds.prev = &cmds;
+	while(oldest_group != NULL)
+	{
+		group_t *const group = oldest_group;
+		int i;
 
-	current = &cmds;
+		for(i = group->begin; i < group->end; ++i)
+		{
+			cmd_t *const cmd = &group->cmds[i];
+			free_op_data(cmd->op, cmd->do_data, cmd->undo_data);
+		}
+		command_count -= group->end - group->begin;
+
+		unlink_group(group);
+		free_group(group);
+	}
+
+	current.group = NULL;
+	current.index = 0;
 	next_group = 0;
 	last_group = NULL;
 }
@@ -302,148 +372,383 @@ int
 add_operation(OPS op, void *do_data, void *undo_data, const char *buf1,
 		const char *buf2)
 {
-	int mem_error;
-	cmd_t *cmd;
+	group_t *group;
 
 	assert(group_opened);
 	assert(buf1 != NULL);
 	assert(buf2 != NULL);
 
 	/* free list tail */
-	while(current->next != NULL)
-		remove_cmd(current->next);
+	while(!same_pos(last_pos(), current))
+		remove_cmd(last_pos());
 
 	while(command_count > 0 && command_count >= *undo_levels)
-		remove_cmd(cmds.next);
+		remove_cmd(first_pos());
 
 	if(*undo_levels <= 0)
 	{
-		if(data_is_ptr[op])
-		{
-			free(do_data);
-		}
-		if(data_is_ptr[undo_op[op]])
-		{
-			free(undo_data);
-		}
+		free_op_data(op, do_data, undo_data);
 		return 0;
 	}
 
-	command_count++;
-
-	/* add operation to the list */
-	cmd = calloc(1, sizeof(*cmd));
-	if(cmd == NULL)
+	group = (last_group != NULL) ? last_group : alloc_group(group_msg);
+	if(group == NULL ||
+			append_cmd(group, op, do_data, undo_data, buf1, buf2) != 0)
+	{
+		if(group != last_group)
+			free_group(group);
+		free_op_data(op, do_data, undo_data);
 		return -1;
+	}
 
-	cmd->buf1 = strdup(buf1);
-	cmd->buf2 = strdup(buf2);
-	cmd->prev = current;
-	init_cmd(cmd, op, do_data, undo_data);
-	if(last_group != NULL)
+	if(group != last_group)
 	{
-		cmd->group = last_group;
+		link_group(group);
+		last_group = group;
 	}
-	else if((cmd->group = malloc(sizeof(group_t))) != NULL)
+
+	if(undo_op[op] == OP_NONE)
+		group->can_undone = 0;
+
+	current.group = group;
+	current.index = group->end - 1;
+
+	command_count++;
+
+	return 0;
+}
+
+/* Appends command to the end of the group.  Returns zero on success, otherwise
+ * non-zero is returned. */
+static int
+append_cmd(group_t *group, OPS op, void *do_data, void *undo_data,
+		const char buf1[], const char buf2[])
+{
+	cmd_t *cmd;
+
+	if(ensure_capacity((void **)&group->cmds, &group->cmds_cap, group->end + 1,
+				sizeof(*group->cmds)) != 0)
 	{
-		cmd->group->msg = strdup(group_msg);
-		cmd->group->error = 0;
-		cmd->group->balance = 0;
-		cmd->group->can_undone = 1;
-		cmd->group->incomplete = 0;
+		return 1;
 	}
-	mem_error = cmd->group == NULL || cmd->buf1 == NULL || cmd->buf2 == NULL;
-	if(mem_error)
+
+	cmd = &group->cmds[group->end];
+	if(store_path(group, buf1, &cmd->dirs[0], &cmd->names[0]) != 0 ||
+			store_path(group, buf2, &cmd->dirs[1], &cmd->names[1]) != 0)
 	{
-		remove_cmd(cmd);
-		return -1;
+		return 1;
 	}
-	last_group = cmd->group;
 
-	if(undo_op[op] == OP_NONE)
-		cmd->group->can_undone = 0;
+	cmd->op = op;
+	cmd->do_data = do_data;
+	cmd->undo_data = undo_data;
+	++group->end;
+	return 0;
+}
+
+/* Frees data of operation if it's a pointer. */
+static void
+free_op_data(OPS op, void *do_data, void *undo_data)
+{
+	if(data_is_ptr[op])
+		free(do_data);
+	if(data_is_ptr[undo_op[op]])
+		free(undo_data);
+}
 
-	current->next = cmd;
-	current = cmd;
-	cmds.prev = cmd;
+/* Allocates new empty group.  Returns the group or NULL on error. */
+static group_t *
+alloc_group(const char msg[])
+{
+	group_t *const group = calloc(1, sizeof(*group));
+	if(group == NULL)
+		return NULL;
 
-	return 0;
+	group->msg = strdup(msg);
+	if(group->msg == NULL)
+	{
+		free(group);
+		return NULL;
+	}
+
+	group->can_undone = 1;
+	group->recent_dirs[0] = -1;
+	group->recent_dirs[1] = -1;
+	return group;
 }
 
+/* Frees the group along with memory of its commands.  The group can be
+ * NULL. */
 static void
-init_cmd(cmd_t *cmd, OPS op, void *do_data, void *undo_data)
-{
-	cmd->do_op.op = op;
-	cmd->do_op.data = do_data;
-	cmd->undo_op.op = undo_op[op];
-	cmd->undo_op.data = undo_data;
-	init_entry(cmd, &cmd->do_op.src, opers[op][0]);
-	init_entry(cmd, &cmd->do_op.dst, opers[op][1]);
-	init_entry(cmd, &cmd->do_op.exists, opers[op][2]);
-	init_entry(cmd, &cmd->do_op.dont_exist, opers[op][3]);
-	init_entry(cmd, &cmd->undo_op.src, opers[op][4]);
-	init_entry(cmd, &cmd->undo_op.dst, opers[op][5]);
-	init_entry(cmd, &cmd->undo_op.exists, opers[op][6]);
-	init_entry(cmd, &cmd->undo_op.dont_exist, opers[op][7]);
+free_group(group_t *group)
+{
+	if(group == NULL)
+		return;
+
+	free(group->cmds);
+	free(group->strs);
+	free(group->dirs);
+	free(group->msg);
+	free(group);
 }
 
+/* Appends the group to the list of groups. */
 static void
-init_entry(cmd_t *cmd, const char **e, int type)
+link_group(group_t *group)
 {
-	if(type == OPER_NON)
-		*e = NULL;
-	else if(type == OPER_1ST)
-		*e = cmd->buf1;
+	group->prev = newest_group;
+	group->next = NULL;
+
+	if(newest_group != NULL)
+		newest_group->next = group;
 	else
-		*e = cmd->buf2;
+		oldest_group = group;
+	newest_group = group;
 }
 
+/* Excludes the group from the list of groups. */
 static void
-remove_cmd(cmd_t *cmd)
+unlink_group(group_t *group)
 {
-	int last_cmd_in_group = 1;
+	if(group->prev != NULL)
+		group->prev->next = group->next;
+	else
+		oldest_group = group->next;
+
+	if(group->next != NULL)
+		group->next->prev = group->prev;
+	else
+		newest_group = group->prev;
+}
+
+/* Makes sure that the array has room for at least size elements.  Capacity is
+ * doubled on growth to make appending cheap.  Returns zero on success,
+ * otherwise non-zero is returned. */
+static int
+ensure_capacity(void **array, size_t *capacity, size_t size, size_t elem_size)
+{
+	size_t new_capacity;
+	void *new_array;
+
+	if(size <= *capacity)
+		return 0;
 
-	if(cmd == current)
-		current = cmd->prev;
+	new_capacity = (*capacity == 0U) ? size : *capacity*2U;
+	if(new_capacity < size)
+		new_capacity = size;
 
-	if(cmd->prev != NULL)
+	new_array = realloc(*array, new_capacity*elem_size);
+	if(new_array == NULL)
+		return 1;
+
+	*array = new_array;
+	*capacity = new_capacity;
+	return 0;
+}
+
+/* Stores copy of the path in memory of the group.  Directory part is looked up
+ * among recently used directories of the group, so paths of bulk operations
+ * take about the size of their names.  Returns zero on success, otherwise
+ * non-zero is returned. */
+static int
+store_path(group_t *group, const char path[], unsigned int *dir,
+		unsigned int *name)
+{
+	const char *const slash = strrchr(path, '/');
+	const size_t dir_len = (slash == NULL) ? 0U : (size_t)(slash - path) + 1U;
+	int dir_idx = -1;
+	size_t i;
+
+	for(i = 0U; i < ARRAY_LEN(group->recent_dirs); ++i)
 	{
-		cmd->prev->next = cmd->next;
-		if(cmd->group == cmd->prev->group)
-			last_cmd_in_group = 0;
+		const int idx = group->recent_dirs[i];
+		const char *recent;
+
+		if(idx < 0)
+			continue;
+
+		recent = group->strs + group->dirs[idx];
+		if(strncmp(recent, path, dir_len) == 0 && recent[dir_len] == '\0')
+		{
+			dir_idx = idx;
+			break;
+		}
 	}
-	if(cmd->next != NULL)
+
+	if(dir_idx < 0)
 	{
-		cmd->next->prev = cmd->prev;
-		if(cmd->group == cmd->next->group)
-			last_cmd_in_group = 0;
+		unsigned int offset;
+
+		if(ensure_capacity((void **)&group->dirs, &group->dirs_cap,
+					group->ndirs + 1U, sizeof(*group->dirs)) != 0 ||
+				store_str(group, path, dir_len, &offset) != 0)
+		{
+			return 1;
+		}
+
+		group->dirs[group->ndirs] = offset;
+		dir_idx = group->ndirs++;
+		i = ARRAY_LEN(group->recent_dirs) - 1U;
 	}
-	else /* this is the last command in the list */
+
+	/* Keep the most recently used directory first. */
+	for(; i > 0U; --i)
 	{
-		cmds.prev = cmd->prev;
+		group->recent_dirs[i] = group->recent_dirs[i - 1U];
 	}
+	group->recent_dirs[0] = dir_idx;
+
+	*dir = dir_idx;
+	return store_str(group, path + dir_len, strlen(path + dir_len), name);
+}
 
-	if(last_cmd_in_group)
+/* Appends copy of first len characters of the str to packed strings of the
+ * group.  Returns zero on success, otherwise non-zero is returned. */
+static int
+store_str(group_t *group, const char str[], size_t len, unsigned int *offset)
+{
+	if(ensure_capacity((void **)&group->strs, &group->strs_cap,
+				group->strs_len + len + 1U, 1U) != 0)
 	{
-		free(cmd->group->msg);
-		free(cmd->group);
-		if(last_group == cmd->group)
-			last_group = NULL;
+		return 1;
 	}
+
+	memcpy(group->strs + group->strs_len, str, len);
+	group->strs[group->strs_len + len] = '\0';
+	*offset = group->strs_len;
+	group->strs_len += len + 1U;
+	return 0;
+}
+
+/* Fills the op with do or undo operation of the cmd of the group. */
+static void
+get_op(const group_t *group, const cmd_t *cmd, int undo, op_t *op)
+{
+	const int base = undo ? 4 : 0;
+
+	op->op = undo ? undo_op[cmd->op] : cmd->op;
+	op->data = undo ? cmd->undo_data : cmd->do_data;
+	snprintf(op->buf1, sizeof(op->buf1), "%s%s",
+			group->strs + group->dirs[cmd->dirs[0]], group->strs + cmd->names[0]);
+	snprintf(op->buf2, sizeof(op->buf2), "%s%s",
+			group->strs + group->dirs[cmd->dirs[1]], group->strs + cmd->names[1]);
+	op->src = get_entry(op, opers[cmd->op][base + 0]);
+	op->dst = get_entry(op, opers[cmd->op][base + 1]);
+	op->exists = get_entry(op, opers[cmd->op][base + 2]);
+	op->dont_exist = get_entry(op, opers[cmd->op][base + 3]);
+}
+
+/* Maps type of operand to its value.  Returns the value. */
+static const char *
+get_entry(const op_t *op, int type)
+{
+	if(type == OPER_NON)
+		return NULL;
+	else if(type == OPER_1ST)
+		return op->buf1;
 	else
+		return op->buf2;
+}
+
+/* Retrieves position of the oldest command.  Returns the position. */
+static pos_t
+first_pos(void)
+{
+	pos_t pos = { oldest_group, 0 };
+	if(oldest_group != NULL)
+		pos.index = oldest_group->begin;
+	return pos;
+}
+
+/* Retrieves position of the newest command.  Returns the position. */
+static pos_t
+last_pos(void)
+{
+	pos_t pos = { newest_group, 0 };
+	if(newest_group != NULL)
+		pos.index = newest_group->end - 1;
+	return pos;
+}
+
+/* Checks whether two positions are equal.  Returns non-zero if so, otherwise
+ * zero is returned. */
+static int
+same_pos(pos_t a, pos_t b)
+{
+	return a.group == b.group && a.index == b.index;
+}
+
+/* Moves the pos to the previous command.  The pos must point to a command. */
+static void
+prev_pos(pos_t *pos)
+{
+	if(pos->index > pos->group->begin)
 	{
-		cmd->group->incomplete = 1;
+		--pos->index;
+		return;
 	}
-	free(cmd->buf1);
-	free(cmd->buf2);
-	if(data_is_ptr[cmd->do_op.op])
-		free(cmd->do_op.data);
-	if(data_is_ptr[cmd->undo_op.op])
-		free(cmd->undo_op.data);
 
-	free(cmd);
+	pos->group = pos->group->prev;
+	pos->index = (pos->group == NULL) ? 0 : pos->group->end - 1;
+}
 
+/* Moves the pos to the next command.  Returns non-zero if there is next
+ * command, otherwise zero is returned and the pos is left unchanged. */
+static int
+next_pos(pos_t *pos)
+{
+	group_t *next;
+
+	if(pos->group != NULL && pos->index + 1 < pos->group->end)
+	{
+		++pos->index;
+		return 1;
+	}
+
+	next = (pos->group == NULL) ? oldest_group : pos->group->next;
+	if(next == NULL)
+		return 0;
+
+	pos->group = next;
+	pos->index = next->begin;
+	return 1;
+}
+
+/* Removes command at the pos freeing its group if it becomes empty.  Commands
+ * are removed from either end of the list, so shifting is a rare case. */
+static void
+remove_cmd(pos_t pos)
+{
+	group_t *const group = pos.group;
+	cmd_t *const cmd = &group->cmds[pos.index];
+
+	if(same_pos(pos, current))
+		prev_pos(&current);
+
+	free_op_data(cmd->op, cmd->do_data, cmd->undo_data);
 	command_count--;
+
+	if(group->end - group->begin == 1)
+	{
+		if(last_group == group)
+			last_group = NULL;
+		unlink_group(group);
+		free_group(group);
+		return;
+	}
+
+	group->incomplete = 1;
+
+	if(pos.index == group->begin)
+	{
+		++group->begin;
+		return;
+	}
+
+	memmove(cmd, cmd + 1, sizeof(*cmd)*(group->end - pos.index - 1));
+	--group->end;
+	if(current.group == group && current.index > pos.index)
+		--current.index;
 }
 
 int
@@ -460,8 +765,8 @@ cmd_group_end(void)
 	group_opened = 0;
 	next_group++;
 
-	while(cmds.next != NULL && cmds.next->group->incomplete)
-		remove_cmd(cmds.next);
+	while(oldest_group != NULL && oldest_group->incomplete)
+		remove_cmd(first_pos());
 }
 
 int
@@ -470,19 +775,21 @@ undo_group(void)
 	int errors, disbalance, cant_undone;
 	int skip;
 	int cancelled;
+	group_t *group;
+	op_t op;
 	assert(!group_opened);
 
-	if(current == &cmds)
+	if(current.group == NULL)
 		return -1;
 
-	errors = current->group->error != 0;
-	disbalance = current->group->balance != 0;
-	cant_undone = !current->group->can_undone;
+	group = current.group;
+	errors = group->error != 0;
+	disbalance = group->balance != 0;
+	cant_undone = !group->can_undone;
 	if(errors || disbalance || cant_undone || !is_undo_group_possible())
 	{
-		do
-			current = current->prev;
-		while(current != &cmds && current->group == current->next->group);
+		current.index = group->begin;
+		prev_pos(&current);
 		if(errors)
 			return 1;
 		else if(disbalance)
@@ -493,30 +800,30 @@ undo_group(void)
 			return -3;
 	}
 
-	current->group->balance--;
+	group->balance--;
 
 	skip = 0;
 	do
 	{
 		if(!skip)
 		{
-			int err = do_func(current->undo_op.op, current->undo_op.data,
-					current->undo_op.src, current->undo_op.dst);
+			int err;
+			get_op(group, &group->cmds[current.index], 1, &op);
+			err = do_func(op.op, op.data, op.src, op.dst);
 			if(err == SKIP_UNDO_REDO_OPERATION)
 			{
 				skip = 1;
-				current->group->balance++;
+				group->balance++;
 			}
 			else if(err != 0)
 			{
-				current->group->error = 1;
+				group->error = 1;
 				errors = 1;
 			}
 		}
-		current = current->prev;
+		prev_pos(&current);
 	}
-	while(!(cancelled = cancel_func()) && current != &cmds &&
-			current->group == current->next->group);
+	while(!(cancelled = cancel_func()) && current.group == group);
 
 	if(cancelled)
 	{
@@ -535,18 +842,19 @@ undo_group(void)
 static int
 is_undo_group_possible(void)
 {
-	cmd_t *cmd = current;
-	do
+	group_t *const group = current.group;
+	int i;
+	op_t op;
+	for(i = current.index; i >= group->begin; --i)
 	{
 		int ret;
-		ret = is_op_possible(&cmd->undo_op);
+		get_op(group, &group->cmds[i], 1, &op);
+		ret = is_op_possible(&op);
 		if(ret == 0)
 			return 0;
 		else if(ret < 0)
-			change_filename_in_trash(cmd, cmd->undo_op.dst);
-		cmd = cmd->prev;
+			change_filename_in_trash(group, &group->cmds[i], op.dst);
 	}
-	while(cmd != &cmds && cmd->group == cmd->next->group);
 	return 1;
 }
 
@@ -556,18 +864,21 @@ redo_group(void)
 	int errors, disbalance;
 	int skip;
 	int cancelled;
+	pos_t next = current;
+	group_t *group;
+	op_t op;
 	assert(!group_opened);
 
-	if(current->next == NULL)
+	if(!next_pos(&next))
 		return -1;
 
-	errors = current->next->group->error != 0;
-	disbalance = current->next->group->balance == 0;
+	group = next.group;
+	errors = group->error != 0;
+	disbalance = group->balance == 0;
 	if(errors || disbalance || !is_redo_group_possible())
 	{
-		do
-			current = current->next;
-		while(current->next != NULL && current->group == current->next->group);
+		current.group = group;
+		current.index = group->end - 1;
 		if(errors)
 			return 1;
 		else if(disbalance)
@@ -576,30 +887,30 @@ redo_group(void)
 			return -3;
 	}
 
-	current->next->group->balance++;
+	group->balance++;
 
 	skip = 0;
 	do
 	{
-		current = current->next;
+		(void)next_pos(&current);
 		if(!skip)
 		{
-			int err = do_func(current->do_op.op, current->do_op.data,
-					current->do_op.src, current->do_op.dst);
+			int err;
+			get_op(group, &group->cmds[current.index], 0, &op);
+			err = do_func(op.op, op.data, op.src, op.dst);
 			if(err == SKIP_UNDO_REDO_OPERATION)
 			{
-				current->next->group->balance--;
+				group->balance--;
 				skip = 1;
 			}
 			else if(err != 0)
 			{
-				current->group->error = 1;
+				group->error = 1;
 				errors = 1;
 			}
 		}
 	}
-	while(!(cancelled = cancel_func()) && current->next != NULL &&
-			current->group == current->next->group);
+	while(!(cancelled = cancel_func()) && current.index + 1 < group->end);
 
 	if(cancelled)
 	{
@@ -618,18 +929,23 @@ redo_group(void)
 static int
 is_redo_group_possible(void)
 {
-	cmd_t *cmd = current;
-	do
+	pos_t pos = current;
+	group_t *group;
+	int i;
+	op_t op;
+
+	(void)next_pos(&pos);
+	group = pos.group;
+	for(i = pos.index; i < group->end; ++i)
 	{
 		int ret;
-		cmd = cmd->next;
-		ret = is_op_possible(&cmd->do_op);
+		get_op(group, &group->cmds[i], 0, &op);
+		ret = is_op_possible(&op);
 		if(ret == 0)
 			return 0;
 		else if(ret < 0)
-			change_filename_in_trash(cmd, cmd->do_op.dst);
+			change_filename_in_trash(group, &group->cmds[i], op.dst);
 	}
-	while(cmd->next != NULL && cmd->group == cmd->next->group);
 	return 1;
 }
 
@@ -664,11 +980,10 @@ is_op_possible(const op_t *op)
 }
 
 static void
-change_filename_in_trash(cmd_t *cmd, const char *filename)
+change_filename_in_trash(group_t *group, cmd_t *cmd, const char *filename)
 {
 	const char *name_tail;
 	char *new;
-	char *old;
 	char *const base_dir = strdup(filename);
 
 	remove_last_path_component(base_dir);
@@ -679,31 +994,11 @@ change_filename_in_trash(cmd_t *cmd, const char *filename)
 
 	free(base_dir);
 
-	old = cmd->buf2;
-	cmd->buf2 = new;
+	(void)store_path(group, new, &cmd->dirs[1], &cmd->names[1]);
 
 	rename_in_registers(filename, new);
 
-	update_entry(&cmd->do_op.src, old, cmd->buf2);
-	update_entry(&cmd->do_op.dst, old, cmd->buf2);
-	update_entry(&cmd->do_op.exists, old, cmd->buf2);
-	update_entry(&cmd->do_op.dont_exist, old, cmd->buf2);
-	update_entry(&cmd->undo_op.src, old, cmd->buf2);
-	update_entry(&cmd->undo_op.dst, old, cmd->buf2);
-	update_entry(&cmd->undo_op.exists, old, cmd->buf2);
-	update_entry(&cmd->undo_op.dont_exist, old, cmd->buf2);
-
-	free(old);
-}
-
-/* Checks whether *e equals old and updates it to new if so. */
-static void
-update_entry(const char **e, const char old[], const char new[])
-{
-	if(*e == old)
-	{
-		*e = new;
-	}
+	free(new);
 }
 
 char **
@@ -711,17 +1006,14 @@ undolist(int detail)
 {
 	char **list, **p;
 	int group_count;
-	cmd_t *cmd;
+	const group_t *group;
 
 	assert(!group_opened);
 
 	group_count = 1;
-	cmd = cmds.prev;
-	while(cmd != &cmds)
+	for(group = oldest_group; group != NULL; group = group->next)
 	{
-		if(cmd->group != cmd->prev->group)
-			group_count++;
-		cmd = cmd->prev;
+		group_count++;
 	}
 
 	if(detail)
@@ -745,103 +1037,103 @@ static char **
 fill_undolist_detail(char **list)
 {
 	int left;
-	cmd_t *cmd;
+	const group_t *group;
+	op_t op;
 
 	left = *undo_levels;
-	cmd = cmds.prev;
-	while(cmd != &cmds && left > 0)
+	for(group = newest_group; group != NULL && left > 0; group = group->prev)
 	{
-		if((*list = strdup(cmd->group->msg)) == NULL)
+		int i;
+
+		if((*list = strdup(group->msg)) == NULL)
 			break;
 
 		list++;
-		do
+		for(i = group->end - 1; i >= group->begin && left > 0; --i, --left)
 		{
 			const char *p;
 
-			p = get_op_desc(cmd->do_op);
+			get_op(group, &group->cmds[i], 0, &op);
+			p = get_op_desc(&op);
 			if((*list = malloc(4 + strlen(p) + 1)) == NULL)
 				return list;
 			sprintf(*list, "do: %s", p);
 			list++;
 
-			p = get_op_desc(cmd->undo_op);
+			get_op(group, &group->cmds[i], 1, &op);
+			p = get_op_desc(&op);
 			if((*list = malloc(6 + strlen(p) + 1)) == NULL)
 				return list;
 			sprintf(*list, "undo: %s", p);
 			list++;
-
-			cmd = cmd->prev;
-			--left;
 		}
-		while(cmd != &cmds && cmd->group == cmd->next->group && left > 0);
 	}
 
 	return list;
 }
 
 static const char *
-get_op_desc(op_t op)
+get_op_desc(const op_t *op)
 {
 	static char buf[64 + 2*PATH_MAX] = "";
-	switch(op.op)
+	switch(op->op)
 	{
 		case OP_NONE:
 			strcpy(buf, "<no operation>");
 			break;
 		case OP_USR:
-			copy_str(buf, sizeof(buf), (const char *)op.data);
+			copy_str(buf, sizeof(buf), (const char *)op->data);
 			break;
 		case OP_REMOVE:
 		case OP_REMOVESL:
-			snprintf(buf, sizeof(buf), "rm %s", op.src);
+			snprintf(buf, sizeof(buf), "rm %s", op->src);
 			break;
 		case OP_COPY:
-			snprintf(buf, sizeof(buf), "cp %s to %s", op.src, op.dst);
+			snprintf(buf, sizeof(buf), "cp %s to %s", op->src, op->dst);
 			break;
 		case OP_COPYF:
-			snprintf(buf, sizeof(buf), "cp -f %s to %s", op.src, op.dst);
+			snprintf(buf, sizeof(buf), "cp -f %s to %s", op->src, op->dst);
 			break;
 		case OP_MOVE:
 		case OP_MOVETMP1:
 		case OP_MOVETMP2:
-			snprintf(buf, sizeof(buf), "mv %s to %s", op.src, op.dst);
+			snprintf(buf, sizeof(buf), "mv %s to %s", op->src, op->dst);
 			break;
 		case OP_MOVEF:
-			snprintf(buf, sizeof(buf), "mv -f %s to %s", op.src, op.dst);
+			snprintf(buf, sizeof(buf), "mv -f %s to %s", op->src, op->dst);
 			break;
 		case OP_CHOWN:
-			snprintf(buf, sizeof(buf), "chown " PRINTF_SIZE_T " %s", (size_t)op.data, op.src);
+			snprintf(buf, sizeof(buf), "chown " PRINTF_SIZE_T " %s", (size_t)op->data, op->src);
 			break;
 		case OP_CHGRP:
-			snprintf(buf, sizeof(buf), "chown :" PRINTF_SIZE_T " %s", (size_t)op.data, op.src);
+			snprintf(buf, sizeof(buf), "chown :" PRINTF_SIZE_T " %s", (size_t)op->data, op->src);
 			break;
 #ifndef _WIN32
 		case OP_CHMOD:
 		case OP_CHMODR:
-			snprintf(buf, sizeof(buf), "chmod %s %s", (char *)op.data, op.src);
+			snprintf(buf, sizeof(buf), "chmod %s %s", (char *)op->data, op->src);
 			break;
 #else
 		case OP_ADDATTR:
-			snprintf(buf, sizeof(buf), "attrib +%s", attr_str((size_t)op.data));
+			snprintf(buf, sizeof(buf), "attrib +%s", attr_str((size_t)op->data));
 			break;
 		case OP_SUBATTR:
-			snprintf(buf, sizeof(buf), "attrib -%s", attr_str((size_t)op.data));
+			snprintf(buf, sizeof(buf), "attrib -%s", attr_str((size_t)op->data));
 			break;
 #endif
 		case OP_SYMLINK:
 		case OP_SYMLINK2:
-			snprintf(buf, sizeof(buf), "ln -s %s to %s", op.src, op.dst);
+			snprintf(buf, sizeof(buf), "ln -s %s to %s", op->src, op->dst);
 			break;
 		case OP_MKDIR:
-			snprintf(buf, sizeof(buf), "mkdir %s%s", op.src,
-					(op.data == NULL) ? "" : "-p ");
+			snprintf(buf, sizeof(buf), "mkdir %s%s", op->src,
+					(op->data == NULL) ? "" : "-p ");
 			break;
 		case OP_RMDIR:
-			snprintf(buf, sizeof(buf), "rmdir %s", op.src);
+			snprintf(buf, sizeof(buf), "rmdir %s", op->src);
 			break;
 		case OP_MKFILE:
-			snprintf(buf, sizeof(buf), "touch %s", op.src);
+			snprintf(buf, sizeof(buf), "touch %s", op->src);
 			break;
 
 		default:
@@ -856,18 +1148,14 @@ static char **
 fill_undolist_nondetail(char **list)
 {
 	int left;
-	cmd_t *cmd;
+	const group_t *group;
 
 	left = *undo_levels;
-	cmd = cmds.prev;
-	while(cmd != &cmds && left-- > 0)
+	for(group = newest_group; group != NULL && left-- > 0; group = group->prev)
 	{
-		if((*list = strdup(cmd->group->msg)) == NULL)
+		if((*list = strdup(group->msg)) == NULL)
 			break;
 
-		do
-			cmd = cmd->prev;
-		while(cmd != &cmds && cmd->group == cmd->next->group);
 		list++;
 	}
 
@@ -877,20 +1165,20 @@ fill_undolist_nondetail(char **list)
 int
 get_undolist_pos(int detail)
 {
-	cmd_t *cur = cmds.prev;
+	pos_t pos = last_pos();
 	int result_group = 0;
 	int result_cmd = 0;
 
 	assert(!group_opened);
 
-	if(cur == &cmds)
+	if(pos.group == NULL)
 		result_group++;
-	while(cur != current)
+	while(!same_pos(pos, current))
 	{
-		if(cur->group != cur->prev->group)
+		if(pos.index == pos.group->begin)
 			result_group++;
 		result_cmd += 2;
-		cur = cur->prev;
+		prev_pos(&pos);
 	}
 	return detail ? (result_group + result_cmd) : result_group;
 }
@@ -898,25 +1186,31 @@ get_undolist_pos(int detail)
 void
 clean_cmds_with_trash(void)
 {
-	cmd_t *cur = cmds.prev;
+	group_t *group = newest_group;
 
 	assert(!group_opened);
 
-	while(cur != &cmds)
+	while(group != NULL)
 	{
-		cmd_t *prev = cur->prev;
+		group_t *const prev = group->prev;
+		int i;
 
-		if(cur->group->balance < 0)
+		for(i = group->end - 1; i >= group->begin; --i)
 		{
-			if(cur->do_op.exists != NULL && is_under_trash(cur->do_op.exists))
-				remove_cmd(cur);
-		}
-		else
-		{
-			if(cur->undo_op.exists != NULL && is_under_trash(cur->undo_op.exists))
-				remove_cmd(cur);
+			const int last_in_group = (group->end - group->begin == 1);
+			op_t op;
+
+			get_op(group, &group->cmds[i], group->balance >= 0, &op);
+			if(op.exists != NULL && is_under_trash(op.exists))
+			{
+				const pos_t pos = { group, i };
+				remove_cmd(pos);
+				/* Removal of the last command frees the group. */
+				if(last_in_group)
+					break;
+			}
 		}
-		cur = prev;
+		group = prev;
 	}
 }
 
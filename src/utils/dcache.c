@@ -0,0 +1,135 @@
+/* vifm
+ * Copyright (C) 2015 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "dcache.h"
+
+#include <ctype.h> /* tolower() */
+#include <stddef.h> /* NULL */
+#include <stdint.h> /* uint64_t */
+#include <stdlib.h> /* free() malloc() */
+
+#include "tree.h"
+
+/* Number of independent parts of the cache (power of two). */
+#define STRIPE_COUNT 16
+
+/* Cache itself, each stripe is a tree with its own lock. */
+struct dcache_t
+{
+	tree_t stripes[STRIPE_COUNT]; /* Trees that hold paths. */
+};
+
+static unsigned int hash_path(const char path[]);
+
+dcache_t *
+dcache_create(void)
+{
+	int i;
+	dcache_t *const cache = malloc(sizeof(*cache));
+	if(cache == NULL)
+	{
+		return NULL;
+	}
+
+	for(i = 0; i < STRIPE_COUNT; ++i)
+	{
+		cache->stripes[i] = tree_create(0, 0);
+		if(cache->stripes[i] == NULL_TREE)
+		{
+			while(i-- > 0)
+			{
+				tree_free(cache->stripes[i]);
+			}
+			free(cache);
+			return NULL;
+		}
+	}
+
+	return cache;
+}
+
+void
+dcache_free(dcache_t *cache)
+{
+	int i;
+
+	if(cache == NULL)
+	{
+		return;
+	}
+
+	for(i = 0; i < STRIPE_COUNT; ++i)
+	{
+		tree_free(cache->stripes[i]);
+	}
+	free(cache);
+}
+
+int
+dcache_get(dcache_t *cache, const char path[], uint64_t *size)
+{
+	const unsigned int stripe = hash_path(path)%STRIPE_COUNT;
+	return tree_get_data(cache->stripes[stripe], path, size);
+}
+
+int
+dcache_set(dcache_t *cache, const char path[], uint64_t size)
+{
+	const unsigned int stripe = hash_path(path)%STRIPE_COUNT;
+	return tree_set_data(cache->stripes[stripe], path, size);
+}
+
+/* Computes hash of the path that doesn't depend on repeated and trailing
+ * slashes, which is how paths are treated by the tree (FNV-1a).  Returns the
+ * hash. */
+static unsigned int
+hash_path(const char path[])
+{
+	unsigned int hash = 2166136261U;
+
+	while(1)
+	{
+		while(*path == '/')
+		{
+			++path;
+		}
+		if(*path == '\0')
+		{
+			break;
+		}
+
+		/* Separator is accounted only between components. */
+		hash = (hash ^ '/')*16777619U;
+
+		while(*path != '/' && *path != '\0')
+		{
+#ifndef _WIN32
+			hash = (hash ^ (unsigned char)*path)*16777619U;
+#else
+			hash = (hash ^ (unsigned char)tolower((unsigned char)*path))*16777619U;
+#endif
+			++path;
+		}
+	}
+
+	/* Mix higher bits in as only a few lower ones are used. */
+	return hash ^ (hash >> 16);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
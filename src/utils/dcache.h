@@ -0,0 +1,55 @@
+/* vifm
+ * Copyright (C) 2015 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__UTILS__DCACHE_H__
+#define VIFM__UTILS__DCACHE_H__
+
+#include <stdint.h> /* uint64_t */
+
+/* Cache of sizes of directories, which is shared by the UI and background
+ * threads that calculate sizes.
+ *
+ * Paths are distributed among several independent stripes by their hash, each
+ * stripe is guarded by its own read-write lock.  Lookups never block each
+ * other, while an update blocks only accesses to one stripe, so threads that
+ * work on different directories rarely wait for each other.  Paths are used as
+ * is (no symbolic links are resolved). */
+
+/* Opaque declaration of the cache. */
+typedef struct dcache_t dcache_t;
+
+/* Creates empty cache.  Returns NULL on error. */
+dcache_t * dcache_create(void);
+
+/* Frees the cache.  cache can be NULL.  Must not be called while the cache is
+ * in use by other threads. */
+void dcache_free(dcache_t *cache);
+
+/* Retrieves size of directory at the path.  Won't change *size if the path is
+ * absent in the cache.  Returns zero on success, otherwise non-zero is
+ * returned. */
+int dcache_get(dcache_t *cache, const char path[], uint64_t *size);
+
+/* Stores size of directory at the path.  Returns zero on success, otherwise
+ * non-zero is returned. */
+int dcache_set(dcache_t *cache, const char path[], uint64_t size);
+
+#endif /* VIFM__UTILS__DCACHE_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
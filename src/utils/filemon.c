@@ -18,11 +18,68 @@
 
 #include "filemon.h"
 
+#ifdef __linux__
+#define HAVE_INOTIFY
+#endif
+
+#ifdef HAVE_INOTIFY
+#include <sys/inotify.h> /* IN_* inotify_* */
+#include <unistd.h> /* close() read() */
+#endif
 #include <sys/stat.h> /* stat */
 
-#include <string.h> /* memcmp() memcpy() */
+#include <errno.h> /* EAGAIN errno */
+#include <stddef.h> /* NULL */
+#include <stdlib.h> /* free() malloc() */
+#include <string.h> /* memcmp() memcpy() strcmp() strdup() */
 
 #include "../compat/os.h"
+#include "string_array.h"
+
+#ifdef HAVE_INOTIFY
+/* Events that signal about changes of list of files, of the files themselves
+ * or of the directory itself. */
+#define WATCH_EVENTS (IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE \
+                    | IN_DELETE_SELF | IN_MODIFY | IN_MOVE_SELF | IN_MOVED_FROM \
+                    | IN_MOVED_TO)
+
+/* Maximum number of distinct changed names to remember.  Examining each of
+ * them individually isn't worth it after this point. */
+#define MAX_CHANGES 256
+#endif
+
+/* Watcher data. */
+struct filemon_watch_t
+{
+	char *path;    /* Path to the directory being watched. */
+	filemon_t mon; /* Last known state of the directory for polling. */
+	int wd;        /* inotify watch descriptor or -1 if polling is used. */
+	int updated;   /* Whether changes were reported since the last poll. */
+	int gone;      /* Whether watched directory was removed or moved. */
+
+	char **changes;   /* Names of changed entries since last take. */
+	int nchanges;     /* Number of elements in the changes array. */
+	int changes_lost; /* Whether some of the changes weren't recorded. */
+
+	filemon_watch_t *next; /* Next watcher in the list of all watchers. */
+};
+
+#ifdef HAVE_INOTIFY
+static int get_inotify_fd(void);
+static int read_events(void);
+static void dispatch_event(const struct inotify_event *e);
+static int is_wd_shared(const filemon_watch_t *w);
+static void record_change(filemon_watch_t *w, const char name[]);
+#endif
+static void forget_changes(filemon_watch_t *w);
+static FileMonState poll_mon(filemon_watch_t *w);
+
+#ifdef HAVE_INOTIFY
+/* inotify instance shared by all watchers or -1 if it's unavailable. */
+static int inotify_fd = -1;
+#endif
+/* List of all watchers to dispatch notifications to. */
+static filemon_watch_t *watchers;
 
 int
 filemon_from_file(const char path[], filemon_t *timestamp)
@@ -57,5 +114,334 @@ filemon_assign(filemon_t *lhs, const filemon_t *rhs)
 	memcpy(lhs, rhs, sizeof(*rhs));
 }
 
+filemon_watch_t *
+filemon_watch_create(const char path[])
+{
+	filemon_watch_t *const w = malloc(sizeof(*w));
+	if(w == NULL)
+	{
+		return NULL;
+	}
+
+	w->path = strdup(path);
+	if(w->path == NULL)
+	{
+		free(w);
+		return NULL;
+	}
+
+	w->wd = -1;
+	w->updated = 0;
+	w->gone = 0;
+	w->changes = NULL;
+	w->nchanges = 0;
+	w->changes_lost = 0;
+
+#ifdef HAVE_INOTIFY
+	if(get_inotify_fd() != -1)
+	{
+		/* Dispatch pending events before the watch is added, so that events of
+		 * other watchers of the same directory aren't attributed to this one. */
+		(void)read_events();
+
+		/* Use polling when inotify can't be used (e.g. limit of watches is
+		 * reached or file system doesn't support notifications). */
+		w->wd = inotify_add_watch(inotify_fd, path, WATCH_EVENTS);
+	}
+#endif
+
+	if(w->wd == -1 && filemon_from_file(path, &w->mon) != 0)
+	{
+		free(w->path);
+		free(w);
+		return NULL;
+	}
+
+	w->next = watchers;
+	watchers = w;
+	return w;
+}
+
+void
+filemon_watch_free(filemon_watch_t *w)
+{
+	filemon_watch_t **p;
+
+	if(w == NULL)
+	{
+		return;
+	}
+
+	for(p = &watchers; *p != w; p = &(*p)->next)
+	{
+		/* Do nothing. */
+	}
+	*p = w->next;
+
+#ifdef HAVE_INOTIFY
+	/* Watch descriptors are per directory, so they can be shared. */
+	if(w->wd != -1 && !is_wd_shared(w))
+	{
+		(void)inotify_rm_watch(inotify_fd, w->wd);
+	}
+#endif
+
+	free_string_array(w->changes, w->nchanges);
+	free(w->path);
+	free(w);
+}
+
+int
+filemon_watch_reset(filemon_watch_t *w, const char path[])
+{
+	if(strcmp(w->path, path) != 0)
+	{
+		return 1;
+	}
+
+#ifdef HAVE_INOTIFY
+	if(w->wd != -1)
+	{
+		const int error = read_events();
+		forget_changes(w);
+		return error || w->gone;
+	}
+#endif
+
+	forget_changes(w);
+	return filemon_from_file(w->path, &w->mon);
+}
+
+FileMonState
+filemon_watch_poll(filemon_watch_t *w)
+{
+#ifdef HAVE_INOTIFY
+	if(w->wd != -1)
+	{
+		int updated;
+
+		if(read_events() != 0)
+		{
+			return FMS_ERRORED;
+		}
+
+		updated = w->updated;
+		w->updated = 0;
+		return updated ? FMS_UPDATED : FMS_UNCHANGED;
+	}
+#endif
+
+	return poll_mon(w);
+}
+
+int
+filemon_watch_is_precise(const filemon_watch_t *w)
+{
+	return w->wd != -1;
+}
+
+int
+filemon_watch_take_changes(filemon_watch_t *w, char ***names, int *count)
+{
+	const int lost = (w->wd == -1 || w->changes_lost);
+
+	if(lost)
+	{
+		free_string_array(w->changes, w->nchanges);
+	}
+	else
+	{
+		*names = w->changes;
+		*count = w->nchanges;
+	}
+
+	w->changes = NULL;
+	w->nchanges = 0;
+	w->changes_lost = 0;
+	return lost;
+}
+
+int
+filemon_watch_fd(void)
+{
+#ifdef HAVE_INOTIFY
+	return inotify_fd;
+#else
+	return -1;
+#endif
+}
+
+void
+filemon_watch_read_events(void)
+{
+#ifdef HAVE_INOTIFY
+	if(inotify_fd != -1)
+	{
+		(void)read_events();
+	}
+#endif
+}
+
+#ifdef HAVE_INOTIFY
+
+/* Creates shared inotify instance on the first call.  Returns its descriptor or
+ * -1 if it's not available. */
+static int
+get_inotify_fd(void)
+{
+	static int initialized;
+
+	if(!initialized)
+	{
+		inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		initialized = 1;
+	}
+
+	return inotify_fd;
+}
+
+/* Reads all pending events from inotify descriptor and dispatches them to
+ * watchers.  Returns zero on success, otherwise non-zero is returned. */
+static int
+read_events(void)
+{
+	/* Size of the buffer is enough for at least one event with the longest
+	 * name. */
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+	while(1)
+	{
+		const char *p;
+		const ssize_t len = read(inotify_fd, buf, sizeof(buf));
+		if(len == -1)
+		{
+			return (errno != EAGAIN);
+		}
+
+		p = buf;
+		while(p < buf + len)
+		{
+			const struct inotify_event *const e = (void *)p;
+			dispatch_event(e);
+			p += sizeof(*e) + e->len;
+		}
+	}
+}
+
+/* Updates state of watchers affected by the event. */
+static void
+dispatch_event(const struct inotify_event *e)
+{
+	filemon_watch_t *w;
+	for(w = watchers; w != NULL; w = w->next)
+	{
+		/* Events can be lost on queue overflow, which affects everyone. */
+		if(e->mask & IN_Q_OVERFLOW)
+		{
+			w->updated = 1;
+			w->changes_lost = 1;
+			continue;
+		}
+
+		if(w->wd != e->wd)
+		{
+			continue;
+		}
+
+		w->updated = 1;
+
+		if(e->len != 0)
+		{
+			record_change(w, e->name);
+		}
+		else
+		{
+			/* The directory itself is affected. */
+			w->changes_lost = 1;
+		}
+
+		/* Path doesn't refer to the watched directory anymore. */
+		if(e->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF))
+		{
+			w->gone = 1;
+		}
+	}
+}
+
+/* Checks whether watch descriptor of the watcher is used by other watchers.
+ * Returns non-zero if so, otherwise zero is returned. */
+static int
+is_wd_shared(const filemon_watch_t *w)
+{
+	const filemon_watch_t *other;
+	for(other = watchers; other != NULL; other = other->next)
+	{
+		if(other != w && other->wd == w->wd)
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* Adds name to the list of changes unless it's already there. */
+static void
+record_change(filemon_watch_t *w, const char name[])
+{
+	if(w->changes_lost || is_in_string_array(w->changes, w->nchanges, name))
+	{
+		return;
+	}
+
+	if(w->nchanges == MAX_CHANGES)
+	{
+		free_string_array(w->changes, w->nchanges);
+		w->changes = NULL;
+		w->nchanges = 0;
+		w->changes_lost = 1;
+		return;
+	}
+
+	{
+		const int len = add_to_string_array(&w->changes, w->nchanges, 1, name);
+		w->changes_lost = (len == w->nchanges);
+		w->nchanges = len;
+	}
+}
+
+#endif
+
+/* Drops information about changes that happened so far. */
+static void
+forget_changes(filemon_watch_t *w)
+{
+	free_string_array(w->changes, w->nchanges);
+	w->changes = NULL;
+	w->nchanges = 0;
+	w->changes_lost = 0;
+	w->updated = 0;
+}
+
+/* Checks modification time of the directory.  Returns state of the
+ * directory. */
+static FileMonState
+poll_mon(filemon_watch_t *w)
+{
+	filemon_t mon;
+
+	if(filemon_from_file(w->path, &mon) != 0)
+	{
+		return FMS_ERRORED;
+	}
+
+	if(filemon_equal(&mon, &w->mon))
+	{
+		return FMS_UNCHANGED;
+	}
+
+	filemon_assign(&w->mon, &mon);
+	return FMS_UPDATED;
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 : */
@@ -49,6 +49,60 @@ int filemon_equal(const filemon_t *a, const filemon_t *b);
 /* Assigns value of the *rhs to *lhs. */
 void filemon_assign(filemon_t *lhs, const filemon_t *rhs);
 
+/* Monitoring of directories for changes.  Uses notifications of the kernel
+ * where they are available (inotify on Linux) and falls back to polling of
+ * directory modification time otherwise.  All watchers share single inotify
+ * instance. */
+
+/* Result of checking directory for changes. */
+typedef enum
+{
+	FMS_UNCHANGED, /* No changes were detected since previous check. */
+	FMS_UPDATED,   /* Directory (or list of its files) was changed. */
+	FMS_ERRORED,   /* Failed to check for changes. */
+}
+FileMonState;
+
+/* Opaque declaration of structure describing state of a watcher. */
+typedef struct filemon_watch_t filemon_watch_t;
+
+/* Creates watcher for the specified directory.  Returns NULL on error. */
+filemon_watch_t * filemon_watch_create(const char path[]);
+
+/* Frees the watcher.  w can be NULL. */
+void filemon_watch_free(filemon_watch_t *w);
+
+/* Drops changes that happened so far, so that they aren't reported.  Returns
+ * zero on success, otherwise non-zero is returned and the watcher should be
+ * recreated (e.g., it watches different path or the directory is gone). */
+int filemon_watch_reset(filemon_watch_t *w, const char path[]);
+
+/* Checks for changes since previous call or since creation of the watcher
+ * without blocking.  Returns state of the directory. */
+FileMonState filemon_watch_poll(filemon_watch_t *w);
+
+/* Checks whether the watcher is based on kernel notifications rather than on
+ * polling.  Returns non-zero if so, otherwise zero is returned. */
+int filemon_watch_is_precise(const filemon_watch_t *w);
+
+/* Retrieves names of entries of the directory that were reported to be changed
+ * (created, removed, renamed, modified) by filemon_watch_poll() calls since
+ * previous call of this function.  Set of changes is unknown when polling is
+ * used, when too many of them happened or when the directory itself was
+ * affected.  Returns zero and sets *names (to be freed by the caller) and
+ * *count on success, otherwise non-zero is returned and the caller should
+ * rescan whole directory. */
+int filemon_watch_take_changes(filemon_watch_t *w, char ***names, int *count);
+
+/* Retrieves file descriptor that becomes readable when any of watched
+ * directories changes.  Returns the descriptor or -1 if there is none. */
+int filemon_watch_fd(void);
+
+/* Reads pending notifications and dispatches them to watchers without
+ * blocking, after which descriptor returned by filemon_watch_fd() isn't
+ * readable until new changes happen. */
+void filemon_watch_read_events(void);
+
 #endif /* VIFM__UTILS__FILEMON_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
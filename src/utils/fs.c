@@ -590,9 +590,9 @@ int
 entry_is_link(const char path[], const struct dirent* dentry)
 {
 #ifndef _WIN32
-	if(dentry->d_type == DT_LNK)
+	if(dentry->d_type != DT_UNKNOWN)
 	{
-		return 1;
+		return dentry->d_type == DT_LNK;
 	}
 #endif
 	return is_symlink(path);
@@ -716,8 +716,12 @@ enum_dir_content(const char path[], dir_content_client_func client, void *param)
 	do
 	{
 		char *const utf8_name = utf8_from_utf16(ffd.cFileName);
-		client(utf8_name, &ffd, param);
+		const int stop = client(utf8_name, &ffd, param);
 		free(utf8_name);
+		if(stop != 0)
+		{
+			break;
+		}
 	}
 	while(FindNextFileW(hfind, &ffd));
 	FindClose(hfind);
@@ -0,0 +1,830 @@
+/* vifm
+ * Copyright (C) 2015 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "pwalk.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#include <pthread.h> /* pthread_* */
+#include <sys/time.h> /* gettimeofday() */
+#ifndef _WIN32
+#include <sys/stat.h> /* fstatat() stat */
+#include <fcntl.h> /* AT_SYMLINK_NOFOLLOW */
+#include <unistd.h> /* _SC_NPROCESSORS_ONLN sysconf() */
+#endif
+
+#include <dirent.h> /* DIR dirent dirfd() */
+#include <errno.h> /* ETIMEDOUT */
+#include <stddef.h> /* NULL */
+#include <stdint.h> /* uint64_t */
+#include <stdio.h> /* snprintf() */
+#include <stdlib.h> /* free() malloc() realloc() */
+#include <string.h> /* memmove() strdup() */
+#include <time.h> /* timespec */
+
+#include "../compat/os.h"
+#include "fs.h"
+#include "fs_limits.h"
+#include "macros.h"
+#include "path.h"
+
+/* Upper limit on number of worker threads. */
+#define MAX_WORKERS 64
+
+/* Maximum number of entries waiting to be visited, workers are suspended when
+ * it's reached. */
+#define QUEUE_LIMIT 4096
+
+/* Number of entries collected by a worker before they are made visible to the
+ * calling thread. */
+#define BATCH_SIZE 256
+
+/* How often progress is reported, in milliseconds. */
+#define PROGRESS_INTERVAL_MS 100
+
+/* Directory which is being walked. */
+typedef struct node_t
+{
+	char *path;            /* Full path to the directory. */
+	struct node_t *parent; /* Parent directory or NULL for the root. */
+	uint64_t size;         /* Accumulated size. */
+	int refs;              /* The scan itself plus number of unfinished
+	                          subdirectories. */
+}
+node_t;
+
+/* Deque of pending directories.  Its owner works at the back, thieves take
+ * items from the front. */
+typedef struct
+{
+	node_t **items;       /* Storage of items. */
+	int head;             /* Index of the first item. */
+	int tail;             /* Index past the last item. */
+	int capacity;         /* Allocated number of items. */
+	pthread_mutex_t lock; /* Protects this structure. */
+}
+deque_t;
+
+/* Entry waiting to be visited. */
+typedef struct
+{
+	char *path;      /* Full path to the entry. */
+	PWalkEntry type; /* Type of the entry. */
+	uint64_t size;   /* Size of the entry. */
+}
+record_t;
+
+/* State of a walk. */
+typedef struct
+{
+	const pwalk_params_t *params; /* Parameters of the walk. */
+	deque_t deques[MAX_WORKERS];  /* Deques of all workers. */
+	int nworkers;                 /* Number of deques in use. */
+
+	/* Fields below are protected by this lock. */
+	pthread_mutex_t lock;
+	pthread_cond_t work_cv;   /* Signaled when work is added or walk is over. */
+	pthread_cond_t caller_cv; /* Signaled when records are added or walk is
+	                             over. */
+	pthread_cond_t space_cv;  /* Signaled when records are taken. */
+	int available;            /* Number of directories in deques. */
+	int pending;              /* Number of directories that aren't scanned. */
+	int finished;             /* Whether everything was scanned. */
+	int stopped;              /* Whether the walk was cancelled. */
+	int root_failed;          /* Whether root couldn't be opened. */
+	int unbounded;            /* Don't limit number of records. */
+	pwalk_stats_t stats;      /* Statistics collected so far. */
+	record_t *records;        /* Entries waiting to be visited. */
+	int nrecords;             /* Number of elements in records. */
+	int records_cap;          /* Capacity of records. */
+
+	pthread_mutex_t agg_lock; /* Protects size and refs fields of nodes. */
+}
+walk_t;
+
+/* Argument of a worker thread. */
+typedef struct
+{
+	walk_t *walk; /* State of the walk. */
+	int id;       /* Index of deque of the worker. */
+}
+worker_t;
+
+/* Protects busy_workers. */
+static pthread_mutex_t budget_lock = PTHREAD_MUTEX_INITIALIZER;
+/* Number of worker threads used by all walks that are in progress. */
+static int busy_workers;
+
+static void run_caller(walk_t *w);
+static void * worker_thread(void *arg);
+static void run_worker(walk_t *w, int id);
+static node_t * take_work(walk_t *w, int id);
+static void scan_dir(walk_t *w, int id, node_t *node);
+static uint64_t get_entry_size(DIR *dir, const struct dirent *d,
+		const char full_path[]);
+static void schedule_dir(walk_t *w, int id, node_t *node);
+static int flush_batch(walk_t *w, record_t batch[], int *n,
+		pwalk_stats_t *stats);
+static void complete_dir(walk_t *w, node_t *node, uint64_t size);
+static node_t * node_alloc(const char path[], node_t *parent);
+static void node_free(node_t *node);
+static int deque_push(deque_t *d, node_t *node);
+static node_t * deque_pop(deque_t *d);
+static node_t * deque_steal(deque_t *d);
+static int reserve_workers(int wanted);
+static void release_workers(int count);
+static int get_cpu_count(void);
+static void set_deadline(struct timespec *ts);
+static int deadline_passed(const struct timespec *ts);
+
+int
+pwalk(const char path[], const pwalk_params_t *params, pwalk_stats_t *stats)
+{
+	static const pwalk_stats_t no_stats;
+
+	pthread_t threads[MAX_WORKERS];
+	worker_t workers[MAX_WORKERS];
+	walk_t w = { .params = params, .stats = no_stats };
+	node_t *root;
+	int nthreads;
+	int i;
+
+	w.nworkers = (params->nworkers > 0) ? params->nworkers : get_cpu_count();
+	w.nworkers = reserve_workers(MIN(MAX(w.nworkers, 1), MAX_WORKERS));
+
+	root = node_alloc(path, NULL);
+	if(root == NULL)
+	{
+		release_workers(w.nworkers);
+		return -1;
+	}
+
+	for(i = 0; i < w.nworkers; ++i)
+	{
+		w.deques[i].items = NULL;
+		w.deques[i].head = 0;
+		w.deques[i].tail = 0;
+		w.deques[i].capacity = 0;
+		pthread_mutex_init(&w.deques[i].lock, NULL);
+	}
+	pthread_mutex_init(&w.lock, NULL);
+	pthread_cond_init(&w.work_cv, NULL);
+	pthread_cond_init(&w.caller_cv, NULL);
+	pthread_cond_init(&w.space_cv, NULL);
+	pthread_mutex_init(&w.agg_lock, NULL);
+
+	if(deque_push(&w.deques[0], root) == 0)
+	{
+		w.available = 1;
+		w.pending = 1;
+	}
+	else
+	{
+		node_free(root);
+		w.finished = 1;
+		w.root_failed = 1;
+	}
+
+	for(nthreads = 0; nthreads < w.nworkers; ++nthreads)
+	{
+		workers[nthreads].walk = &w;
+		workers[nthreads].id = nthreads;
+		if(pthread_create(&threads[nthreads], NULL, &worker_thread,
+					&workers[nthreads]) != 0)
+		{
+			break;
+		}
+	}
+
+	if(nthreads == 0)
+	{
+		/* No threads, so do all the work here and visit entries afterwards. */
+		w.unbounded = 1;
+		run_worker(&w, 0);
+	}
+
+	run_caller(&w);
+
+	for(i = 0; i < nthreads; ++i)
+	{
+		(void)pthread_join(threads[i], NULL);
+	}
+
+	for(i = 0; i < w.nworkers; ++i)
+	{
+		free(w.deques[i].items);
+		pthread_mutex_destroy(&w.deques[i].lock);
+	}
+	free(w.records);
+	pthread_mutex_destroy(&w.lock);
+	pthread_cond_destroy(&w.work_cv);
+	pthread_cond_destroy(&w.caller_cv);
+	pthread_cond_destroy(&w.space_cv);
+	pthread_mutex_destroy(&w.agg_lock);
+
+	release_workers(w.nworkers);
+
+	if(stats != NULL)
+	{
+		*stats = w.stats;
+	}
+
+	return w.root_failed ? -1 : (w.stopped ? 1 : 0);
+}
+
+/* Passes records to the visitor, reports progress and waits for the walk to
+ * finish. */
+static void
+run_caller(walk_t *w)
+{
+	const pwalk_params_t *const params = w->params;
+	struct timespec deadline;
+
+	set_deadline(&deadline);
+
+	pthread_mutex_lock(&w->lock);
+	while(1)
+	{
+		int i;
+		int cancel;
+		int finished;
+		record_t *records;
+		int nrecords;
+		pwalk_stats_t stats;
+
+		while(w->nrecords == 0 && !w->finished)
+		{
+			if(pthread_cond_timedwait(&w->caller_cv, &w->lock, &deadline) ==
+					ETIMEDOUT)
+			{
+				break;
+			}
+		}
+
+		records = w->records;
+		nrecords = w->nrecords;
+		w->records = NULL;
+		w->nrecords = 0;
+		w->records_cap = 0;
+		pthread_cond_broadcast(&w->space_cv);
+
+		stats = w->stats;
+		finished = w->finished;
+		cancel = w->stopped;
+		pthread_mutex_unlock(&w->lock);
+
+		for(i = 0; i < nrecords; ++i)
+		{
+			if(!cancel && params->visit != NULL)
+			{
+				cancel = params->visit(records[i].path, records[i].type,
+						records[i].size, params->arg);
+			}
+			free(records[i].path);
+		}
+		free(records);
+
+		if(!cancel && !finished && params->progress != NULL &&
+				deadline_passed(&deadline))
+		{
+			cancel = params->progress(&stats, params->arg);
+		}
+		if(deadline_passed(&deadline))
+		{
+			set_deadline(&deadline);
+		}
+
+		pthread_mutex_lock(&w->lock);
+		if(cancel && !w->stopped)
+		{
+			w->stopped = 1;
+			pthread_cond_broadcast(&w->space_cv);
+		}
+		if(finished && w->nrecords == 0)
+		{
+			break;
+		}
+	}
+	pthread_mutex_unlock(&w->lock);
+}
+
+/* Entry point of a worker thread.  Returns NULL. */
+static void *
+worker_thread(void *arg)
+{
+	worker_t *const worker = arg;
+	run_worker(worker->walk, worker->id);
+	return NULL;
+}
+
+/* Processes directories until there are none left. */
+static void
+run_worker(walk_t *w, int id)
+{
+	node_t *node;
+	while((node = take_work(w, id)) != NULL)
+	{
+		scan_dir(w, id, node);
+	}
+}
+
+/* Picks next directory to process: from own deque, by stealing from others or
+ * after waiting for more work to appear.  Returns NULL when the walk is
+ * over. */
+static node_t *
+take_work(walk_t *w, int id)
+{
+	while(1)
+	{
+		int i;
+		int done;
+		node_t *node = deque_pop(&w->deques[id]);
+
+		for(i = 1; i < w->nworkers && node == NULL; ++i)
+		{
+			node = deque_steal(&w->deques[(id + i)%w->nworkers]);
+		}
+
+		pthread_mutex_lock(&w->lock);
+		if(node != NULL)
+		{
+			--w->available;
+			pthread_mutex_unlock(&w->lock);
+			return node;
+		}
+
+		/* Counter can be ahead of deques for a short time, so recheck deques even
+		 * if it's not zero. */
+		while(w->available <= 0 && w->pending > 0)
+		{
+			pthread_cond_wait(&w->work_cv, &w->lock);
+		}
+		done = (w->pending == 0);
+		pthread_mutex_unlock(&w->lock);
+
+		if(done)
+		{
+			return NULL;
+		}
+	}
+}
+
+/* Reads single directory, schedules its subdirectories and accounts sizes of
+ * everything else. */
+static void
+scan_dir(walk_t *w, int id, node_t *node)
+{
+	const pwalk_params_t *const params = w->params;
+	record_t batch[BATCH_SIZE];
+	int n = 0;
+	pwalk_stats_t stats = { .dirs = 0 };
+	uint64_t size = 0U;
+	int stopped;
+	DIR *dir;
+
+	pthread_mutex_lock(&w->lock);
+	stopped = w->stopped;
+	pthread_mutex_unlock(&w->lock);
+
+	dir = stopped ? NULL : os_opendir(node->path);
+	if(dir == NULL && !stopped && node->parent == NULL)
+	{
+		pthread_mutex_lock(&w->lock);
+		w->root_failed = 1;
+		pthread_mutex_unlock(&w->lock);
+	}
+	else if(dir == NULL && !stopped && params->visit != NULL)
+	{
+		batch[n].path = strdup(node->path);
+		batch[n].type = PWE_FAIL;
+		batch[n].size = 0U;
+		n += (batch[n].path != NULL);
+		(void)flush_batch(w, batch, &n, &stats);
+	}
+
+	if(dir != NULL)
+	{
+		const char *const slash = ends_with_slash(node->path) ? "" : "/";
+		struct dirent *d;
+
+		stats.dirs = 1U;
+		if(params->visit != NULL)
+		{
+			batch[n].path = strdup(node->path);
+			batch[n].type = PWE_DIR;
+			batch[n].size = 0U;
+			n += (batch[n].path != NULL);
+		}
+
+		while((d = os_readdir(dir)) != NULL)
+		{
+			char full_path[PATH_MAX];
+			PWalkEntry type;
+			uint64_t entry_size;
+
+			if(is_builtin_dir(d->d_name))
+			{
+				continue;
+			}
+
+			snprintf(full_path, sizeof(full_path), "%s%s%s", node->path, slash,
+					d->d_name);
+
+			if(entry_is_link(full_path, d))
+			{
+				type = PWE_LINK;
+			}
+			else if(entry_is_dir(full_path, d))
+			{
+				node_t *child;
+
+				if(params->lookup != NULL &&
+						params->lookup(full_path, &entry_size, params->arg) == 0)
+				{
+					size += entry_size;
+					stats.bytes += entry_size;
+					continue;
+				}
+
+				child = node_alloc(full_path, node);
+				if(child != NULL)
+				{
+					pthread_mutex_lock(&w->agg_lock);
+					++node->refs;
+					pthread_mutex_unlock(&w->agg_lock);
+					schedule_dir(w, id, child);
+				}
+				continue;
+			}
+			else
+			{
+				type = PWE_FILE;
+			}
+
+			entry_size = get_entry_size(dir, d, full_path);
+			size += entry_size;
+			stats.bytes += entry_size;
+			++stats.files;
+
+			if(params->visit != NULL)
+			{
+				batch[n].path = strdup(full_path);
+				batch[n].type = type;
+				batch[n].size = entry_size;
+				n += (batch[n].path != NULL);
+			}
+
+			if(n == BATCH_SIZE || stats.files%BATCH_SIZE == 0U)
+			{
+				if(flush_batch(w, batch, &n, &stats) != 0)
+				{
+					break;
+				}
+			}
+		}
+		os_closedir(dir);
+
+		(void)flush_batch(w, batch, &n, &stats);
+	}
+
+	complete_dir(w, node, size);
+
+	pthread_mutex_lock(&w->lock);
+	if(--w->pending == 0)
+	{
+		w->finished = 1;
+		pthread_cond_broadcast(&w->work_cv);
+		pthread_cond_signal(&w->caller_cv);
+	}
+	pthread_mutex_unlock(&w->lock);
+}
+
+/* Retrieves size of an entry of the directory without resolving its full path
+ * where possible.  Returns the size or zero on error. */
+static uint64_t
+get_entry_size(DIR *dir, const struct dirent *d, const char full_path[])
+{
+#ifndef _WIN32
+	struct stat st;
+	if(fstatat(dirfd(dir), d->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0)
+	{
+		return (uint64_t)st.st_size;
+	}
+	return 0U;
+#else
+	return get_file_size(full_path);
+#endif
+}
+
+/* Makes directory available for processing by any of the workers. */
+static void
+schedule_dir(walk_t *w, int id, node_t *node)
+{
+	if(deque_push(&w->deques[id], node) != 0)
+	{
+		/* Out of memory, process the directory right away. */
+		pthread_mutex_lock(&w->lock);
+		++w->pending;
+		pthread_mutex_unlock(&w->lock);
+		scan_dir(w, id, node);
+		return;
+	}
+
+	pthread_mutex_lock(&w->lock);
+	++w->pending;
+	++w->available;
+	pthread_cond_signal(&w->work_cv);
+	pthread_mutex_unlock(&w->lock);
+}
+
+/* Publishes collected statistics and entries, might wait for the calling
+ * thread to catch up.  Resets *n and *stats.  Returns non-zero if the walk was
+ * cancelled. */
+static int
+flush_batch(walk_t *w, record_t batch[], int *n, pwalk_stats_t *stats)
+{
+	static const pwalk_stats_t no_stats;
+
+	int stopped;
+	int i;
+
+	pthread_mutex_lock(&w->lock);
+
+	w->stats.bytes += stats->bytes;
+	w->stats.files += stats->files;
+	w->stats.dirs += stats->dirs;
+	*stats = no_stats;
+
+	while(w->nrecords + *n > QUEUE_LIMIT && !w->stopped && !w->unbounded)
+	{
+		pthread_cond_wait(&w->space_cv, &w->lock);
+	}
+
+	i = 0;
+	if(!w->stopped && w->nrecords + *n > w->records_cap)
+	{
+		const int new_cap = MAX(w->records_cap*2, w->nrecords + BATCH_SIZE);
+		record_t *const records = realloc(w->records,
+				sizeof(*records)*new_cap);
+		if(records != NULL)
+		{
+			w->records = records;
+			w->records_cap = new_cap;
+		}
+	}
+	if(!w->stopped)
+	{
+		for(; i < *n && w->nrecords < w->records_cap; ++i)
+		{
+			w->records[w->nrecords++] = batch[i];
+		}
+		if(i != 0)
+		{
+			pthread_cond_signal(&w->caller_cv);
+		}
+	}
+
+	stopped = w->stopped;
+	pthread_mutex_unlock(&w->lock);
+
+	/* Free records that weren't passed over. */
+	for(; i < *n; ++i)
+	{
+		free(batch[i].path);
+	}
+	*n = 0;
+
+	return stopped;
+}
+
+/* Adds size to the directory and propagates result up the tree for all
+ * directories that are done.  Frees nodes of such directories. */
+static void
+complete_dir(walk_t *w, node_t *node, uint64_t size)
+{
+	const pwalk_params_t *const params = w->params;
+
+	while(node != NULL)
+	{
+		node_t *const parent = node->parent;
+		int done;
+		int stopped;
+
+		pthread_mutex_lock(&w->agg_lock);
+		node->size += size;
+		done = (--node->refs == 0);
+		size = node->size;
+		pthread_mutex_unlock(&w->agg_lock);
+
+		if(!done)
+		{
+			break;
+		}
+
+		pthread_mutex_lock(&w->lock);
+		stopped = w->stopped || (parent == NULL && w->root_failed);
+		pthread_mutex_unlock(&w->lock);
+
+		if(!stopped && params->store != NULL)
+		{
+			params->store(node->path, size, params->arg);
+		}
+
+		node_free(node);
+		node = parent;
+	}
+}
+
+/* Allocates node for a directory.  Returns the node or NULL on error. */
+static node_t *
+node_alloc(const char path[], node_t *parent)
+{
+	node_t *const node = malloc(sizeof(*node));
+	if(node == NULL)
+	{
+		return NULL;
+	}
+
+	node->path = strdup(path);
+	if(node->path == NULL)
+	{
+		free(node);
+		return NULL;
+	}
+
+	node->parent = parent;
+	node->size = 0U;
+	node->refs = 1;
+	return node;
+}
+
+/* Frees the node. */
+static void
+node_free(node_t *node)
+{
+	free(node->path);
+	free(node);
+}
+
+/* Appends node to the back of the deque.  Returns zero on success, otherwise
+ * non-zero is returned. */
+static int
+deque_push(deque_t *d, node_t *node)
+{
+	pthread_mutex_lock(&d->lock);
+
+	if(d->tail == d->capacity && d->head != 0)
+	{
+		memmove(d->items, d->items + d->head,
+				sizeof(*d->items)*(d->tail - d->head));
+		d->tail -= d->head;
+		d->head = 0;
+	}
+
+	if(d->tail == d->capacity)
+	{
+		const int new_capacity = MAX(d->capacity*2, 64);
+		node_t **const items = realloc(d->items, sizeof(*items)*new_capacity);
+		if(items == NULL)
+		{
+			pthread_mutex_unlock(&d->lock);
+			return 1;
+		}
+		d->items = items;
+		d->capacity = new_capacity;
+	}
+
+	d->items[d->tail++] = node;
+
+	pthread_mutex_unlock(&d->lock);
+	return 0;
+}
+
+/* Takes the last node from the deque.  Returns the node or NULL if the deque
+ * is empty. */
+static node_t *
+deque_pop(deque_t *d)
+{
+	node_t *node = NULL;
+
+	pthread_mutex_lock(&d->lock);
+	if(d->tail != d->head)
+	{
+		node = d->items[--d->tail];
+		if(d->tail == d->head)
+		{
+			d->head = d->tail = 0;
+		}
+	}
+	pthread_mutex_unlock(&d->lock);
+
+	return node;
+}
+
+/* Takes the first node from the deque.  Nodes closer to the front are closer
+ * to the root and thus are likely to have more work under them.  Returns the
+ * node or NULL if the deque is empty. */
+static node_t *
+deque_steal(deque_t *d)
+{
+	node_t *node = NULL;
+
+	pthread_mutex_lock(&d->lock);
+	if(d->tail != d->head)
+	{
+		node = d->items[d->head++];
+		if(d->tail == d->head)
+		{
+			d->head = d->tail = 0;
+		}
+	}
+	pthread_mutex_unlock(&d->lock);
+
+	return node;
+}
+
+/* Takes up to wanted workers out of the budget shared by all walks, which
+ * keeps concurrent walks (e.g., of several background tasks) from starting
+ * number of CPUs workers each.  Returns number of taken workers, which is at
+ * least one. */
+static int
+reserve_workers(int wanted)
+{
+	const int budget = get_cpu_count();
+	int count;
+
+	pthread_mutex_lock(&budget_lock);
+	count = MIN(wanted, MAX(budget - busy_workers, 1));
+	busy_workers += count;
+	pthread_mutex_unlock(&budget_lock);
+
+	return count;
+}
+
+/* Returns workers taken by reserve_workers() back to the budget. */
+static void
+release_workers(int count)
+{
+	pthread_mutex_lock(&budget_lock);
+	busy_workers -= count;
+	pthread_mutex_unlock(&budget_lock);
+}
+
+/* Retrieves number of online processors.  Returns the number, which is at
+ * least one. */
+static int
+get_cpu_count(void)
+{
+#ifndef _WIN32
+	const long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return (count > 0) ? (int)MIN(count, MAX_WORKERS) : 1;
+#else
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return MAX((int)info.dwNumberOfProcessors, 1);
+#endif
+}
+
+/* Sets *ts to the moment when progress should be reported next time. */
+static void
+set_deadline(struct timespec *ts)
+{
+	struct timeval tv;
+	long nsec;
+
+	(void)gettimeofday(&tv, NULL);
+	nsec = (tv.tv_usec + PROGRESS_INTERVAL_MS*1000L)*1000L;
+	ts->tv_sec = tv.tv_sec + nsec/1000000000L;
+	ts->tv_nsec = nsec%1000000000L;
+}
+
+/* Checks whether the moment specified by *ts has come.  Returns non-zero if
+ * so, otherwise zero is returned. */
+static int
+deadline_passed(const struct timespec *ts)
+{
+	struct timeval tv;
+	(void)gettimeofday(&tv, NULL);
+	return tv.tv_sec > ts->tv_sec
+	    || (tv.tv_sec == ts->tv_sec && tv.tv_usec*1000L >= ts->tv_nsec);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
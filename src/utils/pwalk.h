@@ -0,0 +1,98 @@
+/* vifm
+ * Copyright (C) 2015 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__UTILS__PWALK_H__
+#define VIFM__UTILS__PWALK_H__
+
+#include <stdint.h> /* uint64_t */
+
+/* Parallel walker of file system trees.
+ *
+ * Directories are read by a pool of worker threads.  Each worker has its own
+ * deque of pending directories: it pushes subdirectories it finds to the back
+ * of its deque and takes work from there as well, while idle workers steal
+ * directories from the front of deques of other workers.  Sizes of directories
+ * are accumulated bottom-up, so size of a directory is known as soon as all of
+ * its subdirectories are processed.
+ *
+ * Callbacks that are marked as called on "the calling thread" are invoked only
+ * by the thread that called pwalk(), others can be called concurrently from
+ * worker threads. */
+
+/* Kind of entry passed to a visitor. */
+typedef enum
+{
+	PWE_DIR,  /* Directory that was successfully opened. */
+	PWE_FILE, /* Anything that's neither a directory nor a symbolic link. */
+	PWE_LINK, /* Symbolic link, links to directories aren't followed. */
+	PWE_FAIL, /* Subdirectory that couldn't be opened. */
+}
+PWalkEntry;
+
+/* Statistics of a walk. */
+typedef struct
+{
+	uint64_t bytes; /* Total size of files (including sizes from lookups). */
+	uint64_t files; /* Number of files and symbolic links. */
+	uint64_t dirs;  /* Number of read directories. */
+}
+pwalk_stats_t;
+
+/* Visitor of entries, called on the calling thread.  size is zero for
+ * directories.  Should return non-zero to cancel the walk. */
+typedef int (*pwalk_visit_func)(const char path[], PWalkEntry type,
+		uint64_t size, void *arg);
+
+/* Looks up known size of a subdirectory, which won't be walked if it's found.
+ * Should return zero and set *size on success. */
+typedef int (*pwalk_lookup_func)(const char path[], uint64_t *size, void *arg);
+
+/* Receives size of a directory once it's completely walked.  Not called after
+ * cancellation, so only valid sizes are reported. */
+typedef void (*pwalk_store_func)(const char path[], uint64_t size, void *arg);
+
+/* Reports progress, called periodically on the calling thread.  Should return
+ * non-zero to cancel the walk. */
+typedef int (*pwalk_progress_func)(const pwalk_stats_t *stats, void *arg);
+
+/* Parameters of a walk.  All callbacks are optional. */
+typedef struct
+{
+	int nworkers; /* Maximum number of workers, non-positive for automatic.
+	                 Concurrent walks share a budget of number of CPUs
+	                 workers, but each gets at least one. */
+
+	pwalk_visit_func visit;       /* Visitor of entries. */
+	pwalk_lookup_func lookup;     /* Lookup of known sizes. */
+	pwalk_store_func store;       /* Receiver of calculated sizes. */
+	pwalk_progress_func progress; /* Progress reporter. */
+
+	void *arg; /* Argument for all of the callbacks. */
+}
+pwalk_params_t;
+
+/* Walks directory tree rooted at the path.  Fills *stats, which can be NULL.
+ * Returns zero on success, positive number on cancellation and negative number
+ * if the path can't be read as a directory. */
+int pwalk(const char path[], const pwalk_params_t *params,
+		pwalk_stats_t *stats);
+
+#endif /* VIFM__UTILS__PWALK_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -18,35 +18,67 @@
 
 #include "tree.h"
 
-#include <stdlib.h>
-#include <string.h>
+#include <pthread.h> /* pthread_rwlock_* */
+
+#include <ctype.h> /* tolower() */
+#include <stddef.h> /* NULL size_t */
+#include <stdlib.h> /* free() malloc() */
+#include <string.h> /* memcpy() */
 
-#ifdef _WIN32
-#include "fs.h"
-#endif
-#include "fs_limits.h"
 #include "str.h"
 
+/* Minimal size of a block of arena memory. */
+#define ARENA_BLOCK_SIZE (16*1024)
+/* Alignment of allocations from arena. */
+#define ARENA_ALIGN sizeof(tree_val_t)
+/* Initial size of hash table of children of a node (power of two). */
+#define INITIAL_CHILDREN_CAPACITY 4
+
+/* Block of memory from which nodes and their names are allocated. */
+typedef struct arena_block_t
+{
+	struct arena_block_t *next; /* Previously allocated block. */
+	size_t size;                /* Size of data. */
+	size_t used;                /* Number of used bytes of data. */
+	char *data;                 /* Memory of the block. */
+}
+arena_block_t;
+
+/* Node of the tree, which corresponds to a single path component. */
 typedef struct node_t
 {
-	char *name;
-	size_t name_len;
-	tree_val_t data;
-	int valid;
-	struct node_t *next;
-	struct node_t *child;
-}node_t;
+	const char *name;          /* Name of the component (not terminated). */
+	size_t name_len;           /* Length of the name. */
+	unsigned int hash;         /* Hash of the name. */
+	tree_val_t data;           /* Data associated with the node. */
+	int valid;                 /* Whether data is set. */
+	struct node_t **children;  /* Open addressing hash table of children. */
+	unsigned int nchildren;    /* Number of children. */
+	unsigned int capacity;     /* Size of the children table (power of two). */
+}
+node_t;
 
+/* Root of the tree with its properties. */
 typedef struct root_t
 {
-	node_t node;
-	int longest;
-	int mem;
-}root_t;
+	node_t node;              /* Root node, which corresponds to "/". */
+	int longest;              /* Whether to fallback to longest matching path. */
+	int mem;                  /* Whether data values are pointers to free. */
+	arena_block_t *arena;     /* List of memory blocks for nodes and names. */
+	pthread_rwlock_t lock;    /* Lets readers access the tree concurrently. */
+}
+root_t;
 
-static void nodes_free(node_t *node);
-static node_t * find_node(node_t *root, const char *name, int create,
+static void free_node_data(const root_t *tree, node_t *node);
+static node_t * find_node(root_t *tree, const char path[], int create,
 		node_t **last);
+static unsigned int hash_name(const char name[], size_t len);
+static node_t * find_child(const node_t *node, const char name[], size_t len,
+		unsigned int hash);
+static node_t * add_child(root_t *tree, node_t *node, const char name[],
+		size_t len, unsigned int hash);
+static int grow_children(node_t *node);
+static void * arena_alloc(root_t *tree, size_t size);
 
 tree_t
 tree_create(int longest, int mem)
@@ -58,47 +90,91 @@ tree_create(int longest, int mem)
 		return NULL_TREE;
 	}
 
-	tree->node.child = NULL;
-	tree->node.next = NULL;
+	if(pthread_rwlock_init(&tree->lock, NULL) != 0)
+	{
+		free(tree);
+		return NULL_TREE;
+	}
+
 	tree->node.name = NULL;
+	tree->node.name_len = 0;
+	tree->node.hash = 0;
+	tree->node.data = 0;
 	tree->node.valid = 0;
+	tree->node.children = NULL;
+	tree->node.nchildren = 0;
+	tree->node.capacity = 0;
 	tree->longest = longest;
 	tree->mem = mem;
+	tree->arena = NULL;
 	return tree;
 }
 
 void
 tree_free(tree_t tree)
 {
-	if(tree != NULL_TREE)
+	if(tree == NULL_TREE)
 	{
-		nodes_free(&tree->node);
+		return;
 	}
+
+	free_node_data(tree, &tree->node);
+
+	while(tree->arena != NULL)
+	{
+		arena_block_t *const block = tree->arena;
+		tree->arena = block->next;
+		free(block);
+	}
+
+	pthread_rwlock_destroy(&tree->lock);
+	free(tree);
 }
 
+/* Frees memory owned by the node and all its children, but not nodes
+ * themselves, which are part of the arena. */
 static void
-nodes_free(node_t *node)
+free_node_data(const root_t *tree, node_t *node)
 {
-	if(node->child != NULL)
-		nodes_free(node->child);
+	unsigned int i;
 
-	if(node->next != NULL)
-		nodes_free(node->next);
+	for(i = 0U; i < node->capacity; ++i)
+	{
+		if(node->children[i] != NULL)
+		{
+			free_node_data(tree, node->children[i]);
+		}
+	}
+	free(node->children);
 
-	free(node->name);
-	free(node);
+	if(node->valid && tree->mem)
+	{
+		union
+		{
+			tree_val_t l;
+			void *p;
+		}u = {
+			.l = node->data,
+		};
+
+		free(u.p);
+	}
 }
 
 int
 tree_set_data(tree_t tree, const char *path, tree_val_t data)
 {
 	node_t *node;
-	char real_path[PATH_MAX];
 
-	if(realpath(path, real_path) != real_path)
+	pthread_rwlock_wrlock(&tree->lock);
+
+	node = find_node(tree, path, 1, NULL);
+	if(node == NULL)
+	{
+		pthread_rwlock_unlock(&tree->lock);
 		return -1;
+	}
 
-	node = find_node(&tree->node, real_path, 1, NULL);
 	if(node->valid && tree->mem)
 	{
 		union
@@ -113,6 +189,8 @@ tree_set_data(tree_t tree, const char *path, tree_val_t data)
 	}
 	node->data = data;
 	node->valid = 1;
+
+	pthread_rwlock_unlock(&tree->lock);
 	return 0;
 }
 
@@ -121,83 +199,215 @@ tree_get_data(tree_t tree, const char *path, tree_val_t *data)
 {
 	node_t *last = NULL;
 	node_t *node;
-	char real_path[PATH_MAX];
-
-	if(tree->node.child == NULL)
-		return -1;
+	int result = 0;
 
-	if(realpath(path, real_path) != real_path)
-		return -1;
-
-	node = find_node(&tree->node, real_path, 0, tree->longest ? &last : NULL);
-	if((node == NULL || !node->valid) && last == NULL)
-		return -1;
+	pthread_rwlock_rdlock(&tree->lock);
 
+	node = find_node(tree, path, 0, tree->longest ? &last : NULL);
 	if(node != NULL && node->valid)
 		*data = node->data;
-	else
+	else if(last != NULL)
 		*data = last->data;
-	return 0;
+	else
+		result = -1;
+
+	pthread_rwlock_unlock(&tree->lock);
+	return result;
 }
 
+/* Looks up node that corresponds to the path optionally creating missing
+ * nodes.  When last isn't NULL, it's set to the deepest valid node on the way.
+ * Returns the node or NULL if it doesn't exist or can't be created. */
 static node_t *
-find_node(node_t *root, const char *name, int create, node_t **last)
+find_node(root_t *tree, const char path[], int create, node_t **last)
 {
-	const char *end;
-	size_t name_len;
-	node_t *prev = NULL, *curr;
-	node_t *new_node;
-
-	name = skip_char(name, '/');
-	if(*name == '\0')
-		return root;
+	node_t *node = &tree->node;
 
-	end = until_first(name, '/');
+	if(node->valid && last != NULL)
+		*last = node;
 
-	name_len = end - name;
-	curr = root->child;
-	while(curr != NULL)
+	while(1)
 	{
-		int comp = strnoscmp(name, curr->name, name_len);
-		if(comp == 0 && curr->name_len == name_len)
+		const char *end;
+		size_t len;
+		unsigned int hash;
+		node_t *child;
+
+		path = skip_char(path, '/');
+		if(*path == '\0')
+			return node;
+
+		end = until_first(path, '/');
+		len = end - path;
+		hash = hash_name(path, len);
+
+		child = find_child(node, path, len, hash);
+		if(child == NULL)
 		{
-			if(curr->valid && last != NULL)
-				*last = curr;
-			return find_node(curr, end, create, last);
+			if(!create)
+				return NULL;
+
+			child = add_child(tree, node, path, len, hash);
+			if(child == NULL)
+				return NULL;
 		}
-		else if(comp < 0)
+
+		if(child->valid && last != NULL)
+			*last = child;
+
+		node = child;
+		path = end;
+	}
+}
+
+/* Computes hash of a path component consistently with comparison of names
+ * (FNV-1a).  Returns the hash. */
+static unsigned int
+hash_name(const char name[], size_t len)
+{
+	unsigned int hash = 2166136261U;
+	size_t i;
+	for(i = 0U; i < len; ++i)
+	{
+#ifndef _WIN32
+		hash ^= (unsigned char)name[i];
+#else
+		hash ^= (unsigned char)tolower((unsigned char)name[i]);
+#endif
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
+/* Finds child of the node by its name.  Returns the child or NULL. */
+static node_t *
+find_child(const node_t *node, const char name[], size_t len,
+		unsigned int hash)
+{
+	unsigned int i;
+
+	if(node->capacity == 0U)
+		return NULL;
+
+	for(i = hash & (node->capacity - 1U); node->children[i] != NULL;
+			i = (i + 1U) & (node->capacity - 1U))
+	{
+		node_t *const child = node->children[i];
+		if(child->hash == hash && child->name_len == len &&
+				strnoscmp(child->name, name, len) == 0)
 		{
-			break;
+			return child;
 		}
-		prev = curr;
-		curr = curr->next;
 	}
 
-	if(!create)
+	return NULL;
+}
+
+/* Creates new child of the node.  Returns the child or NULL on error. */
+static node_t *
+add_child(root_t *tree, node_t *node, const char name[], size_t len,
+		unsigned int hash)
+{
+	node_t *child;
+	char *child_name;
+	unsigned int i;
+
+	/* Keep load factor of the table below 3/4. */
+	if(4U*(node->nchildren + 1U) > 3U*node->capacity && grow_children(node) != 0)
 		return NULL;
 
-	new_node = malloc(sizeof(*new_node));
-	if(new_node == NULL)
+	child = arena_alloc(tree, sizeof(*child));
+	child_name = arena_alloc(tree, len);
+	if(child == NULL || child_name == NULL)
 		return NULL;
 
-	if((new_node->name = malloc(name_len + 1)) == NULL)
+	memcpy(child_name, name, len);
+	child->name = child_name;
+	child->name_len = len;
+	child->hash = hash;
+	child->data = 0;
+	child->valid = 0;
+	child->children = NULL;
+	child->nchildren = 0U;
+	child->capacity = 0U;
+
+	i = hash & (node->capacity - 1U);
+	while(node->children[i] != NULL)
 	{
-		free(new_node);
-		return NULL;
+		i = (i + 1U) & (node->capacity - 1U);
+	}
+	node->children[i] = child;
+	++node->nchildren;
+
+	return child;
+}
+
+/* Doubles size of hash table of children of the node.  Returns zero on
+ * success, otherwise non-zero is returned. */
+static int
+grow_children(node_t *node)
+{
+	const unsigned int capacity = (node->capacity == 0U)
+	                            ? INITIAL_CHILDREN_CAPACITY
+	                            : node->capacity*2U;
+	node_t **const children = calloc(capacity, sizeof(*children));
+	unsigned int i;
+
+	if(children == NULL)
+		return 1;
+
+	for(i = 0U; i < node->capacity; ++i)
+	{
+		node_t *const child = node->children[i];
+		if(child != NULL)
+		{
+			unsigned int j = child->hash & (capacity - 1U);
+			while(children[j] != NULL)
+			{
+				j = (j + 1U) & (capacity - 1U);
+			}
+			children[j] = child;
+		}
+	}
+
+	free(node->children);
+	node->children = children;
+	node->capacity = capacity;
+	return 0;
+}
+
+/* Allocates memory that lives as long as the tree.  Returns pointer to the
+ * memory or NULL on error. */
+static void *
+arena_alloc(root_t *tree, size_t size)
+{
+	arena_block_t *block = tree->arena;
+	void *ptr;
+
+	size = (size + ARENA_ALIGN - 1U)/ARENA_ALIGN*ARENA_ALIGN;
+
+	if(block == NULL || block->size - block->used < size)
+	{
+		const size_t block_size = (size > ARENA_BLOCK_SIZE)
+		                        ? size
+		                        : ARENA_BLOCK_SIZE;
+		const size_t header_size = (sizeof(*block) + ARENA_ALIGN - 1U)
+		                         /ARENA_ALIGN*ARENA_ALIGN;
+
+		block = malloc(header_size + block_size);
+		if(block == NULL)
+			return NULL;
+
+		block->next = tree->arena;
+		block->size = block_size;
+		block->used = 0U;
+		block->data = (char *)block + header_size;
+		tree->arena = block;
 	}
-	strncpy(new_node->name, name, name_len);
-	new_node->name[name_len] = '\0';
-	new_node->name_len = name_len;
-	new_node->valid = 0;
-	new_node->child = NULL;
-	new_node->next = curr;
-
-	if(root->child == curr)
-		root->child = new_node;
-	else
-		prev->next = new_node;
 
-	return find_node(new_node, end, create, last);
+	ptr = block->data + block->used;
+	block->used += size;
+	return ptr;
 }
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
@@ -38,6 +38,13 @@ tree_t tree_create(int longest, int mem);
  * true. Freeing of NULL_TREE tree is OK. */
 void tree_free(tree_t tree);
 
+/* Paths are used as is, no symbolic links are resolved, so callers that need
+ * it should canonicalize paths themselves.  Repeated and trailing slashes are
+ * ignored.
+ *
+ * Functions below can be called from multiple threads: lookups run
+ * concurrently with each other, while updates are exclusive. */
+
 /* Returns non-zero on error. */
 int tree_set_data(tree_t tree, const char *path, tree_val_t data);
 
@@ -207,10 +207,14 @@ int format_help_cmd(char cmd[], size_t cmd_size);
  * terminal. */
 void display_help(const char cmd[]);
 
-/* Updates dir_mtime field of the view.  Returns zero on success, otherwise
- * non-zero is returned. */
+/* Updates dir_mtime field of the view (and directory watcher on *nix).  Returns
+ * zero on success, otherwise non-zero is returned. */
 int update_dir_mtime(FileView *view);
 
+/* Forgets state of directory recorded by update_dir_mtime(), so that next check
+ * for changes reports that the directory was changed. */
+void reset_dir_mtime(FileView *view);
+
 /* Suspends process until external signal comes. */
 void wait_for_signal(void);
 
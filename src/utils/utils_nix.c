@@ -32,6 +32,8 @@
 #include <sys/wait.h> /* waitpid */
 #include <fcntl.h> /* open() close() */
 #include <grp.h> /* getgrnam() getgrgid_r() */
+#include <poll.h> /* POLLERR POLLNVAL POLLPRI poll() pollfd */
+#include <pthread.h> /* PTHREAD_MUTEX_INITIALIZER pthread_mutex_* */
 #include <pwd.h> /* getpwnam() getpwuid_r() */
 #include <unistd.h> /* X_OK dup() dup2() getpid() pause() */
 
@@ -44,7 +46,7 @@
 #include <stddef.h> /* NULL size_t */
 #include <stdio.h> /* FILE stderr fdopen() fprintf() snprintf() */
 #include <stdlib.h> /* atoi() free() malloc() */
-#include <string.h> /* strchr() strdup() strlen() strncmp() */
+#include <string.h> /* memset() strchr() strdup() strlen() strncmp() */
 
 #include "../cfg/config.h"
 #include "../compat/os.h"
@@ -60,9 +62,14 @@
 #include "mntent.h" /* mntent setmntent() getmntent() endmntent() */
 #include "path.h"
 #include "str.h"
+#include "tree.h"
 #include "utils.h"
 
-/* Types of mount point information for get_mount_point_traverser_state. */
+/* File that lists mount points of the process on Linux.  The kernel signals
+ * changes of the list by raising POLLPRI on its descriptor. */
+#define PROC_MOUNTS "/proc/self/mounts"
+
+/* Types of mount point information for get_mount_info(). */
 typedef enum
 {
 	MI_MOUNT_POINT, /* Path to the mount point. */
@@ -70,25 +77,30 @@ typedef enum
 }
 mntinfo;
 
-/* State for get_mount_point() traverser. */
-typedef struct
-{
-	mntinfo type;     /* Type of information to put into the buffer. */
-	const char *path; /* Path whose mount point we're looking for. */
-	size_t buf_len;   /* Output buffer length. */
-	char *buf;        /* Output buffer. */
-	size_t curr_len;  /* Max length among all found points (len of buf string). */
-}
-get_mount_point_traverser_state;
-
-static int get_mount_info_traverser(struct mntent *entry, void *arg);
+static int get_mount_info(const char path[], mntinfo type, size_t buf_len,
+		char buf[]);
+static void update_mount_table(void);
+static int mount_table_changed(void);
+static tree_t index_mnt_entries(const struct mntent *entries,
+		unsigned int nentries);
 static void free_mnt_entries(struct mntent *entries, unsigned int nentries);
-struct mntent * read_mnt_entries(unsigned int *nentries);
+static struct mntent * read_mnt_entries(const char path[],
+		unsigned int *nentries);
 static int clone_mnt_entry(struct mntent *lhs, const struct mntent *rhs);
 static void free_mnt_entry(struct mntent *entry);
 static int starts_with_list_item(const char str[], const char list[]);
 static int find_path_prefix_index(const char path[], const char list[]);
 
+/* Cached mount entries in the order of the mount table. */
+static struct mntent *mnt_entries;
+/* Number of elements in mnt_entries array. */
+static unsigned int mnt_nentries;
+/* Maps mount points to indexes of mnt_entries with longest path match. */
+static tree_t mnt_index = NULL_TREE;
+/* Protects all of the above, because lookups are done from background
+ * threads. */
+static pthread_mutex_t mnt_lock = PTHREAD_MUTEX_INITIALIZER;
+
 void
 pause_shell(void)
 {
@@ -372,14 +384,6 @@ int
 is_on_slow_fs(const char full_path[])
 {
 	char fs_name[PATH_MAX];
-	get_mount_point_traverser_state state =
-	{
-		.type = MI_FS_TYPE,
-		.path = full_path,
-		.buf_len = sizeof(fs_name),
-		.buf = fs_name,
-		.curr_len = 0UL,
-	};
 
 	/* Empty list optimization. */
 	if(cfg.slow_fs_list[0] == '\0')
@@ -387,14 +391,11 @@ is_on_slow_fs(const char full_path[])
 		return 0;
 	}
 
-	if(traverse_mount_points(&get_mount_info_traverser, &state) == 0)
+	if(get_mount_info(full_path, MI_FS_TYPE, sizeof(fs_name), fs_name) == 0)
 	{
-		if(state.curr_len > 0)
+		if(starts_with_list_item(fs_name, cfg.slow_fs_list))
 		{
-			if(starts_with_list_item(fs_name, cfg.slow_fs_list))
-			{
-				return 1;
-			}
+			return 1;
 		}
 	}
 
@@ -404,77 +405,169 @@ is_on_slow_fs(const char full_path[])
 int
 get_mount_point(const char path[], size_t buf_len, char buf[])
 {
-	get_mount_point_traverser_state state =
-	{
-		.type = MI_MOUNT_POINT,
-		.path = path,
-		.buf_len = buf_len,
-		.buf = buf,
-		.curr_len = 0UL,
-	};
-	return traverse_mount_points(&get_mount_info_traverser, &state);
+	return get_mount_info(path, MI_MOUNT_POINT, buf_len, buf);
 }
 
-/* traverse_mount_points client that gets mount point info for a given path. */
+/* Fills the buf with information of the given type about the mount point on
+ * which the path resides.  Returns zero on success, otherwise non-zero is
+ * returned. */
 static int
-get_mount_info_traverser(struct mntent *entry, void *arg)
+get_mount_info(const char path[], mntinfo type, size_t buf_len, char buf[])
 {
-	get_mount_point_traverser_state *const state = arg;
-	if(path_starts_with(state->path, entry->mnt_dir))
+	tree_val_t i;
+	int result = 1;
+
+	pthread_mutex_lock(&mnt_lock);
+
+	update_mount_table();
+
+	if(mnt_index != NULL_TREE && tree_get_data(mnt_index, path, &i) == 0)
 	{
-		const size_t new_len = strlen(entry->mnt_dir);
-		if(new_len > state->curr_len)
+		const struct mntent *const entry = &mnt_entries[i];
+		switch(type)
 		{
-			state->curr_len = new_len;
-			switch(state->type)
-			{
-				case MI_MOUNT_POINT:
-					copy_str(state->buf, state->buf_len, entry->mnt_dir);
-					break;
-				case MI_FS_TYPE:
-					copy_str(state->buf, state->buf_len, entry->mnt_type);
-					break;
-
-				default:
-					assert(0 && "Unknown mount information type.");
-					break;
-			}
+			case MI_MOUNT_POINT:
+				copy_str(buf, buf_len, entry->mnt_dir);
+				break;
+			case MI_FS_TYPE:
+				copy_str(buf, buf_len, entry->mnt_type);
+				break;
+
+			default:
+				assert(0 && "Unknown mount information type.");
+				break;
 		}
+		result = 0;
 	}
-	return 0;
+
+	pthread_mutex_unlock(&mnt_lock);
+
+	return result;
 }
 
 int
 traverse_mount_points(mptraverser client, void *arg)
 {
-	/* Cached mount entries, updated only when /etc/mtab changes. */
+	unsigned int i;
+	int result;
+
+	pthread_mutex_lock(&mnt_lock);
+
+	update_mount_table();
+
+	result = (mnt_nentries == 0U);
+	for(i = 0U; i < mnt_nentries; ++i)
+	{
+		if(client(&mnt_entries[i], arg) != 0)
+		{
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&mnt_lock);
+
+	return result;
+}
+
+/* Re-reads mount table if it has changed since the last time it was read.
+ * Should be called with mnt_lock held. */
+static void
+update_mount_table(void)
+{
+	if(!mount_table_changed())
+	{
+		return;
+	}
+
+	tree_free(mnt_index);
+	free_mnt_entries(mnt_entries, mnt_nentries);
+
+	mnt_entries = read_mnt_entries(PROC_MOUNTS, &mnt_nentries);
+	if(mnt_entries == NULL)
+	{
+		mnt_entries = read_mnt_entries("/etc/mtab", &mnt_nentries);
+	}
+	mnt_index = index_mnt_entries(mnt_entries, mnt_nentries);
+}
+
+/* Checks whether mount table might have changed since the last call.  Polls
+ * descriptor of PROC_MOUNTS for POLLPRI where it's available and falls back to
+ * checking modification time of /etc/mtab otherwise.  Returns non-zero if so,
+ * otherwise zero is returned. */
+static int
+mount_table_changed(void)
+{
+	static int initialized;
+	static int mounts_fd = -1;
 	static filemon_t mtab_mon;
-	static struct mntent *entries;
-	static unsigned int nentries;
 
 	filemon_t mon;
-	unsigned int i;
 
-	/* Check for cache validity. */
-	if(filemon_from_file("/etc/mtab", &mon) != 0 ||
-			!filemon_equal(&mon, &mtab_mon))
+	if(!initialized)
+	{
+		/* The descriptor is opened before the table is read, so changes made in
+		 * between are not missed. */
+		mounts_fd = open(PROC_MOUNTS, O_RDONLY | O_CLOEXEC);
+		if(mounts_fd == -1)
+		{
+			(void)filemon_from_file("/etc/mtab", &mtab_mon);
+		}
+		initialized = 1;
+		return 1;
+	}
+
+	if(mounts_fd != -1)
 	{
-		filemon_assign(&mtab_mon, &mon);
-		free_mnt_entries(entries, nentries);
-		entries = read_mnt_entries(&nentries);
+		struct pollfd pfd = { .fd = mounts_fd, .events = POLLPRI };
+		if(poll(&pfd, 1, 0) < 0)
+		{
+			return 1;
+		}
+		return (pfd.revents & (POLLPRI | POLLERR | POLLNVAL)) != 0;
 	}
 
-	if(nentries == 0U)
+	if(filemon_from_file("/etc/mtab", &mon) != 0)
 	{
 		return 1;
 	}
+	if(filemon_equal(&mon, &mtab_mon))
+	{
+		return 0;
+	}
+	filemon_assign(&mtab_mon, &mon);
+	return 1;
+}
+
+/* Builds index of mount points for lookup by longest path prefix.  When the
+ * same directory is listed several times, the first entry wins.  Returns the
+ * index or NULL_TREE on error or when there are no entries. */
+static tree_t
+index_mnt_entries(const struct mntent *entries, unsigned int nentries)
+{
+	unsigned int i;
+	tree_t index;
+
+	if(nentries == 0U || (index = tree_create(1, 0)) == NULL_TREE)
+	{
+		return NULL_TREE;
+	}
 
-	for(i = 0; i < nentries; ++i)
+	for(i = nentries; i-- > 0U; )
 	{
-		client(&entries[i], arg);
+		/* Entries like "none" of swap aren't paths. */
+		if(entries[i].mnt_dir[0] != '/')
+		{
+			continue;
+		}
+
+		if(tree_set_data(index, entries[i].mnt_dir, i) != 0)
+		{
+			tree_free(index);
+			return NULL_TREE;
+		}
 	}
 
-	return 0;
+	return index;
 }
 
 /* Frees array of mount entries. */
@@ -491,10 +584,11 @@ free_mnt_entries(struct mntent *entries, unsigned int nentries)
 	free(entries);
 }
 
-/* Reads in array of mount entries.  Always sets *nentries.  Returns the array,
- * which might be NULL if empty.  On memory allocation error, skips entries. */
-struct mntent *
-read_mnt_entries(unsigned int *nentries)
+/* Reads in array of mount entries from file at the path.  Always sets
+ * *nentries.  Returns the array, which might be NULL if empty.  On memory
+ * allocation error, skips entries. */
+static struct mntent *
+read_mnt_entries(const char path[], unsigned int *nentries)
 {
 	FILE *f;
 	struct mntent *entries = NULL;
@@ -502,7 +596,7 @@ read_mnt_entries(unsigned int *nentries)
 
 	*nentries = 0U;
 
-	if((f = setmntent("/etc/mtab", "r")) == NULL)
+	if((f = setmntent(path, "r")) == NULL)
 	{
 		return NULL;
 	}
@@ -712,9 +806,26 @@ display_help(const char cmd[])
 int
 update_dir_mtime(FileView *view)
 {
+	/* Pending events describe changes that are about to be loaded.  Watcher is
+	 * recreated if it can't be reused for the current path. */
+	if(view->watch == NULL ||
+			filemon_watch_reset(view->watch, view->curr_dir) != 0)
+	{
+		filemon_watch_free(view->watch);
+		view->watch = filemon_watch_create(view->curr_dir);
+	}
+
 	return filemon_from_file(view->curr_dir, &view->mon);
 }
 
+void
+reset_dir_mtime(FileView *view)
+{
+	filemon_watch_free(view->watch);
+	view->watch = NULL;
+	memset(&view->mon, 0, sizeof(view->mon));
+}
+
 void
 wait_for_signal(void)
 {
@@ -33,7 +33,7 @@
 #include <stddef.h> /* NULL size_t */
 #include <stdint.h> /* uint32_t */
 #include <stdlib.h> /* EXIT_SUCCESS free() */
-#include <string.h> /* strcat() strchr() strcpy() strlen() */
+#include <string.h> /* memset() strcat() strchr() strcpy() strlen() */
 #include <stdio.h> /* FILE SEEK_SET fread() fclose() snprintf() */
 
 #include "../cfg/config.h"
@@ -698,6 +698,12 @@ update_dir_mtime(FileView *view)
 	return 0;
 }
 
+void
+reset_dir_mtime(FileView *view)
+{
+	memset(&view->dir_mtime, 0, sizeof(view->dir_mtime));
+}
+
 void
 wait_for_signal(void)
 {
@@ -86,7 +86,6 @@
 #include "vim.h"
 
 static int pair_in_use(short int pair);
-static void move_pair(short int from, short int to);
 static int undo_perform_func(OPS op, void *data, const char src[],
 		const char dst[]);
 static void parse_received_arguments(char *args[]);
@@ -207,9 +206,7 @@ main(int argc, char *argv[])
 			.max_color_pairs = COLOR_PAIRS,
 			.max_colors = COLORS,
 			.init_pair = &init_pair,
-			.pair_content = &pair_content,
 			.pair_in_use = &pair_in_use,
-			.move_pair = &move_pair,
 		};
 		colmgr_init(&colmgr_conf);
 	}
@@ -294,28 +291,6 @@ pair_in_use(short int pair)
 	return 0;
 }
 
-/* Substitutes old pair number with the new one. */
-static void
-move_pair(short int from, short int to)
-{
-	int i;
-	for(i = 0; i < MAXNUM_COLOR; ++i)
-	{
-		if(cfg.cs.pair[i] == from)
-		{
-			cfg.cs.pair[i] = to;
-		}
-		if(lwin.cs.pair[i] == from)
-		{
-			lwin.cs.pair[i] = to;
-		}
-		if(rwin.cs.pair[i] == from)
-		{
-			rwin.cs.pair[i] = to;
-		}
-	}
-}
-
 /* perform_operation() interface adaptor for the undo unit. */
 static int
 undo_perform_func(OPS op, void *data, const char src[], const char dst[])
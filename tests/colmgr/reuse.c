@@ -0,0 +1,79 @@
+#include <stic.h>
+
+#include "../../src/color_manager.h"
+
+#include "test.h"
+
+SETUP()
+{
+	colmgr_reset();
+}
+
+TEST(pairs_are_found_after_index_growth)
+{
+	int pairs[CUSTOM_COLOR_PAIRS];
+	int i;
+
+	for(i = 0; i < CUSTOM_COLOR_PAIRS; ++i)
+	{
+		pairs[i] = colmgr_get_pair(INUSE_SEED, i);
+		assert_true(pairs[i] != 0);
+	}
+
+	init_pair_calls = 0;
+	for(i = 0; i < CUSTOM_COLOR_PAIRS; ++i)
+	{
+		assert_int_equal(pairs[i], colmgr_get_pair(INUSE_SEED, i));
+	}
+	assert_int_equal(0, init_pair_calls);
+}
+
+TEST(recently_used_pairs_survive_compression)
+{
+	int first, last;
+	int i;
+
+	for(i = 0; i < CUSTOM_COLOR_PAIRS; ++i)
+	{
+		(void)colmgr_get_pair(UNUSED_SEED, i);
+	}
+
+	/* Make first pair the most recently used one. */
+	first = colmgr_get_pair(UNUSED_SEED, 0);
+	last = colmgr_get_pair(UNUSED_SEED, CUSTOM_COLOR_PAIRS - 1);
+
+	assert_true(colmgr_get_pair(INUSE_SEED, 0) != 0);
+
+	init_pair_calls = 0;
+	assert_int_equal(first, colmgr_get_pair(UNUSED_SEED, 0));
+	assert_int_equal(last, colmgr_get_pair(UNUSED_SEED, CUSTOM_COLOR_PAIRS - 1));
+	assert_int_equal(0, init_pair_calls);
+
+	/* Least recently used pair was freed. */
+	assert_true(colmgr_get_pair(UNUSED_SEED, 1) != 0);
+	assert_int_equal(1, init_pair_calls);
+}
+
+TEST(pairs_in_use_survive_compression)
+{
+	int in_use;
+	int i;
+
+	in_use = colmgr_get_pair(INUSE_SEED, 0);
+	for(i = 0; i < CUSTOM_COLOR_PAIRS - 1; ++i)
+	{
+		(void)colmgr_get_pair(UNUSED_SEED, i);
+	}
+
+	for(i = 0; i < CUSTOM_COLOR_PAIRS - 1; ++i)
+	{
+		assert_true(colmgr_get_pair(INUSE_SEED, 1 + i) != 0);
+	}
+
+	init_pair_calls = 0;
+	assert_int_equal(in_use, colmgr_get_pair(INUSE_SEED, 0));
+	assert_int_equal(0, init_pair_calls);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
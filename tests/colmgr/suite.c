@@ -6,12 +6,12 @@
 #include "test.h"
 
 static int init_pair(short pair, short f, short b);
-static int pair_content(short pair, short *f, short *b);
 static int pair_in_use(short int pair);
-static void move_pair(short int from, short int to);
 
 static int colors[TOTAL_COLOR_PAIRS][2];
 
+int init_pair_calls;
+
 DEFINE_SUITE();
 
 SETUP()
@@ -26,9 +26,7 @@ SETUP_ONCE()
 		.max_color_pairs = ARRAY_LEN(colors),
 		.max_colors = 8,
 		.init_pair = &init_pair,
-		.pair_content = &pair_content,
 		.pair_in_use = &pair_in_use,
-		.move_pair = &move_pair,
 	};
 	colmgr_init(&colmgr_conf);
 }
@@ -38,14 +36,7 @@ init_pair(short pair, short f, short b)
 {
 	colors[pair][0] = f;
 	colors[pair][1] = b;
-	return 0;
-}
-
-static int
-pair_content(short pair, short *f, short *b)
-{
-	*f = colors[pair][0];
-	*b = colors[pair][1];
+	++init_pair_calls;
 	return 0;
 }
 
@@ -55,14 +46,5 @@ pair_in_use(short int pair)
 	return colors[pair][0] == INUSE_SEED;
 }
 
-static void
-move_pair(short int from, short int to)
-{
-	colors[to][0] = colors[from][0];
-	colors[to][1] = colors[from][1];
-
-	colors[from][0] = UNUSED_SEED;
-}
-
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 : */
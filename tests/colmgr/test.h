@@ -8,6 +8,9 @@
 #define UNUSED_SEED 99
 #define INUSE_SEED 999
 
+/* Number of times init_pair() was called. */
+extern int init_pair_calls;
+
 #endif /* VIFM_TESTS__COLMGR__TEST_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
@@ -0,0 +1,124 @@
+#include <stic.h>
+
+#include <sys/time.h> /* gettimeofday() timeval */
+
+#include <stddef.h> /* NULL */
+#include <stdint.h> /* uint64_t */
+
+#include "../../src/io/private/ioeta.h"
+#include "../../src/io/ioeta.h"
+#include "../../src/io/iolimit.h"
+
+static int cancel_now(void *arg);
+static uint64_t get_time_ms(void);
+
+static iolimit_t *limit;
+
+SETUP()
+{
+	limit = iolimit_alloc();
+	assert_non_null(limit);
+}
+
+TEARDOWN()
+{
+	iolimit_free(limit);
+	limit = NULL;
+}
+
+TEST(no_limit_means_no_waiting)
+{
+	const uint64_t start = get_time_ms();
+	iolimit_consume(limit, 100U*1024U*1024U, 1000U, NULL, NULL);
+	assert_true(get_time_ms() - start < 50U);
+}
+
+TEST(rates_can_be_changed)
+{
+	uint64_t bytes_rate, files_rate;
+
+	iolimit_set(limit, 10U, 20U);
+	iolimit_get(limit, &bytes_rate, &files_rate);
+	assert_int_equal(10, bytes_rate);
+	assert_int_equal(20, files_rate);
+}
+
+TEST(bytes_over_the_limit_cause_waiting)
+{
+	const uint64_t start = get_time_ms();
+	iolimit_set(limit, 10000U, 0U);
+	iolimit_consume(limit, 2000U, 0U, NULL, NULL);
+	assert_true(get_time_ms() - start >= 150U);
+}
+
+TEST(files_over_the_limit_cause_waiting)
+{
+	const uint64_t start = get_time_ms();
+	iolimit_set(limit, 0U, 20U);
+	iolimit_consume(limit, 0U, 4U, NULL, NULL);
+	assert_true(get_time_ms() - start >= 150U);
+}
+
+TEST(cancellation_stops_waiting)
+{
+	int checked = 0;
+
+	/* Would take days without cancellation. */
+	iolimit_set(limit, 1U, 0U);
+	iolimit_consume(limit, 1000000U, 0U, &cancel_now, &checked);
+	assert_true(checked);
+}
+
+TEST(skipped_progress_is_not_limited)
+{
+	ioeta_estim_t *const estim = ioeta_alloc(NULL);
+
+	/* Would take days if the bytes were charged. */
+	estim->limit = limit;
+	iolimit_set(limit, 1U, 1U);
+
+	ioeta_update_skipped(estim, "a", "b", 1, 1000000U);
+	ioeta_update_skipped(estim, "a", "b", 1, 1000000U);
+	assert_int_equal(2000000U, estim->current_byte);
+
+	ioeta_free(estim);
+}
+
+TEST(progress_updates_are_limited)
+{
+	ioeta_estim_t *const estim = ioeta_alloc(NULL);
+	const uint64_t start = get_time_ms();
+
+	estim->limit = limit;
+	iolimit_set(limit, 0U, 20U);
+
+	ioeta_update(estim, "a", "b", 1, 0U);
+	ioeta_update(estim, "a", "b", 1, 0U);
+	ioeta_update(estim, "a", "b", 1, 0U);
+	ioeta_update(estim, "a", "b", 1, 0U);
+	assert_true(get_time_ms() - start >= 150U);
+
+	ioeta_free(estim);
+}
+
+/* Cancels waiting on the first check and records that it was done.  Returns
+ * non-zero. */
+static int
+cancel_now(void *arg)
+{
+	int *const checked = arg;
+	*checked = 1;
+	return 1;
+}
+
+/* Retrieves current time.  Returns the time in milliseconds. */
+static uint64_t
+get_time_ms(void)
+{
+	struct timeval tv;
+	(void)gettimeofday(&tv, NULL);
+	return (uint64_t)tv.tv_sec*1000U + tv.tv_usec/1000U;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
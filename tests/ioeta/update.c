@@ -1,19 +1,35 @@
 #include <stic.h>
 
+#include <pthread.h> /* pthread_create() pthread_join() */
+
 #include <stddef.h> /* NULL */
+#include <stdint.h> /* uint64_t */
 
 #include "../../src/io/private/ioeta.h"
 #include "../../src/io/ioeta.h"
+#include "../../src/io/ionotif.h"
+
+static void progress_changed(const io_progress_t *const progress);
+static void * update_in_thread(void *arg);
+static uint64_t fake_clock(void);
 
 static ioeta_estim_t *estim;
+static int notified;
+/* Time returned by fake_clock(). */
+static uint64_t now;
 
 SETUP()
 {
 	estim = ioeta_alloc(NULL);
+
+	now = 1000000U;
+	ioeta_set_clock(&fake_clock);
 }
 
 TEARDOWN()
 {
+	ioeta_set_clock(NULL);
+
 	ioeta_free(estim);
 	estim = NULL;
 }
@@ -100,5 +116,99 @@ TEST(finished_update_increments_current_item)
 	assert_int_equal(prev + 1, estim->current_item);
 }
 
+TEST(progress_notifications_are_throttled)
+{
+	ionotif_register(&progress_changed);
+
+	ioeta_add_item(estim, "a");
+	ioeta_add_item(estim, "b");
+	now += 1000000U;
+	notified = 0;
+
+	ioeta_update(estim, "a", "x", 0, 10);
+	assert_int_equal(1, notified);
+	ioeta_update(estim, NULL, NULL, 0, 10);
+	ioeta_update(estim, NULL, NULL, 1, 0);
+	ioeta_update(estim, "b", "y", 0, 10);
+	assert_int_equal(1, notified);
+	assert_string_equal("b", estim->item);
+	assert_int_equal(30, estim->current_byte);
+
+	now += 1000000U;
+	ioeta_update(estim, NULL, NULL, 0, 10);
+	assert_int_equal(2, notified);
+
+	/* Completion of the last item is always reported. */
+	ioeta_update(estim, NULL, NULL, 1, 0);
+	assert_int_equal(3, notified);
+
+	ionotif_register(NULL);
+}
+
+TEST(estimation_notifications_are_throttled)
+{
+	ionotif_register(&progress_changed);
+	notified = 0;
+
+	ioeta_add_item(estim, "a");
+	ioeta_add_dir(estim, "dir");
+	ioeta_add_item(estim, "b");
+	assert_int_equal(1, notified);
+	assert_int_equal(2, estim->total_items);
+
+	now += 1000000U;
+	ioeta_add_item(estim, "c");
+	assert_int_equal(2, notified);
+
+	ionotif_register(NULL);
+}
+
+TEST(paths_of_other_threads_are_picked_up_on_notification)
+{
+	pthread_t id;
+
+	ionotif_register(&progress_changed);
+
+	ioeta_add_item(estim, "a");
+	ioeta_add_item(estim, "b");
+	ioeta_update(estim, "a", "x", 0, 10);
+
+	assert_int_equal(0, pthread_create(&id, NULL, &update_in_thread, NULL));
+	assert_int_equal(0, pthread_join(id, NULL));
+
+	/* Counters are updated right away, paths only by the notifying thread. */
+	assert_int_equal(1, estim->current_item);
+	assert_int_equal(30, estim->current_byte);
+	assert_string_equal("a", estim->item);
+	assert_string_equal("x", estim->target);
+
+	now += 1000000U;
+	ioeta_update(estim, NULL, NULL, 0, 0);
+	assert_string_equal("b", estim->item);
+	assert_string_equal("y", estim->target);
+
+	ionotif_register(NULL);
+}
+
+static void *
+update_in_thread(void *arg)
+{
+	ioeta_update(estim, NULL, NULL, 1, 10);
+	ioeta_update(estim, "b", "y", 0, 10);
+	return NULL;
+}
+
+static void
+progress_changed(const io_progress_t *const progress)
+{
+	++notified;
+}
+
+static uint64_t
+fake_clock(void)
+{
+	return now;
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 : */
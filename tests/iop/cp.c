@@ -4,7 +4,10 @@
 #include <sys/stat.h> /* stat */
 #include <unistd.h> /* lstat() */
 
+#include <stdio.h> /* FILE fclose() fopen() fputc() */
+
 #include "../../src/compat/os.h"
+#include "../../src/io/ioeta.h"
 #include "../../src/io/iop.h"
 #include "../../src/utils/fs.h"
 #include "../../src/utils/fs_limits.h"
@@ -12,6 +15,10 @@
 
 #include "utils.h"
 
+/* Size of a file that can't be transferred at once. */
+#define LARGE_FILE_SIZE (2*1024*1024 + 512*1024 + 1)
+
+static void create_large_file(const char name[], int size);
 static int not_windows(void);
 
 TEST(dir_is_not_copied)
@@ -196,6 +203,50 @@ TEST(appending_does_not_shrink_files)
 	}
 }
 
+TEST(large_file_is_copied_with_progress)
+{
+	ioeta_estim_t *const estim = ioeta_alloc(NULL);
+
+	create_large_file("large", LARGE_FILE_SIZE);
+
+	{
+		io_args_t args = {
+			.arg1.src = "large",
+			.arg2.dst = "large-copy",
+
+			.estim = estim,
+		};
+		assert_int_equal(0, iop_cp(&args));
+	}
+
+	assert_true(files_are_identical("large", "large-copy"));
+	assert_int_equal(LARGE_FILE_SIZE, estim->current_byte);
+
+	ioeta_free(estim);
+	delete_test_file("large");
+	delete_test_file("large-copy");
+}
+
+TEST(appending_works_for_large_files)
+{
+	create_large_file("large", LARGE_FILE_SIZE);
+	create_large_file("appending", LARGE_FILE_SIZE/2);
+
+	{
+		io_args_t args = {
+			.arg1.src = "large",
+			.arg2.dst = "appending",
+			.arg3.crs = IO_CRS_APPEND_TO_FILES,
+		};
+		assert_int_equal(0, iop_cp(&args));
+	}
+
+	assert_true(files_are_identical("large", "appending"));
+
+	delete_test_file("large");
+	delete_test_file("appending");
+}
+
 /* Windows doesn't support Unix-style permissions. */
 TEST(file_permissions_are_preserved, IF(not_windows))
 {
@@ -306,6 +357,22 @@ TEST(dir_symlink_copy_is_symlink, IF(not_windows))
 	}
 }
 
+/* Creates file of specified size filled with non-repeating pattern. */
+static void
+create_large_file(const char name[], int size)
+{
+	int i;
+	FILE *const f = fopen(name, "wb");
+	assert_non_null(f);
+
+	for(i = 0; i < size; ++i)
+	{
+		fputc(i%251, f);
+	}
+
+	fclose(f);
+}
+
 static int
 not_windows(void)
 {
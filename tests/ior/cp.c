@@ -4,7 +4,10 @@
 #include <sys/types.h> /* stat */
 #include <unistd.h> /* F_OK access() lstat() */
 
+#include <stdio.h> /* snprintf() */
+
 #include "../../src/compat/os.h"
+#include "../../src/io/ioeta.h"
 #include "../../src/io/iop.h"
 #include "../../src/io/ior.h"
 #include "../../src/utils/fs.h"
@@ -12,6 +15,8 @@
 
 #include "utils.h"
 
+static int deny_overwrite(io_args_t *args, const char src[],
+		const char dst[]);
 static int not_windows(void);
 
 TEST(file_is_copied)
@@ -505,6 +510,259 @@ TEST(symlink_to_dir_is_symlink_after_copy, IF(not_windows))
 	}
 }
 
+TEST(many_files_are_copied_in_parallel)
+{
+	char path[64];
+	int i;
+
+	create_non_empty_nested_dir("dir", "nested-dir", "a-file");
+	for(i = 0; i < 100; ++i)
+	{
+		snprintf(path, sizeof(path), "dir/file%d", i);
+		create_empty_file(path);
+	}
+
+	{
+		io_args_t args =
+		{
+			.arg1.src = "dir",
+			.arg2.dst = "dir-copy",
+			.nthreads = 4,
+		};
+		assert_int_equal(0, ior_cp(&args));
+		assert_int_equal(0, args.result.errors.error_count);
+	}
+
+	assert_true(file_exists("dir-copy/nested-dir/a-file"));
+	for(i = 0; i < 100; ++i)
+	{
+		snprintf(path, sizeof(path), "dir-copy/file%d", i);
+		assert_true(file_exists(path));
+	}
+
+	delete_tree("dir");
+	delete_tree("dir-copy");
+}
+
+TEST(progress_of_parallel_copy_is_counted)
+{
+	char path[64];
+	int i;
+	ioeta_estim_t *const estim = ioeta_alloc(NULL);
+
+	create_empty_dir("dir");
+	for(i = 0; i < 20; ++i)
+	{
+		snprintf(path, sizeof(path), "dir/file%d", i);
+		clone_file("../read/binary-data", path);
+	}
+	ioeta_calculate(estim, "dir", 0);
+
+	{
+		io_args_t args =
+		{
+			.arg1.src = "dir",
+			.arg2.dst = "dir-copy",
+			.nthreads = 4,
+			.estim = estim,
+		};
+		assert_int_equal(0, ior_cp(&args));
+	}
+
+	assert_int_equal(20*1024, estim->total_bytes);
+	assert_int_equal(estim->total_bytes, estim->current_byte);
+	assert_int_equal(estim->total_items, estim->current_item);
+
+	ioeta_free(estim);
+
+	delete_tree("dir");
+	delete_tree("dir-copy");
+}
+
+TEST(permissions_are_set_after_parallel_copy)
+{
+	struct stat src;
+	struct stat dst;
+
+	create_non_empty_nested_dir("dir", "nested-dir", "a-file");
+	assert_int_equal(0, chmod("dir/nested-dir", 0500));
+	assert_int_equal(0, chmod("dir", 0500));
+
+	{
+		io_args_t args =
+		{
+			.arg1.src = "dir",
+			.arg2.dst = "dir-copy",
+			.nthreads = 4,
+		};
+		assert_int_equal(0, ior_cp(&args));
+	}
+
+	assert_true(file_exists("dir-copy/nested-dir/a-file"));
+
+	assert_int_equal(0, os_stat("dir/nested-dir", &src));
+	assert_int_equal(0, os_stat("dir-copy/nested-dir", &dst));
+	assert_int_equal(src.st_mode & 0777, dst.st_mode & 0777);
+
+	assert_int_equal(0, os_stat("dir", &src));
+	assert_int_equal(0, os_stat("dir-copy", &dst));
+	assert_int_equal(src.st_mode & 0777, dst.st_mode & 0777);
+
+	assert_int_equal(0, chmod("dir", 0700));
+	assert_int_equal(0, chmod("dir/nested-dir", 0700));
+	assert_int_equal(0, chmod("dir-copy", 0700));
+	assert_int_equal(0, chmod("dir-copy/nested-dir", 0700));
+
+	delete_tree("dir");
+	delete_tree("dir-copy");
+}
+
+TEST(entries_found_by_estimation_are_copied)
+{
+	ioeta_estim_t *const estim = ioeta_alloc(NULL);
+
+	create_non_empty_nested_dir("dir", "nested-dir", "a-file");
+	create_empty_file("dir/b-file");
+	ioeta_calculate(estim, "dir", 0);
+
+	/* Files that appear after estimation are still seen by the operation. */
+	create_empty_file("dir/nested-dir/c-file");
+
+	{
+		io_args_t args =
+		{
+			.arg1.src = "dir",
+			.arg2.dst = "dir-copy",
+			.estim = estim,
+		};
+		assert_int_equal(0, ior_cp(&args));
+	}
+
+	assert_true(file_exists("dir-copy/nested-dir/a-file"));
+	assert_true(file_exists("dir-copy/b-file"));
+	assert_true(file_exists("dir-copy/nested-dir/c-file"));
+
+	{
+		io_args_t args =
+		{
+			.arg1.path = "dir-copy",
+			.estim = estim,
+		};
+		assert_int_equal(0, ior_rm(&args));
+	}
+
+	ioeta_free(estim);
+
+	delete_tree("dir");
+}
+
+TEST(entries_removed_after_estimation_are_skipped)
+{
+	ioeta_estim_t *const estim = ioeta_alloc(NULL);
+
+	create_non_empty_dir("dir", "a-file");
+	create_empty_file("dir/b-file");
+	ioeta_calculate(estim, "dir", 0);
+
+	delete_file("dir/b-file");
+
+	{
+		io_args_t args =
+		{
+			.arg1.src = "dir",
+			.arg2.dst = "dir-copy",
+			.estim = estim,
+		};
+		assert_int_equal(0, ior_cp(&args));
+	}
+
+	assert_true(file_exists("dir-copy/a-file"));
+	assert_false(file_exists("dir-copy/b-file"));
+
+	ioeta_free(estim);
+
+	delete_tree("dir");
+	delete_tree("dir-copy");
+}
+
+TEST(journal_is_removed_after_successful_copying)
+{
+	create_non_empty_dir("dir", "a-file");
+
+	{
+		io_args_t args =
+		{
+			.arg1.src = "dir",
+			.arg2.dst = "dir-copy",
+		};
+		assert_int_equal(0, ior_cp(&args));
+	}
+
+	assert_false(ior_can_resume("dir-copy"));
+
+	delete_tree("dir");
+	delete_tree("dir-copy");
+}
+
+TEST(files_without_records_are_copied_anew_on_resume)
+{
+	create_empty_dir("dir");
+	clone_file("../read/binary-data", "dir/a-file");
+	create_empty_dir("dir-copy");
+	clone_file("../read/two-lines", "dir-copy/a-file");
+	create_empty_file(".dir-copy.vifm-journal");
+
+	{
+		io_args_t args =
+		{
+			.arg1.src = "dir",
+			.arg2.dst = "dir-copy",
+			.arg3.crs = IO_CRS_APPEND_TO_FILES,
+		};
+		assert_int_equal(0, ior_cp(&args));
+	}
+
+	assert_int_equal(get_file_size("../read/binary-data"),
+			get_file_size("dir-copy/a-file"));
+	assert_false(ior_can_resume("dir-copy"));
+
+	delete_tree("dir");
+	delete_tree("dir-copy");
+}
+
+TEST(files_without_records_are_not_overwritten_without_confirmation)
+{
+	create_empty_dir("dir");
+	clone_file("../read/binary-data", "dir/a-file");
+	create_empty_dir("dir-copy");
+	clone_file("../read/two-lines", "dir-copy/a-file");
+	create_empty_file(".dir-copy.vifm-journal");
+
+	{
+		io_args_t args =
+		{
+			.arg1.src = "dir",
+			.arg2.dst = "dir-copy",
+			.arg3.crs = IO_CRS_APPEND_TO_FILES,
+			.confirm = &deny_overwrite,
+		};
+		assert_int_equal(0, ior_cp(&args));
+	}
+
+	assert_int_equal(get_file_size("../read/two-lines"),
+			get_file_size("dir-copy/a-file"));
+
+	delete_tree("dir");
+	delete_tree("dir-copy");
+	(void)unlink(".dir-copy.vifm-journal");
+}
+
+static int
+deny_overwrite(io_args_t *args, const char src[], const char dst[])
+{
+	return 0;
+}
+
 static int
 not_windows(void)
 {
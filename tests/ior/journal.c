@@ -0,0 +1,92 @@
+#include <stic.h>
+
+#include <sys/stat.h> /* stat */
+
+#include <stdint.h> /* uint64_t */
+#include <stdio.h> /* FILE fclose() fopen() fputs() */
+#include <stdlib.h> /* free() */
+
+#include "../../src/compat/os.h"
+#include "../../src/io/private/journal.h"
+#include "../../src/io/ior.h"
+
+static struct stat src_st;
+
+SETUP()
+{
+	assert_success(os_stat("../read/binary-data", &src_st));
+}
+
+TEST(journal_is_named_after_destination)
+{
+	char *const path = journal_path("dir/file");
+	assert_string_equal("dir/.file.vifm-journal", path);
+	free(path);
+}
+
+TEST(empty_journal_is_removed_on_close)
+{
+	journal_close(journal_open("file", 0), 0);
+	assert_false(ior_can_resume("file"));
+}
+
+TEST(records_are_loaded_back)
+{
+	uint64_t offset;
+	journal_t *journal = journal_open("dir", 0);
+	assert_non_null(journal);
+	journal_checkpoint(journal, "dir/a", &src_st, 10U);
+	journal_done(journal, "dir/b", &src_st);
+	journal_checkpoint(journal, "dir/c", &src_st, 10U);
+	journal_done(journal, "dir/c", &src_st);
+	journal_close(journal, 0);
+
+	assert_true(ior_can_resume("dir"));
+
+	journal = journal_open("dir", 1);
+	assert_non_null(journal);
+	assert_false(journal_is_done(journal, "dir/a", &src_st));
+	assert_success(journal_get_offset(journal, "dir/a", &src_st, &offset));
+	assert_int_equal(10, offset);
+	assert_true(journal_is_done(journal, "dir/b", &src_st));
+	assert_true(journal_is_done(journal, "dir/c", &src_st));
+	assert_failure(journal_get_offset(journal, "dir/c", &src_st, &offset));
+	journal_close(journal, 1);
+
+	assert_false(ior_can_resume("dir"));
+}
+
+TEST(records_about_changed_files_are_ignored)
+{
+	struct stat changed_st = src_st;
+	journal_t *journal = journal_open("dir", 0);
+	journal_done(journal, "dir/a", &src_st);
+	journal_close(journal, 0);
+
+	++changed_st.st_size;
+
+	journal = journal_open("dir", 1);
+	assert_true(journal_is_done(journal, "dir/a", &src_st));
+	assert_false(journal_is_done(journal, "dir/a", &changed_st));
+	journal_close(journal, 1);
+}
+
+TEST(incomplete_records_are_ignored)
+{
+	journal_t *journal;
+
+	{
+		FILE *const fp = fopen(".dir.vifm-journal", "w");
+		fputs("D 1", fp);
+		fclose(fp);
+	}
+
+	journal = journal_open("dir", 1);
+	assert_non_null(journal);
+	journal_close(journal, 0);
+
+	assert_false(ior_can_resume("dir"));
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
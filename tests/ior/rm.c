@@ -2,7 +2,7 @@
 
 #include <stdio.h> /* FILE fopen() fclose() */
 
-#include <unistd.h> /* F_OK access() */
+#include <unistd.h> /* F_OK access() chdir() symlink() */
 
 #include "../../src/compat/os.h"
 #include "../../src/io/ior.h"
@@ -70,5 +70,73 @@ TEST(non_empty_directory_is_removed)
 	assert_int_equal(-1, access(DIRECTORY_NAME, F_OK));
 }
 
+TEST(deep_directory_is_removed)
+{
+	int i;
+
+	os_mkdir(DIRECTORY_NAME, 0700);
+	assert_int_equal(0, chdir(DIRECTORY_NAME));
+	for(i = 0; i < 50; ++i)
+	{
+		FILE *const f = fopen(FILE_NAME, "w");
+		fclose(f);
+		assert_int_equal(0, os_mkdir("sub", 0700));
+		assert_int_equal(0, chdir("sub"));
+	}
+	for(i = 0; i < 51; ++i)
+	{
+		assert_int_equal(0, chdir(".."));
+	}
+
+	{
+		io_args_t args =
+		{
+			.arg1.src = DIRECTORY_NAME,
+		};
+		assert_int_equal(0, ior_rm(&args));
+	}
+
+	assert_int_equal(-1, access(DIRECTORY_NAME, F_OK));
+}
+
+#ifndef _WIN32
+
+TEST(symlink_to_directory_is_removed_without_its_target)
+{
+	os_mkdir(DIRECTORY_NAME, 0700);
+	assert_int_equal(0, chdir(DIRECTORY_NAME));
+	{
+		FILE *const f = fopen(FILE_NAME, "w");
+		fclose(f);
+	}
+	assert_int_equal(0, chdir(".."));
+
+	os_mkdir("dir", 0700);
+	assert_int_equal(0, symlink("../directory-to-remove", "dir/link"));
+
+	{
+		io_args_t args =
+		{
+			.arg1.src = "dir",
+		};
+		assert_int_equal(0, ior_rm(&args));
+	}
+
+	assert_int_equal(-1, access("dir", F_OK));
+	assert_int_equal(0, chdir(DIRECTORY_NAME));
+	assert_int_equal(0, access(FILE_NAME, F_OK));
+	assert_int_equal(0, chdir(".."));
+
+	{
+		io_args_t args =
+		{
+			.arg1.src = DIRECTORY_NAME,
+		};
+		assert_int_equal(0, ior_rm(&args));
+	}
+}
+
+#endif
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 : */
@@ -0,0 +1,247 @@
+#include <stic.h>
+
+#include <pthread.h> /* PTHREAD_* pthread_cond_* pthread_mutex_* */
+#include <unistd.h> /* usleep() */
+
+#include <stdint.h> /* uint64_t */
+
+#include "../../src/cfg/config.h"
+#include "../../src/io/ioeta.h"
+#include "../../src/io/iolimit.h"
+#include "../../src/io/ior.h"
+#include "../../src/utils/fs.h"
+#include "../../src/background.h"
+
+static void wait_task(bg_op_t *bg_op, void *arg);
+static void cancellable_task(bg_op_t *bg_op, void *arg);
+static void cancelled_copy_task(bg_op_t *bg_op, void *arg);
+static void mark_started(void);
+static void wait_for_start(void);
+static void release_tasks(void);
+static void wait_for_all_jobs(void);
+
+/* Whether waiting tasks should finish. */
+static int release;
+/* Number of tasks that started execution. */
+static int started;
+/* Result of copying performed by cancelled_copy_task(). */
+static int copy_result;
+/* Protects variables above. */
+static pthread_mutex_t state_lock = PTHREAD_MUTEX_INITIALIZER;
+/* Signaled when any of variables above changes. */
+static pthread_cond_t state_cond = PTHREAD_COND_INITIALIZER;
+
+SETUP()
+{
+	release = 0;
+	started = 0;
+}
+
+TEARDOWN()
+{
+	cfg.bg_threads = 0;
+}
+
+TEST(tasks_of_the_same_group_are_run_one_by_one)
+{
+	cfg.bg_threads = 4;
+
+	assert_success(bg_execute_grouped("1", BG_UNDEFINED_TOTAL, 0, 1U, &wait_task,
+				NULL));
+	assert_success(bg_execute_grouped("2", BG_UNDEFINED_TOTAL, 0, 1U, &wait_task,
+				NULL));
+
+	/* Second task can't start until the first one is released. */
+	wait_for_start();
+	assert_true(jobs->queued != jobs->next->queued);
+
+	release_tasks();
+	wait_for_all_jobs();
+	assert_int_equal(2, started);
+}
+
+TEST(tasks_are_queued_when_there_are_no_free_threads)
+{
+	cfg.bg_threads = 1;
+
+	assert_success(bg_execute("1", BG_UNDEFINED_TOTAL, 0, &wait_task, NULL));
+	assert_success(bg_execute("2", BG_UNDEFINED_TOTAL, 0, &wait_task, NULL));
+	assert_success(bg_execute("3", BG_UNDEFINED_TOTAL, 0, &wait_task, NULL));
+
+	/* Other tasks can't start until the first one is released. */
+	wait_for_start();
+	assert_int_equal(2, jobs->queued + jobs->next->queued +
+			jobs->next->next->queued);
+
+	release_tasks();
+	wait_for_all_jobs();
+	assert_int_equal(3, started);
+}
+
+TEST(only_queued_jobs_of_non_cancellable_tasks_can_be_cancelled)
+{
+	job_t *running, *queued;
+
+	cfg.bg_threads = 1;
+
+	assert_success(bg_execute("1", BG_UNDEFINED_TOTAL, 0, &wait_task, NULL));
+	assert_success(bg_execute("2", BG_UNDEFINED_TOTAL, 0, &wait_task, NULL));
+	wait_for_start();
+
+	running = jobs->queued ? jobs->next : jobs;
+	queued = jobs->queued ? jobs : jobs->next;
+
+	assert_failure(bg_job_cancel(running));
+	assert_false(bg_op_cancelled(&running->bg_op));
+	assert_success(bg_job_cancel(queued));
+	assert_true(bg_op_cancelled(&queued->bg_op));
+
+	release_tasks();
+	wait_for_all_jobs();
+}
+
+TEST(running_cancellable_task_can_be_cancelled)
+{
+	cfg.bg_threads = 1;
+
+	assert_success(bg_execute("1", BG_UNDEFINED_TOTAL, 0, &cancellable_task,
+				NULL));
+	wait_for_start();
+
+	assert_success(bg_job_cancel(jobs));
+	wait_for_all_jobs();
+}
+
+TEST(cancellation_keeps_limit_of_the_job)
+{
+	uint64_t bytes_rate, files_rate;
+
+	cfg.bg_threads = 1;
+
+	assert_success(bg_execute("1", BG_UNDEFINED_TOTAL, 1, &cancellable_task,
+				NULL));
+	wait_for_start();
+
+	iolimit_set(jobs->bg_op.limit, 1024U, 1U);
+	assert_success(bg_job_cancel(jobs));
+
+	iolimit_get(jobs->bg_op.limit, &bytes_rate, &files_rate);
+	assert_int_equal(1024, bytes_rate);
+	assert_int_equal(1, files_rate);
+
+	wait_for_all_jobs();
+}
+
+TEST(cancelled_task_stops_io_operation)
+{
+	cfg.bg_threads = 1;
+
+	assert_success(bg_execute("1", BG_UNDEFINED_TOTAL, 0, &cancelled_copy_task,
+				NULL));
+	wait_for_start();
+
+	assert_success(bg_job_cancel(jobs));
+	wait_for_all_jobs();
+
+	assert_failure(copy_result);
+	assert_false(path_exists("test-data/sandbox/read", NODEREF));
+}
+
+/* Background task that waits until it's released. */
+static void
+wait_task(bg_op_t *bg_op, void *arg)
+{
+	mark_started();
+
+	pthread_mutex_lock(&state_lock);
+	while(!release)
+	{
+		pthread_cond_wait(&state_cond, &state_lock);
+	}
+	pthread_mutex_unlock(&state_lock);
+}
+
+/* Background task that waits until it's cancelled. */
+static void
+cancellable_task(bg_op_t *bg_op, void *arg)
+{
+	bg_op_set_cancellable(bg_op);
+	mark_started();
+
+	while(!bg_op_cancelled(bg_op))
+	{
+		usleep(1000);
+	}
+}
+
+/* Background task that copies a directory after it's cancelled. */
+static void
+cancelled_copy_task(bg_op_t *bg_op, void *arg)
+{
+	ioeta_estim_t *const estim = ioeta_alloc(NULL);
+	io_args_t args = {
+		.arg1.src = "test-data/read",
+		.arg2.dst = "test-data/sandbox/read",
+		.estim = estim,
+	};
+
+	estim->bg_op = bg_op;
+
+	bg_op_set_cancellable(bg_op);
+	mark_started();
+
+	while(!bg_op_cancelled(bg_op))
+	{
+		usleep(1000);
+	}
+
+	copy_result = ior_cp(&args);
+
+	ioeta_free(estim);
+}
+
+/* Counts task as started. */
+static void
+mark_started(void)
+{
+	pthread_mutex_lock(&state_lock);
+	++started;
+	pthread_cond_broadcast(&state_cond);
+	pthread_mutex_unlock(&state_lock);
+}
+
+/* Waits for the first task to start. */
+static void
+wait_for_start(void)
+{
+	pthread_mutex_lock(&state_lock);
+	while(started == 0)
+	{
+		pthread_cond_wait(&state_cond, &state_lock);
+	}
+	pthread_mutex_unlock(&state_lock);
+}
+
+/* Lets waiting tasks finish. */
+static void
+release_tasks(void)
+{
+	pthread_mutex_lock(&state_lock);
+	release = 1;
+	pthread_cond_broadcast(&state_cond);
+	pthread_mutex_unlock(&state_lock);
+}
+
+/* Waits for all jobs to finish and removes them from the list. */
+static void
+wait_for_all_jobs(void)
+{
+	while(jobs != NULL)
+	{
+		check_background_jobs();
+		usleep(1000);
+	}
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -0,0 +1,54 @@
+#include <stic.h>
+
+#include "../../src/ui/cancellation.h"
+
+SETUP()
+{
+	ui_cancellation_reset();
+}
+
+TEST(cancellation_can_be_nested)
+{
+	ui_cancellation_enable();
+	ui_cancellation_reset();
+	ui_cancellation_enable();
+	ui_cancellation_request();
+	ui_cancellation_disable();
+
+	/* Still enabled for outer operation. */
+	assert_true(ui_cancellation_requested());
+
+	ui_cancellation_disable();
+	assert_true(ui_cancellation_requested());
+
+	ui_cancellation_reset();
+	assert_false(ui_cancellation_requested());
+}
+
+TEST(nested_reset_keeps_outer_request)
+{
+	ui_cancellation_enable();
+	ui_cancellation_request();
+
+	ui_cancellation_reset();
+	ui_cancellation_enable();
+	assert_true(ui_cancellation_requested());
+	ui_cancellation_disable();
+
+	ui_cancellation_disable();
+	assert_true(ui_cancellation_requested());
+}
+
+TEST(request_is_ignored_after_outermost_disable)
+{
+	ui_cancellation_enable();
+	ui_cancellation_enable();
+	ui_cancellation_disable();
+	ui_cancellation_disable();
+
+	ui_cancellation_request();
+	assert_false(ui_cancellation_requested());
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
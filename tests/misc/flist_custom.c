@@ -68,6 +68,16 @@ TEST(duplicates_are_not_added)
 	assert_int_equal(1, lwin.list_rows);
 }
 
+TEST(all_files_are_added)
+{
+	flist_custom_start(&lwin, "test");
+	flist_custom_add(&lwin, "test-data/existing-files/a");
+	flist_custom_add(&lwin, "test-data/existing-files/b");
+	flist_custom_add(&lwin, "test-data/existing-files/c");
+	assert_true(flist_custom_finish(&lwin) == 0);
+	assert_int_equal(3, lwin.list_rows);
+}
+
 TEST(custom_view_replaces_custom_view_fine)
 {
 	assert_false(flist_custom_active(&lwin));
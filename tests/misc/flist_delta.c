@@ -0,0 +1,232 @@
+#include <stic.h>
+
+#include <unistd.h> /* chdir() getcwd() rmdir() unlink() */
+
+#include <stdio.h> /* FILE fclose() fopen() fputs() snprintf() */
+#include <stdlib.h> /* free() */
+#include <string.h> /* strdup() */
+
+#include "../../src/cfg/config.h"
+#include "../../src/compat/os.h"
+#include "../../src/utils/filemon.h"
+#include "../../src/utils/fs_limits.h"
+#include "../../src/filelist.h"
+#include "../../src/status.h"
+
+#define SANDBOX_PATH "test-data/sandbox/flist-delta"
+
+static void create_file(const char name[]);
+static void append_to_file(const char name[]);
+static void remove_file(const char name[]);
+static int watch_is_precise(void);
+static void free_view(FileView *view);
+
+static char cwd[PATH_MAX];
+
+SETUP()
+{
+	assert_non_null(getcwd(cwd, sizeof(cwd)));
+
+	assert_success(os_mkdir(SANDBOX_PATH, 0700));
+	create_file("b");
+	create_file("d");
+	create_file(".hidden");
+
+	cfg.slow_fs_list = strdup("");
+
+	lwin.dir_entry = NULL;
+	lwin.list_rows = 0;
+	lwin.list_pos = 0;
+	lwin.top_line = 0;
+	lwin.window_rows = 1;
+	lwin.hide_dot = 1;
+	lwin.sort[0] = SK_BY_NAME;
+	ui_view_sort_list_ensure_well_formed(&lwin);
+
+	snprintf(lwin.curr_dir, sizeof(lwin.curr_dir), "%s/%s", cwd, SANDBOX_PATH);
+
+	curr_view = &lwin;
+	other_view = &rwin;
+
+	curr_stats.number_of_windows = 2;
+
+	populate_dir_list(&lwin, 0);
+	assert_int_equal(2, lwin.list_rows);
+	assert_int_equal(1, lwin.filtered);
+}
+
+TEARDOWN()
+{
+	assert_success(chdir(cwd));
+
+	filemon_watch_free(lwin.watch);
+	lwin.watch = NULL;
+	free_view(&lwin);
+
+	free(cfg.slow_fs_list);
+	cfg.slow_fs_list = NULL;
+
+	remove_file("a");
+	remove_file("b");
+	remove_file("c");
+	remove_file("d");
+	remove_file("e");
+	remove_file(".a");
+	remove_file(".c");
+	remove_file(".hidden");
+	assert_success(rmdir(SANDBOX_PATH));
+}
+
+static void
+create_file(const char name[])
+{
+	char path[PATH_MAX];
+	FILE *f;
+
+	snprintf(path, sizeof(path), "%s/%s/%s", cwd, SANDBOX_PATH, name);
+	f = fopen(path, "w");
+	assert_non_null(f);
+	fclose(f);
+}
+
+static void
+append_to_file(const char name[])
+{
+	char path[PATH_MAX];
+	FILE *f;
+
+	snprintf(path, sizeof(path), "%s/%s/%s", cwd, SANDBOX_PATH, name);
+	f = fopen(path, "a");
+	assert_non_null(f);
+	fputs("data", f);
+	fclose(f);
+}
+
+static void
+remove_file(const char name[])
+{
+	char path[PATH_MAX];
+	snprintf(path, sizeof(path), "%s/%s/%s", cwd, SANDBOX_PATH, name);
+	(void)unlink(path);
+}
+
+static int
+watch_is_precise(void)
+{
+	filemon_watch_t *const w = filemon_watch_create(".");
+	const int precise = (w != NULL && filemon_watch_is_precise(w));
+	filemon_watch_free(w);
+	return precise;
+}
+
+static void
+free_view(FileView *view)
+{
+	int i;
+
+	for(i = 0; i < view->list_rows; ++i)
+	{
+		free_dir_entry(view, &view->dir_entry[i]);
+	}
+	free(view->dir_entry);
+	view->dir_entry = NULL;
+	view->list_rows = 0;
+}
+
+TEST(new_files_are_inserted_in_sorted_positions, IF(watch_is_precise))
+{
+	create_file("a");
+	create_file("c");
+	create_file("e");
+
+	check_if_filelist_have_changed(&lwin);
+
+	assert_int_equal(5, lwin.list_rows);
+	assert_string_equal("a", lwin.dir_entry[0].name);
+	assert_string_equal("b", lwin.dir_entry[1].name);
+	assert_string_equal("c", lwin.dir_entry[2].name);
+	assert_string_equal("d", lwin.dir_entry[3].name);
+	assert_string_equal("e", lwin.dir_entry[4].name);
+	assert_int_equal(1, lwin.filtered);
+}
+
+TEST(removed_files_are_removed, IF(watch_is_precise))
+{
+	remove_file("b");
+
+	check_if_filelist_have_changed(&lwin);
+
+	assert_int_equal(1, lwin.list_rows);
+	assert_string_equal("d", lwin.dir_entry[0].name);
+}
+
+TEST(cursor_and_selection_are_preserved, IF(watch_is_precise))
+{
+	lwin.list_pos = 1;
+	lwin.dir_entry[0].selected = 1;
+	lwin.selected_files = 1;
+
+	create_file("a");
+	remove_file("d");
+	create_file("d");
+
+	check_if_filelist_have_changed(&lwin);
+
+	assert_int_equal(3, lwin.list_rows);
+	assert_string_equal("d", lwin.dir_entry[lwin.list_pos].name);
+	assert_true(lwin.dir_entry[1].selected);
+	assert_int_equal(1, lwin.selected_files);
+}
+
+TEST(filtered_out_files_are_counted, IF(watch_is_precise))
+{
+	create_file(".a");
+	remove_file(".hidden");
+	create_file(".c");
+
+	check_if_filelist_have_changed(&lwin);
+
+	assert_int_equal(2, lwin.list_rows);
+	assert_int_equal(2, lwin.filtered);
+}
+
+TEST(modified_files_are_updated_in_place, IF(watch_is_precise))
+{
+	dir_entry_t *const list = lwin.dir_entry;
+	char *const name = lwin.dir_entry[0].name;
+
+	append_to_file("b");
+
+	check_if_filelist_have_changed(&lwin);
+
+	assert_int_equal(2, lwin.list_rows);
+	assert_true(lwin.dir_entry == list);
+	assert_true(lwin.dir_entry[0].name == name);
+	assert_int_equal(4, lwin.dir_entry[0].size);
+	assert_int_equal(0, lwin.dir_entry[1].size);
+}
+
+TEST(modified_files_are_moved_to_keep_list_sorted, IF(watch_is_precise))
+{
+	lwin.sort[0] = SK_BY_SIZE;
+	lwin.sort[1] = SK_BY_NAME;
+	ui_view_sort_list_ensure_well_formed(&lwin);
+	populate_dir_list(&lwin, 1);
+	assert_string_equal("b", lwin.dir_entry[0].name);
+
+	append_to_file("b");
+
+	check_if_filelist_have_changed(&lwin);
+
+	assert_int_equal(2, lwin.list_rows);
+	assert_string_equal("d", lwin.dir_entry[0].name);
+	assert_string_equal("b", lwin.dir_entry[1].name);
+	assert_int_equal(4, lwin.dir_entry[1].size);
+
+	lwin.sort[0] = SK_BY_NAME;
+	lwin.sort[1] = SK_NONE;
+	ui_view_sort_list_ensure_well_formed(&lwin);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -0,0 +1,144 @@
+#include <stic.h>
+
+#include <unistd.h> /* chdir() getcwd() rmdir() symlink() unlink() */
+
+#include <stdio.h> /* snprintf() */
+#include <stdlib.h> /* free() */
+#include <string.h> /* strdup() */
+
+#include "../../src/cfg/config.h"
+#include "../../src/compat/os.h"
+#include "../../src/ui/ui.h"
+#include "../../src/utils/fs_limits.h"
+#include "../../src/filelist.h"
+
+#define SANDBOX_PATH "test-data/sandbox/link-state"
+
+static void free_view(FileView *view);
+static dir_entry_t * find_entry(const char name[]);
+
+static char cwd[PATH_MAX];
+static char sandbox[PATH_MAX];
+
+SETUP()
+{
+	char target[PATH_MAX];
+
+	assert_non_null(getcwd(cwd, sizeof(cwd)));
+	snprintf(sandbox, sizeof(sandbox), "%s/%s", cwd, SANDBOX_PATH);
+
+	assert_success(os_mkdir(sandbox, 0700));
+
+	snprintf(target, sizeof(target), "%s/dir", sandbox);
+	assert_success(os_mkdir(target, 0700));
+	assert_success(chdir(sandbox));
+	assert_success(symlink(target, "to-dir"));
+	assert_success(symlink("nowhere", "broken"));
+
+	cfg.slow_fs_list = strdup("");
+
+	lwin.dir_entry = NULL;
+	lwin.list_rows = 0;
+	lwin.window_rows = 1;
+	lwin.sort[0] = SK_BY_NAME;
+	ui_view_sort_list_ensure_well_formed(&lwin);
+	snprintf(lwin.curr_dir, sizeof(lwin.curr_dir), "%s", sandbox);
+
+	populate_dir_list(&lwin, 0);
+}
+
+TEARDOWN()
+{
+	free_view(&lwin);
+
+	free(cfg.slow_fs_list);
+	cfg.slow_fs_list = NULL;
+
+	assert_success(chdir(sandbox));
+	(void)rmdir("dir");
+	assert_success(unlink("to-dir"));
+	assert_success(unlink("broken"));
+	assert_success(chdir(cwd));
+	assert_success(rmdir(sandbox));
+}
+
+TEST(target_type_is_resolved_once_on_load)
+{
+	/* Widths of names with decorations are computed on load. */
+	assert_int_equal(1, find_entry("to-dir")->link_to_dir);
+	assert_int_equal(0, find_entry("broken")->link_to_dir);
+	/* This one is resolved on drawing. */
+	assert_int_equal(-1, find_entry("broken")->link_broken);
+}
+
+TEST(link_target_type_is_cached)
+{
+	dir_entry_t *const entry = find_entry("to-dir");
+	const int pos = entry_to_pos(&lwin, entry);
+
+	assert_int_equal(FT_DIR, ui_view_entry_target_type(&lwin, pos));
+	assert_int_equal(1, entry->link_to_dir);
+
+	/* Cached value is used until the entry is reloaded. */
+	assert_success(rmdir("dir"));
+	assert_int_equal(FT_DIR, ui_view_entry_target_type(&lwin, pos));
+}
+
+TEST(broken_link_is_not_a_directory)
+{
+	dir_entry_t *const entry = find_entry("broken");
+	const int pos = entry_to_pos(&lwin, entry);
+
+	assert_int_equal(FT_LINK, ui_view_entry_target_type(&lwin, pos));
+	assert_int_equal(0, entry->link_to_dir);
+}
+
+TEST(reload_drops_cached_state)
+{
+	dir_entry_t *entry = find_entry("to-dir");
+	assert_int_equal(FT_DIR,
+			ui_view_entry_target_type(&lwin, entry_to_pos(&lwin, entry)));
+
+	assert_success(rmdir("dir"));
+	populate_dir_list(&lwin, 1);
+
+	entry = find_entry("to-dir");
+	assert_int_equal(FT_LINK,
+			ui_view_entry_target_type(&lwin, entry_to_pos(&lwin, entry)));
+}
+
+TEST(rename_drops_cached_state)
+{
+	dir_entry_t *const entry = find_entry("to-dir");
+	(void)ui_view_entry_target_type(&lwin, entry_to_pos(&lwin, entry));
+
+	rename_dir_entry(entry, "to-dir");
+	assert_int_equal(-1, entry->link_to_dir);
+	assert_int_equal(-1, entry->link_broken);
+}
+
+static void
+free_view(FileView *view)
+{
+	int i;
+
+	for(i = 0; i < view->list_rows; ++i)
+	{
+		free_dir_entry(view, &view->dir_entry[i]);
+	}
+	free(view->dir_entry);
+	view->dir_entry = NULL;
+	view->list_rows = 0;
+}
+
+/* Looks up entry of the lwin by its name.  Returns the entry. */
+static dir_entry_t *
+find_entry(const char name[])
+{
+	const int pos = find_file_pos_in_list(&lwin, name);
+	assert_true(pos >= 0);
+	return &lwin.dir_entry[pos];
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -0,0 +1,73 @@
+#include <stic.h>
+
+#include <stdlib.h> /* calloc() free() */
+#include <string.h> /* strdup() */
+
+#include "../../src/cfg/config.h"
+#include "../../src/ui/ui.h"
+#include "../../src/filelist.h"
+#include "../../src/fileview.h"
+
+static FileView *const view = &lwin;
+
+SETUP()
+{
+	view->list_rows = 3;
+	view->dir_entry = calloc(view->list_rows, sizeof(*view->dir_entry));
+	view->dir_entry[0].name = strdup("a");
+	view->dir_entry[0].type = FT_REG;
+	view->dir_entry[1].name = strdup("abcdef");
+	view->dir_entry[1].type = FT_REG;
+	view->dir_entry[2].name = strdup("abc");
+	view->dir_entry[2].type = FT_DIR;
+}
+
+TEARDOWN()
+{
+	int i;
+
+	for(i = 0; i < view->list_rows; ++i)
+	{
+		free(view->dir_entry[i].name);
+	}
+	free(view->dir_entry);
+	view->dir_entry = NULL;
+	view->list_rows = 0;
+
+	cfg.decorations[FT_DIR][DECORATION_SUFFIX] = '\0';
+}
+
+TEST(widths_are_cached_on_list_update)
+{
+	fview_list_updated(view);
+
+	assert_int_equal(6, view->max_filename_width);
+	assert_int_equal(1, view->dir_entry[0].name_width);
+	assert_int_equal(6, view->dir_entry[1].name_width);
+	assert_int_equal(3, view->dir_entry[2].name_width);
+}
+
+TEST(decorations_are_not_cached)
+{
+	fview_list_updated(view);
+	cfg.decorations[FT_DIR][DECORATION_SUFFIX] = '/';
+	rename_dir_entry(&view->dir_entry[2], "abcdef");
+	fview_list_updated(view);
+
+	assert_int_equal(7, view->max_filename_width);
+	assert_int_equal(6, view->dir_entry[2].name_width);
+}
+
+TEST(rename_drops_cached_width)
+{
+	fview_list_updated(view);
+	rename_dir_entry(&view->dir_entry[0], "abcdefgh");
+	assert_int_equal(0, view->dir_entry[0].name_width);
+
+	fview_list_updated(view);
+	assert_int_equal(8, view->max_filename_width);
+	assert_int_equal(8, view->dir_entry[0].name_width);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
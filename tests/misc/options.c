@@ -98,5 +98,19 @@ TEST(lsview_block_columns_update_on_sort_change)
 	/* The check is implicit, an assert will fail if view columns are updated. */
 }
 
+TEST(copythreads_is_bounded)
+{
+	assert_success(exec_commands("set copythreads=64", curr_view, CIT_COMMAND));
+	assert_int_equal(64, cfg.copy_threads);
+
+	assert_failure(exec_commands("set copythreads=65", curr_view, CIT_COMMAND));
+	assert_int_equal(64, cfg.copy_threads);
+
+	assert_failure(exec_commands("set copythreads=0", curr_view, CIT_COMMAND));
+	assert_int_equal(64, cfg.copy_threads);
+
+	cfg.copy_threads = 1;
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 : */
@@ -293,5 +293,50 @@ TEST(ignore_case_name_sort_breaks_ties_deterministically)
 	assert_string_equal("аааааааааа", rwin.dir_entry[1].name);
 }
 
+TEST(secondary_key_breaks_ties_of_primary_key)
+{
+	lwin.dir_entry[0].size = 2;
+	lwin.dir_entry[1].size = 1;
+	lwin.dir_entry[2].size = 2;
+
+	lwin.sort[0] = -SK_BY_SIZE;
+	lwin.sort[1] = SK_BY_NAME;
+	memset(&lwin.sort[2], SK_NONE, sizeof(lwin.sort) - 2);
+
+	sort_view(&lwin);
+
+	assert_string_equal("A", lwin.dir_entry[0].name);
+	assert_string_equal("a", lwin.dir_entry[1].name);
+	assert_string_equal("_", lwin.dir_entry[2].name);
+}
+
+TEST(sorting_is_stable)
+{
+	lwin.sort[0] = SK_BY_SIZE;
+	memset(&lwin.sort[1], SK_NONE, sizeof(lwin.sort) - 1);
+
+	sort_view(&lwin);
+
+	assert_string_equal("a", lwin.dir_entry[0].name);
+	assert_string_equal("_", lwin.dir_entry[1].name);
+	assert_string_equal("A", lwin.dir_entry[2].name);
+}
+
+TEST(insert_position_keeps_list_sorted)
+{
+	dir_entry_t entry = { .name = "B", .type = FT_REG };
+
+	lwin.sort[0] = SK_BY_NAME;
+	memset(&lwin.sort[1], SK_NONE, sizeof(lwin.sort) - 1);
+
+	sort_view(&lwin);
+
+	assert_string_equal("A", lwin.dir_entry[0].name);
+	assert_int_equal(1, sort_find_insert_pos(&lwin, &entry));
+
+	entry.name = "b";
+	assert_int_equal(3, sort_find_insert_pos(&lwin, &entry));
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 : */
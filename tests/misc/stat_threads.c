@@ -0,0 +1,181 @@
+#include <stic.h>
+
+#include <sys/stat.h> /* S_ISDIR() */
+#include <unistd.h> /* chdir() getcwd() rmdir() symlink() unlink() */
+
+#include <stdio.h> /* FILE fclose() fopen() snprintf() */
+#include <stdlib.h> /* free() */
+#include <string.h> /* strcpy() strdup() */
+
+#include "../../src/cfg/config.h"
+#include "../../src/compat/os.h"
+#include "../../src/utils/fs_limits.h"
+#include "../../src/filelist.h"
+
+#define SANDBOX_PATH "test-data/sandbox/stat-threads"
+
+/* Number of files in the directory, more than a thread processes at once. */
+#define FILE_COUNT 300
+
+static void create_files(void);
+static void remove_files(void);
+static void free_view(FileView *view);
+
+static char cwd[PATH_MAX];
+
+SETUP()
+{
+	assert_non_null(getcwd(cwd, sizeof(cwd)));
+
+	create_files();
+
+	cfg.slow_fs_list = strdup("");
+
+	lwin.dir_entry = NULL;
+	lwin.list_rows = 0;
+	lwin.window_rows = 1;
+	lwin.sort[0] = SK_BY_NAME;
+	ui_view_sort_list_ensure_well_formed(&lwin);
+
+	snprintf(lwin.curr_dir, sizeof(lwin.curr_dir), "%s/%s", cwd, SANDBOX_PATH);
+
+	curr_view = &lwin;
+	other_view = &rwin;
+}
+
+TEARDOWN()
+{
+	assert_success(chdir(cwd));
+
+	free_view(&lwin);
+
+	free(cfg.slow_fs_list);
+	cfg.slow_fs_list = NULL;
+	cfg.stat_threads = 1;
+
+	remove_files();
+}
+
+static void
+create_files(void)
+{
+	int i;
+
+	assert_success(os_mkdir(SANDBOX_PATH, 0700));
+
+	for(i = 0; i < FILE_COUNT; ++i)
+	{
+		char path[PATH_MAX];
+		FILE *f;
+
+		snprintf(path, sizeof(path), "%s/file%03d", SANDBOX_PATH, i);
+		f = fopen(path, "w");
+		assert_non_null(f);
+		fclose(f);
+	}
+}
+
+static void
+remove_files(void)
+{
+	int i;
+
+	for(i = 0; i < FILE_COUNT; ++i)
+	{
+		char path[PATH_MAX];
+		snprintf(path, sizeof(path), "%s/file%03d", SANDBOX_PATH, i);
+		assert_success(unlink(path));
+	}
+
+	assert_success(rmdir(SANDBOX_PATH));
+}
+
+static void
+free_view(FileView *view)
+{
+	int i;
+
+	for(i = 0; i < view->list_rows; ++i)
+	{
+		free_dir_entry(view, &view->dir_entry[i]);
+	}
+	free(view->dir_entry);
+	view->dir_entry = NULL;
+	view->list_rows = 0;
+}
+
+TEST(all_files_are_loaded_by_several_threads)
+{
+	int i;
+
+	cfg.stat_threads = 4;
+	populate_dir_list(&lwin, 0);
+
+	assert_int_equal(FILE_COUNT, lwin.list_rows);
+
+	for(i = 0; i < lwin.list_rows; ++i)
+	{
+		char name[NAME_MAX];
+		snprintf(name, sizeof(name), "file%03d", i);
+		assert_string_equal(name, lwin.dir_entry[i].name);
+		assert_int_equal(FT_REG, lwin.dir_entry[i].type);
+	}
+}
+
+TEST(result_does_not_depend_on_number_of_threads)
+{
+	int i;
+	dir_entry_t *entries;
+	int count;
+
+	cfg.stat_threads = 1;
+	populate_dir_list(&lwin, 0);
+	entries = lwin.dir_entry;
+	count = lwin.list_rows;
+	lwin.dir_entry = NULL;
+	lwin.list_rows = 0;
+
+	cfg.stat_threads = 3;
+	populate_dir_list(&lwin, 0);
+
+	assert_int_equal(count, lwin.list_rows);
+	for(i = 0; i < count; ++i)
+	{
+		assert_string_equal(entries[i].name, lwin.dir_entry[i].name);
+		assert_int_equal(entries[i].type, lwin.dir_entry[i].type);
+		assert_int_equal(entries[i].size, lwin.dir_entry[i].size);
+		assert_int_equal(entries[i].mtime, lwin.dir_entry[i].mtime);
+		free_dir_entry(&lwin, &entries[i]);
+	}
+	free(entries);
+}
+
+TEST(number_of_threads_is_not_limited)
+{
+	cfg.stat_threads = 1000;
+	populate_dir_list(&lwin, 0);
+
+	assert_int_equal(FILE_COUNT, lwin.list_rows);
+}
+
+TEST(mode_of_link_target_is_queried)
+{
+	dir_entry_t *entry;
+
+	assert_success(symlink(".", SANDBOX_PATH "/link"));
+
+	cfg.stat_threads = 4;
+	populate_dir_list(&lwin, 0);
+
+	assert_success(chdir(cwd));
+	assert_success(unlink(SANDBOX_PATH "/link"));
+
+	assert_int_equal(FILE_COUNT + 1, lwin.list_rows);
+	assert_true(find_file_pos_in_list(&lwin, "link") >= 0);
+	entry = &lwin.dir_entry[find_file_pos_in_list(&lwin, "link")];
+	assert_int_equal(FT_LINK, entry->type);
+	assert_true(S_ISDIR(entry->mode));
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -0,0 +1,208 @@
+#include <stic.h>
+
+#include <unistd.h> /* chdir() getcwd() rmdir() unlink() */
+
+#include <stdio.h> /* FILE fclose() fopen() snprintf() */
+
+#include "../../src/compat/os.h"
+#include "../../src/utils/fs_limits.h"
+#include "../../src/utils/path.h"
+#include "../../src/trash.h"
+
+/* Number of entries, enough to make the index grow several times. */
+#define FILE_COUNT 500
+
+static void make_name(char buf[], size_t buf_len, int i);
+
+/* Working directory of the tests, which contains the files. */
+static char sandbox[PATH_MAX];
+/* Working directory to restore after a test. */
+static char cwd[PATH_MAX];
+
+SETUP()
+{
+	int i;
+
+	/* Previous tests can leave any working directory, so make our own. */
+	assert_non_null(getcwd(cwd, sizeof(cwd)));
+	snprintf(sandbox, sizeof(sandbox), "%s/vifm-trash-registry", get_tmpdir());
+	assert_success(os_mkdir(sandbox, 0700));
+	assert_success(chdir(sandbox));
+
+	for(i = 0; i < FILE_COUNT; ++i)
+	{
+		char name[64];
+		FILE *f;
+
+		make_name(name, sizeof(name), i);
+		f = fopen(name, "w");
+		assert_non_null(f);
+		fclose(f);
+	}
+}
+
+TEARDOWN()
+{
+	int i;
+
+	for(i = 0; i < FILE_COUNT; ++i)
+	{
+		char name[64];
+		make_name(name, sizeof(name), i);
+		(void)unlink(name);
+	}
+	assert_success(chdir(cwd));
+	assert_success(rmdir(sandbox));
+
+	trash_prune_dead_entries();
+	assert_int_equal(0, nentries);
+}
+
+TEST(many_entries_are_found)
+{
+	int i;
+
+	for(i = 0; i < FILE_COUNT; ++i)
+	{
+		char name[64];
+		make_name(name, sizeof(name), i);
+		assert_success(add_to_trash("/orig", name));
+	}
+	assert_int_equal(FILE_COUNT, nentries);
+
+	for(i = 0; i < FILE_COUNT; ++i)
+	{
+		char name[64];
+		make_name(name, sizeof(name), i);
+		assert_true(is_in_trash(name));
+	}
+	assert_false(is_in_trash("no-such-file"));
+}
+
+TEST(duplicates_are_not_added)
+{
+	char name[64];
+	make_name(name, sizeof(name), 0);
+
+	assert_success(add_to_trash("/orig", name));
+	assert_success(add_to_trash("/orig", name));
+	assert_int_equal(1, nentries);
+}
+
+TEST(entries_are_found_after_removal_of_others)
+{
+	int i;
+
+	for(i = 0; i < FILE_COUNT; ++i)
+	{
+		char name[64];
+		make_name(name, sizeof(name), i);
+		assert_success(add_to_trash("/orig", name));
+	}
+
+	for(i = 0; i < FILE_COUNT; i += 2)
+	{
+		char name[64];
+		make_name(name, sizeof(name), i);
+		assert_success(remove_from_trash(name));
+	}
+	assert_int_equal(FILE_COUNT/2, nentries);
+
+	for(i = 0; i < FILE_COUNT; ++i)
+	{
+		char name[64];
+		make_name(name, sizeof(name), i);
+		assert_int_equal(i%2 != 0, is_in_trash(name));
+	}
+}
+
+TEST(removal_keeps_order_of_entries)
+{
+	int i;
+
+	for(i = 0; i < FILE_COUNT; ++i)
+	{
+		char name[64];
+		make_name(name, sizeof(name), i);
+		assert_success(add_to_trash("/orig", name));
+	}
+
+	for(i = 0; i < FILE_COUNT; i += 2)
+	{
+		char name[64];
+		make_name(name, sizeof(name), i);
+		assert_success(remove_from_trash(name));
+	}
+
+	for(i = 0; i < nentries; ++i)
+	{
+		char name[64];
+		make_name(name, sizeof(name), i*2 + 1);
+		assert_string_equal(name, trash_list[i].trash_name);
+	}
+}
+
+TEST(entries_can_be_removed_in_any_order)
+{
+	int i, j;
+
+	for(i = 0; i < FILE_COUNT; ++i)
+	{
+		char name[64];
+		make_name(name, sizeof(name), i);
+		assert_success(add_to_trash("/orig", name));
+	}
+
+	/* 7 and FILE_COUNT are coprime, so this visits every entry once. */
+	for(i = 0; i < FILE_COUNT; ++i)
+	{
+		char name[64];
+		make_name(name, sizeof(name), (i*7)%FILE_COUNT);
+		assert_success(remove_from_trash(name));
+		assert_failure(remove_from_trash(name));
+
+		for(j = i + 1; j < FILE_COUNT; ++j)
+		{
+			make_name(name, sizeof(name), (j*7)%FILE_COUNT);
+			assert_true(is_in_trash(name));
+		}
+	}
+	assert_int_equal(0, nentries);
+}
+
+TEST(entries_are_found_after_pruning)
+{
+	int i;
+
+	for(i = 0; i < FILE_COUNT; ++i)
+	{
+		char name[64];
+		make_name(name, sizeof(name), i);
+		assert_success(add_to_trash("/orig", name));
+	}
+
+	for(i = 0; i < FILE_COUNT; i += 3)
+	{
+		char name[64];
+		make_name(name, sizeof(name), i);
+		assert_success(unlink(name));
+	}
+	trash_prune_dead_entries();
+
+	for(i = 0; i < FILE_COUNT; ++i)
+	{
+		char name[64];
+		make_name(name, sizeof(name), i);
+		assert_int_equal(i%3 != 0, is_in_trash(name));
+	}
+}
+
+/* Formats path to i-th file relative to the sandbox. */
+static void
+make_name(char buf[], size_t buf_len, int i)
+{
+	snprintf(buf, buf_len, "file%d", i);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -0,0 +1,78 @@
+#include <stic.h>
+
+#include <stddef.h> /* NULL */
+
+#include "../../src/ops.h"
+#include "../../src/undo.h"
+
+#include "test.h"
+
+static int exec_func(OPS op, void *data, const char src[], const char dst[]);
+
+static const char *const paths[][2] = {
+	{ "/dir/a", "/trash/000_a" },
+	{ "/dir/b", "/trash/000_b" },
+	{ "/other/dir/", "/trash/000_dir" },
+	{ "/root-file", "relative" },
+	{ "name", "" },
+};
+
+static int i;
+static int undoing;
+
+SETUP()
+{
+	static int undo_levels = 10;
+	size_t j;
+
+	reset_undo_list();
+	init_undo_list_for_tests(&exec_func, &undo_levels);
+
+	cmd_group_begin("msg");
+	for(j = 0U; j < sizeof(paths)/sizeof(paths[0]); ++j)
+	{
+		assert_success(add_operation(OP_MOVE, NULL, NULL, paths[j][0],
+					paths[j][1]));
+	}
+	cmd_group_end();
+}
+
+TEST(paths_of_commands_are_preserved)
+{
+	i = sizeof(paths)/sizeof(paths[0]);
+	undoing = 1;
+	assert_success(undo_group());
+	assert_int_equal(0, i);
+
+	undoing = 0;
+	assert_success(redo_group());
+	assert_int_equal(sizeof(paths)/sizeof(paths[0]), i);
+}
+
+static int
+exec_func(OPS op, void *data, const char src[], const char dst[])
+{
+	if(op != OP_MOVE)
+	{
+		return 0;
+	}
+
+	if(undoing)
+	{
+		/* Undo goes backwards swapping source and destination. */
+		--i;
+		assert_string_equal(paths[i][1], src);
+		assert_string_equal(paths[i][0], dst);
+	}
+	else
+	{
+		assert_string_equal(paths[i][0], src);
+		assert_string_equal(paths[i][1], dst);
+		++i;
+	}
+
+	return 0;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
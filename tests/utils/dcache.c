@@ -0,0 +1,119 @@
+#include <stic.h>
+
+#include <pthread.h> /* pthread_create() pthread_join() */
+
+#include <stdint.h> /* uint64_t */
+#include <stdio.h> /* snprintf() */
+
+#include "../../src/utils/dcache.h"
+
+/* Number of threads that update the cache simultaneously. */
+#define THREAD_COUNT 8
+/* Number of directories each of the threads processes. */
+#define DIR_COUNT 2000
+
+static void * fill_cache(void *arg);
+
+static dcache_t *cache;
+
+SETUP()
+{
+	cache = dcache_create();
+}
+
+TEARDOWN()
+{
+	dcache_free(cache);
+}
+
+TEST(absent_path_is_not_found)
+{
+	uint64_t size = 5;
+	assert_failure(dcache_get(cache, "/no/such/dir", &size));
+	assert_int_equal(5, size);
+}
+
+TEST(stored_size_is_found)
+{
+	uint64_t size = 0;
+	assert_success(dcache_set(cache, "/a/b", 10));
+	assert_success(dcache_get(cache, "/a/b", &size));
+	assert_int_equal(10, size);
+}
+
+TEST(extra_slashes_do_not_matter)
+{
+	uint64_t size = 0;
+	assert_success(dcache_set(cache, "/a//b/", 10));
+	assert_success(dcache_get(cache, "//a/b", &size));
+	assert_int_equal(10, size);
+}
+
+TEST(parallel_updates_and_lookups_are_consistent)
+{
+	pthread_t threads[THREAD_COUNT];
+	long i;
+	int j;
+
+	for(i = 0; i < THREAD_COUNT; ++i)
+	{
+		assert_success(pthread_create(&threads[i], NULL, &fill_cache, (void *)i));
+	}
+
+	/* Look up the same paths while they are being updated like sorting does. */
+	for(j = 0; j < DIR_COUNT; ++j)
+	{
+		for(i = 0; i < THREAD_COUNT; ++i)
+		{
+			char path[64];
+			uint64_t size = 0;
+			snprintf(path, sizeof(path), "/root/%ld/dir%d", i, j);
+			if(dcache_get(cache, path, &size) == 0)
+			{
+				assert_true(size == (uint64_t)(i*DIR_COUNT + j) ||
+				            size == (uint64_t)(i*DIR_COUNT + j + 1));
+			}
+		}
+	}
+
+	for(i = 0; i < THREAD_COUNT; ++i)
+	{
+		assert_success(pthread_join(threads[i], NULL));
+	}
+
+	for(i = 0; i < THREAD_COUNT; ++i)
+	{
+		for(j = 0; j < DIR_COUNT; ++j)
+		{
+			char path[64];
+			uint64_t size = 0;
+			snprintf(path, sizeof(path), "/root/%ld/dir%d", i, j);
+			assert_success(dcache_get(cache, path, &size));
+			assert_true(size == (uint64_t)(i*DIR_COUNT + j + 1));
+		}
+	}
+}
+
+/* Stores sizes of directories of a thread twice.  Returns NULL. */
+static void *
+fill_cache(void *arg)
+{
+	const long id = (long)arg;
+	int pass;
+
+	for(pass = 0; pass < 2; ++pass)
+	{
+		int j;
+		for(j = 0; j < DIR_COUNT; ++j)
+		{
+			char path[64];
+			snprintf(path, sizeof(path), "/root/%ld/dir%d", id, j);
+			(void)dcache_set(cache, path, id*DIR_COUNT + j + pass);
+		}
+	}
+
+	return NULL;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
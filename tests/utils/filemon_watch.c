@@ -0,0 +1,212 @@
+#include <stic.h>
+
+#include <poll.h> /* POLLIN poll() pollfd */
+#include <sys/stat.h> /* chmod() */
+#include <unistd.h> /* rmdir() unlink() */
+
+#include <stdio.h> /* FILE fclose() fopen() fputs() */
+
+#include "../../src/compat/os.h"
+#include "../../src/utils/filemon.h"
+#include "../../src/utils/string_array.h"
+
+#define SANDBOX_PATH "test-data/sandbox"
+
+TEST(unwatchable_path_is_an_error)
+{
+	assert_null(filemon_watch_create(SANDBOX_PATH "/does-not-exist"));
+}
+
+TEST(no_changes_are_reported_initially)
+{
+	filemon_watch_t *const w = filemon_watch_create(SANDBOX_PATH);
+	assert_non_null(w);
+
+	assert_int_equal(FMS_UNCHANGED, filemon_watch_poll(w));
+
+	filemon_watch_free(w);
+}
+
+TEST(new_file_is_detected)
+{
+	FILE *f;
+	filemon_watch_t *const w = filemon_watch_create(SANDBOX_PATH);
+	assert_non_null(w);
+
+	/* Polling fallback can't detect changes within modification time
+	 * precision. */
+	if(!filemon_watch_is_precise(w))
+	{
+		filemon_watch_free(w);
+		return;
+	}
+
+	f = fopen(SANDBOX_PATH "/file", "w");
+	assert_non_null(f);
+	fclose(f);
+
+	assert_int_equal(FMS_UPDATED, filemon_watch_poll(w));
+	assert_int_equal(FMS_UNCHANGED, filemon_watch_poll(w));
+
+	assert_success(unlink(SANDBOX_PATH "/file"));
+
+	assert_int_equal(FMS_UPDATED, filemon_watch_poll(w));
+	assert_int_equal(FMS_UNCHANGED, filemon_watch_poll(w));
+
+	filemon_watch_free(w);
+}
+
+TEST(modification_of_file_is_reported)
+{
+	FILE *f;
+	filemon_watch_t *w;
+	char **names;
+	int count;
+
+	f = fopen(SANDBOX_PATH "/file", "w");
+	assert_non_null(f);
+	fclose(f);
+
+	w = filemon_watch_create(SANDBOX_PATH);
+	assert_non_null(w);
+
+	if(filemon_watch_is_precise(w))
+	{
+		f = fopen(SANDBOX_PATH "/file", "a");
+		assert_non_null(f);
+		fputs("data", f);
+		fclose(f);
+
+		assert_int_equal(FMS_UPDATED, filemon_watch_poll(w));
+		assert_success(filemon_watch_take_changes(w, &names, &count));
+		assert_int_equal(1, count);
+		assert_string_equal("file", names[0]);
+		free_string_array(names, count);
+
+		assert_success(chmod(SANDBOX_PATH "/file", 0600));
+
+		assert_int_equal(FMS_UPDATED, filemon_watch_poll(w));
+		assert_success(filemon_watch_take_changes(w, &names, &count));
+		assert_int_equal(1, count);
+		free_string_array(names, count);
+	}
+
+	filemon_watch_free(w);
+	assert_success(unlink(SANDBOX_PATH "/file"));
+}
+
+TEST(removal_of_directory_is_detected)
+{
+	filemon_watch_t *w;
+
+	assert_success(os_mkdir(SANDBOX_PATH "/dir", 0700));
+
+	w = filemon_watch_create(SANDBOX_PATH "/dir");
+	assert_non_null(w);
+
+	assert_success(rmdir(SANDBOX_PATH "/dir"));
+
+	assert_false(filemon_watch_poll(w) == FMS_UNCHANGED);
+
+	filemon_watch_free(w);
+}
+
+TEST(watchers_of_the_same_directory_are_independent)
+{
+	FILE *f;
+	filemon_watch_t *const w1 = filemon_watch_create(SANDBOX_PATH);
+	filemon_watch_t *const w2 = filemon_watch_create(SANDBOX_PATH);
+	assert_non_null(w1);
+	assert_non_null(w2);
+
+	if(filemon_watch_is_precise(w1) && filemon_watch_is_precise(w2))
+	{
+		f = fopen(SANDBOX_PATH "/file", "w");
+		assert_non_null(f);
+		fclose(f);
+
+		/* Polling of one watcher doesn't steal events of another one. */
+		assert_int_equal(FMS_UPDATED, filemon_watch_poll(w1));
+		assert_int_equal(FMS_UPDATED, filemon_watch_poll(w2));
+
+		/* Removing one watcher doesn't remove watch of the other. */
+		filemon_watch_free(w1);
+		assert_success(unlink(SANDBOX_PATH "/file"));
+		assert_int_equal(FMS_UPDATED, filemon_watch_poll(w2));
+	}
+	else
+	{
+		filemon_watch_free(w1);
+	}
+
+	filemon_watch_free(w2);
+	(void)unlink(SANDBOX_PATH "/file");
+}
+
+TEST(reset_drops_changes)
+{
+	FILE *f;
+	filemon_watch_t *const w = filemon_watch_create(SANDBOX_PATH);
+	assert_non_null(w);
+
+	if(filemon_watch_is_precise(w))
+	{
+		f = fopen(SANDBOX_PATH "/file", "w");
+		assert_non_null(f);
+		fclose(f);
+
+		assert_success(filemon_watch_reset(w, SANDBOX_PATH));
+		assert_int_equal(FMS_UNCHANGED, filemon_watch_poll(w));
+		assert_success(unlink(SANDBOX_PATH "/file"));
+	}
+
+	assert_failure(filemon_watch_reset(w, SANDBOX_PATH "/.."));
+
+	filemon_watch_free(w);
+}
+
+TEST(reset_fails_for_removed_directory)
+{
+	filemon_watch_t *w;
+
+	assert_success(os_mkdir(SANDBOX_PATH "/dir", 0700));
+	w = filemon_watch_create(SANDBOX_PATH "/dir");
+	assert_non_null(w);
+	assert_success(rmdir(SANDBOX_PATH "/dir"));
+
+	assert_failure(filemon_watch_reset(w, SANDBOX_PATH "/dir"));
+
+	filemon_watch_free(w);
+}
+
+TEST(descriptor_becomes_readable_on_changes)
+{
+	FILE *f;
+	filemon_watch_t *const w = filemon_watch_create(SANDBOX_PATH);
+	assert_non_null(w);
+
+	if(filemon_watch_is_precise(w))
+	{
+		struct pollfd pfd = { .fd = filemon_watch_fd(), .events = POLLIN };
+		assert_true(pfd.fd != -1);
+
+		assert_int_equal(0, poll(&pfd, 1, 0));
+
+		f = fopen(SANDBOX_PATH "/file", "w");
+		assert_non_null(f);
+		fclose(f);
+
+		assert_int_equal(1, poll(&pfd, 1, 0));
+		filemon_watch_read_events();
+		assert_int_equal(0, poll(&pfd, 1, 0));
+
+		/* Events are kept until watcher is polled. */
+		assert_int_equal(FMS_UPDATED, filemon_watch_poll(w));
+		assert_success(unlink(SANDBOX_PATH "/file"));
+	}
+
+	filemon_watch_free(w);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
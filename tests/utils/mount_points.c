@@ -0,0 +1,156 @@
+#include <stic.h>
+
+#ifndef _WIN32
+
+#include <stdlib.h> /* free() */
+#include <string.h> /* strcmp() strdup() strlen() */
+
+#include "../../src/cfg/config.h"
+#include "../../src/utils/fs_limits.h"
+#include "../../src/utils/mntent.h"
+#include "../../src/utils/path.h"
+#include "../../src/utils/utils.h"
+
+/* State of brute force search of mount point of a path. */
+typedef struct
+{
+	const char *path; /* Path whose mount point is being looked up. */
+	char *mount_point; /* Mount point found so far or NULL. */
+	char *fs_type;     /* Type of file system of the mount point or NULL. */
+}
+lookup_t;
+
+static int count_entries(struct mntent *entry, void *arg);
+static int find_longest(struct mntent *entry, void *arg);
+static int stop_traversal(struct mntent *entry, void *arg);
+static void check_path(const char path[]);
+
+SETUP()
+{
+	cfg.slow_fs_list = strdup("");
+}
+
+TEARDOWN()
+{
+	free(cfg.slow_fs_list);
+	cfg.slow_fs_list = NULL;
+}
+
+TEST(lookup_matches_longest_prefix_among_entries)
+{
+	int count = 0;
+
+	check_path("/");
+	check_path("/no/such/path");
+	check_path("/proc/self");
+	check_path("/dev/null");
+	check_path("/sys/kernel");
+
+	assert_success(traverse_mount_points(&count_entries, &count));
+	assert_true(count > 0);
+}
+
+TEST(fs_type_of_mount_point_is_slow_when_listed)
+{
+	lookup_t lookup = { .path = "/", .mount_point = NULL, .fs_type = NULL };
+	assert_success(traverse_mount_points(&find_longest, &lookup));
+
+	if(lookup.fs_type != NULL)
+	{
+		free(cfg.slow_fs_list);
+		cfg.slow_fs_list = lookup.fs_type;
+		lookup.fs_type = NULL;
+		assert_true(is_on_slow_fs("/"));
+	}
+
+	free(lookup.mount_point);
+	free(lookup.fs_type);
+}
+
+TEST(traversal_is_stopped_by_client)
+{
+	int count = 0;
+	assert_success(traverse_mount_points(&stop_traversal, &count));
+	assert_int_equal(1, count);
+}
+
+TEST(repeated_lookups_are_consistent)
+{
+	char first[PATH_MAX], second[PATH_MAX];
+	int i;
+
+	assert_success(get_mount_point("/", sizeof(first), first));
+	for(i = 0; i < 100; ++i)
+	{
+		assert_success(get_mount_point("/", sizeof(second), second));
+		assert_string_equal(first, second);
+	}
+}
+
+/* traverse_mount_points() client that counts entries. */
+static int
+count_entries(struct mntent *entry, void *arg)
+{
+	++*(int *)arg;
+	return 0;
+}
+
+/* traverse_mount_points() client that finds the first entry with the longest
+ * mount point that's a prefix of the path. */
+static int
+find_longest(struct mntent *entry, void *arg)
+{
+	lookup_t *const lookup = arg;
+
+	if(!path_starts_with(lookup->path, entry->mnt_dir))
+	{
+		return 0;
+	}
+
+	if(lookup->mount_point == NULL ||
+			strlen(entry->mnt_dir) > strlen(lookup->mount_point))
+	{
+		free(lookup->mount_point);
+		free(lookup->fs_type);
+		lookup->mount_point = strdup(entry->mnt_dir);
+		lookup->fs_type = strdup(entry->mnt_type);
+	}
+	return 0;
+}
+
+/* traverse_mount_points() client that stops after the first entry. */
+static int
+stop_traversal(struct mntent *entry, void *arg)
+{
+	++*(int *)arg;
+	return 1;
+}
+
+/* Checks that get_mount_point() agrees with linear search over all mount
+ * entries. */
+static void
+check_path(const char path[])
+{
+	char buf[PATH_MAX];
+	lookup_t lookup = { .path = path, .mount_point = NULL, .fs_type = NULL };
+
+	assert_success(traverse_mount_points(&find_longest, &lookup));
+
+	if(lookup.mount_point == NULL)
+	{
+		assert_failure(get_mount_point(path, sizeof(buf), buf));
+	}
+	else
+	{
+		assert_success(get_mount_point(path, sizeof(buf), buf));
+		assert_string_equal(lookup.mount_point, buf);
+	}
+
+	free(lookup.mount_point);
+	free(lookup.fs_type);
+}
+
+#endif
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
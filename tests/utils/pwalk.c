@@ -0,0 +1,278 @@
+#include <stic.h>
+
+#include <unistd.h> /* rmdir() unlink() */
+
+#include <stdint.h> /* uint64_t */
+#include <stdio.h> /* FILE fclose() fopen() fputc() snprintf() */
+#include <string.h> /* strcmp() */
+
+#include "../../src/compat/os.h"
+#include "../../src/utils/dcache.h"
+#include "../../src/utils/pwalk.h"
+
+#define SANDBOX_PATH "test-data/sandbox"
+#define ROOT SANDBOX_PATH "/root"
+
+/* Number of directories with a single file at the top level. */
+#define DIR_COUNT 50
+
+static void create_file(const char path[], int size);
+static int count_entries(const char path[], PWalkEntry type, uint64_t size,
+		void *arg);
+static int cancel_walk(const char path[], PWalkEntry type, uint64_t size,
+		void *arg);
+static int walk_nested(const char path[], PWalkEntry type, uint64_t size,
+		void *arg);
+static int lookup_sub1(const char path[], uint64_t *size, void *arg);
+static void store_size(const char path[], uint64_t size, void *arg);
+
+/* Counters of visited entries. */
+static int dirs, files, links;
+
+SETUP()
+{
+	int i;
+
+	dirs = 0;
+	files = 0;
+	links = 0;
+
+	assert_success(os_mkdir(ROOT, 0700));
+	assert_success(os_mkdir(ROOT "/sub1", 0700));
+	assert_success(os_mkdir(ROOT "/sub1/sub2", 0700));
+	assert_success(os_mkdir(ROOT "/sub3", 0700));
+	create_file(ROOT "/a", 10);
+	create_file(ROOT "/sub1/b", 20);
+	create_file(ROOT "/sub1/sub2/c", 30);
+
+	for(i = 0; i < DIR_COUNT; ++i)
+	{
+		char path[64];
+
+		snprintf(path, sizeof(path), "%s/d%d", ROOT, i);
+		assert_success(os_mkdir(path, 0700));
+
+		snprintf(path, sizeof(path), "%s/d%d/f", ROOT, i);
+		create_file(path, i);
+	}
+}
+
+TEARDOWN()
+{
+	int i;
+
+	for(i = 0; i < DIR_COUNT; ++i)
+	{
+		char path[64];
+
+		snprintf(path, sizeof(path), "%s/d%d/f", ROOT, i);
+		assert_success(unlink(path));
+
+		snprintf(path, sizeof(path), "%s/d%d", ROOT, i);
+		assert_success(rmdir(path));
+	}
+
+	assert_success(unlink(ROOT "/sub1/sub2/c"));
+	assert_success(unlink(ROOT "/sub1/b"));
+	assert_success(unlink(ROOT "/a"));
+	assert_success(rmdir(ROOT "/sub3"));
+	assert_success(rmdir(ROOT "/sub1/sub2"));
+	assert_success(rmdir(ROOT "/sub1"));
+	assert_success(rmdir(ROOT));
+}
+
+TEST(unreadable_root_is_an_error)
+{
+	const pwalk_params_t params = { .nworkers = 2 };
+	assert_true(pwalk(ROOT "/does-not-exist", &params, NULL) < 0);
+}
+
+TEST(sizes_and_counts_are_summed_up)
+{
+	const pwalk_params_t params = { .nworkers = 4 };
+	pwalk_stats_t stats;
+
+	assert_success(pwalk(ROOT, &params, &stats));
+
+	assert_int_equal(10 + 20 + 30 + DIR_COUNT*(DIR_COUNT - 1)/2, stats.bytes);
+	assert_int_equal(3 + DIR_COUNT, stats.files);
+	assert_int_equal(4 + DIR_COUNT, stats.dirs);
+}
+
+TEST(single_worker_produces_the_same_result)
+{
+	const pwalk_params_t params = { .nworkers = 1 };
+	pwalk_stats_t stats;
+
+	assert_success(pwalk(ROOT, &params, &stats));
+
+	assert_int_equal(10 + 20 + 30 + DIR_COUNT*(DIR_COUNT - 1)/2, stats.bytes);
+	assert_int_equal(3 + DIR_COUNT, stats.files);
+	assert_int_equal(4 + DIR_COUNT, stats.dirs);
+}
+
+TEST(sizes_of_all_directories_are_stored)
+{
+	dcache_t *const cache = dcache_create();
+	const pwalk_params_t params = {
+		.nworkers = 4,
+		.store = &store_size,
+		.arg = cache,
+	};
+	uint64_t size;
+
+	assert_success(pwalk(ROOT, &params, NULL));
+
+	assert_success(dcache_get(cache, ROOT, &size));
+	assert_int_equal(10 + 20 + 30 + DIR_COUNT*(DIR_COUNT - 1)/2, size);
+	assert_success(dcache_get(cache, ROOT "/sub1", &size));
+	assert_int_equal(50, size);
+	assert_success(dcache_get(cache, ROOT "/sub1/sub2", &size));
+	assert_int_equal(30, size);
+	assert_success(dcache_get(cache, ROOT "/sub3", &size));
+	assert_int_equal(0, size);
+	assert_success(dcache_get(cache, ROOT "/d10", &size));
+	assert_int_equal(10, size);
+
+	dcache_free(cache);
+}
+
+TEST(known_sizes_are_not_walked)
+{
+	const pwalk_params_t params = { .nworkers = 4, .lookup = &lookup_sub1 };
+	pwalk_stats_t stats;
+
+	assert_success(pwalk(ROOT, &params, &stats));
+
+	assert_int_equal(10 + 100 + DIR_COUNT*(DIR_COUNT - 1)/2, stats.bytes);
+	assert_int_equal(1 + DIR_COUNT, stats.files);
+	assert_int_equal(2 + DIR_COUNT, stats.dirs);
+}
+
+TEST(every_entry_is_visited)
+{
+	const pwalk_params_t params = { .nworkers = 4, .visit = &count_entries };
+
+	assert_success(pwalk(ROOT, &params, NULL));
+
+	assert_int_equal(4 + DIR_COUNT, dirs);
+	assert_int_equal(3 + DIR_COUNT, files);
+	assert_int_equal(0, links);
+}
+
+#ifndef _WIN32
+
+TEST(symbolic_links_are_not_followed)
+{
+	const pwalk_params_t params = { .nworkers = 4, .visit = &count_entries };
+
+	assert_success(symlink("sub1", ROOT "/link"));
+	assert_success(pwalk(ROOT, &params, NULL));
+	assert_success(unlink(ROOT "/link"));
+
+	assert_int_equal(4 + DIR_COUNT, dirs);
+	assert_int_equal(3 + DIR_COUNT, files);
+	assert_int_equal(1, links);
+}
+
+#endif
+
+TEST(visitor_can_cancel_walk)
+{
+	const pwalk_params_t params = { .nworkers = 4, .visit = &cancel_walk };
+
+	assert_int_equal(1, pwalk(ROOT, &params, NULL));
+	assert_int_equal(1, dirs + files);
+}
+
+TEST(nested_walks_run_out_of_shared_workers)
+{
+	/* Inner walks are started while outer one holds workers. */
+	const pwalk_params_t params = { .nworkers = 64, .visit = &walk_nested };
+	pwalk_stats_t stats;
+
+	assert_success(pwalk(ROOT, &params, &stats));
+	assert_int_equal(4 + DIR_COUNT, stats.dirs);
+	assert_int_equal(4 + DIR_COUNT, dirs);
+}
+
+/* Creates file of specified size. */
+static void
+create_file(const char path[], int size)
+{
+	FILE *const f = fopen(path, "w");
+	assert_non_null(f);
+	while(size-- > 0)
+	{
+		fputc('x', f);
+	}
+	fclose(f);
+}
+
+/* Counts visited entries by their type.  Returns zero. */
+static int
+count_entries(const char path[], PWalkEntry type, uint64_t size, void *arg)
+{
+	switch(type)
+	{
+		case PWE_DIR:
+			++dirs;
+			break;
+		case PWE_FILE:
+			++files;
+			break;
+		case PWE_LINK:
+			++links;
+			break;
+		case PWE_FAIL:
+			break;
+	}
+	return 0;
+}
+
+/* Counts the first visited entry and cancels the walk.  Returns non-zero. */
+static int
+cancel_walk(const char path[], PWalkEntry type, uint64_t size, void *arg)
+{
+	++files;
+	return 1;
+}
+
+/* Walks each visited directory and checks that the walk isn't affected by the
+ * outer one.  Returns zero. */
+static int
+walk_nested(const char path[], PWalkEntry type, uint64_t size, void *arg)
+{
+	if(type == PWE_DIR)
+	{
+		const pwalk_params_t params = { .nworkers = 64 };
+		pwalk_stats_t stats;
+		assert_success(pwalk(path, &params, &stats));
+		assert_true(stats.dirs > 0);
+		++dirs;
+	}
+	return 0;
+}
+
+/* Pretends that size of sub1 directory is known.  Returns zero for it,
+ * otherwise non-zero is returned. */
+static int
+lookup_sub1(const char path[], uint64_t *size, void *arg)
+{
+	if(strcmp(path, ROOT "/sub1") == 0)
+	{
+		*size = 100;
+		return 0;
+	}
+	return 1;
+}
+
+/* Puts size of directory into the cache.  Called from worker threads. */
+static void
+store_size(const char path[], uint64_t size, void *arg)
+{
+	(void)dcache_set(arg, path, size);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -0,0 +1,134 @@
+#include <stic.h>
+
+#include <stdio.h> /* snprintf() */
+#include <stdlib.h> /* free() */
+#include <string.h> /* strdup() */
+
+#include "../../src/utils/tree.h"
+
+static tree_t tree;
+
+SETUP()
+{
+	tree = tree_create(0, 0);
+}
+
+TEARDOWN()
+{
+	tree_free(tree);
+}
+
+TEST(paths_are_not_required_to_exist)
+{
+	tree_val_t data = 0;
+
+	assert_success(tree_set_data(tree, "/no/such/path", 10));
+	assert_success(tree_get_data(tree, "/no/such/path", &data));
+	assert_int_equal(10, data);
+}
+
+TEST(absent_path_is_an_error)
+{
+	tree_val_t data = 5;
+
+	assert_success(tree_set_data(tree, "/a/b", 10));
+	assert_failure(tree_get_data(tree, "/a", &data));
+	assert_failure(tree_get_data(tree, "/a/b/c", &data));
+	assert_int_equal(5, data);
+}
+
+TEST(extra_slashes_are_ignored)
+{
+	tree_val_t data = 0;
+
+	assert_success(tree_set_data(tree, "/a//b/", 10));
+	assert_success(tree_get_data(tree, "/a/b", &data));
+	assert_int_equal(10, data);
+}
+
+TEST(paths_are_not_resolved)
+{
+	tree_val_t data = 0;
+
+	assert_success(tree_set_data(tree, "/a/../b", 10));
+	assert_failure(tree_get_data(tree, "/b", &data));
+	assert_success(tree_get_data(tree, "/a/../b", &data));
+	assert_int_equal(10, data);
+}
+
+TEST(many_siblings_are_found)
+{
+	int i;
+
+	for(i = 0; i < 1000; ++i)
+	{
+		char path[32];
+		snprintf(path, sizeof(path), "/dir/%d", i);
+		assert_success(tree_set_data(tree, path, i));
+	}
+
+	for(i = 0; i < 1000; ++i)
+	{
+		char path[32];
+		tree_val_t data = -1;
+		snprintf(path, sizeof(path), "/dir/%d", i);
+		assert_success(tree_get_data(tree, path, &data));
+		assert_int_equal(i, data);
+	}
+}
+
+TEST(longest_match_is_found)
+{
+	tree_t longest = tree_create(1, 0);
+	tree_val_t data = 0;
+
+	assert_success(tree_set_data(longest, "/a", 1));
+	assert_success(tree_set_data(longest, "/a/b/c", 3));
+
+	assert_success(tree_get_data(longest, "/a/b", &data));
+	assert_int_equal(1, data);
+	assert_success(tree_get_data(longest, "/a/b/c/d", &data));
+	assert_int_equal(3, data);
+	assert_failure(tree_get_data(longest, "/b", &data));
+
+	tree_free(longest);
+}
+
+TEST(root_is_the_shortest_match)
+{
+	tree_t longest = tree_create(1, 0);
+	tree_val_t data = 0;
+
+	assert_success(tree_set_data(longest, "/", 1));
+	assert_success(tree_set_data(longest, "/a", 2));
+
+	assert_success(tree_get_data(longest, "/b/c", &data));
+	assert_int_equal(1, data);
+	assert_success(tree_get_data(longest, "/a/c", &data));
+	assert_int_equal(2, data);
+
+	tree_free(longest);
+}
+
+TEST(values_of_mem_tree_are_freed)
+{
+	tree_t mem = tree_create(0, 1);
+	union
+	{
+		char *s;
+		tree_val_t l;
+	}
+	u = { .s = strdup("first") };
+
+	assert_success(tree_set_data(mem, "/a", u.l));
+	u.s = strdup("second");
+	assert_success(tree_set_data(mem, "/a", u.l));
+
+	assert_success(tree_get_data(mem, "/a", &u.l));
+	assert_string_equal("second", u.s);
+
+	tree_free(mem);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */